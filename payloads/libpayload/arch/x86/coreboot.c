@@ -198,6 +198,12 @@ static void cb_parse_x86_rom_var_mtrr(void *ptr, struct sysinfo_t *info)
 	info->x86_rom_var_mtrr_index = rom_mtrr->index;
 }
 
+static void cb_parse_tsc_info(void *ptr, struct sysinfo_t *info)
+{
+	struct cb_tsc_info *tsc_info = ptr;
+	info->cpu_khz = tsc_info->freq_khz;
+}
+
 static void cb_parse_string(unsigned char *ptr, char **info)
 {
 	*info = (char *)((struct cb_string *)ptr)->string;
@@ -327,6 +333,9 @@ static int cb_parse_header(void *addr, int len, struct sysinfo_t *info)
 		case CB_TAG_X86_ROM_MTRR:
 			cb_parse_x86_rom_var_mtrr(ptr, info);
 			break;
+		case CB_TAG_TSC_INFO:
+			cb_parse_tsc_info(ptr, info);
+			break;
 		}
 
 		ptr += rec->size;
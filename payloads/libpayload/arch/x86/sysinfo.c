@@ -49,8 +49,8 @@ int lib_get_sysinfo(void)
 {
 	int ret;
 
-	/* Get the CPU speed (for delays). */
-	lib_sysinfo.cpu_khz = get_cpu_speed();
+	/* coreboot may pass on the CPU speed (for delays). */
+	lib_sysinfo.cpu_khz = 0;
 
 #ifdef CONFIG_LP_MULTIBOOT
 	/* Get the information from the multiboot tables,
@@ -63,6 +63,10 @@ int lib_get_sysinfo(void)
 
 	ret = get_coreboot_info(&lib_sysinfo);
 
+	/* Otherwise measure it, this takes a few milliseconds. */
+	if (!lib_sysinfo.cpu_khz)
+		lib_sysinfo.cpu_khz = get_cpu_speed();
+
 	if (!lib_sysinfo.n_memranges) {
 		/* If we can't get a good memory range, use the default. */
 		lib_sysinfo.n_memranges = 2;
@@ -243,5 +243,10 @@ void PDC_transform_line(int lineno, int x, int len, const chtype *srcp)
 	}
 #endif
     }
+
+#ifdef CONFIG_LP_VIDEO_CONSOLE
+    if (curses_flags & F_ENABLE_CONSOLE)
+        video_console_flush();
+#endif
 }
 
@@ -167,6 +167,237 @@ char sprintf_tmp[1024];
 
 int curses_flags = (F_ENABLE_CONSOLE | F_ENABLE_SERIAL);
 
+#ifdef CONFIG_LP_SERIAL_CONSOLE
+/*
+ * What the serial terminal shows, so that a refresh only sends the cells
+ * that really changed. A cell is the character that was sent in the low
+ * byte plus the attributes it was sent with, reduced to what the terminal
+ * understands.
+ */
+#define SERIAL_BOLD		(1 << 8)
+#define SERIAL_REVERSE		(1 << 9)
+#define SERIAL_ALTCHARSET	(1 << 10)
+#define SERIAL_COLOR		(1 << 11)	/* Not the terminal's default. */
+#define SERIAL_COLORS(c)	((c) << 16)	/* As in color_pairs[]. */
+#define SERIAL_ATTRS		(~0xffU)
+
+/* Never a cell or attributes that tinycurses sends. */
+#define SERIAL_UNKNOWN		(~0U)
+
+static struct {
+	unsigned int cells[SCREEN_Y][SCREEN_X];
+	int y, x;		/* The cursor, y < 0 if unknown. */
+	unsigned int attr;	/* The attributes the next character gets. */
+} term;
+
+static void term_puts(const char *str)
+{
+	while (*str)
+		serial_putchar(*(str++));
+}
+
+static int term_digits(int n)
+{
+	int digits = 1;
+
+	while (n >= 10) {
+		n /= 10;
+		digits++;
+	}
+	return digits;
+}
+
+/* The cost of a cursor motion sequence that moves by n, see term_csi(). */
+static int term_csi_cost(int n)
+{
+	return 3 + (n > 1 ? term_digits(n) : 0);
+}
+
+static void term_csi(int n, char cmd)
+{
+	char buffer[16];
+
+	if (n > 1)
+		snprintf(buffer, sizeof(buffer), "\e[%d%c", n, cmd);
+	else
+		snprintf(buffer, sizeof(buffer), "\e[%c", cmd);
+	term_puts(buffer);
+}
+
+/* Switch to the attributes of cell, in as few bytes as possible. */
+static void term_attr(unsigned int cell)
+{
+	unsigned int attr = cell & SERIAL_ATTRS & ~SERIAL_ALTCHARSET;
+	unsigned int cur = term.attr & SERIAL_ATTRS & ~SERIAL_ALTCHARSET;
+	char buffer[32];
+	int len = 0;
+
+	if (term.attr == SERIAL_UNKNOWN ||
+	    (cur & ~attr & (SERIAL_BOLD | SERIAL_REVERSE | SERIAL_COLOR))) {
+		/* Attributes can only be turned off all together. */
+		len = snprintf(buffer, sizeof(buffer), "\e[%s",
+			       attr ? "0;" : "");
+		cur = 0;
+	}
+
+	if (attr != cur) {
+		if (!len)
+			len = snprintf(buffer, sizeof(buffer), "\e[");
+		if ((attr & SERIAL_BOLD) && !(cur & SERIAL_BOLD))
+			len += snprintf(buffer + len, sizeof(buffer) - len,
+					"1;");
+		if ((attr & SERIAL_REVERSE) && !(cur & SERIAL_REVERSE))
+			len += snprintf(buffer + len, sizeof(buffer) - len,
+					"7;");
+		if ((attr & SERIAL_COLOR) && (attr & (SERIAL_COLOR |
+		    SERIAL_COLORS(0xff))) != (cur & (SERIAL_COLOR |
+		    SERIAL_COLORS(0xff))))
+			len += snprintf(buffer + len, sizeof(buffer) - len,
+					"3%d;4%d;", (attr >> 16) & 0xf,
+					(attr >> 20) & 0xf);
+	}
+
+	if (len) {
+		/* Replace the last separator. */
+		if (buffer[len - 1] == ';')
+			len--;
+		buffer[len] = 'm';
+		buffer[len + 1] = '\0';
+		term_puts(buffer);
+	}
+
+	if (term.attr == SERIAL_UNKNOWN ||
+	    (cell & SERIAL_ALTCHARSET) != (term.attr & SERIAL_ALTCHARSET)) {
+		if (cell & SERIAL_ALTCHARSET)
+			serial_start_altcharset();
+		else
+			serial_end_altcharset();
+	}
+
+	term.attr = cell & SERIAL_ATTRS;
+}
+
+/*
+ * Returns the cost of moving the cursor from column from to column to in
+ * row y, and does it if emit is set. Moving forward over cells that already
+ * show the current attributes is done by sending them again.
+ */
+static int term_horizontal(int y, int from, int to, int emit)
+{
+	int n, x;
+
+	if (to > from) {
+		n = to - from;
+		if (n < term_csi_cost(n) && term.attr != SERIAL_UNKNOWN) {
+			for (x = from; x < to; x++)
+				if ((term.cells[y][x] & SERIAL_ATTRS) != term.attr)
+					break;
+			if (x == to) {
+				for (x = from; emit && x < to; x++)
+					serial_putchar(term.cells[y][x] & 0xff);
+				return n;
+			}
+		}
+		if (emit)
+			term_csi(n, 'C');
+		return term_csi_cost(n);
+	}
+
+	if (to < from) {
+		n = from - to;
+		if (n < term_csi_cost(n)) {
+			while (emit && n--)
+				serial_putchar('\b');
+			return from - to;
+		}
+		if (emit)
+			term_csi(n, 'D');
+		return term_csi_cost(n);
+	}
+
+	return 0;
+}
+
+static int term_vertical(int from, int to, int emit)
+{
+	if (to == from)
+		return 0;
+	if (emit)
+		term_csi(to > from ? to - from : from - to, to > from ? 'B' : 'A');
+	return term_csi_cost(to > from ? to - from : from - to);
+}
+
+/* Move the cursor the cheapest of the absolute and relative ways. */
+static void term_move(int y, int x)
+{
+	enum { MOVE_ABSOLUTE, MOVE_RELATIVE, MOVE_RETURN } how = MOVE_ABSOLUTE;
+	int best, cost;
+
+	if (y == term.y && x == term.x)
+		return;
+
+	/* "\e[y;xH" */
+	best = 4 + term_digits(y + 1) + term_digits(x + 1);
+
+	if (term.y >= 0) {
+		cost = term_vertical(term.y, y, 0) +
+		       term_horizontal(y, term.x, x, 0);
+		if (cost < best) {
+			best = cost;
+			how = MOVE_RELATIVE;
+		}
+		cost = 1 + term_vertical(term.y, y, 0) +
+		       term_horizontal(y, 0, x, 0);
+		if (cost < best) {
+			best = cost;
+			how = MOVE_RETURN;
+		}
+	}
+
+	switch (how) {
+	case MOVE_ABSOLUTE:
+		serial_set_cursor(y, x);
+		break;
+	case MOVE_RELATIVE:
+		term_vertical(term.y, y, 1);
+		term_horizontal(y, term.x, x, 1);
+		break;
+	case MOVE_RETURN:
+		serial_putchar('\r');
+		term_vertical(term.y, y, 1);
+		term_horizontal(y, 0, x, 1);
+		break;
+	}
+
+	term.y = y;
+	term.x = x;
+}
+
+static void term_put(int y, int x, unsigned int cell)
+{
+	if (y >= SCREEN_Y || x >= SCREEN_X || term.cells[y][x] == cell)
+		return;
+
+	term_move(y, x);
+	term_attr(cell);
+	serial_putchar(cell & 0xff);
+	term.cells[y][x] = cell;
+
+	/* Past the last column the cursor depends on the terminal. */
+	if (++term.x >= SCREEN_X)
+		term.y = -1;
+}
+
+static void term_invalidate(int begy, int begx, int lines, int cols)
+{
+	int y, x;
+
+	for (y = begy; y < begy + lines && y < SCREEN_Y; y++)
+		for (x = begx; x < begx + cols && x < SCREEN_X; x++)
+			term.cells[y][x] = SERIAL_UNKNOWN;
+}
+#endif
+
 /* Return bit mask for clearing color pair number if given ch has color */
 #define COLOR_MASK(ch) (~(attr_t)((ch) & A_COLOR ? A_COLOR : 0))
 
@@ -316,8 +547,17 @@ WINDOW *initscr(void)
 	for (i = 0; i < 128; i++)
 	  acs_map[i] = (chtype) i | A_ALTCHARSET;
 #ifdef CONFIG_LP_SERIAL_CONSOLE
+	term_invalidate(0, 0, SCREEN_Y, SCREEN_X);
+	term.y = -1;
+	term.attr = SERIAL_UNKNOWN;
 	if (curses_flags & F_ENABLE_SERIAL) {
+		/* Clear to the default colors, so every cell is a blank. */
+		term_attr(0);
 		serial_clear();
+		for (i = 0; i < SCREEN_Y * SCREEN_X; i++)
+			term.cells[i / SCREEN_X][i % SCREEN_X] = ' ';
+		term.y = 0;
+		term.x = 0;
 	}
 #endif
 #ifdef CONFIG_LP_VIDEO_CONSOLE
@@ -720,21 +960,23 @@ int whline(WINDOW *win, chtype ch, int n)
 int wnoutrefresh(WINDOW *win)
 {
 #ifdef CONFIG_LP_SERIAL_CONSOLE
-	// FIXME.
-	int serial_is_bold = 0;
-	int serial_is_reverse = 0;
-	int serial_is_altcharset = 0;
-	int serial_cur_pair = 0;
-
 	int need_altcharset;
-	short fg, bg;
+	unsigned int cell;
 #endif
 	int x, y;
 	chtype ch;
 
 #ifdef CONFIG_LP_SERIAL_CONSOLE
-	serial_end_bold();
-	serial_end_altcharset();
+	/* Anything may have been printed since, so find the cursor again. */
+	term.y = -1;
+
+	/* wclear() and clearok() send everything again. */
+	if (win->_clear) {
+		term_invalidate(win->_begy, win->_begx, win->_maxy + 1,
+				win->_maxx + 1);
+		wredrawln(win, 0, win->_maxy + 1);
+		win->_clear = FALSE;
+	}
 #endif
 
 	for (y = 0; y <= win->_maxy; y++) {
@@ -742,14 +984,6 @@ int wnoutrefresh(WINDOW *win)
 		if (win->_line[y].firstchar == _NOCHANGE)
 			continue;
 
-		/* Position the serial cursor */
-
-#ifdef CONFIG_LP_SERIAL_CONSOLE
-		if (curses_flags & F_ENABLE_SERIAL)
-			serial_set_cursor(win->_begy + y, win->_begx +
-					win->_line[y].firstchar);
-#endif
-
 		for (x = win->_line[y].firstchar; x <= win->_line[y].lastchar; x++) {
 			attr_t attr = win->_line[y].text[x].attr;
 
@@ -757,40 +991,6 @@ int wnoutrefresh(WINDOW *win)
 			if (curses_flags & F_ENABLE_SERIAL) {
 				ch = win->_line[y].text[x].chars[0];
 
-				if (attr & A_BOLD) {
-					if (!serial_is_bold) {
-						serial_start_bold();
-						serial_is_bold = 1;
-					}
-				} else {
-					if (serial_is_bold) {
-						serial_end_bold();
-						serial_is_bold = 0;
-						/* work around serial.c
-						 * shortcoming:
-						 */
-						serial_is_reverse = 0;
-						serial_cur_pair = 0;
-					}
-				}
-
-				if (attr & A_REVERSE) {
-					if (!serial_is_reverse) {
-						serial_start_reverse();
-						serial_is_reverse = 1;
-					}
-				} else {
-					if (serial_is_reverse) {
-						serial_end_reverse();
-						serial_is_reverse = 0;
-						/* work around serial.c
-						 * shortcoming:
-						 */
-						serial_is_bold = 0;
-						serial_cur_pair = 0;
-					}
-				}
-
 				need_altcharset = 0;
 				if (attr & A_ALTCHARSET) {
 					if (serial_acs_map[ch & 0x7f]) {
@@ -799,24 +999,19 @@ int wnoutrefresh(WINDOW *win)
 					} else
 						ch = fallback_acs_map[ch & 0x7f];
 				}
-				if (need_altcharset && !serial_is_altcharset) {
-					serial_start_altcharset();
-					serial_is_altcharset = 1;
-				}
-				if (!need_altcharset && serial_is_altcharset) {
-					serial_end_altcharset();
-					serial_is_altcharset = 0;
-				}
-
-				if (serial_cur_pair != PAIR_NUMBER(attr)) {
-					pair_content(PAIR_NUMBER(attr),
-						     &fg, &bg);
-					serial_set_color(fg, bg);
-					serial_cur_pair = PAIR_NUMBER(attr);
-				}
-
-				serial_putchar(ch);
 
+				cell = ch & 0xff;
+				if (attr & A_BOLD)
+					cell |= SERIAL_BOLD;
+				if (attr & A_REVERSE)
+					cell |= SERIAL_REVERSE;
+				if (need_altcharset)
+					cell |= SERIAL_ALTCHARSET;
+				if (PAIR_NUMBER(attr))
+					cell |= SERIAL_COLOR | SERIAL_COLORS(
+						color_pairs[PAIR_NUMBER(attr)]);
+
+				term_put(win->_begy + y, win->_begx + x, cell);
 			}
 #endif
 #ifdef CONFIG_LP_VIDEO_CONSOLE
@@ -862,12 +1057,14 @@ int wnoutrefresh(WINDOW *win)
 
 #ifdef CONFIG_LP_SERIAL_CONSOLE
 	if (curses_flags & F_ENABLE_SERIAL)
-		serial_set_cursor(win->_begy + win->_cury, win->_begx + win->_curx);
+		term_move(win->_begy + win->_cury, win->_begx + win->_curx);
 #endif
 
 #ifdef CONFIG_LP_VIDEO_CONSOLE
-	if (curses_flags & F_ENABLE_CONSOLE)
+	if (curses_flags & F_ENABLE_CONSOLE) {
 		video_console_set_cursor(win->_begx + win->_curx, win->_begy + win->_cury);
+		video_console_flush();
+	}
 #endif
 
 	return OK;
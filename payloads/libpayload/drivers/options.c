@@ -52,6 +52,41 @@ struct nvram_accessor *use_mem = &(struct nvram_accessor) {
 	mem_write
 };
 
+/*
+ * Writes collected by options_batch_begin() until options_batch_commit().
+ * Reads are served from here once a byte has been read or written, and the
+ * checksum is only recomputed when it is read or the batch is committed.
+ */
+static struct {
+	const struct nvram_accessor *nvram;
+	u8 data[256];
+	u32 loaded[256 / 32];
+	u32 dirty[256 / 32];
+	int checksum_stale;
+} batch;
+
+static u8 batch_read(u8 reg);
+static void batch_write(u8 val, u8 reg);
+
+static struct nvram_accessor batch_accessor = {
+	batch_read,
+	batch_write
+};
+
+/*
+ * A hash index over the option table, so lookups don't walk the table and
+ * compare every name. It is built on the first lookup in a table.
+ */
+struct option_index {
+	struct cb_cmos_option_table *table;
+	u32 mask;				/* Number of slots - 1. */
+	struct cb_cmos_entries **entries;	/* By name. */
+	struct cb_cmos_enums **by_value;	/* By config_id and value. */
+	struct cb_cmos_enums **by_text;		/* By config_id and text. */
+};
+
+static struct option_index opt_index;
+
 struct cb_cmos_option_table *get_system_option_table(void)
 {
 	return lib_sysinfo.option_table;
@@ -74,7 +109,7 @@ int options_checksum_valid(const struct nvram_accessor *nvram)
 	return (checksum_old == checksum);
 }
 
-void fix_options_checksum_with(const struct nvram_accessor *nvram)
+static void write_options_checksum(const struct nvram_accessor *nvram)
 {
 	int i;
 	int range_start = lib_sysinfo.cmos_range_start / 8;
@@ -90,11 +125,100 @@ void fix_options_checksum_with(const struct nvram_accessor *nvram)
 	nvram->write((checksum & 0xff), checksum_location + 1);
 }
 
+void fix_options_checksum_with(const struct nvram_accessor *nvram)
+{
+	if (nvram == &batch_accessor)
+		batch.checksum_stale = 1;
+	else
+		write_options_checksum(nvram);
+}
+
 void fix_options_checksum(void)
 {
 	fix_options_checksum_with(use_nvram);
 }
 
+static int batch_test(const u32 *bits, u8 reg)
+{
+	return bits[reg / 32] & (1 << (reg % 32));
+}
+
+static void batch_set(u32 *bits, u8 reg)
+{
+	bits[reg / 32] |= 1 << (reg % 32);
+}
+
+static u8 batch_read(u8 reg)
+{
+	int checksum_location = lib_sysinfo.cmos_checksum_location / 8;
+
+	if (batch.checksum_stale &&
+	    (reg == checksum_location || reg == checksum_location + 1)) {
+		batch.checksum_stale = 0;
+		write_options_checksum(&batch_accessor);
+	}
+
+	if (!batch_test(batch.loaded, reg)) {
+		batch.data[reg] = batch.nvram->read(reg);
+		batch_set(batch.loaded, reg);
+	}
+
+	return batch.data[reg];
+}
+
+static void batch_write(u8 val, u8 reg)
+{
+	if (batch_read(reg) == val)
+		return;
+
+	batch.data[reg] = val;
+	batch_set(batch.dirty, reg);
+}
+
+/**
+ * Start collecting option updates to nvram.
+ *
+ * Options set through the returned accessor only reach nvram with
+ * options_batch_commit(), each changed byte written once along with a
+ * single checksum update. There is one batch at a time, starting another
+ * one drops the uncommitted updates.
+ *
+ * @param nvram The accessor to write the options to.
+ * @return The accessor to pass to the option functions.
+ */
+struct nvram_accessor *options_batch_begin(const struct nvram_accessor *nvram)
+{
+	memset(&batch, 0, sizeof(batch));
+	batch.nvram = nvram;
+
+	return &batch_accessor;
+}
+
+/**
+ * Write the updates collected since options_batch_begin() to nvram.
+ *
+ * @return 0 on success, 1 if no batch was started.
+ */
+int options_batch_commit(void)
+{
+	int reg;
+
+	if (batch.nvram == NULL)
+		return 1;
+
+	if (batch.checksum_stale) {
+		batch.checksum_stale = 0;
+		write_options_checksum(&batch_accessor);
+	}
+
+	for (reg = 0; reg < ARRAY_SIZE(batch.data); reg++)
+		if (batch_test(batch.dirty, reg))
+			batch.nvram->write(batch.data[reg], reg);
+
+	batch.nvram = NULL;
+	return 0;
+}
+
 static int get_cmos_value(const struct nvram_accessor *nvram, u32 bitnum, u32 len, void *valptr)
 {
 	u8 *value = valptr;
@@ -152,23 +276,6 @@ static int set_cmos_value(const struct nvram_accessor *nvram, u32 bitnum, u32 le
 	return 0;
 }
 
-static struct cb_cmos_entries *lookup_cmos_entry(struct cb_cmos_option_table *option_table, const char *name)
-{
-	struct cb_cmos_entries *cmos_entry;
-	int len = name ? strnlen(name, CB_CMOS_MAX_NAME_LENGTH) : 0;
-
-	/* cmos entries are located right after the option table */
-	cmos_entry = first_cmos_entry(option_table);
-	while (cmos_entry) {
-		if (memcmp((const char*)cmos_entry->name, name, len) == 0)
-			return cmos_entry;
-		cmos_entry = next_cmos_entry(cmos_entry);
-	}
-
-	printf("ERROR: No such CMOS option (%s)\n", name);
-	return NULL;
-}
-
 struct cb_cmos_entries *first_cmos_entry(struct cb_cmos_option_table *option_table)
 {
 	return (struct cb_cmos_entries*)((unsigned char *)option_table + option_table->header_length);
@@ -232,33 +339,205 @@ struct cb_cmos_enums *first_cmos_enum_of_id(struct cb_cmos_option_table *option_
 	return next_cmos_enum_of_id(cmos_enum, id);
 }
 
-/* Either value or text must be NULL. Returns the field that matches "the other" for a given config_id */
-static struct cb_cmos_enums *lookup_cmos_enum_core(struct cb_cmos_option_table *option_table, int config_id, const u8 *value, const char *text)
+static u32 hash_bytes(u32 hash, const void *data, size_t len)
 {
-	int len = strnlen(text, CB_CMOS_MAX_TEXT_LENGTH);
+	const u8 *p = data;
 
-	/* cmos enums are located after cmos entries. */
+	/* FNV-1a */
+	while (len--) {
+		hash ^= *p++;
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+static u32 hash_name(const char *name)
+{
+	return hash_bytes(0x811c9dc5, name,
+			  strnlen(name, CB_CMOS_MAX_NAME_LENGTH));
+}
+
+static u32 hash_value(u32 config_id, u32 value)
+{
+	return hash_bytes(hash_bytes(0x811c9dc5, &config_id, sizeof(config_id)),
+			  &value, sizeof(value));
+}
+
+static u32 hash_text(u32 config_id, const char *text)
+{
+	return hash_bytes(hash_bytes(0x811c9dc5, &config_id, sizeof(config_id)),
+			  text, strnlen(text, CB_CMOS_MAX_TEXT_LENGTH));
+}
+
+static int same_name(const struct cb_cmos_entries *cmos_entry, const char *name)
+{
+	return strncmp((const char *)cmos_entry->name, name,
+		       CB_CMOS_MAX_NAME_LENGTH) == 0;
+}
+
+static int same_text(const struct cb_cmos_enums *cmos_enum, u32 config_id,
+		     const char *text)
+{
+	return cmos_enum->config_id == config_id &&
+	       strncmp((const char *)cmos_enum->text, text,
+		       CB_CMOS_MAX_TEXT_LENGTH) == 0;
+}
+
+/* The first of equal keys is kept, like the walk through the table finds. */
+static void index_entry(struct option_index *idx,
+			struct cb_cmos_entries *cmos_entry)
+{
+	u32 i = hash_name((const char *)cmos_entry->name);
+
+	for (; idx->entries[i & idx->mask]; i++)
+		if (same_name(idx->entries[i & idx->mask],
+			      (const char *)cmos_entry->name))
+			return;
+	idx->entries[i & idx->mask] = cmos_entry;
+}
+
+static void index_enum(struct option_index *idx, struct cb_cmos_enums *cmos_enum)
+{
+	struct cb_cmos_enums *e;
+	u32 i;
+
+	for (i = hash_value(cmos_enum->config_id, cmos_enum->value);
+	     (e = idx->by_value[i & idx->mask]); i++)
+		if (e->config_id == cmos_enum->config_id &&
+		    e->value == cmos_enum->value)
+			break;
+	if (e == NULL)
+		idx->by_value[i & idx->mask] = cmos_enum;
+
+	for (i = hash_text(cmos_enum->config_id, (const char *)cmos_enum->text);
+	     (e = idx->by_text[i & idx->mask]); i++)
+		if (same_text(e, cmos_enum->config_id,
+			      (const char *)cmos_enum->text))
+			break;
+	if (e == NULL)
+		idx->by_text[i & idx->mask] = cmos_enum;
+}
+
+static struct option_index *get_option_index(struct cb_cmos_option_table *option_table)
+{
+	struct option_index *idx = &opt_index;
+	struct cb_cmos_entries *cmos_entry;
 	struct cb_cmos_enums *cmos_enum;
-	for (   cmos_enum = first_cmos_enum_of_id(option_table, config_id);
-		cmos_enum;
-		cmos_enum = next_cmos_enum_of_id(cmos_enum, config_id)) {
-		if (((value == NULL) || (cmos_enum->value == *value)) &&
-		    ((text == NULL) || (memcmp((const char*)cmos_enum->text, text, len) == 0))) {
-			return cmos_enum;
-		}
+	u32 count = 0, slots;
+
+	if (idx->table == option_table)
+		return idx;
+
+	free(idx->entries);
+	free(idx->by_value);
+	free(idx->by_text);
+	memset(idx, 0, sizeof(*idx));
+
+	for (cmos_entry = first_cmos_entry(option_table); cmos_entry;
+	     cmos_entry = next_cmos_entry(cmos_entry))
+		count++;
+	for (cmos_enum = first_cmos_enum(option_table); cmos_enum &&
+	     cmos_enum->tag == CB_TAG_OPTION_ENUM;
+	     cmos_enum = next_cmos_enum(cmos_enum))
+		count++;
+
+	/* Keep the tables at most half full. */
+	for (slots = 16; slots < 2 * count; slots *= 2)
+		;
+
+	idx->entries = calloc(slots, sizeof(*idx->entries));
+	idx->by_value = calloc(slots, sizeof(*idx->by_value));
+	idx->by_text = calloc(slots, sizeof(*idx->by_text));
+	if (!idx->entries || !idx->by_value || !idx->by_text) {
+		free(idx->entries);
+		free(idx->by_value);
+		free(idx->by_text);
+		memset(idx, 0, sizeof(*idx));
+		return NULL;
+	}
+	idx->mask = slots - 1;
+
+	for (cmos_entry = first_cmos_entry(option_table); cmos_entry;
+	     cmos_entry = next_cmos_entry(cmos_entry))
+		index_entry(idx, cmos_entry);
+	for (cmos_enum = first_cmos_enum(option_table); cmos_enum &&
+	     cmos_enum->tag == CB_TAG_OPTION_ENUM;
+	     cmos_enum = next_cmos_enum(cmos_enum))
+		index_enum(idx, cmos_enum);
+
+	idx->table = option_table;
+	return idx;
+}
+
+static struct cb_cmos_entries *lookup_cmos_entry(struct cb_cmos_option_table *option_table, const char *name)
+{
+	struct option_index *idx = get_option_index(option_table);
+	struct cb_cmos_entries *cmos_entry;
+	u32 i;
+
+	if (name == NULL)
+		return NULL;
+
+	if (idx) {
+		for (i = hash_name(name); (cmos_entry = idx->entries[i & idx->mask]); i++)
+			if (same_name(cmos_entry, name))
+				return cmos_entry;
+	} else {
+		for (cmos_entry = first_cmos_entry(option_table); cmos_entry;
+		     cmos_entry = next_cmos_entry(cmos_entry))
+			if (same_name(cmos_entry, name))
+				return cmos_entry;
 	}
 
+	printf("ERROR: No such CMOS option (%s)\n", name);
 	return NULL;
 }
 
 static struct cb_cmos_enums *lookup_cmos_enum_by_value(struct cb_cmos_option_table *option_table, int config_id, const u8 *value)
 {
-	return lookup_cmos_enum_core(option_table, config_id, value, NULL);
+	struct option_index *idx = get_option_index(option_table);
+	struct cb_cmos_enums *cmos_enum;
+	u32 i;
+
+	if (idx == NULL) {
+		for (cmos_enum = first_cmos_enum_of_id(option_table, config_id);
+		     cmos_enum;
+		     cmos_enum = next_cmos_enum_of_id(cmos_enum, config_id))
+			if (cmos_enum->value == *value)
+				return cmos_enum;
+		return NULL;
+	}
+
+	for (i = hash_value(config_id, *value);
+	     (cmos_enum = idx->by_value[i & idx->mask]); i++)
+		if (cmos_enum->config_id == config_id &&
+		    cmos_enum->value == *value)
+			return cmos_enum;
+
+	return NULL;
 }
 
 static struct cb_cmos_enums *lookup_cmos_enum_by_label(struct cb_cmos_option_table *option_table, int config_id, const char *label)
 {
-	return lookup_cmos_enum_core(option_table, config_id, NULL, label);
+	struct option_index *idx = get_option_index(option_table);
+	struct cb_cmos_enums *cmos_enum;
+	u32 i;
+
+	if (idx == NULL) {
+		for (cmos_enum = first_cmos_enum_of_id(option_table, config_id);
+		     cmos_enum;
+		     cmos_enum = next_cmos_enum_of_id(cmos_enum, config_id))
+			if (same_text(cmos_enum, config_id, label))
+				return cmos_enum;
+		return NULL;
+	}
+
+	for (i = hash_text(config_id, label);
+	     (cmos_enum = idx->by_text[i & idx->mask]); i++)
+		if (same_text(cmos_enum, config_id, label))
+			return cmos_enum;
+
+	return NULL;
 }
 
 int get_option_with(const struct nvram_accessor *nvram, struct cb_cmos_option_table *option_table, void *dest, const char *name)
@@ -333,6 +612,10 @@ int get_option_as_string(const struct nvram_accessor *nvram, struct cb_cmos_opti
 			break;
 		case 'e':
 			cmos_enum = lookup_cmos_enum_by_value(option_table, cmos_entry->config_id, (u8*)raw);
+			if (!cmos_enum) {
+				ret = 1;
+				break;
+			}
 			*dest = strdup((const char*)cmos_enum->text);
 			break;
 		default: /* fail */
@@ -361,6 +644,8 @@ int set_option_from_string(const struct nvram_accessor *nvram, struct cb_cmos_op
 			break;
 		case 'e':
 			cmos_enum = lookup_cmos_enum_by_label(option_table, cmos_entry->config_id, value);
+			if (!cmos_enum)
+				return 1;
 			raw = malloc(sizeof(u32));
 			*(u32*)raw = cmos_enum->value;
 			break;
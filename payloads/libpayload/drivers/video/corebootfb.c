@@ -61,45 +61,233 @@ static const u32 vga_colors[] = {
 	(0xFF << 16) | (0xFF << 8) | 0xFF,
 };
 
+/*
+ * The framebuffer is never read back, it is slow write-combined memory.
+ * Instead the cells it shows are kept next to the cells it should show, and
+ * updates only mark the rows they touch. corebootfb_flush() then redraws
+ * the cells that differ, so scrolling and clearing cost nothing until the
+ * output is flushed, and then only the cells that actually changed.
+ */
+struct dirty_span {
+	u16 first;
+	u16 last;
+};
+
 /* Addresses for the various components */
 static unsigned long fbinfo;
 static unsigned long fbaddr;
-static unsigned long chars;
+static unsigned long chars;	/* What the console should show. */
+static unsigned long shown;	/* What the framebuffer shows. */
+static unsigned long dirty;	/* Per row the columns that may differ. */
+static int dirty_rows;
+/* Without memory for the grids, draw straight into the framebuffer. */
+static int direct;
 
 #define FI ((struct cb_framebuffer *) phys_to_virt(fbinfo))
 #define FB ((unsigned char *) phys_to_virt(fbaddr))
 #define CHARS ((unsigned short *) phys_to_virt(chars))
+#define SHOWN ((unsigned short *) phys_to_virt(shown))
+#define DIRTY ((struct dirty_span *) phys_to_virt(dirty))
 
-static void corebootfb_scroll_up(void)
+#define BLANK (VGA_COLOR_DEFAULT << 8)
+
+/*
+ * Glyph rows expanded to pixels for the last few colour pairs. Eight pixels
+ * of up to four bytes each are four 64 bit stores.
+ */
+#define COLOR_SLOTS 4
+static struct {
+	int attr;
+	u64 rows[256][4];
+} expanded[COLOR_SLOTS];
+static int next_slot;
+
+static u32 corebootfb_pixel(unsigned int color)
 {
-	unsigned char *dst = FB;
-	unsigned char *src = FB + (FI->bytes_per_line * FONT_HEIGHT);
-	int y;
+	const struct cb_framebuffer *fi = FI;
 
-	/* Scroll all lines up */
-	for(y = 0; y < FI->y_resolution - FONT_HEIGHT; y++) {
-		memcpy(dst, src, FI->x_resolution * (FI->bits_per_pixel >> 3));
+	if (fi->bits_per_pixel == 8) /* Indexed */
+		return color;
+
+	return ((((vga_colors[color] >> 0) & 0xff) >> (8 - fi->blue_mask_size)) << fi->blue_mask_pos) |
+		((((vga_colors[color] >> 8) & 0xff) >> (8 - fi->green_mask_size)) << fi->green_mask_pos) |
+		((((vga_colors[color] >> 16) & 0xff) >> (8 - fi->red_mask_size)) << fi->red_mask_pos);
+}
 
-		dst += FI->bytes_per_line;
-		src += FI->bytes_per_line;
+static u64 (*corebootfb_glyph_rows(unsigned int attr))[4]
+{
+	int bytes = FI->bits_per_pixel >> 3;
+	u32 fgval = corebootfb_pixel(attr & 0xf);
+	u32 bgval = corebootfb_pixel((attr >> 4) & 0xf);
+	int slot, bits, x, i;
+
+	for (slot = 0; slot < COLOR_SLOTS; slot++)
+		if (expanded[slot].attr == attr)
+			return expanded[slot].rows;
+
+	slot = next_slot;
+	next_slot = (next_slot + 1) % COLOR_SLOTS;
+
+	for (bits = 0; bits < 256; bits++) {
+		u8 *row = (u8 *)expanded[slot].rows[bits];
+
+		for (x = 0; x < FONT_WIDTH; x++) {
+			u32 val = (bits & (0x80 >> x)) ? fgval : bgval;
+
+			for (i = 0; i < bytes; i++)
+				row[x * bytes + i] = val >> (i * 8);
+		}
 	}
+	expanded[slot].attr = attr;
 
-	/* Erase last line */
-	dst = FB + (FI->y_resolution - FONT_HEIGHT) * FI->bytes_per_line;
+	return expanded[slot].rows;
+}
 
-	for(; y < FI->y_resolution; y++) {
-		memset(dst, 0, FI->x_resolution * (FI->bits_per_pixel >> 3));
-		dst += FI->bytes_per_line;
+/*
+ * Always inlined with a constant word count, so there is one unrolled
+ * blitter per depth.
+ */
+static inline __attribute__((always_inline))
+void corebootfb_blit(unsigned char *dst, unsigned long pitch,
+		     const unsigned char *glyph, u64 (*rows)[4], const int words)
+{
+	int y, i;
+
+	for (y = 0; y < FONT_HEIGHT; y++) {
+		const u64 *src = rows[glyph[y]];
+		u64 *d = (u64 *)dst;
+
+		for (i = 0; i < words; i++)
+			d[i] = src[i];
+		dst += pitch;
+	}
+}
+
+static void corebootfb_putchar(u8 row, u8 col, unsigned int ch)
+{
+	const struct cb_framebuffer *fi = FI;
+	const unsigned char *glyph = font8x16 + ((ch & 0xFF) * FONT_HEIGHT);
+	u64 (*rows)[4] = corebootfb_glyph_rows((ch >> 8) & 0xFF);
+	unsigned long pitch = fi->bytes_per_line;
+	unsigned char *dst;
+
+	dst = FB + ((row * FONT_HEIGHT) * pitch);
+	dst += (col * FONT_WIDTH * (fi->bits_per_pixel >> 3));
+
+	switch (fi->bits_per_pixel) {
+	case 8:
+		corebootfb_blit(dst, pitch, glyph, rows, 1);
+		break;
+	case 16:
+		corebootfb_blit(dst, pitch, glyph, rows, 2);
+		break;
+	case 24:
+		corebootfb_blit(dst, pitch, glyph, rows, 3);
+		break;
+	case 32:
+		corebootfb_blit(dst, pitch, glyph, rows, 4);
+		break;
 	}
+}
+
+static void corebootfb_mark(unsigned int row, unsigned int first,
+			    unsigned int last)
+{
+	struct dirty_span *d;
+
+	if (direct || row >= coreboot_video_console.rows)
+		return;
+
+	d = &DIRTY[row];
+	if (d->first > d->last) {
+		d->first = first;
+		d->last = last;
+		dirty_rows++;
+		return;
+	}
+	if (first < d->first)
+		d->first = first;
+	if (last > d->last)
+		d->last = last;
+}
 
-	/* And update the char buffer */
-	dst = (unsigned char *) CHARS;
-	src = (unsigned char *) (CHARS + coreboot_video_console.columns);
-	memcpy(dst, src, coreboot_video_console.columns *
-			(coreboot_video_console.rows - 1) * 2);
+static void corebootfb_mark_all(void)
+{
+	int row;
+
+	for (row = 0; row < coreboot_video_console.rows; row++)
+		corebootfb_mark(row, 0, coreboot_video_console.columns - 1);
+}
+
+static void corebootfb_flush(void)
+{
+	unsigned int columns = coreboot_video_console.columns;
+	unsigned int row, col, i;
+	unsigned short ch;
+
+	if (!dirty_rows)
+		return;
+
+	for (row = 0; row < coreboot_video_console.rows; row++) {
+		struct dirty_span *d = &DIRTY[row];
+
+		if (d->first > d->last)
+			continue;
+
+		for (col = d->first; col <= d->last; col++) {
+			i = row * columns + col;
+			ch = CHARS[i];
+			/* The cursor swaps the colours of its cell. */
+			if (cursor_en && row == cursor_y && col == cursor_x)
+				ch = (ch & 0xff) | ((ch << 4) & 0xf000) |
+				     ((ch >> 4) & 0x0f00);
+			if (SHOWN[i] == ch)
+				continue;
+			corebootfb_putchar(row, col, ch);
+			SHOWN[i] = ch;
+		}
+
+		d->first = 1;
+		d->last = 0;
+	}
+	dirty_rows = 0;
+}
+
+/* Only used without the grids, as it reads the framebuffer back. */
+static void corebootfb_scroll_fb(void)
+{
+	unsigned long pitch = FI->bytes_per_line;
+	unsigned long height = coreboot_video_console.rows * FONT_HEIGHT;
+	unsigned long width = FI->x_resolution * (FI->bits_per_pixel >> 3);
+	unsigned char *dst = FB;
+	unsigned long y;
+
+	for (y = 0; y < height - FONT_HEIGHT; y++) {
+		memcpy(dst, dst + FONT_HEIGHT * pitch, width);
+		dst += pitch;
+	}
+	for (; y < height; y++) {
+		memset(dst, 0, width);
+		dst += pitch;
+	}
+}
+
+static void corebootfb_scroll_up(void)
+{
+	unsigned int columns = coreboot_video_console.columns;
+	unsigned int last = (coreboot_video_console.rows - 1) * columns;
 	int column;
-	for (column = 0; column < coreboot_video_console.columns; column++)
-		CHARS[(coreboot_video_console.rows - 1) * coreboot_video_console.columns + column] = (VGA_COLOR_DEFAULT << 8);
+
+	if (direct) {
+		corebootfb_scroll_fb();
+		cursor_y--;
+		return;
+	}
+
+	memmove(CHARS, CHARS + columns, last * sizeof(*CHARS));
+	for (column = 0; column < columns; column++)
+		CHARS[last + column] = BLANK;
+	corebootfb_mark_all();
 
 	cursor_y--;
 }
@@ -109,102 +297,41 @@ static void corebootfb_clear(void)
 	int row, column;
 	unsigned char *ptr = FB;
 
-	/* Clear the screen */
+	/* Clear the screen, including what is outside the character grid. */
 	for(row = 0; row < FI->y_resolution; row++) {
 		memset(ptr, 0, FI->x_resolution * (FI->bits_per_pixel >> 3));
 		ptr += FI->bytes_per_line;
 	}
 
-	/* And update the char buffer */
-	for(row = 0; row < coreboot_video_console.rows; row++)
-		for (column = 0; column < coreboot_video_console.columns; column++)
-			CHARS[row * coreboot_video_console.columns + column] = (VGA_COLOR_DEFAULT << 8);
-}
-
-static void corebootfb_putchar(u8 row, u8 col, unsigned int ch)
-{
-	unsigned char *dst;
-	unsigned char *glyph = font8x16 + ((ch & 0xFF) * FONT_HEIGHT);
-
-	unsigned char bg = (ch >> 12) & 0xF;
-	unsigned char fg = (ch >> 8) & 0xF;
-	u32 fgval = 0, bgval = 0;
-	u16 *dst16;
-	u32 *dst32;
-
-	int x, y;
-
-	if (FI->bits_per_pixel > 8) {
-		bgval = ((((vga_colors[bg] >> 0) & 0xff) >> (8 - FI->blue_mask_size)) << FI->blue_mask_pos) |
-			((((vga_colors[bg] >> 8) & 0xff) >> (8 - FI->green_mask_size)) << FI->green_mask_pos) |
-			((((vga_colors[bg] >> 16) & 0xff) >> (8 - FI->red_mask_size)) << FI->red_mask_pos);
-		fgval = ((((vga_colors[fg] >> 0) & 0xff) >> (8 - FI->blue_mask_size)) << FI->blue_mask_pos) |
-			((((vga_colors[fg] >> 8) & 0xff) >> (8 - FI->green_mask_size)) << FI->green_mask_pos) |
-			((((vga_colors[fg] >> 16) & 0xff) >> (8 - FI->red_mask_size)) << FI->red_mask_pos);
-	}
-
+	if (direct)
+		return;
 
-	dst = FB + ((row * FONT_HEIGHT) * FI->bytes_per_line);
-	dst += (col * FONT_WIDTH * (FI->bits_per_pixel >> 3));
-
-	for(y = 0; y < FONT_HEIGHT; y++) {
-		for(x = FONT_WIDTH - 1; x >= 0; x--) {
-
-			switch (FI->bits_per_pixel) {
-			case 8: /* Indexed */
-				dst[(FONT_WIDTH - x) * (FI->bits_per_pixel >> 3)] = (*glyph & (1 << x)) ?  fg : bg;
-				break;
-			case 16: /* 16 bpp */
-				dst16 = (u16 *)(dst + (FONT_WIDTH - x) * (FI->bits_per_pixel >> 3));
-				*dst16 = (*glyph & (1 << x)) ? fgval : bgval;
-				break;
-			case 24: /* 24 bpp */
-				if (*glyph & (1 << x)) {
-					dst[(FONT_WIDTH - x) * (FI->bits_per_pixel >> 3) + 0] = fgval & 0xff;
-					dst[(FONT_WIDTH - x) * (FI->bits_per_pixel >> 3) + 1] = (fgval >> 8) & 0xff;
-					dst[(FONT_WIDTH - x) * (FI->bits_per_pixel >> 3) + 2] = (fgval >> 16) & 0xff;
-				} else {
-					dst[(FONT_WIDTH - x) * (FI->bits_per_pixel >> 3) + 0] = bgval & 0xff;
-					dst[(FONT_WIDTH - x) * (FI->bits_per_pixel >> 3) + 1] = (bgval >> 8) & 0xff;
-					dst[(FONT_WIDTH - x) * (FI->bits_per_pixel >> 3) + 2] = (bgval >> 16) & 0xff;
-				}
-				break;
-			case 32: /* 32 bpp */
-				dst32 = (u32 *)(dst + (FONT_WIDTH - x) * (FI->bits_per_pixel >> 3));
-				*dst32 = (*glyph & (1 << x)) ? fgval : bgval;
-				break;
-			}
+	/* A blank cell is drawn all zeroes, so that is what is shown now. */
+	for(row = 0; row < coreboot_video_console.rows; row++)
+		for (column = 0; column < coreboot_video_console.columns; column++) {
+			CHARS[row * coreboot_video_console.columns + column] = BLANK;
+			SHOWN[row * coreboot_video_console.columns + column] = BLANK;
 		}
 
-		dst += FI->bytes_per_line;
-		glyph++;
-	}
+	if (cursor_en)
+		corebootfb_mark(cursor_y, cursor_x, cursor_x);
 }
 
 static void corebootfb_putc(u8 row, u8 col, unsigned int ch)
 {
-	CHARS[row * coreboot_video_console.columns + col] = ch;
-	corebootfb_putchar(row, col, ch);
-}
-
-static void corebootfb_update_cursor(void)
-{
-	int ch, paint;
-	if(cursor_en) {
-		ch = CHARS[cursor_y * coreboot_video_console.columns + cursor_x];
-		paint = (ch & 0xff) | ((ch<<4) & 0xf000) | ((ch >> 4) & 0x0f00);
-	} else {
-		paint = CHARS[cursor_y * coreboot_video_console.columns + cursor_x];
+	if (direct) {
+		corebootfb_putchar(row, col, ch);
+		return;
 	}
 
-	if (cursor_y < coreboot_video_console.rows)
-		corebootfb_putchar(cursor_y, cursor_x, paint);
+	CHARS[row * coreboot_video_console.columns + col] = ch;
+	corebootfb_mark(row, col, col);
 }
 
 static void corebootfb_enable_cursor(int state)
 {
 	cursor_en = state;
-	corebootfb_update_cursor();
+	corebootfb_mark(cursor_y, cursor_x, cursor_x);
 }
 
 static void corebootfb_get_cursor(unsigned int *x, unsigned int *y, unsigned int *en)
@@ -216,19 +343,22 @@ static void corebootfb_get_cursor(unsigned int *x, unsigned int *y, unsigned int
 
 static void corebootfb_set_cursor(unsigned int x, unsigned int y)
 {
-	int cursor_remember = cursor_en;
-	if (cursor_remember)
-		corebootfb_enable_cursor(0);
+	if (cursor_en)
+		corebootfb_mark(cursor_y, cursor_x, cursor_x);
 
 	cursor_x = x;
 	cursor_y = y;
 
-	if (cursor_remember)
-		corebootfb_enable_cursor(1);
+	if (cursor_en)
+		corebootfb_mark(cursor_y, cursor_x, cursor_x);
 }
 
 static int corebootfb_init(void)
 {
+	unsigned int cells, row;
+	void *c, *s, *d;
+	int slot;
+
 	if (lib_sysinfo.framebuffer == NULL)
 		return -1;
 
@@ -242,8 +372,28 @@ static int corebootfb_init(void)
 	coreboot_video_console.rows = FI->y_resolution / FONT_HEIGHT;
 
 	/* See setting of fbinfo above. */
-	chars = virt_to_phys(malloc(coreboot_video_console.rows *
-				    coreboot_video_console.columns * 2));
+	cells = coreboot_video_console.rows * coreboot_video_console.columns;
+	c = malloc(cells * sizeof(*CHARS));
+	s = malloc(cells * sizeof(*SHOWN));
+	d = malloc(coreboot_video_console.rows * sizeof(*DIRTY));
+	if (c == NULL || s == NULL || d == NULL) {
+		/* Still usable, just slower and without a cursor. */
+		free(c);
+		free(s);
+		free(d);
+		direct = 1;
+	} else {
+		chars = virt_to_phys(c);
+		shown = virt_to_phys(s);
+		dirty = virt_to_phys(d);
+
+		for (row = 0; row < coreboot_video_console.rows; row++) {
+			DIRTY[row].first = 1;
+			DIRTY[row].last = 0;
+		}
+	}
+	for (slot = 0; slot < COLOR_SLOTS; slot++)
+		expanded[slot].attr = -1;
 
 	// clear boot splash screen if there is one.
 	corebootfb_clear();
@@ -255,6 +405,7 @@ struct video_console coreboot_video_console = {
 	.putc = corebootfb_putc,
 	.clear = corebootfb_clear,
 	.scroll_up = corebootfb_scroll_up,
+	.flush = corebootfb_flush,
 
 	.get_cursor = corebootfb_get_cursor,
 	.set_cursor = corebootfb_set_cursor,
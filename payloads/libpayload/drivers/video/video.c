@@ -96,10 +96,17 @@ static void video_console_fixup_cursor(void)
 		console->set_cursor(cursorx, cursory);
 }
 
+void video_console_flush(void)
+{
+	if (console && console->flush)
+		console->flush();
+}
+
 void video_console_cursor_enable(int state)
 {
 	if (console && console->enable_cursor)
 		console->enable_cursor(state);
+	video_console_flush();
 }
 
 void video_console_clear(void)
@@ -112,19 +119,21 @@ void video_console_clear(void)
 
 	if (console && console->set_cursor)
 		console->set_cursor(cursorx, cursory);
+	video_console_flush();
 }
 
+/*
+ * Not flushed, the curses implementations write a whole screen of cells and
+ * then call video_console_flush().
+ */
 void video_console_putc(u8 row, u8 col, unsigned int ch)
 {
 	if (console)
 		console->putc(row, col, ch);
 }
 
-void video_console_putchar(unsigned int ch)
+static void video_console_output(unsigned int ch)
 {
-	if (!console)
-		return;
-
 	/* replace black-on-black with light-gray-on-black.
 	 * do it here, instead of in libc/console.c
 	 */
@@ -162,6 +171,28 @@ void video_console_putchar(unsigned int ch)
 	video_console_fixup_cursor();
 }
 
+void video_console_putchar(unsigned int ch)
+{
+	if (!console)
+		return;
+
+	video_console_output(ch);
+	video_console_flush();
+}
+
+/* Draws a whole string at once, however often it scrolls. */
+static void video_console_write(const void *buffer, size_t count)
+{
+	const unsigned char *ptr;
+
+	if (!console)
+		return;
+
+	for (ptr = buffer; (void *)ptr < buffer + count; ptr++)
+		video_console_output(*ptr);
+	video_console_flush();
+}
+
 void video_console_get_cursor(unsigned int *x, unsigned int *y, unsigned int *en)
 {
 	*x=0;
@@ -180,10 +211,12 @@ void video_console_set_cursor(unsigned int x, unsigned int y)
 	cursorx = x;
 	cursory = y;
 	video_console_fixup_cursor();
+	video_console_flush();
 }
 
 static struct console_output_driver cons = {
-	.putchar = video_console_putchar
+	.putchar = video_console_putchar,
+	.write = video_console_write,
 };
 
 int video_init(void)
@@ -208,6 +241,7 @@ int video_init(void)
 		}
 
 		video_console_fixup_cursor();
+		video_console_flush();
 		return 0;
 	}
 	return 1;
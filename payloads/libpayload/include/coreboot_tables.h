@@ -216,6 +216,13 @@ struct cb_x86_rom_mtrr {
 	uint32_t index;
 };
 
+#define CB_TAG_TSC_INFO		0x0027
+struct cb_tsc_info {
+	uint32_t tag;
+	uint32_t size;
+	uint32_t freq_khz;
+};
+
 /* The following structures are for the cmos definitions table */
 #define CB_TAG_CMOS_OPTION_TABLE 0x00c8
 /* cmos header record */
@@ -202,6 +202,7 @@ void video_get_rows_cols(unsigned int *rows, unsigned int *cols);
 void video_console_putchar(unsigned int ch);
 void video_console_putc(u8 row, u8 col, unsigned int ch);
 void video_console_clear(void);
+void video_console_flush(void);
 void video_console_cursor_enable(int state);
 void video_console_get_cursor(unsigned int *x, unsigned int *y, unsigned int *en);
 void video_console_set_cursor(unsigned int cursorx, unsigned int cursory);
@@ -229,6 +230,8 @@ struct cb_cmos_option_table *get_system_option_table(void);
 int options_checksum_valid(const struct nvram_accessor *nvram);
 void fix_options_checksum_with(const struct nvram_accessor *nvram);
 void fix_options_checksum(void);
+struct nvram_accessor *options_batch_begin(const struct nvram_accessor *nvram);
+int options_batch_commit(void);
 
 struct cb_cmos_entries *first_cmos_entry(struct cb_cmos_option_table *option_table);
 struct cb_cmos_entries *next_cmos_entry(struct cb_cmos_entries *cur);
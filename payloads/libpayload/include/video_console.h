@@ -35,6 +35,8 @@ struct video_console {
 	void (*putc)(u8, u8, unsigned int);
 	void (*clear)(void);
 	void (*scroll_up)(void);
+	/* Optional, draws what the calls above only recorded. */
+	void (*flush)(void);
 
 	void (*get_cursor)(unsigned int *, unsigned int *, unsigned int *);
 	void (*set_cursor)(unsigned int, unsigned int);
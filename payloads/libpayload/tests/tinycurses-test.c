@@ -0,0 +1,379 @@
+/*
+ * This file is part of the libpayload project.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Draws through tinycurses into a small VT100 model, checks that the model
+ * shows what the window holds and counts the bytes sent over serial.
+ */
+
+/* system headers */
+#include <stdlib.h>
+#include <stdio.h>
+
+/* libpayload headers */
+#include "local.h"
+
+/*
+ * Bytes a refresh may send. The screen draw_menu() draws is about half
+ * what sending every cell would take.
+ */
+#define FULL_REDRAW_BYTES	1200
+/* "\e[yy;xxH" */
+#define CURSOR_MOVE_BYTES	8
+/* A cursor move, "\e[m" and the character. */
+#define ONE_CHAR_BYTES		(CURSOR_MOVE_BYTES + 3 + 1)
+
+#define VT_BOLD		(1 << 0)
+#define VT_REVERSE	(1 << 1)
+#define VT_ALTCHARSET	(1 << 2)
+#define VT_COLOR	(1 << 3)
+#define VT_FG(c)	((c) << 8)
+#define VT_BG(c)	((c) << 12)
+
+/* From tinycurses.c. */
+extern chtype serial_acs_map[128];
+extern chtype fallback_acs_map[128];
+
+static int errors;
+static unsigned int bytes;
+
+static struct {
+	unsigned char ch[SCREEN_Y][SCREEN_X];
+	unsigned int attr[SCREEN_Y][SCREEN_X];
+	int y, x;
+	unsigned int sgr;	/* Without VT_ALTCHARSET. */
+	int altcharset;
+	char seq[16];		/* The escape sequence being received. */
+	int seq_len;
+} vt;
+
+static void fail(const char *str, int y, int x)
+{
+	fprintf(stderr, "%s at %d,%d\n", str, y, x);
+	if (++errors == 20)
+		exit(1);
+}
+
+static void vt_sgr(int n)
+{
+	if (n == 0)
+		vt.sgr = 0;
+	else if (n == 1)
+		vt.sgr |= VT_BOLD;
+	else if (n == 7)
+		vt.sgr |= VT_REVERSE;
+	else if (n >= 30 && n <= 37)
+		vt.sgr = (vt.sgr & ~VT_FG(0xf)) | VT_COLOR | VT_FG(n - 30);
+	else if (n >= 40 && n <= 47)
+		vt.sgr = (vt.sgr & ~VT_BG(0xf)) | VT_COLOR | VT_BG(n - 40);
+	else
+		fail("unknown SGR", vt.y, vt.x);
+}
+
+static void vt_csi(void)
+{
+	int params[4] = { 0, 0, 0, 0 };
+	int count = 1;
+	char cmd = vt.seq[vt.seq_len - 1];
+	int i, n;
+
+	for (i = 2; i < vt.seq_len - 1; i++) {
+		if (vt.seq[i] == ';' && count < 4)
+			count++;
+		else if (vt.seq[i] >= '0' && vt.seq[i] <= '9')
+			params[count - 1] = params[count - 1] * 10 +
+					    vt.seq[i] - '0';
+	}
+	n = params[0] ? params[0] : 1;
+
+	switch (cmd) {
+	case 'H':
+		vt.y = params[0] ? params[0] - 1 : 0;
+		vt.x = params[1] ? params[1] - 1 : 0;
+		break;
+	case 'J':
+		for (i = vt.y * SCREEN_X + vt.x; i < SCREEN_Y * SCREEN_X; i++) {
+			vt.ch[i / SCREEN_X][i % SCREEN_X] = ' ';
+			vt.attr[i / SCREEN_X][i % SCREEN_X] = vt.sgr;
+		}
+		break;
+	case 'A':
+		vt.y = vt.y > n ? vt.y - n : 0;
+		break;
+	case 'B':
+		vt.y = vt.y + n < SCREEN_Y ? vt.y + n : SCREEN_Y - 1;
+		break;
+	case 'C':
+		vt.x = vt.x + n < SCREEN_X ? vt.x + n : SCREEN_X - 1;
+		break;
+	case 'D':
+		vt.x = vt.x >= SCREEN_X ? SCREEN_X - 1 : vt.x;
+		vt.x = vt.x > n ? vt.x - n : 0;
+		break;
+	case 'm':
+		for (i = 0; i < count; i++)
+			vt_sgr(params[i]);
+		break;
+	case 'h':
+	case 'l':
+		/* Cursor on and off. */
+		break;
+	default:
+		fail("unknown escape sequence", vt.y, vt.x);
+	}
+}
+
+void serial_putchar(unsigned int c)
+{
+	bytes++;
+
+	if (vt.seq_len) {
+		vt.seq[vt.seq_len++] = c;
+		if (vt.seq_len == 3 && vt.seq[1] == '(') {
+			vt.altcharset = c == '0';
+			vt.seq_len = 0;
+		} else if (vt.seq_len > 2 && c >= '@' && c <= '~') {
+			vt_csi();
+			vt.seq_len = 0;
+		} else if (vt.seq_len == sizeof(vt.seq)) {
+			fail("escape sequence too long", vt.y, vt.x);
+			vt.seq_len = 0;
+		}
+		return;
+	}
+
+	switch (c) {
+	case '\e':
+		vt.seq[vt.seq_len++] = c;
+		break;
+	case '\r':
+		vt.x = 0;
+		break;
+	case '\b':
+		/* A pending wrap is dropped as well. */
+		if (vt.x >= SCREEN_X)
+			vt.x = SCREEN_X - 1;
+		if (vt.x > 0)
+			vt.x--;
+		break;
+	default:
+		if (c < ' ' || c > '~') {
+			fail("unexpected control character", vt.y, vt.x);
+			break;
+		}
+		/* The cursor stays on the last column until the next one. */
+		if (vt.x >= SCREEN_X) {
+			vt.x = 0;
+			if (++vt.y >= SCREEN_Y)
+				fail("scrolled", vt.y, vt.x);
+		}
+		vt.ch[vt.y][vt.x] = c;
+		vt.attr[vt.y][vt.x] = vt.sgr |
+				      (vt.altcharset ? VT_ALTCHARSET : 0);
+		vt.x++;
+	}
+}
+
+/* The escape sequences are the ones drivers/serial/8250.c sends. */
+void serial_clear(void)
+{
+	const char *s = "\e[H\e[J";
+
+	while (*s)
+		serial_putchar(*s++);
+}
+
+void serial_set_cursor(int y, int x)
+{
+	char buffer[32];
+	char *s = buffer;
+
+	snprintf(buffer, sizeof(buffer), "\e[%d;%dH", y + 1, x + 1);
+	while (*s)
+		serial_putchar(*s++);
+}
+
+void serial_start_altcharset(void)
+{
+	serial_putchar('\e');
+	serial_putchar('(');
+	serial_putchar('0');
+}
+
+void serial_end_altcharset(void)
+{
+	serial_putchar('\e');
+	serial_putchar('(');
+	serial_putchar('B');
+}
+
+void serial_cursor_enable(int state)
+{
+}
+
+/* Only the serial console is checked. */
+void video_console_clear(void) {}
+void video_console_cursor_enable(int state) {}
+void video_console_putc(u8 row, u8 col, unsigned int ch) {}
+void video_console_set_cursor(unsigned int cursorx, unsigned int cursory) {}
+void video_console_flush(void) {}
+void speaker_tone(u16 freq, unsigned int duration) {}
+
+/* What the terminal should show for cell x of line y of win. */
+static void expected(WINDOW *win, int y, int x, unsigned char *ch,
+		     unsigned int *attr)
+{
+	attr_t a = win->_line[y].text[x].attr;
+	int pair = PAIR_NUMBER(a);
+
+	*ch = win->_line[y].text[x].chars[0] & 0xff;
+	*attr = 0;
+	if (a & A_ALTCHARSET) {
+		if (serial_acs_map[*ch & 0x7f]) {
+			*ch = serial_acs_map[*ch & 0x7f];
+			*attr |= VT_ALTCHARSET;
+		} else {
+			*ch = fallback_acs_map[*ch & 0x7f];
+		}
+	}
+	if (a & A_BOLD)
+		*attr |= VT_BOLD;
+	if (a & A_REVERSE)
+		*attr |= VT_REVERSE;
+	if (pair)
+		*attr |= VT_COLOR | VT_FG(color_pairs[pair] & 0xf) |
+			 VT_BG(color_pairs[pair] >> 4);
+}
+
+static unsigned int refresh_and_check(WINDOW *win)
+{
+	unsigned int attr;
+	unsigned char ch;
+	int y, x;
+
+	bytes = 0;
+	wrefresh(win);
+
+	for (y = 0; y <= win->_maxy; y++) {
+		for (x = 0; x <= win->_maxx; x++) {
+			expected(win, y, x, &ch, &attr);
+			if (vt.ch[y][x] != ch)
+				fail("wrong character", y, x);
+			else if (vt.attr[y][x] != attr)
+				fail("wrong attributes", y, x);
+		}
+	}
+	if (vt.y != win->_cury || vt.x != win->_curx)
+		fail("cursor not where the window has it", vt.y, vt.x);
+
+	return bytes;
+}
+
+/* A boot menu like screen. */
+static void draw_menu(WINDOW *win)
+{
+	int i;
+
+	werase(win);
+	box(win, 0, 0);
+	wattrset(win, A_REVERSE);
+	mvwaddstr(win, 0, 30, " coreboot boot menu ");
+	for (i = 0; i < 16; i++) {
+		wattrset(win, i == 3 ? COLOR_PAIR(1) | A_BOLD : A_NORMAL);
+		mvwprintw(win, 3 + i, 4, "%2d. Boot option number %d", i + 1,
+			  i * 37 % 100);
+	}
+	wattrset(win, A_BOLD);
+	mvwaddstr(win, 22, 4, "Use the arrow keys to select, Enter to boot.");
+	wattrset(win, A_NORMAL);
+	wmove(win, 6, 4);
+}
+
+int main(int argc, char **argv)
+{
+	WINDOW *win;
+	unsigned int n;
+	int i;
+
+	srand(1);
+	curses_flags = F_ENABLE_SERIAL;
+	vt.y = vt.x = 0;
+	win = initscr();
+	init_pair(1, COLOR_YELLOW, COLOR_BLUE);
+
+	draw_menu(win);
+	n = refresh_and_check(win);
+	printf("full redraw: %u bytes\n", n);
+	if (n > FULL_REDRAW_BYTES)
+		fail("full redraw sends too much", 0, 0);
+
+	mvwaddch(win, 12, 40, 'X');
+	n = refresh_and_check(win);
+	printf("one character changed: %u bytes\n", n);
+	if (n > ONE_CHAR_BYTES)
+		fail("one character sends too much", 12, 40);
+
+	/* Nothing changed, only the cursor is placed again. */
+	touchwin(win);
+	n = refresh_and_check(win);
+	if (n > CURSOR_MOVE_BYTES)
+		fail("unchanged window sends too much", 0, 0);
+
+	/* Other console output moves the cursor behind curses' back. */
+	serial_set_cursor(SCREEN_Y - 1, 0);
+	mvwaddch(win, 12, 41, 'Y');
+	refresh_and_check(win);
+
+	clearok(win, TRUE);
+	n = refresh_and_check(win);
+	if (n < FULL_REDRAW_BYTES / 2)
+		fail("clearok() doesn't send everything again", 0, 0);
+
+	/* Small random changes, as a menu makes them. */
+	for (i = 0; i < 2000; i++) {
+		static const attr_t attrs[] = {
+			A_NORMAL, A_BOLD, A_REVERSE, COLOR_PAIR(1),
+			COLOR_PAIR(1) | A_BOLD, A_ALTCHARSET,
+		};
+		int y = rand() % SCREEN_Y;
+		int x = rand() % (SCREEN_X - 8);
+		int len = rand() % 8 + 1;
+
+		wattrset(win, attrs[rand() % ARRAY_SIZE(attrs)]);
+		wmove(win, y, x);
+		while (len--)
+			waddch(win, 'a' + rand() % 26);
+		if (rand() % 4 == 0)
+			wmove(win, rand() % SCREEN_Y, rand() % SCREEN_X);
+		refresh_and_check(win);
+		if (rand() % 100 == 0)
+			draw_menu(win);
+	}
+
+	printf("tinycurses-test: %s\n", errors ? "FAILED" : "passed");
+	return errors != 0;
+}
@@ -229,6 +229,8 @@ int main()
 		render_form(form);
 	}
 
+	/* Write all options at once, with a single checksum update. */
+	struct nvram_accessor *nvram = options_batch_begin(use_nvram);
 	for (i = 0; i < numopts; i++) {
 		char *name = field_buffer(fields[2*i], 0);
 		char *value = field_buffer(fields[2*i+1], 0);
@@ -236,8 +238,9 @@ int main()
 		for (ptr = value + strlen (value) - 1;
 		     ptr >= value && *ptr == ' '; ptr--);
 		ptr[1] = '\0';
-		set_option_from_string(use_nvram, opttbl, value, name);
+		set_option_from_string(nvram, opttbl, value, name);
 	}
+	options_batch_commit();
 
 	unpost_form(form);
 	free_form(form);
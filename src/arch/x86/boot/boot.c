@@ -4,8 +4,8 @@
 #include <ip_checksum.h>
 #include <string.h>
 
-/* When the ramstage is relocatable the elf loading ensures an elf image cannot
- * be loaded over the ramstage code. */
+/* When the ramstage is relocatable or the payload was loaded in place the elf
+ * loading ensures an elf image cannot be loaded over the ramstage code. */
 static void jmp_payload_no_bounce_buffer(void *entry)
 {
 	/* Jump to kernel */
@@ -125,7 +125,8 @@ static void jmp_payload(void *entry, unsigned long buffer, unsigned long size)
 
 void arch_payload_run(const struct payload *payload)
 {
-	if (IS_ENABLED(CONFIG_RELOCATABLE_RAMSTAGE))
+	if (IS_ENABLED(CONFIG_RELOCATABLE_RAMSTAGE) ||
+	    payload->bounce.size == 0)
 		jmp_payload_no_bounce_buffer(payload->entry);
 	else
 		jmp_payload(payload->entry, (uintptr_t)payload->bounce.data,
@@ -0,0 +1,270 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <arch/cpu.h>
+#include <boot/table_cache.h>
+#include <console/console.h>
+#include <device/device.h>
+#include <device/resource.h>
+#include <ip_checksum.h>
+#include <pc80/mc146818rtc.h>
+#include <spi-generic.h>
+#include <spi_flash.h>
+#include <stdlib.h>
+#include <string.h>
+#include <version.h>
+
+#if CONFIG_USE_OPTION_TABLE
+#include "option_table.h"
+#endif
+
+#define TABLE_CACHE_SIGNATURE	0x434c4254	/* "TBLC" */
+#define MAX_TABLES		4
+
+#define FNV_OFFSET_BASIS	0xcbf29ce484222325ULL
+#define FNV_PRIME		0x100000001b3ULL
+
+struct table_cache_entry {
+	u32 id;
+	u32 addr;
+	u32 size;
+	u32 checksum;		/* Of the table data. */
+} __attribute__((packed));
+
+/* The record in flash. The data of the tables follows in order. */
+struct table_cache_header {
+	u32 signature;
+	u32 size;		/* Of the whole record. */
+	u32 checksum;		/* Of the header with this field 0. */
+	u32 num_tables;
+	u64 fingerprint;
+	struct table_cache_entry tables[MAX_TABLES];
+} __attribute__((packed));
+
+/* The tables of this boot. Their data stays in place until saved. */
+static struct table_cache_header cache;
+static const struct table_cache_header *saved;
+static int initialized;
+static int dirty;
+
+static u64 hash(u64 h, const void *data, size_t len)
+{
+	const u8 *p = data;
+
+	while (len--) {
+		h ^= *p++;
+		h *= FNV_PRIME;
+	}
+
+	return h;
+}
+
+static u64 hash_u32(u64 h, u32 value)
+{
+	return hash(h, &value, sizeof(value));
+}
+
+/* Everything the cached tables are generated from. */
+static u64 fingerprint(void)
+{
+	struct device *dev;
+	struct resource *res;
+	u64 h = FNV_OFFSET_BASIS;
+	const char *path;
+
+	h = hash(h, coreboot_version, strlen(coreboot_version));
+	h = hash(h, coreboot_build, strlen(coreboot_build));
+	h = hash_u32(h, cpuid_eax(1));
+
+	for (dev = all_devices; dev; dev = dev->next) {
+		path = dev_path(dev);
+		h = hash(h, path, strlen(path));
+		h = hash_u32(h, dev->enabled);
+		h = hash_u32(h, dev->vendor);
+		h = hash_u32(h, dev->device);
+		h = hash_u32(h, dev->class);
+		h = hash_u32(h, dev->subsystem_vendor);
+		h = hash_u32(h, dev->subsystem_device);
+		for (res = dev->resource_list; res; res = res->next) {
+			h = hash_u32(h, res->index);
+			h = hash_u32(h, res->flags);
+			h = hash(h, &res->base, sizeof(res->base));
+			h = hash(h, &res->size, sizeof(res->size));
+		}
+	}
+
+#if CONFIG_USE_OPTION_TABLE
+	int i;
+
+	for (i = LB_CKS_RANGE_START; i <= LB_CKS_RANGE_END; i++)
+		h = hash_u32(h, cmos_read(i));
+#endif
+
+	return h;
+}
+
+static u32 header_checksum(const struct table_cache_header *h)
+{
+	struct table_cache_header copy;
+
+	memcpy(&copy, h, sizeof(copy));
+	copy.checksum = 0;
+
+	return compute_ip_checksum(&copy, sizeof(copy));
+}
+
+static void table_cache_init(void)
+{
+	const struct table_cache_header *h;
+
+	initialized = 1;
+	cache.signature = TABLE_CACHE_SIGNATURE;
+	cache.fingerprint = fingerprint();
+
+	h = (const struct table_cache_header *)CONFIG_TABLE_CACHE_POS;
+	if (h->signature != TABLE_CACHE_SIGNATURE ||
+	    h->size < sizeof(*h) || h->size > CONFIG_TABLE_CACHE_SIZE ||
+	    h->num_tables > MAX_TABLES || h->checksum != header_checksum(h)) {
+		printk(BIOS_DEBUG, "Table cache: no valid record.\n");
+		return;
+	}
+
+	if (h->fingerprint != cache.fingerprint) {
+		printk(BIOS_DEBUG, "Table cache: configuration changed.\n");
+		return;
+	}
+
+	saved = h;
+}
+
+static void add_entry(u32 id, unsigned long start, unsigned long end,
+		      u32 checksum)
+{
+	struct table_cache_entry *e;
+
+	if (cache.num_tables == MAX_TABLES) {
+		printk(BIOS_ERR, "Table cache: too many tables.\n");
+		return;
+	}
+
+	e = &cache.tables[cache.num_tables++];
+	e->id = id;
+	e->addr = start;
+	e->size = end - start;
+	e->checksum = checksum;
+}
+
+unsigned long table_cache_restore(u32 id, unsigned long start)
+{
+	const struct table_cache_entry *e = NULL;
+	const u8 *data;
+	int i;
+
+	if (!initialized)
+		table_cache_init();
+	if (saved == NULL)
+		return 0;
+
+	data = (const u8 *)(saved + 1);
+	for (i = 0; i < saved->num_tables; i++) {
+		if (saved->tables[i].id == id) {
+			e = &saved->tables[i];
+			break;
+		}
+		data += saved->tables[i].size;
+	}
+	if (e == NULL)
+		return 0;
+
+	/* Tables point into themselves, so they can only go back in place. */
+	if (e->addr != start) {
+		printk(BIOS_DEBUG, "Table cache: %08x moved.\n", id);
+		return 0;
+	}
+	if (data + e->size > (const u8 *)saved + saved->size)
+		return 0;
+
+	memcpy((void *)start, data, e->size);
+	if (compute_ip_checksum((void *)start, e->size) != e->checksum) {
+		printk(BIOS_WARNING, "Table cache: bad checksum for %08x.\n",
+		       id);
+		return 0;
+	}
+
+	add_entry(id, start, start + e->size, e->checksum);
+	printk(BIOS_DEBUG, "Table cache: restored %08x, %u bytes.\n", id,
+	       e->size);
+
+	return start + e->size;
+}
+
+void table_cache_add(u32 id, unsigned long start, unsigned long end)
+{
+	if (!initialized)
+		table_cache_init();
+
+	add_entry(id, start, end, compute_ip_checksum((void *)start,
+						      end - start));
+	dirty = 1;
+}
+
+void table_cache_save(void)
+{
+	struct table_cache_header *h;
+	struct spi_flash *flash;
+	u8 *data;
+	u32 size = sizeof(*h);
+	int i;
+
+	if (!dirty)
+		return;
+
+	for (i = 0; i < cache.num_tables; i++)
+		size += cache.tables[i].size;
+	if (size > CONFIG_TABLE_CACHE_SIZE) {
+		printk(BIOS_ERR, "Table cache: %u bytes don't fit.\n", size);
+		return;
+	}
+
+	h = malloc(size);
+	if (h == NULL) {
+		printk(BIOS_ERR, "Table cache: out of memory.\n");
+		return;
+	}
+	memcpy(h, &cache, sizeof(*h));
+	h->size = size;
+	h->checksum = header_checksum(h);
+
+	data = (u8 *)(h + 1);
+	for (i = 0; i < cache.num_tables; i++) {
+		memcpy(data, (void *)cache.tables[i].addr, cache.tables[i].size);
+		data += cache.tables[i].size;
+	}
+
+	spi_init();
+	flash = spi_flash_probe(0, 0);
+	if (flash == NULL) {
+		printk(BIOS_ERR, "Table cache: no SPI flash.\n");
+		free(h);
+		return;
+	}
+
+	printk(BIOS_DEBUG, "Table cache: saving %u bytes.\n", size);
+	spi_flash_update(flash, CONFIG_TABLE_CACHE_POS & (flash->size - 1),
+			 size, h);
+	free(h);
+}
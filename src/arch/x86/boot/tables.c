@@ -22,6 +22,7 @@
 #include <console/console.h>
 #include <cpu/cpu.h>
 #include <boot/tables.h>
+#include <boot/table_cache.h>
 #include <boot/coreboot_tables.h>
 #include <arch/pirq_routing.h>
 #include <arch/smp/mpspec.h>
@@ -128,7 +129,14 @@ void write_tables(void)
 		unsigned long new_high_table_pointer;
 
 		rom_table_end = ALIGN(rom_table_end, 16);
-		new_high_table_pointer = write_acpi_tables(high_table_pointer);
+		new_high_table_pointer = table_cache_restore(CBMEM_ID_ACPI,
+							     high_table_pointer);
+		if (!new_high_table_pointer) {
+			new_high_table_pointer =
+				write_acpi_tables(high_table_pointer);
+			table_cache_add(CBMEM_ID_ACPI, high_table_pointer,
+					new_high_table_pointer);
+		}
 		if (new_high_table_pointer > ( high_table_pointer + MAX_ACPI_SIZE)) {
 			printk(BIOS_ERR, "ERROR: Increase ACPI size\n");
 		}
@@ -171,7 +179,14 @@ void write_tables(void)
 	if (high_table_pointer) {
 		unsigned long new_high_table_pointer;
 
-		new_high_table_pointer = smbios_write_tables(high_table_pointer);
+		new_high_table_pointer = table_cache_restore(CBMEM_ID_SMBIOS,
+							     high_table_pointer);
+		if (!new_high_table_pointer) {
+			new_high_table_pointer =
+				smbios_write_tables(high_table_pointer);
+			table_cache_add(CBMEM_ID_SMBIOS, high_table_pointer,
+					new_high_table_pointer);
+		}
 		rom_table_end = ALIGN(rom_table_end, 16);
 		memcpy((void *)rom_table_end, (void *)high_table_pointer, sizeof(struct smbios_entry));
 		rom_table_end += sizeof(struct smbios_entry);
@@ -188,6 +203,8 @@ void write_tables(void)
 	}
 #endif
 
+	table_cache_save();
+
 #if CONFIG_USE_CBMEM_FILE_OVERRIDE
 	/* Write additional files into cbmem area to override existing */
 	create_cbmem_file_area();
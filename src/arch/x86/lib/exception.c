@@ -369,11 +369,26 @@ static void put_packet(char *buffer)
 #endif /* CONFIG_GDB_STUB */
 
 #include <arch/registers.h>
+#include <cpu/x86/lapic.h>
+#include <profiler.h>
 
 void x86_exception(struct eregs *info);
 
 void x86_exception(struct eregs *info)
 {
+#if CONFIG_SAMPLING_PROFILER
+	if (info->vector == LAPIC_TIMER_VECTOR) {
+		profiler_sample(info);
+		return;
+	}
+#endif
+#if CONFIG_TICKLESS_IDLE
+	/* Only there to end the hlt in lapic_idle_usecs(). */
+	if (info->vector == LAPIC_TIMER_VECTOR) {
+		lapic_write(LAPIC_EOI, 0);
+		return;
+	}
+#endif
 #if CONFIG_GDB_STUB
 	int signo;
 	memcpy(gdb_stub_registers, info, 8*sizeof(uint32_t));
@@ -0,0 +1,48 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+// Use simple device model for this file even in ramstage
+#define __SIMPLE_DEVICE__
+
+#include <arch/io.h>
+#include <cpu/x86/msr.h>
+#include <cpu/x86/tsc.h>
+
+/* D18F4x15C Core Performance Boost Control */
+#define CPB_CTRL		0x15c
+#define  NUM_BOOST_STATES(x)	(((x) >> 2) & 7)
+
+#define PSTATE_0_MSR		0xc0010064
+#define  PSTATE_CPU_FID(x)	((x) & 0x3f)
+#define  PSTATE_CPU_DID(x)	(((x) >> 6) & 7)
+
+/*
+ * The TSC is invariant and counts at the software P0 frequency, the first
+ * P-state after the boost states, whichever P-state the cores run in.
+ */
+unsigned long tsc_freq_mhz(void)
+{
+	u32 boost;
+	msr_t msr;
+
+	boost = NUM_BOOST_STATES(pci_read_config32(PCI_DEV(0, 0x18, 4),
+						   CPB_CTRL));
+	msr = rdmsr(PSTATE_0_MSR + boost);
+
+	/* CoreCOF = 100MHz * (CpuFid + 10h) / 2^CpuDid */
+	return (100 * (PSTATE_CPU_FID(msr.lo) + 0x10)) >> PSTATE_CPU_DID(msr.lo);
+}
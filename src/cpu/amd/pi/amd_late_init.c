@@ -34,6 +34,9 @@ static void agesawrapper_post_device(void *unused)
 
 	AGESAWRAPPER(amdinitlate);
 
+	if (IS_ENABLED(CONFIG_AGESA_MEM_CONTEXT_CACHE))
+		AGESAWRAPPER(amdsavememcontext);
+
 	if (!acpi_s3_resume_allowed())
 		return;
 
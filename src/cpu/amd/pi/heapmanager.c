@@ -6,6 +6,7 @@
 
 #include <cbmem.h>
 #include <arch/acpi.h>
+#include <stdlib.h>
 #include <string.h>
 #if CONFIG_AGESA_HEAP_MEMTEST
 #include <lib.h>					// memory test prototypes
@@ -61,21 +62,191 @@ static AGESA_STATUS alloc_cbmem(AGESA_BUFFER_PARAMS *AllocParams) {
 }
 #endif
 
+#define NODE_FREE		1
+#define NODE_ALIGN		8
+#define HANDLE_EMPTY		0
+#define HANDLE_DELETED		1
+
+/* A free node keeps its list links at the start of the buffer. */
+typedef struct _BIOS_FREE_LINKS {
+	UINT32 NextNodeOffset;
+	UINT32 PrevNodeOffset;
+} BIOS_FREE_LINKS;
+
+#define MIN_NODE_SIZE	(sizeof(BIOS_BUFFER_NODE) + sizeof(BIOS_FREE_LINKS))
+#define FIRST_NODE	ALIGN_UP(sizeof(BIOS_HEAP_MANAGER), NODE_ALIGN)
+
+static inline BIOS_BUFFER_NODE *node_at(UINT8 *Base, UINT32 Offset)
+{
+	return (BIOS_BUFFER_NODE *)(Base + Offset);
+}
+
+static inline BIOS_FREE_LINKS *links_at(UINT8 *Base, UINT32 Offset)
+{
+	return (BIOS_FREE_LINKS *)(Base + Offset + sizeof(BIOS_BUFFER_NODE));
+}
+
+static inline UINT32 node_size(const BIOS_BUFFER_NODE *Node)
+{
+	return Node->NodeSize & ~NODE_FREE;
+}
+
+static inline UINT32 free_list(UINT32 Size)
+{
+	return 31 - __builtin_clz(Size);
+}
+
+static void free_list_add(BIOS_HEAP_MANAGER *Mgr, UINT8 *Base, UINT32 Offset)
+{
+	UINT32 List = free_list(node_size(node_at(Base, Offset)));
+	BIOS_FREE_LINKS *Links = links_at(Base, Offset);
+
+	Links->PrevNodeOffset = 0;
+	Links->NextNodeOffset = Mgr->FreeLists[List];
+	if (Links->NextNodeOffset)
+		links_at(Base, Links->NextNodeOffset)->PrevNodeOffset = Offset;
+	Mgr->FreeLists[List] = Offset;
+	Mgr->FreeListMap |= 1 << List;
+}
+
+static void free_list_remove(BIOS_HEAP_MANAGER *Mgr, UINT8 *Base, UINT32 Offset)
+{
+	UINT32 List = free_list(node_size(node_at(Base, Offset)));
+	BIOS_FREE_LINKS *Links = links_at(Base, Offset);
+
+	if (Links->PrevNodeOffset)
+		links_at(Base, Links->PrevNodeOffset)->NextNodeOffset =
+			Links->NextNodeOffset;
+	else
+		Mgr->FreeLists[List] = Links->NextNodeOffset;
+	if (Links->NextNodeOffset)
+		links_at(Base, Links->NextNodeOffset)->PrevNodeOffset =
+			Links->PrevNodeOffset;
+	if (Mgr->FreeLists[List] == 0)
+		Mgr->FreeListMap &= ~(1 << List);
+
+	/* Free buffers are kept zeroed apart from the links. */
+	Links->NextNodeOffset = 0;
+	Links->PrevNodeOffset = 0;
+}
+
+/* Sets the size of a node and updates the boundary tag of the next one. */
+static void set_node_size(UINT8 *Base, UINT32 Offset, UINT32 Size, UINT32 Free)
+{
+	node_at(Base, Offset)->NodeSize = Size | Free;
+	if (Offset + Size < BIOS_HEAP_SIZE)
+		node_at(Base, Offset + Size)->PrevNodeSize = Size;
+}
+
+static void heap_init(BIOS_HEAP_MANAGER *Mgr, UINT8 *Base)
+{
+	BIOS_BUFFER_NODE *Node = node_at(Base, FIRST_NODE);
+
+	/* EmptyHeap() has cleared everything already. */
+	Node->PrevNodeSize = 0;
+	set_node_size(Base, FIRST_NODE, BIOS_HEAP_SIZE - FIRST_NODE, NODE_FREE);
+	free_list_add(Mgr, Base, FIRST_NODE);
+	Mgr->StartOfNodes = FIRST_NODE;
+}
+
+static inline UINT32 handle_hash(UINT32 Handle)
+{
+	return (Handle * 0x9e3779b1) >> 22;
+}
+
+static BIOS_HEAP_HANDLE *handle_find(BIOS_HEAP_MANAGER *Mgr, UINT32 Handle)
+{
+	UINT32 i = handle_hash(Handle);
+	BIOS_HEAP_HANDLE *Slot;
+
+	for (;; i = (i + 1) & (BIOS_HEAP_HANDLE_SLOTS - 1)) {
+		Slot = &Mgr->Handles[i];
+		if (Slot->NodeOffset == HANDLE_EMPTY)
+			return NULL;
+		if (Slot->NodeOffset != HANDLE_DELETED &&
+		    Slot->BufferHandle == Handle)
+			return Slot;
+	}
+}
+
+static void handle_insert(BIOS_HEAP_MANAGER *Mgr, UINT32 Handle, UINT32 Offset)
+{
+	UINT32 i = handle_hash(Handle);
+	BIOS_HEAP_HANDLE *Slot;
+
+	for (;; i = (i + 1) & (BIOS_HEAP_HANDLE_SLOTS - 1)) {
+		Slot = &Mgr->Handles[i];
+		if (Slot->NodeOffset == HANDLE_DELETED) {
+			Mgr->DeletedHandles--;
+			break;
+		}
+		if (Slot->NodeOffset == HANDLE_EMPTY)
+			break;
+	}
+
+	Slot->BufferHandle = Handle;
+	Slot->NodeOffset = Offset;
+	Mgr->UsedHandles++;
+}
+
+/*
+ * Makes room for one more handle. Deleted slots are dropped by rebuilding
+ * the index from the allocated nodes once they make up too much of it, so
+ * that probe sequences stay short.
+ */
+static int handle_reserve(BIOS_HEAP_MANAGER *Mgr, UINT8 *Base)
+{
+	UINT32 Offset;
+	BIOS_BUFFER_NODE *Node;
+
+	if (Mgr->UsedHandles + 1 > BIOS_HEAP_HANDLE_SLOTS * 3 / 4)
+		return 0;
+	if (Mgr->UsedHandles + Mgr->DeletedHandles + 1 <=
+	    BIOS_HEAP_HANDLE_SLOTS * 7 / 8)
+		return 1;
+
+	memset(Mgr->Handles, 0, sizeof(Mgr->Handles));
+	Mgr->UsedHandles = 0;
+	Mgr->DeletedHandles = 0;
+	for (Offset = Mgr->StartOfNodes; Offset < BIOS_HEAP_SIZE;
+	     Offset += node_size(Node)) {
+		Node = node_at(Base, Offset);
+		if (!(Node->NodeSize & NODE_FREE))
+			handle_insert(Mgr, Node->BufferHandle, Offset);
+	}
+
+	return 1;
+}
+
+/* Returns the offset of a free node of at least Size bytes, or 0. */
+static UINT32 find_free_node(BIOS_HEAP_MANAGER *Mgr, UINT8 *Base, UINT32 Size)
+{
+	UINT32 List = free_list(Size);
+	UINT32 Offset;
+	UINT32 Map;
+
+	/* Nodes in the matching list may still be too small. */
+	for (Offset = Mgr->FreeLists[List]; Offset != 0;
+	     Offset = links_at(Base, Offset)->NextNodeOffset) {
+		if (node_size(node_at(Base, Offset)) >= Size)
+			return Offset;
+	}
+
+	/* Any node in a larger list will do. */
+	Map = List < 31 ? Mgr->FreeListMap & ~((2U << List) - 1) : 0;
+	if (Map == 0)
+		return 0;
+
+	return Mgr->FreeLists[__builtin_ctz(Map)];
+}
+
 AGESA_STATUS agesa_AllocateBuffer (UINT32 Func, UINT32 Data, VOID *ConfigPtr)
 {
-	UINT32              AvailableHeapSize;
 	UINT8               *BiosHeapBaseAddr;
-	UINT32              CurrNodeOffset;
-	UINT32              PrevNodeOffset;
-	UINT32              FreedNodeOffset;
-	UINT32              BestFitNodeOffset;
-	UINT32              BestFitPrevNodeOffset;
-	UINT32              NextFreeOffset;
-	BIOS_BUFFER_NODE   *CurrNodePtr;
-	BIOS_BUFFER_NODE   *FreedNodePtr;
-	BIOS_BUFFER_NODE   *BestFitNodePtr;
-	BIOS_BUFFER_NODE   *BestFitPrevNodePtr;
-	BIOS_BUFFER_NODE   *NextFreePtr;
+	UINT32              NodeOffset;
+	UINT32              NodeSize;
+	UINT32              FreeSize;
+	BIOS_BUFFER_NODE   *NodePtr;
 	BIOS_HEAP_MANAGER  *BiosHeapBasePtr;
 	AGESA_BUFFER_PARAMS *AllocParams;
 
@@ -88,127 +259,62 @@ AGESA_STATUS agesa_AllocateBuffer (UINT32 Func, UINT32 Data, VOID *ConfigPtr)
 		return alloc_cbmem(AllocParams);
 #endif
 
-	AvailableHeapSize = BIOS_HEAP_SIZE - sizeof (BIOS_HEAP_MANAGER);
 	BiosHeapBaseAddr = (UINT8 *) GetHeapBase(&(AllocParams->StdHeader));
 	BiosHeapBasePtr = (BIOS_HEAP_MANAGER *) BiosHeapBaseAddr;
 
-	if (BiosHeapBasePtr->StartOfAllocatedNodes == 0) {
-		/* First allocation */
-		CurrNodeOffset = sizeof (BIOS_HEAP_MANAGER);
-		CurrNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + CurrNodeOffset);
-		CurrNodePtr->BufferHandle = AllocParams->BufferHandle;
-		CurrNodePtr->BufferSize = AllocParams->BufferLength;
-		CurrNodePtr->NextNodeOffset = 0;
-		AllocParams->BufferPointer = (UINT8 *) CurrNodePtr + sizeof (BIOS_BUFFER_NODE);
-
-		/* Update the remaining free space */
-		FreedNodeOffset = CurrNodeOffset + CurrNodePtr->BufferSize + sizeof (BIOS_BUFFER_NODE);
-		FreedNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + FreedNodeOffset);
-		FreedNodePtr->BufferSize = AvailableHeapSize - sizeof (BIOS_BUFFER_NODE) - CurrNodePtr->BufferSize;
-		FreedNodePtr->NextNodeOffset = 0;
-
-		/* Update the offsets for Allocated and Freed nodes */
-		BiosHeapBasePtr->StartOfAllocatedNodes = CurrNodeOffset;
-		BiosHeapBasePtr->StartOfFreedNodes = FreedNodeOffset;
+	if (BiosHeapBasePtr->StartOfNodes == 0)
+		heap_init(BiosHeapBasePtr, BiosHeapBaseAddr);
+
+	/* A BufferHandle can only be allocated once. */
+	if (handle_find(BiosHeapBasePtr, AllocParams->BufferHandle))
+		return AGESA_BOUNDS_CHK;
+
+	if (AllocParams->BufferLength > BIOS_HEAP_SIZE)
+		return AGESA_BOUNDS_CHK;
+	NodeSize = ALIGN_UP(AllocParams->BufferLength + sizeof (BIOS_BUFFER_NODE), NODE_ALIGN);
+	if (NodeSize < MIN_NODE_SIZE)
+		NodeSize = MIN_NODE_SIZE;
+
+	if (!handle_reserve(BiosHeapBasePtr, BiosHeapBaseAddr))
+		return AGESA_BOUNDS_CHK;
+
+	NodeOffset = find_free_node(BiosHeapBasePtr, BiosHeapBaseAddr, NodeSize);
+	if (NodeOffset == 0)
+		return AGESA_BOUNDS_CHK;
+
+	NodePtr = node_at(BiosHeapBaseAddr, NodeOffset);
+	free_list_remove(BiosHeapBasePtr, BiosHeapBaseAddr, NodeOffset);
+
+	/* Split off the tail if it is large enough to be a node of its own. */
+	FreeSize = node_size(NodePtr) - NodeSize;
+	if (FreeSize >= MIN_NODE_SIZE) {
+		set_node_size(BiosHeapBaseAddr, NodeOffset + NodeSize, FreeSize, NODE_FREE);
+		free_list_add(BiosHeapBasePtr, BiosHeapBaseAddr, NodeOffset + NodeSize);
 	} else {
-		/* Find out whether BufferHandle has been allocated on the heap.
-		 * If it has, return AGESA_BOUNDS_CHK.
-		 */
-		CurrNodeOffset = BiosHeapBasePtr->StartOfAllocatedNodes;
-		CurrNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + CurrNodeOffset);
-
-		while (CurrNodeOffset != 0) {
-			CurrNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + CurrNodeOffset);
-			if (CurrNodePtr->BufferHandle == AllocParams->BufferHandle) {
-				return AGESA_BOUNDS_CHK;
-			}
-			CurrNodeOffset = CurrNodePtr->NextNodeOffset;
-			/* If BufferHandle has not been allocated on the heap, CurrNodePtr here points
-			 * to the end of the allocated nodes list.
-			 */
-		}
-		/* Find the node that best fits the requested buffer size */
-		FreedNodeOffset = BiosHeapBasePtr->StartOfFreedNodes;
-		PrevNodeOffset = FreedNodeOffset;
-		BestFitNodeOffset = 0;
-		BestFitPrevNodeOffset = 0;
-		while (FreedNodeOffset != 0) {
-			FreedNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + FreedNodeOffset);
-			if (FreedNodePtr->BufferSize >= (AllocParams->BufferLength + sizeof (BIOS_BUFFER_NODE))) {
-				if (BestFitNodeOffset == 0) {
-					/* First node that fits the requested buffer size */
-					BestFitNodeOffset = FreedNodeOffset;
-					BestFitPrevNodeOffset = PrevNodeOffset;
-				} else {
-					/* Find out whether current node is a better fit than the previous nodes */
-					BestFitNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + BestFitNodeOffset);
-					if (BestFitNodePtr->BufferSize > FreedNodePtr->BufferSize) {
-						BestFitNodeOffset = FreedNodeOffset;
-						BestFitPrevNodeOffset = PrevNodeOffset;
-					}
-				}
-			}
-			PrevNodeOffset = FreedNodeOffset;
-			FreedNodeOffset = FreedNodePtr->NextNodeOffset;
-		} /* end of while loop */
-
-		if (BestFitNodeOffset == 0) {
-			/* If we could not find a node that fits the requested buffer
-			 * size, return AGESA_BOUNDS_CHK.
-			 */
-			return AGESA_BOUNDS_CHK;
-		} else {
-			BestFitNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + BestFitNodeOffset);
-			BestFitPrevNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + BestFitPrevNodeOffset);
-
-			/* If BestFitNode is larger than the requested buffer, fragment the node further */
-			if (BestFitNodePtr->BufferSize > (AllocParams->BufferLength + sizeof (BIOS_BUFFER_NODE))) {
-				NextFreeOffset = BestFitNodeOffset + AllocParams->BufferLength + sizeof (BIOS_BUFFER_NODE);
-
-				NextFreePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + NextFreeOffset);
-				NextFreePtr->BufferSize = BestFitNodePtr->BufferSize - (AllocParams->BufferLength + sizeof (BIOS_BUFFER_NODE));
-				NextFreePtr->NextNodeOffset = BestFitNodePtr->NextNodeOffset;
-			} else {
-				/* Otherwise, next free node is NextNodeOffset of BestFitNode */
-				NextFreeOffset = BestFitNodePtr->NextNodeOffset;
-			}
-
-			/* If BestFitNode is the first buffer in the list, then update
-			 * StartOfFreedNodes to reflect the new free node.
-			 */
-			if (BestFitNodeOffset == BiosHeapBasePtr->StartOfFreedNodes) {
-				BiosHeapBasePtr->StartOfFreedNodes = NextFreeOffset;
-			} else {
-				BestFitPrevNodePtr->NextNodeOffset = NextFreeOffset;
-			}
-
-			/* Add BestFitNode to the list of Allocated nodes */
-			CurrNodePtr->NextNodeOffset = BestFitNodeOffset;
-			BestFitNodePtr->BufferSize = AllocParams->BufferLength;
-			BestFitNodePtr->BufferHandle = AllocParams->BufferHandle;
-			BestFitNodePtr->NextNodeOffset = 0;
-
-			/* Remove BestFitNode from list of Freed nodes */
-			AllocParams->BufferPointer = (UINT8 *) BestFitNodePtr + sizeof (BIOS_BUFFER_NODE);
-		}
+		NodeSize = node_size(NodePtr);
 	}
 
+	set_node_size(BiosHeapBaseAddr, NodeOffset, NodeSize, 0);
+	NodePtr->BufferHandle = AllocParams->BufferHandle;
+	NodePtr->BufferSize = AllocParams->BufferLength;
+	handle_insert(BiosHeapBasePtr, AllocParams->BufferHandle, NodeOffset);
+
+	AllocParams->BufferPointer = (UINT8 *) NodePtr + sizeof (BIOS_BUFFER_NODE);
+
 	return AGESA_SUCCESS;
 }
 
 AGESA_STATUS agesa_DeallocateBuffer (UINT32 Func, UINT32 Data, VOID *ConfigPtr)
 {
-
 	UINT8               *BiosHeapBaseAddr;
-	UINT32              AllocNodeOffset;
-	UINT32              PrevNodeOffset;
-	UINT32              NextNodeOffset;
-	UINT32              FreedNodeOffset;
-	UINT32              EndNodeOffset;
-	BIOS_BUFFER_NODE   *AllocNodePtr;
-	BIOS_BUFFER_NODE   *PrevNodePtr;
-	BIOS_BUFFER_NODE   *FreedNodePtr;
+	UINT32              NodeOffset;
+	UINT32              NodeSize;
+	UINT32              NextOffset;
+	UINT32              PrevOffset;
+	BIOS_BUFFER_NODE   *NodePtr;
 	BIOS_BUFFER_NODE   *NextNodePtr;
+	BIOS_BUFFER_NODE   *PrevNodePtr;
+	BIOS_HEAP_HANDLE   *HandlePtr;
 	BIOS_HEAP_MANAGER  *BiosHeapBasePtr;
 	AGESA_BUFFER_PARAMS *AllocParams;
 
@@ -217,109 +323,59 @@ AGESA_STATUS agesa_DeallocateBuffer (UINT32 Func, UINT32 Data, VOID *ConfigPtr)
 	BiosHeapBaseAddr = (UINT8 *) GetHeapBase(&(AllocParams->StdHeader));
 	BiosHeapBasePtr = (BIOS_HEAP_MANAGER *) BiosHeapBaseAddr;
 
-	/* Find target node to deallocate in list of allocated nodes.
-	 * Return AGESA_BOUNDS_CHK if the BufferHandle is not found.
-	 */
-	AllocNodeOffset = BiosHeapBasePtr->StartOfAllocatedNodes;
-	AllocNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + AllocNodeOffset);
-	PrevNodeOffset = AllocNodeOffset;
-
-	while (AllocNodePtr->BufferHandle !=  AllocParams->BufferHandle) {
-		if (AllocNodePtr->NextNodeOffset == 0) {
-			return AGESA_BOUNDS_CHK;
-		}
-		PrevNodeOffset = AllocNodeOffset;
-		AllocNodeOffset = AllocNodePtr->NextNodeOffset;
-		AllocNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + AllocNodeOffset);
-	}
+	/* Return AGESA_BOUNDS_CHK if the BufferHandle is not found. */
+	if (BiosHeapBasePtr->StartOfNodes == 0)
+		return AGESA_BOUNDS_CHK;
+	HandlePtr = handle_find(BiosHeapBasePtr, AllocParams->BufferHandle);
+	if (HandlePtr == NULL)
+		return AGESA_BOUNDS_CHK;
 
-	/* Remove target node from list of allocated nodes */
-	PrevNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + PrevNodeOffset);
-	PrevNodePtr->NextNodeOffset = AllocNodePtr->NextNodeOffset;
+	NodeOffset = HandlePtr->NodeOffset;
+	HandlePtr->NodeOffset = HANDLE_DELETED;
+	BiosHeapBasePtr->UsedHandles--;
+	BiosHeapBasePtr->DeletedHandles++;
 
 	/* Zero out the buffer, and clear the BufferHandle */
-	LibAmdMemFill ((UINT8 *)AllocNodePtr + sizeof (BIOS_BUFFER_NODE), 0, AllocNodePtr->BufferSize, &(AllocParams->StdHeader));
-	AllocNodePtr->BufferHandle = 0;
-	AllocNodePtr->BufferSize += sizeof (BIOS_BUFFER_NODE);
-
-	/* Add deallocated node in order to the list of freed nodes */
-	FreedNodeOffset = BiosHeapBasePtr->StartOfFreedNodes;
-	FreedNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + FreedNodeOffset);
-
-	EndNodeOffset = AllocNodeOffset + AllocNodePtr->BufferSize;
-
-	if (AllocNodeOffset < FreedNodeOffset) {
-		/* Add to the start of the freed list */
-		if (EndNodeOffset == FreedNodeOffset) {
-			/* If the freed node is adjacent to the first node in the list, concatenate both nodes */
-			AllocNodePtr->BufferSize += FreedNodePtr->BufferSize;
-			AllocNodePtr->NextNodeOffset = FreedNodePtr->NextNodeOffset;
-
-			/* Clear the BufferSize and NextNodeOffset of the previous first node */
-			FreedNodePtr->BufferSize = 0;
-			FreedNodePtr->NextNodeOffset = 0;
-
-		} else {
-			/* Otherwise, add freed node to the start of the list
-			 * Update NextNodeOffset and BufferSize to include the
-			 * size of BIOS_BUFFER_NODE.
-			 */
-			AllocNodePtr->NextNodeOffset = FreedNodeOffset;
-		}
-		/* Update StartOfFreedNodes to the new first node */
-		BiosHeapBasePtr->StartOfFreedNodes = AllocNodeOffset;
-	} else {
-		/* Traverse list of freed nodes to find where the deallocated node
-		 * should be placed.
-		 */
-		NextNodeOffset = FreedNodeOffset;
-		NextNodePtr = FreedNodePtr;
-		while (AllocNodeOffset > NextNodeOffset) {
-			PrevNodeOffset = NextNodeOffset;
-			if (NextNodePtr->NextNodeOffset == 0) {
-				break;
-			}
-			NextNodeOffset = NextNodePtr->NextNodeOffset;
-			NextNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + NextNodeOffset);
+	NodePtr = node_at(BiosHeapBaseAddr, NodeOffset);
+	NodeSize = node_size(NodePtr);
+	LibAmdMemFill ((UINT8 *)NodePtr + sizeof (BIOS_BUFFER_NODE), 0, NodePtr->BufferSize, &(AllocParams->StdHeader));
+	NodePtr->BufferHandle = 0;
+	NodePtr->BufferSize = 0;
+
+	/* Merge with the next node if that one is free. */
+	NextOffset = NodeOffset + NodeSize;
+	if (NextOffset < BIOS_HEAP_SIZE) {
+		NextNodePtr = node_at(BiosHeapBaseAddr, NextOffset);
+		if (NextNodePtr->NodeSize & NODE_FREE) {
+			free_list_remove(BiosHeapBasePtr, BiosHeapBaseAddr, NextOffset);
+			NodeSize += node_size(NextNodePtr);
+			LibAmdMemFill (NextNodePtr, 0, sizeof (BIOS_BUFFER_NODE), &(AllocParams->StdHeader));
 		}
+	}
 
-		/* If deallocated node is adjacent to the next node,
-		 * concatenate both nodes.
-		 */
-		if (NextNodeOffset == EndNodeOffset) {
-			NextNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + NextNodeOffset);
-			AllocNodePtr->BufferSize += NextNodePtr->BufferSize;
-			AllocNodePtr->NextNodeOffset = NextNodePtr->NextNodeOffset;
-
-			NextNodePtr->BufferSize = 0;
-			NextNodePtr->NextNodeOffset = 0;
-		} else {
-			/*AllocNodePtr->NextNodeOffset = FreedNodePtr->NextNodeOffset; */
-			AllocNodePtr->NextNodeOffset = NextNodeOffset;
-		}
-		/* If deallocated node is adjacent to the previous node,
-		 * concatenate both nodes.
-		 */
-		PrevNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + PrevNodeOffset);
-		EndNodeOffset = PrevNodeOffset + PrevNodePtr->BufferSize;
-		if (AllocNodeOffset == EndNodeOffset) {
-			PrevNodePtr->NextNodeOffset = AllocNodePtr->NextNodeOffset;
-			PrevNodePtr->BufferSize += AllocNodePtr->BufferSize;
-
-			AllocNodePtr->BufferSize = 0;
-			AllocNodePtr->NextNodeOffset = 0;
-		} else {
-			PrevNodePtr->NextNodeOffset = AllocNodeOffset;
+	/* And with the previous one. */
+	if (NodePtr->PrevNodeSize != 0) {
+		PrevOffset = NodeOffset - NodePtr->PrevNodeSize;
+		PrevNodePtr = node_at(BiosHeapBaseAddr, PrevOffset);
+		if (PrevNodePtr->NodeSize & NODE_FREE) {
+			free_list_remove(BiosHeapBasePtr, BiosHeapBaseAddr, PrevOffset);
+			NodeSize += node_size(PrevNodePtr);
+			LibAmdMemFill (NodePtr, 0, sizeof (BIOS_BUFFER_NODE), &(AllocParams->StdHeader));
+			NodeOffset = PrevOffset;
 		}
 	}
+
+	set_node_size(BiosHeapBaseAddr, NodeOffset, NodeSize, NODE_FREE);
+	free_list_add(BiosHeapBasePtr, BiosHeapBaseAddr, NodeOffset);
+
 	return AGESA_SUCCESS;
 }
 
 AGESA_STATUS agesa_LocateBuffer (UINT32 Func, UINT32 Data, VOID *ConfigPtr)
 {
-	UINT32              AllocNodeOffset;
 	UINT8               *BiosHeapBaseAddr;
 	BIOS_BUFFER_NODE   *AllocNodePtr;
+	BIOS_HEAP_HANDLE   *HandlePtr = NULL;
 	BIOS_HEAP_MANAGER  *BiosHeapBasePtr;
 	AGESA_BUFFER_PARAMS *AllocParams;
 
@@ -328,20 +384,16 @@ AGESA_STATUS agesa_LocateBuffer (UINT32 Func, UINT32 Data, VOID *ConfigPtr)
 	BiosHeapBaseAddr = (UINT8 *) GetHeapBase(&(AllocParams->StdHeader));
 	BiosHeapBasePtr = (BIOS_HEAP_MANAGER *) BiosHeapBaseAddr;
 
-	AllocNodeOffset = BiosHeapBasePtr->StartOfAllocatedNodes;
-	AllocNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + AllocNodeOffset);
+	if (BiosHeapBasePtr->StartOfNodes != 0)
+		HandlePtr = handle_find(BiosHeapBasePtr, AllocParams->BufferHandle);
 
-	while (AllocParams->BufferHandle != AllocNodePtr->BufferHandle) {
-		if (AllocNodePtr->NextNodeOffset == 0) {
-			AllocParams->BufferPointer = NULL;
-			AllocParams->BufferLength = 0;
-			return AGESA_BOUNDS_CHK;
-		} else {
-			AllocNodeOffset = AllocNodePtr->NextNodeOffset;
-			AllocNodePtr = (BIOS_BUFFER_NODE *) (BiosHeapBaseAddr + AllocNodeOffset);
-		}
+	if (HandlePtr == NULL) {
+		AllocParams->BufferPointer = NULL;
+		AllocParams->BufferLength = 0;
+		return AGESA_BOUNDS_CHK;
 	}
 
+	AllocNodePtr = node_at(BiosHeapBaseAddr, HandlePtr->NodeOffset);
 	AllocParams->BufferPointer = (UINT8 *) ((UINT8 *) AllocNodePtr + sizeof (BIOS_BUFFER_NODE));
 	AllocParams->BufferLength = AllocNodePtr->BufferSize;
 
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,  MA 02110-1301 USA
+ */
+
+#include <console/console.h>
+#include <ip_checksum.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem_context.h"
+#include "s3_resume.h"
+
+/*
+ * The flash region holds a u32 length followed by the record, which is the
+ * layout spi_SaveS3info() writes. An erased region reads as 0xffffffff.
+ */
+#define MAX_RECORD_SIZE	(CONFIG_AGESA_MEM_CONTEXT_SIZE - sizeof(u32))
+
+static u32 record_checksum(const struct mem_context_header *h, u32 len)
+{
+	struct mem_context_header copy;
+	u32 sum;
+
+	/* Checksum the header with this field 0, then add the data. */
+	memcpy(&copy, h, sizeof(copy));
+	copy.checksum = 0;
+	sum = compute_ip_checksum(&copy, sizeof(copy));
+	sum += compute_ip_checksum((void *)mem_context_data(h),
+				   len - sizeof(*h));
+
+	return sum;
+}
+
+const struct mem_context_header *mem_context_find(
+	const struct mem_context_key *key)
+{
+	const u32 *region = (const u32 *)CONFIG_AGESA_MEM_CONTEXT_POS;
+	const struct mem_context_header *h;
+	u32 len = *region;
+
+	if (len < sizeof(*h) || len > MAX_RECORD_SIZE)
+		return NULL;
+
+	h = (const struct mem_context_header *)(region + 1);
+	if (h->signature != MEM_CONTEXT_SIGNATURE ||
+	    h->data_size != len - sizeof(*h)) {
+		printk(BIOS_DEBUG, "Memory context: no valid record.\n");
+		return NULL;
+	}
+
+	if (memcmp(&h->key, key, sizeof(*key))) {
+		printk(BIOS_DEBUG, "Memory context: DIMM configuration changed.\n");
+		return NULL;
+	}
+
+	if (h->checksum != record_checksum(h, len)) {
+		printk(BIOS_WARNING, "Memory context: bad checksum.\n");
+		return NULL;
+	}
+
+	return h;
+}
+
+#ifndef __PRE_RAM__
+void mem_context_save(const struct mem_context_key *key, u32 train_usecs,
+		      const void *data, u32 size)
+{
+	const u32 *region = (const u32 *)CONFIG_AGESA_MEM_CONTEXT_POS;
+	struct mem_context_header *h;
+	u32 len = sizeof(*h) + size;
+
+	if (len > MAX_RECORD_SIZE) {
+		printk(BIOS_ERR, "Memory context: %u bytes don't fit.\n", len);
+		return;
+	}
+
+	h = malloc(len);
+	if (h == NULL) {
+		printk(BIOS_ERR, "Memory context: out of memory.\n");
+		return;
+	}
+	h->signature = MEM_CONTEXT_SIGNATURE;
+	h->data_size = size;
+	h->train_usecs = train_usecs;
+	memcpy(&h->key, key, sizeof(*key));
+	memcpy(h + 1, data, size);
+	h->checksum = record_checksum(h, len);
+
+	/* Don't wear out the flash when the training came out the same. */
+	if (region[0] == len && !memcmp(region + 1, h, len)) {
+		printk(BIOS_DEBUG, "Memory context: up to date.\n");
+	} else {
+		printk(BIOS_DEBUG, "Memory context: saving %u bytes.\n", len);
+		spi_SaveS3info(CONFIG_AGESA_MEM_CONTEXT_POS,
+			       CONFIG_AGESA_MEM_CONTEXT_SIZE, (u8 *)h, len);
+	}
+
+	free(h);
+}
+#endif
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,  MA 02110-1301 USA
+ */
+
+#ifndef MEM_CONTEXT_H
+#define MEM_CONTEXT_H
+
+#include <stdint.h>
+#include <spd_cache.h>
+
+/*
+ * With CONFIG_AGESA_MEM_CONTEXT_CACHE the memory context AGESA produces in
+ * AmdS3Save (the trained DCT and PHY settings) is kept in a dedicated flash
+ * region. On the next boot romstage hands it back to AmdInitPost with
+ * MemRestoreCtl set, which skips training. The record is only used when the
+ * key, i.e. the SPD contents and the board straps, is unchanged.
+ */
+
+#define MEM_CONTEXT_SIGNATURE	0x5843454d	/* "MECX" */
+
+struct mem_context_key {
+	u32 strap;
+	u8 spd[SPD_SIZE];
+} __attribute__((packed));
+
+struct mem_context_header {
+	u32 signature;
+	u32 data_size;
+	u32 checksum;		/* See record_checksum(). */
+	u32 train_usecs;	/* How long training took for this context. */
+	struct mem_context_key key;
+} __attribute__((packed));
+
+static inline const void *mem_context_data(const struct mem_context_header *h)
+{
+	return h + 1;
+}
+
+/* Returns the record saved for this key or NULL if there is none. */
+const struct mem_context_header *mem_context_find(
+	const struct mem_context_key *key);
+
+/* Writes a new record unless an identical one is already in flash. */
+void mem_context_save(const struct mem_context_key *key, u32 train_usecs,
+		      const void *data, u32 size);
+
+#endif
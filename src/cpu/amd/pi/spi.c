@@ -20,12 +20,15 @@
 #include <console/console.h>
 #include <spi-generic.h>
 #include <spi_flash.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "s3_resume.h"
 
 void spi_SaveS3info(u32 pos, u32 size, u8 *buf, u32 len)
 {
 	struct spi_flash *flash;
+	u8 *record;
 
 	spi_init();
 	flash = spi_flash_probe(0, 0);
@@ -38,9 +41,19 @@ void spi_SaveS3info(u32 pos, u32 size, u8 *buf, u32 len)
 	flash->spi->rw = SPI_WRITE_FLAG;
 	spi_claim_bus(flash->spi);
 
-	flash->erase(flash, pos, size);
-	flash->write(flash, pos, sizeof(len), &len);
-	flash->write(flash, pos + sizeof(len), len, buf);
+	/*
+	 * Only touch what changed. After the first boot the record mostly
+	 * is the same, and the rest of the region is never read.
+	 */
+	record = malloc(sizeof(len) + len);
+	if (record == NULL) {
+		printk(BIOS_DEBUG, "Could not allocate the S3 record\n");
+	} else {
+		memcpy(record, &len, sizeof(len));
+		memcpy(record + sizeof(len), buf, len);
+		spi_flash_update(flash, pos, sizeof(len) + len, record);
+		free(record);
+	}
 
 	flash->spi->rw = SPI_WRITE_FLAG;
 	spi_release_bus(flash->spi);
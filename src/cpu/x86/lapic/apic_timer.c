@@ -157,10 +157,12 @@ void timer_monotonic_get(struct mono_time *mt)
 	/* Note that the APIC timer counts down. */
 	usecs_elapsed = (mono_counter.last_value - current_tick) / timer_fsb;
 
-	/* Update current time and tick values only if a full tick occurred. */
+	/* Update current time and tick values only if a full tick occurred.
+	 * Keep the ticks of the partial microsecond, or the clock runs slow
+	 * when it's polled often. */
 	if (usecs_elapsed) {
 		mono_time_add_usecs(&mono_counter.time, usecs_elapsed);
-		mono_counter.last_value = current_tick;
+		mono_counter.last_value -= usecs_elapsed * timer_fsb;
 	}
 
 	/* Save result. */
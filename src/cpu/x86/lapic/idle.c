@@ -0,0 +1,77 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <arch/io.h>
+#include <console/console.h>
+#include <cpu/x86/lapic.h>
+#include <timer.h>
+
+/* LAPIC timer ticks per microsecond, 0 until set up. */
+static u32 ticks_per_usec;
+
+static void idle_init(void)
+{
+	u32 hz;
+
+	enable_lapic();
+	lapic_write(LAPIC_TASKPRI, lapic_read(LAPIC_TASKPRI) & ~LAPIC_TPRI_MASK);
+	lapic_write(LAPIC_SPIV, lapic_read(LAPIC_SPIV) | LAPIC_SPIV_ENABLE);
+
+	hz = lapic_timer_calibrate();
+	lapic_write(LAPIC_TMICT, 0);
+
+	ticks_per_usec = hz / USECS_PER_SEC;
+	if (ticks_per_usec == 0)
+		ticks_per_usec = 1;
+
+	printk(BIOS_DEBUG, "Idle: LAPIC timer at %u kHz.\n", hz / 1000);
+}
+
+void lapic_idle_usecs(u32 usecs)
+{
+	u32 ticks;
+	u8 master_mask, slave_mask;
+
+	if (ticks_per_usec == 0)
+		idle_init();
+
+	if (usecs > 0xffffffff / ticks_per_usec)
+		ticks = 0xffffffff;
+	else
+		ticks = usecs * ticks_per_usec;
+
+	/* Only the LAPIC timer may end the hlt. The 8259 masks are put back
+	 * afterwards, later code and the payload rely on what was set up. */
+	master_mask = inb(0x21);
+	slave_mask = inb(0xa1);
+	outb(0xff, 0x21);
+	outb(0xff, 0xa1);
+
+	/* One-shot, the count stops at 0. */
+	lapic_write(LAPIC_LVTT, LAPIC_TIMER_VECTOR);
+	lapic_write(LAPIC_TMICT, ticks);
+
+	/* Interrupts are only taken after the instruction following sti, so
+	 * one arriving in between still ends the hlt. */
+	asm volatile ("sti; hlt; cli" ::: "memory");
+
+	lapic_write(LAPIC_TMICT, 0);
+	lapic_write(LAPIC_LVTT, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+
+	outb(master_mask, 0x21);
+	outb(slave_mask, 0xa1);
+}
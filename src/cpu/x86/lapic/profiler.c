@@ -0,0 +1,162 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <arch/io.h>
+#include <arch/registers.h>
+#include <bootstate.h>
+#include <cbmem.h>
+#include <console/console.h>
+#include <cpu/x86/lapic.h>
+#include <profiler.h>
+#include <string.h>
+#include <timer.h>
+
+#define HISTOGRAM_SIZE		(sizeof(struct profile_histogram) + \
+			 CONFIG_SAMPLING_PROFILER_BUCKETS * sizeof(uint32_t))
+
+/* The ramstage text, see ramstage.ld and rmodule.ld. */
+extern unsigned char _ram_seg;
+extern unsigned char _etext;
+
+/* Only used until CBMEM is up, like the trace buffer. */
+static u8 profile_early[HISTOGRAM_SIZE] __attribute__((aligned(4)));
+static struct profile_histogram *hist;
+static int running;
+
+void profiler_sample(struct eregs *info)
+{
+	struct profile_histogram *h = hist;
+	uint32_t offset = info->eip - h->base;
+
+	h->samples++;
+	if (offset >> h->shift < h->buckets)
+		h->counts[offset >> h->shift]++;
+	else
+		h->outside++;
+
+	lapic_write(LAPIC_EOI, 0);
+}
+
+static void timer_start(void)
+{
+	lapic_write(LAPIC_LVTT, LAPIC_LVT_TIMER_PERIODIC | LAPIC_TIMER_VECTOR);
+	asm volatile ("sti" ::: "memory");
+}
+
+static void timer_stop(void)
+{
+	asm volatile ("cli" ::: "memory");
+	lapic_write(LAPIC_LVTT, lapic_read(LAPIC_LVTT) | LAPIC_LVT_MASKED);
+}
+
+static void profiler_start(void *unused)
+{
+	struct profile_histogram *h;
+	uint32_t base = (uintptr_t)&_ram_seg;
+	uint32_t size = (uintptr_t)&_etext - base;
+	uint32_t hz;
+
+	h = (struct profile_histogram *)profile_early;
+	h->magic = PROFILER_MAGIC;
+	h->base = base;
+	h->link_base = IS_ENABLED(CONFIG_RELOCATABLE_RAMSTAGE) ? 0 : base;
+	/* Make the buckets just large enough to cover all of the text. */
+	for (h->shift = 2; (size >> h->shift) >=
+			   CONFIG_SAMPLING_PROFILER_BUCKETS; h->shift++)
+		;
+	h->buckets = ((size - 1) >> h->shift) + 1;
+	h->rate_hz = CONFIG_SAMPLING_PROFILER_HZ;
+	hist = h;
+
+	enable_lapic();
+	lapic_write(LAPIC_TASKPRI, lapic_read(LAPIC_TASKPRI) & ~LAPIC_TPRI_MASK);
+	lapic_write(LAPIC_SPIV, lapic_read(LAPIC_SPIV) | LAPIC_SPIV_ENABLE);
+
+	/* Nothing else in ramstage expects interrupts, keep the 8259 quiet. */
+	outb(0xff, 0x21);
+	outb(0xff, 0xa1);
+
+	hz = lapic_timer_calibrate();
+	lapic_write(LAPIC_TMICT, hz / CONFIG_SAMPLING_PROFILER_HZ);
+
+	printk(BIOS_DEBUG, "Profiler: LAPIC timer at %u kHz, %u buckets of "
+	       "%u bytes from 0x%08x.\n", hz / 1000, h->buckets, 1 << h->shift,
+	       h->base);
+
+	running = 1;
+	timer_start();
+}
+
+void profiler_pause(void)
+{
+	if (running)
+		timer_stop();
+}
+
+void profiler_resume(void)
+{
+	if (!running)
+		return;
+
+	/* Option ROMs leave the 8259 the way they like it. */
+	outb(0xff, 0x21);
+	outb(0xff, 0xa1);
+	timer_start();
+}
+
+/* Keep sampling into CBMEM so table writing and payload loading show up. */
+static void profiler_move_to_cbmem(void *unused)
+{
+	struct profile_histogram *h;
+
+	if (!running)
+		return;
+
+	timer_stop();
+	h = cbmem_add(CBMEM_ID_PROFILE, HISTOGRAM_SIZE);
+	if (h != NULL) {
+		memcpy(h, hist, HISTOGRAM_SIZE);
+		hist = h;
+	}
+	timer_start();
+
+	if (h == NULL)
+		printk(BIOS_ERR, "Profiler: no room in CBMEM.\n");
+}
+
+static void profiler_stop(void *unused)
+{
+	if (!running)
+		return;
+
+	timer_stop();
+	running = 0;
+
+	printk(BIOS_DEBUG, "Profiler: %u samples, %u outside the ramstage.\n",
+	       hist->samples, hist->outside);
+}
+
+BOOT_STATE_INIT_ENTRIES(profiler_bscb) = {
+	BOOT_STATE_INIT_ENTRY(BS_PRE_DEVICE, BS_ON_ENTRY,
+			      profiler_start, NULL),
+	BOOT_STATE_INIT_ENTRY(BS_WRITE_TABLES, BS_ON_ENTRY,
+			      profiler_move_to_cbmem, NULL),
+	BOOT_STATE_INIT_ENTRY(BS_OS_RESUME, BS_ON_ENTRY,
+			      profiler_stop, NULL),
+	BOOT_STATE_INIT_ENTRY(BS_PAYLOAD_BOOT, BS_ON_ENTRY,
+			      profiler_stop, NULL),
+};
@@ -0,0 +1,41 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <cpu/x86/lapic.h>
+#include <timer.h>
+
+#define CALIBRATE_USECS		10000
+
+/* Leaves the timer masked and counting down from the top. */
+u32 lapic_timer_calibrate(void)
+{
+	struct mono_time start, now;
+	u32 count;
+
+	lapic_write(LAPIC_LVTT, LAPIC_LVT_TIMER_PERIODIC | LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_TDCR, LAPIC_TDR_DIV_1);
+	lapic_write(LAPIC_TMICT, 0xffffffff);
+
+	timer_monotonic_get(&start);
+	count = lapic_read(LAPIC_TMCCT);
+	do {
+		timer_monotonic_get(&now);
+	} while (mono_time_diff_microseconds(&start, &now) < CALIBRATE_USECS);
+	count -= lapic_read(LAPIC_TMCCT);
+
+	return count * (USECS_PER_SEC / CALIBRATE_USECS);
+}
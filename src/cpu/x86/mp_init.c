@@ -19,6 +19,7 @@
  * MA 02110-1301 USA
  */
 
+#include <bootstate.h>
 #include <console/console.h>
 #include <stdint.h>
 #include <rmodule.h>
@@ -39,6 +40,7 @@
 #include <lib.h>
 #include <smp/atomic.h>
 #include <smp/spinlock.h>
+#include <string.h>
 #include <thread.h>
 
 #define MAX_APIC_IDS 256
@@ -90,6 +92,45 @@ struct cpu_map {
 /* Keep track of apic and device structure for each cpu. */
 static struct cpu_map cpus[CONFIG_MAX_CPUS];
 
+/* Number of APs that made it through the flight plan. */
+static int num_aps_started;
+
+struct mp_callback {
+	mp_callback_t func;
+	void *arg;
+};
+
+/* Each AP polls its own slot for work once the flight plan is done. */
+static struct mp_callback *ap_callbacks[CONFIG_MAX_CPUS];
+
+static struct mp_callback *read_callback(struct mp_callback **slot)
+{
+	return *(struct mp_callback * volatile *)slot;
+}
+
+static void store_callback(struct mp_callback **slot, struct mp_callback *val)
+{
+	*(struct mp_callback * volatile *)slot = val;
+	mfence();
+}
+
+/* An AP has claimed the slot and is copying the callback out of it. */
+#define AP_SLOT_BUSY ((struct mp_callback *)1)
+
+/* Replaces *slot with val if it still holds old. Returns the prior value. */
+static struct mp_callback *cmpxchg_callback(struct mp_callback **slot,
+					    struct mp_callback *old,
+					    struct mp_callback *val)
+{
+	struct mp_callback *prev;
+
+	__asm__ __volatile__("lock; cmpxchg %2, %1"
+			     : "=a" (prev), "+m" (*slot)
+			     : "r" (val), "0" (old)
+			     : "memory");
+	return prev;
+}
+
 static inline void barrier_wait(atomic_t *b)
 {
 	while (atomic_read(b) == 0) {
@@ -122,6 +163,33 @@ static int wait_for_aps(atomic_t *val, int target, int total_delay,
 	return timeout;
 }
 
+static void ap_wait_for_instruction(void)
+{
+	struct mp_callback lcb;
+	struct mp_callback **per_cpu_slot;
+
+	per_cpu_slot = &ap_callbacks[cpu_index()];
+
+	while (1) {
+		struct mp_callback *cb = read_callback(per_cpu_slot);
+
+		if (cb == NULL || cb == AP_SLOT_BUSY) {
+			asm ("pause");
+			continue;
+		}
+
+		/* Claim the slot so the BSP can no longer retract it. */
+		if (cmpxchg_callback(per_cpu_slot, cb, AP_SLOT_BUSY) != cb)
+			continue;
+
+		/* Copy to local variable before signalling consumption. */
+		memcpy(&lcb, cb, sizeof(lcb));
+		mfence();
+		store_callback(per_cpu_slot, NULL);
+		lcb.func(lcb.arg);
+	}
+}
+
 static void ap_do_flight_plan(void)
 {
 	int i;
@@ -155,6 +223,7 @@ static void asmlinkage ap_init(unsigned int cpu)
 
 	apic_id = lapicid();
 	info->cpu->path.apic.apic_id = apic_id;
+	dev_index_path(info->cpu);
 	cpus[cpu].apic_id = apic_id;
 
 	printk(BIOS_INFO, "AP: slot %d apic_id %x.\n", cpu, apic_id);
@@ -162,6 +231,10 @@ static void asmlinkage ap_init(unsigned int cpu)
 	/* Walk the flight plan */
 	ap_do_flight_plan();
 
+	/* Keep the AP around for mp_run_on_aps() if requested. */
+	if (IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK))
+		ap_wait_for_instruction();
+
 	/* Park the AP. */
 	stop_this_cpu();
 }
@@ -563,6 +636,8 @@ int mp_init(struct bus *cpu_bus, struct mp_params *p)
 		return -1;
 	}
 
+	num_aps_started = num_aps;
+
 	/* Walk the flight plan for the BSP. */
 	return bsp_do_flight_plan(p);
 }
@@ -582,6 +657,237 @@ int mp_get_apic_id(int cpu_slot)
 	return cpus[cpu_slot].apic_id;
 }
 
+/*
+ * Returns the number of APs that picked up func(arg). Fewer than
+ * num_aps_started means the rest did not show up within expire_us and had
+ * the work retracted, so they will never run it.
+ */
+static int dispatch_to_aps(mp_callback_t func, void *arg, long expire_us,
+			   long *delayed)
+{
+	struct mp_callback lcb = { .func = func, .arg = arg };
+	int i, retracted = 0;
+
+	/* APs occupy the cpu slots following the BSP. */
+	for (i = 1; i <= num_aps_started; i++)
+		store_callback(&ap_callbacks[i], &lcb);
+
+	/* lcb lives on this stack, so wait for every AP to take a copy. */
+	for (i = 1; i <= num_aps_started; i++) {
+		while (read_callback(&ap_callbacks[i]) != NULL) {
+			if (expire_us > 0 && *delayed >= expire_us)
+				break;
+			udelay(1);
+			(*delayed)++;
+		}
+
+		if (read_callback(&ap_callbacks[i]) == NULL)
+			continue;
+
+		/*
+		 * Retract the work so it cannot run later. An AP that got
+		 * there first is copying lcb and will clear the slot shortly.
+		 */
+		if (cmpxchg_callback(&ap_callbacks[i], &lcb, NULL) == &lcb) {
+			retracted++;
+			continue;
+		}
+		while (read_callback(&ap_callbacks[i]) != NULL)
+			asm ("pause");
+	}
+
+	return num_aps_started - retracted;
+}
+
+int mp_run_on_aps(mp_callback_t func, void *arg, long expire_us)
+{
+	long delayed = 0;
+
+	if (!IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK) || num_aps_started == 0)
+		return 0;
+
+	if (dispatch_to_aps(func, arg, expire_us, &delayed) < num_aps_started) {
+		printk(BIOS_ERR, "AP call expired after %ld us.\n", delayed);
+		return -1;
+	}
+
+	return num_aps_started;
+}
+
+/*
+ * State shared by mp_run_on_all_cpus() and mp_run_work(). Only one of them
+ * runs at a time. APs still inside a callback of an expired call keep
+ * ap_work.active non-zero, and the next call waits for them first.
+ */
+static struct {
+	spinlock_t lock;
+	mp_callback_t func;
+	void *arg;
+	const struct mp_work *work;
+	int count;
+	int next;
+	atomic_t active;
+} ap_work = {
+	.lock = SPIN_LOCK_UNLOCKED,
+};
+
+/* Returns 1 if the APs did not go idle within expire_us, 0 waits forever. */
+static int wait_for_idle(long expire_us, long *delayed)
+{
+	while (atomic_read(&ap_work.active) != 0) {
+		if (expire_us > 0 && *delayed >= expire_us)
+			return 1;
+		udelay(1);
+		(*delayed)++;
+	}
+	mfence();
+
+	return 0;
+}
+
+static void ap_run_func(void *unused)
+{
+	ap_work.func(ap_work.arg);
+	mfence();
+	atomic_dec(&ap_work.active);
+}
+
+/* Returns the next work item to run or NULL once all are handed out. */
+static const struct mp_work *claim_work(void)
+{
+	const struct mp_work *w = NULL;
+
+	spin_lock(&ap_work.lock);
+	if (ap_work.next < ap_work.count)
+		w = &ap_work.work[ap_work.next++];
+	spin_unlock(&ap_work.lock);
+
+	return w;
+}
+
+static void run_work(void)
+{
+	const struct mp_work *w;
+
+	while ((w = claim_work()) != NULL)
+		w->func(w->arg);
+}
+
+static void ap_run_work(void *unused)
+{
+	run_work();
+	mfence();
+	atomic_dec(&ap_work.active);
+}
+
+/*
+ * Hands fn to the APs. Returns how many of them are running it, or < 0 if
+ * some of them did not pick it up in time.
+ */
+static int start_ap_work(mp_callback_t fn, long expire_us, long *delayed)
+{
+	int aps, i;
+
+	if (!IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK) || num_aps_started == 0)
+		return 0;
+
+	atomic_set(&ap_work.active, num_aps_started);
+	aps = dispatch_to_aps(fn, NULL, expire_us, delayed);
+	if (aps < num_aps_started) {
+		printk(BIOS_ERR, "Only %d of %d APs took work within %ld us.\n",
+		       aps, num_aps_started, *delayed);
+		/* Only the retracted APs will never check out. */
+		for (i = aps; i < num_aps_started; i++)
+			atomic_dec(&ap_work.active);
+		return -1;
+	}
+
+	return aps;
+}
+
+int mp_run_on_all_cpus(mp_callback_t func, void *arg, long expire_us)
+{
+	long delayed = 0;
+
+	if (wait_for_idle(expire_us, &delayed)) {
+		printk(BIOS_ERR, "APs still busy with expired work.\n");
+		return -1;
+	}
+
+	ap_work.func = func;
+	ap_work.arg = arg;
+
+	if (start_ap_work(ap_run_func, expire_us, &delayed) < 0)
+		return -1;
+
+	func(arg);
+
+	if (wait_for_idle(expire_us, &delayed)) {
+		printk(BIOS_ERR, "AP work timed out after %ld us.\n", delayed);
+		return -1;
+	}
+
+	return 0;
+}
+
+int mp_run_work(const struct mp_work *work, int count, long expire_us)
+{
+	long delayed = 0;
+	int busy;
+
+	/* Without the APs every item still gets run, just on the BSP. */
+	busy = wait_for_idle(expire_us, &delayed);
+
+	spin_lock(&ap_work.lock);
+	ap_work.work = work;
+	ap_work.count = count;
+	ap_work.next = 0;
+	spin_unlock(&ap_work.lock);
+
+	if (!busy)
+		start_ap_work(ap_run_work, expire_us, &delayed);
+
+	run_work();
+
+	if (wait_for_idle(expire_us, &delayed)) {
+		printk(BIOS_ERR, "AP work timed out after %ld us.\n", delayed);
+		return -1;
+	}
+
+	return 0;
+}
+
+static atomic_t aps_parked;
+
+static void ap_park(void *unused)
+{
+	mfence();
+	atomic_inc(&aps_parked);
+	stop_this_cpu();
+}
+
+/* The APs must not keep polling ramstage memory once the OS owns it. */
+static void park_aps(void *unused)
+{
+	if (!IS_ENABLED(CONFIG_PARALLEL_MP_AP_WORK) || num_aps_started == 0)
+		return;
+
+	atomic_set(&aps_parked, 0);
+	if (mp_run_on_aps(ap_park, NULL, 100000 /* 100 ms */) < 0 ||
+	    wait_for_aps(&aps_parked, num_aps_started, 100000, 10)) {
+		printk(BIOS_ERR, "Only %d of %d APs parked.\n",
+		       atomic_read(&aps_parked), num_aps_started);
+		return;
+	}
+
+	printk(BIOS_DEBUG, "%d APs parked.\n", num_aps_started);
+}
+
+BOOT_STATE_INIT_ENTRIES(mp_park_bscb) = {
+	BOOT_STATE_INIT_ENTRY(BS_OS_RESUME, BS_ON_ENTRY, park_aps, NULL),
+	BOOT_STATE_INIT_ENTRY(BS_PAYLOAD_BOOT, BS_ON_ENTRY, park_aps, NULL),
+};
+
 void smm_initiate_relocation_parallel(void)
 {
 	if ((lapic_read(LAPIC_ICR) & LAPIC_ICR_BUSY)) {
@@ -96,6 +96,11 @@ static void enable_var_mtrr(unsigned char deftype)
 	wrmsr(MTRRdefType_MSR, msr);
 }
 
+static inline int msr_equal(msr_t a, msr_t b)
+{
+	return a.lo == b.lo && a.hi == b.hi;
+}
+
 /* fms: find most sigificant bit set, stolen from Linux Kernel Source. */
 static inline unsigned int fms(unsigned int x)
 {
@@ -142,11 +147,11 @@ static inline unsigned int fls(unsigned int x)
  * The default MTRR type selection uses 3 approaches for selecting the
  * optimal number of variable MTRRs.  For each range do 3 calculations:
  *   1. UC as default type with no holes at top of range.
- *   2. UC as default using holes at top of range.
+ *   2. UC as default using holes around the range.
  *   3. WB as default.
  * If using holes is optimal for a range when UC is the default type the
- * tag is updated to direct the commit routine to use a hole at the top
- * of a range.
+ * tag is updated to direct the commit routine to carve holes around the
+ * range.
  */
 #define MTRR_ALGO_SHIFT (8)
 #define MTRR_TAG_MASK ((1 << MTRR_ALGO_SHIFT) - 1)
@@ -362,9 +367,17 @@ static void commit_fixed_mtrrs(void)
 		printk(BIOS_DEBUG, "MTRR: Fixed MSR 0x%lx 0x%08x%08x\n",
 		       msr_index[i], fixed_msrs[i].hi, fixed_msrs[i].lo);
 
-	disable_cache();
+	/* APs usually come up with the BSP's MTRRs already in place. */
 	for (i = 0; i < ARRAY_SIZE(fixed_msrs); i++)
-		wrmsr(msr_index[i], fixed_msrs[i]);
+		if (!msr_equal(rdmsr(msr_index[i]), fixed_msrs[i]))
+			break;
+	if (i == ARRAY_SIZE(fixed_msrs))
+		return;
+
+	disable_cache();
+	for (; i < ARRAY_SIZE(fixed_msrs); i++)
+		if (!msr_equal(rdmsr(msr_index[i]), fixed_msrs[i]))
+			wrmsr(msr_index[i], fixed_msrs[i]);
 	enable_cache();
 }
 
@@ -485,22 +498,89 @@ static void calc_var_mtrr_range(struct var_mtrr_state *var_state,
 	}
 }
 
+/* Returns the number of variable MTRRs calc_var_mtrr_range() would use. */
+static int var_mtrr_range_count(uint32_t base, uint32_t size)
+{
+	int count = 0;
+
+	while (size != 0) {
+		uint32_t addr_lsb;
+		uint32_t size_msb;
+		uint32_t mtrr_size;
+
+		addr_lsb = fls(base);
+		size_msb = fms(size);
+
+		if (addr_lsb > size_msb)
+			mtrr_size = 1 << size_msb;
+		else
+			mtrr_size = 1 << addr_lsb;
+
+		size -= mtrr_size;
+		base += mtrr_size;
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * Find how far a hole may extend around [a1, a2) without touching another
+ * range that is not of the default type. Ranges below 1MiB don't count
+ * since the fixed MTRRs take precedence there.
+ */
+static void var_mtrr_hole_limits(struct var_mtrr_state *var_state,
+				 struct range_entry *r, uint32_t a1,
+				 uint32_t a2, uint32_t *lo, uint64_t *hi)
+{
+	struct range_entry *e;
+
+	*lo = 0;
+	*hi = 1ULL << ADDR_SHIFT_TO_RANGE_SHIFT(var_state->address_bits);
+
+	memranges_each_entry(e, var_state->addr_space) {
+		uint64_t base = PHYS_TO_RANGE_ADDR(range_entry_base(e));
+		uint64_t end = PHYS_TO_RANGE_ADDR(range_entry_end(e));
+
+		if (e == r || range_entry_mtrr_type(e) == var_state->def_mtrr_type)
+			continue;
+		if (end <= RANGE_1MB)
+			continue;
+		if (end <= a1 && end > *lo)
+			*lo = end;
+		if (base >= a2 && base < *hi)
+			*hi = base;
+	}
+
+	/* Nothing above 4GiB is processed, so don't reach beyond it. */
+	if (!var_state->above4gb && *hi > RANGE_4GB)
+		*hi = RANGE_4GB;
+}
+
 static void calc_var_mtrrs_with_hole(struct var_mtrr_state *var_state,
                                      struct range_entry *r)
 {
-	uint32_t a1, a2, b1, b2;
+	uint32_t a1, a2, b1, b2, lo;
+	uint32_t best_b1, best_b2;
+	uint64_t hi;
 	int mtrr_type;
+	int i, j, best;
+	int low_count[32];
 	struct range_entry *next;
 
 	/*
 	 * Determine MTRRs based on the following algorithm for the given entry:
-	 * +------------------+ b2 = ALIGN_UP(end)
-	 * |  0 or more bytes | <-- hole is carved out between b1 and b2
-	 * +------------------+ a2 = b1 = end
+	 * +------------------+ b2 >= end
+	 * |  0 or more bytes | <-- hole is carved out between a2 and b2
+	 * +------------------+ a2 = end
 	 * |                  |
 	 * +------------------+ a1 = begin
+	 * |  0 or more bytes | <-- hole is carved out between b1 and a1
+	 * +------------------+ b1 <= begin
 	 *
-	 * Thus, there are 3 sub-ranges to configure variable MTRRs for.
+	 * b1 and b2 are tried at every alignment that keeps the holes clear
+	 * of other ranges, and the combination using the fewest MTRRs wins.
+	 * b1 = a1 and b2 = a2 is the plain range without holes.
 	 */
 	mtrr_type = range_entry_mtrr_type(r);
 
@@ -529,8 +609,6 @@ static void calc_var_mtrrs_with_hole(struct var_mtrr_state *var_state,
 
 	next = memranges_next_entry(var_state->addr_space, r);
 
-	b1 = a2;
-
 	/* First check if a1 is >= 4GiB and the current entry is the last
 	 * entry. If so perform an optimization of covering a larger range
 	 * defined by the base address' alignment. */
@@ -545,22 +623,48 @@ static void calc_var_mtrrs_with_hole(struct var_mtrr_state *var_state,
 		}
 	}
 
-	/* Handle the min alignment roundup case. */
-	b2 = ALIGN_UP(a2, MTRR_MIN_ALIGN);
-
-	/* Check against the next range. If the current range_entry is the
-	 * last entry then carving a hole is no problem. If the current entry
-	 * isn't the last entry then check that the last entry covers the
-	 * entire hole range with the default mtrr type. */
-	if (next != NULL &&
-	    (range_entry_mtrr_type(next) != var_state->def_mtrr_type ||
-	     range_entry_end_mtrr_addr(next) < b2)) {
-		calc_var_mtrr_range(var_state, a1, a2 - a1, mtrr_type);
-		return;
+	var_mtrr_hole_limits(var_state, r, a1, a2, &lo, &hi);
+
+	/* Cost of the hole below the range for each alignment of b1. */
+	for (i = 0; i < 32; i++) {
+		b1 = ALIGN_DOWN(a1, 1UL << i);
+		low_count[i] = b1 < lo ? -1 : var_mtrr_range_count(b1, a1 - b1);
+	}
+
+	best = var_mtrr_range_count(a1, a2 - a1);
+	best_b1 = a1;
+	best_b2 = a2;
+
+	for (j = 0; j < 32; j++) {
+		uint64_t up = ALIGN_UP((uint64_t)a2, 1ULL << j);
+		int high_count;
+
+		if (up > hi || up > UINT32_MAX)
+			break;
+		b2 = up;
+		high_count = var_mtrr_range_count(a2, b2 - a2);
+
+		for (i = 0; i < 32; i++) {
+			int count;
+
+			if (low_count[i] < 0)
+				break;
+			b1 = ALIGN_DOWN(a1, 1UL << i);
+			count = var_mtrr_range_count(b1, b2 - b1) +
+				low_count[i] + high_count;
+			if (count < best) {
+				best = count;
+				best_b1 = b1;
+				best_b2 = b2;
+			}
+		}
 	}
 
-	calc_var_mtrr_range(var_state, a1, b2 - a1, mtrr_type);
-	calc_var_mtrr_range(var_state, b1, b2 - b1, var_state->def_mtrr_type);
+	calc_var_mtrr_range(var_state, best_b1, best_b2 - best_b1, mtrr_type);
+	calc_var_mtrr_range(var_state, best_b1, a1 - best_b1,
+			    var_state->def_mtrr_type);
+	calc_var_mtrr_range(var_state, a2, best_b2 - a2,
+			    var_state->def_mtrr_type);
 }
 
 static void calc_var_mtrrs_without_hole(struct var_mtrr_state *var_state,
@@ -645,7 +749,7 @@ static void __calc_var_mtrrs(struct memranges *addr_space,
 	/*
 	 * For each range do 3 calculations:
 	 *   1. UC as default type with no holes at top of range.
-	 *   2. UC as default using holes at top of range.
+	 *   2. UC as default using holes around the range.
 	 *   3. WB as default.
 	 * The lowest count is then used as default after totaling all
 	 * MTRRs. Note that the optimal algorithm for UC default is marked in
@@ -765,19 +869,49 @@ static void prepare_var_mtrrs(struct memranges *addr_space, int def_type,
 	sol->num_used = var_state.mtrr_index;
 }
 
+/* Returns 1 if variable MTRR i already holds what the solution wants. */
+static int var_mtrr_matches(const struct var_mtrr_solution *sol, int i)
+{
+	msr_t mask = rdmsr(MTRRphysMask_MSR(i));
+
+	if (i >= sol->num_used)
+		return !(mask.lo & MTRRphysMaskValid);
+
+	return msr_equal(mask, sol->regs[i].mask) &&
+	       msr_equal(rdmsr(MTRRphysBase_MSR(i)), sol->regs[i].base);
+}
+
 static void commit_var_mtrrs(const struct var_mtrr_solution *sol)
 {
+	msr_t def_type;
 	int i;
 
+	/*
+	 * Every cpu commits the same solution, and most of them already have
+	 * it from the BSP. Only pay for the cache flush when something is
+	 * actually different, and then only rewrite what differs.
+	 */
+	def_type = rdmsr(MTRRdefType_MSR);
+	for (i = 0; i < total_mtrrs; i++)
+		if (!var_mtrr_matches(sol, i))
+			break;
+	if (i == total_mtrrs && (def_type.lo & MTRRdefTypeEn) &&
+	    (def_type.lo & 0xff) == sol->mtrr_default_type)
+		return;
+
 	/* Write out the variable MTRRs. */
 	disable_cache();
-	for (i = 0; i < sol->num_used; i++) {
+	for (; i < total_mtrrs; i++) {
+		if (var_mtrr_matches(sol, i))
+			continue;
+		if (i >= sol->num_used) {
+			/* Clear the ones that are unused. */
+			clear_var_mtrr(i);
+			continue;
+		}
 		wrmsr(MTRRphysBase_MSR(i), sol->regs[i].base);
 		wrmsr(MTRRphysMask_MSR(i), sol->regs[i].mask);
 	}
-	/* Clear the ones that are unused. */
-	for (; i < total_mtrrs; i++)
-		clear_var_mtrr(i);
 	enable_var_mtrr(sol->mtrr_default_type);
 	enable_cache();
 
@@ -1,19 +1,23 @@
 #include <console/console.h>
+#include <arch/acpi.h>
 #include <arch/io.h>
+#include <bootstate.h>
+#include <cbmem.h>
 #include <cpu/x86/msr.h>
 #include <cpu/x86/tsc.h>
 #include <smp/spinlock.h>
 #include <delay.h>
+#include <stdlib.h>
 #include <thread.h>
 
 #if !defined(__PRE_RAM__)
 
-static unsigned long clocks_per_usec;
+static unsigned long tsc_khz;
 
 #if CONFIG_TSC_CONSTANT_RATE
 static unsigned long calibrate_tsc(void)
 {
-	return tsc_freq_mhz();
+	return tsc_freq_mhz() * 1000;
 }
 #else /* CONFIG_TSC_CONSTANT_RATE */
 #if !CONFIG_TSC_CALIBRATE_WITH_IO
@@ -78,7 +82,9 @@ static unsigned long long calibrate_tsc(void)
 		if (end.lo <= CALIBRATE_DIVISOR)
 			goto bad_ctc;
 
-		return CEIL_DIV(end.lo, CALIBRATE_DIVISOR);
+		/* In kHz, the interval is CALIBRATE_INTERVAL PIT ticks. */
+		return (unsigned long long)end.lo * CLOCK_TICK_RATE /
+		       (CALIBRATE_INTERVAL * 1000);
 	}
 
 	/*
@@ -143,31 +149,71 @@ static unsigned long long calibrate_tsc(void)
 	printk(BIOS_SPEW, "%s 32-bit result is %ld\n",
 			__func__,
 			result);
-	return delta;
+	/* In kHz, from the full count so the fraction of a MHz isn't lost. */
+	return ((end - start) * 1000) >> 20;
 }
 
 
 #endif /* CONFIG_TSC_CALIBRATE_WITH_IO */
 #endif /* CONFIG_TSC_CONSTANT_RATE */
 
+#if ENV_RAMSTAGE
+/* The frequency doesn't change across S3, don't measure it again. */
+static unsigned long tsc_info_restore(void)
+{
+	struct tsc_info *info;
+
+	if (!acpi_is_wakeup_s3())
+		return 0;
+
+	info = cbmem_find(CBMEM_ID_TSC_INFO);
+	if (info == NULL)
+		return 0;
+
+	return info->freq_khz;
+}
+
+static void tsc_info_save(void *unused)
+{
+	struct tsc_info *info;
+
+	info = cbmem_add(CBMEM_ID_TSC_INFO, sizeof(*info));
+	if (info != NULL)
+		info->freq_khz = tsc_freq_khz();
+}
+
+BOOT_STATE_INIT_ENTRIES(tsc_info_bscb) = {
+	BOOT_STATE_INIT_ENTRY(BS_WRITE_TABLES, BS_ON_ENTRY,
+			      tsc_info_save, NULL),
+};
+#else
+static inline unsigned long tsc_info_restore(void)
+{
+	return 0;
+}
+#endif
+
 void init_timer(void)
 {
-	if (!clocks_per_usec) {
-		clocks_per_usec = calibrate_tsc();
-		printk(BIOS_INFO, "clocks_per_usec: %lu\n", clocks_per_usec);
-	}
+	if (tsc_khz)
+		return;
+
+	tsc_khz = tsc_info_restore();
+	if (!tsc_khz)
+		tsc_khz = calibrate_tsc();
+	printk(BIOS_INFO, "TSC: %lu kHz\n", tsc_khz);
 }
 
-static inline unsigned long get_clocks_per_usec(void)
+unsigned long tsc_freq_khz(void)
 {
 	init_timer();
-	return clocks_per_usec;
+	return tsc_khz;
 }
 #else /* !defined(__PRE_RAM__) */
 /* romstage calls into cpu/board specific function every time. */
-static inline unsigned long get_clocks_per_usec(void)
+static inline unsigned long tsc_freq_khz(void)
 {
-	return tsc_freq_mhz();
+	return tsc_freq_mhz() * 1000;
 }
 #endif /* !defined(__PRE_RAM__) */
 
@@ -182,7 +228,7 @@ void udelay(unsigned us)
 
 	start = rdtscll();
 	clocks = us;
-	clocks *= get_clocks_per_usec();
+	clocks = CEIL_DIV(clocks * tsc_freq_khz(), 1000);
 	current = rdtscll();
 	while((current - start) < clocks) {
 		cpu_relax();
@@ -195,34 +241,22 @@ void udelay(unsigned us)
 
 static struct monotonic_counter {
 	int initialized;
-	struct mono_time time;
-	uint64_t last_value;
+	uint64_t start;
 } mono_counter;
 
 void timer_monotonic_get(struct mono_time *mt)
 {
-	uint64_t current_tick;
 	uint64_t ticks_elapsed;
 
 	if (!mono_counter.initialized) {
 		init_timer();
-		mono_counter.last_value = rdtscll();
+		mono_counter.start = rdtscll();
 		mono_counter.initialized = 1;
 	}
 
-	current_tick = rdtscll();
-	ticks_elapsed = current_tick - mono_counter.last_value;
-
-	/* Update current time and tick values only if a full tick occurred. */
-	if (ticks_elapsed >= clocks_per_usec) {
-		uint64_t usecs_elapsed;
-
-		usecs_elapsed = ticks_elapsed / clocks_per_usec;
-		mono_time_add_usecs(&mono_counter.time, (long)usecs_elapsed);
-		mono_counter.last_value = current_tick;
-	}
-
-	/* Save result. */
-	*mt = mono_counter.time;
+	/* Always scaled from the start, so the fractions of a microsecond
+	 * left over at each call don't add up to the clock running slow. */
+	ticks_elapsed = rdtscll() - mono_counter.start;
+	mono_time_set_usecs(mt, (long)(ticks_elapsed * 1000 / tsc_khz));
 }
 #endif
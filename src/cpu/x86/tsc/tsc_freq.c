@@ -0,0 +1,74 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The TSC frequency for when the TSC isn't the delay timer. It's measured
+ * against the monotonic timer from before the devices are initialized to
+ * when it's first asked for, normally when the tables are written. Over
+ * that span the measurement is precise without waiting for anything.
+ */
+
+#include <bootstate.h>
+#include <console/console.h>
+#include <cpu/x86/tsc.h>
+#include <timer.h>
+
+/* The shortest span to measure over, 100ppm at the timer's resolution. */
+#define TSC_MEASURE_USECS	10000
+
+static struct {
+	int valid;
+	struct mono_time time;
+	unsigned long long tsc;
+} tsc_start;
+
+static void tsc_measure_start(void *unused)
+{
+	timer_monotonic_get(&tsc_start.time);
+	tsc_start.tsc = rdtscll();
+	tsc_start.valid = 1;
+}
+
+BOOT_STATE_INIT_ENTRIES(tsc_freq_bscb) = {
+	BOOT_STATE_INIT_ENTRY(BS_PRE_DEVICE, BS_ON_ENTRY,
+			      tsc_measure_start, NULL),
+};
+
+unsigned long tsc_freq_khz(void)
+{
+	static unsigned long tsc_khz;
+	struct mono_time now;
+	unsigned long long tsc;
+	long usecs;
+
+	if (tsc_khz)
+		return tsc_khz;
+
+	if (!tsc_start.valid)
+		tsc_measure_start(NULL);
+
+	do {
+		timer_monotonic_get(&now);
+		tsc = rdtscll();
+		usecs = mono_time_diff_microseconds(&tsc_start.time, &now);
+	} while (usecs < TSC_MEASURE_USECS);
+
+	tsc_khz = (tsc - tsc_start.tsc) * 1000 / usecs;
+	printk(BIOS_INFO, "TSC: %lu kHz over %ld us\n", tsc_khz, usecs);
+
+	return tsc_khz;
+}
@@ -32,8 +32,10 @@ void remap_bsp_lapic(struct bus *cpu_bus)
 		cpu_path.type = DEVICE_PATH_APIC;
 		cpu_path.apic.apic_id = 0;
 		cpu = find_dev_path(cpu_bus, &cpu_path);
-		if (cpu)
+		if (cpu) {
 			cpu->path.apic.apic_id = bsp_lapic_id;
+			dev_index_path(cpu);
+		}
 	}
 }
 
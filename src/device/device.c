@@ -142,8 +142,10 @@ static device_t __alloc_dev(struct bus *parent, struct device_path *path)
 	/* Append a new device to the global device list.
 	 * The list is used to find devices once everything is set up.
 	 */
+	dev->seq = last_dev->seq + 1;
 	last_dev->next = dev;
 	last_dev = dev;
+	dev_index_path(dev);
 
 	return dev;
 }
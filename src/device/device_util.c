@@ -22,12 +22,15 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <bootstate.h>
 #include <console/console.h>
 #include <device/device.h>
 #include <device/path.h>
 #include <device/pci_def.h>
 #include <device/resource.h>
+#include <smp/spinlock.h>
 #include <string.h>
+#include <timestamp.h>
 
 /**
  * See if a device structure exists for path.
@@ -47,6 +50,155 @@ device_t find_dev_path(struct bus *parent, struct device_path *path)
 	return child;
 }
 
+DECLARE_SPIN_LOCK(dev_index_lock)
+
+enum {
+	LOOKUP_SLOT,
+	LOOKUP_SMBUS,
+	LOOKUP_PNP,
+	LOOKUP_LAPIC,
+	LOOKUP_DEVICE,
+	LOOKUP_CLASS,
+	LOOKUP_COUNT
+};
+
+#if IS_ENABLED(CONFIG_DEVICE_LOOKUP_STATS)
+static const char *const lookup_names[LOOKUP_COUNT] = {
+	"dev_find_slot", "dev_find_slot_on_smbus", "dev_find_slot_pnp",
+	"dev_find_lapic", "dev_find_device", "dev_find_class",
+};
+
+static struct lookup_stats {
+	u32 calls;
+	u32 steps;	/* Devices looked at. */
+	u64 ticks;
+} lookup_stats[LOOKUP_COUNT];
+#endif
+
+static inline u64 lookup_begin(void)
+{
+	spin_lock(&dev_index_lock);
+#if IS_ENABLED(CONFIG_DEVICE_LOOKUP_STATS)
+	return timestamp_get();
+#else
+	return 0;
+#endif
+}
+
+static inline void lookup_end(int which, u64 start, unsigned int steps)
+{
+#if IS_ENABLED(CONFIG_DEVICE_LOOKUP_STATS)
+	lookup_stats[which].calls++;
+	lookup_stats[which].steps += steps;
+	lookup_stats[which].ticks += timestamp_get() - start;
+#endif
+	spin_unlock(&dev_index_lock);
+}
+
+#define LOOKUP_BEGIN()		u64 lookup_start = lookup_begin(); \
+				unsigned int lookup_steps = 0
+#define LOOKUP_STEP()		lookup_steps++
+#define LOOKUP_END(which)	lookup_end(which, lookup_start, lookup_steps)
+
+/*
+ * Returns 1 and the DEV_INDEX_PATH key of path if it has one. util/sconfig
+ * lays out the chains of the static devices with the same keys.
+ */
+static int dev_path_key(const struct device_path *path, u32 *key)
+{
+	switch (path->type) {
+	case DEVICE_PATH_PCI:
+		*key = path->pci.devfn << 16;
+		return 1;
+	case DEVICE_PATH_PNP:
+		*key = path->pnp.port << 16 ^ path->pnp.device;
+		return 1;
+	case DEVICE_PATH_I2C:
+		*key = path->i2c.device << 16;
+		return 1;
+	case DEVICE_PATH_APIC:
+		*key = path->apic.apic_id << 16;
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static inline struct device *index_head(int index, u32 key)
+{
+	return dev_index[index][dev_index_hash(key)];
+}
+
+static void index_unlink(struct device *dev, int index)
+{
+	struct device **p;
+
+	if (!dev->index_slot[index])
+		return;
+
+	p = &dev_index[index][dev->index_slot[index] - 1];
+	while (*p && *p != dev)
+		p = &(*p)->index_next[index];
+	if (*p)
+		*p = dev->index_next[index];
+
+	dev->index_next[index] = NULL;
+	dev->index_slot[index] = 0;
+}
+
+/* The chains are kept in all_devices order, as the lookups walked that. */
+static void index_link(struct device *dev, int index, u32 key)
+{
+	unsigned int bucket = dev_index_hash(key);
+	struct device **p = &dev_index[index][bucket];
+
+	while (*p && (*p)->seq < dev->seq)
+		p = &(*p)->index_next[index];
+
+	dev->index_next[index] = *p;
+	*p = dev;
+	dev->index_slot[index] = bucket + 1;
+}
+
+/**
+ * File a device in the path index.
+ *
+ * alloc_dev() does this for new devices. Code that changes the path of a
+ * device afterwards, like the APIC ID of a CPU, has to call it again.
+ *
+ * @param dev The device.
+ */
+void dev_index_path(struct device *dev)
+{
+	u32 key;
+
+	spin_lock(&dev_index_lock);
+	index_unlink(dev, DEV_INDEX_PATH);
+	if (dev_path_key(&dev->path, &key))
+		index_link(dev, DEV_INDEX_PATH, key);
+	spin_unlock(&dev_index_lock);
+}
+
+/**
+ * File a device in the vendor/device ID and class indexes.
+ *
+ * Has to be called whenever the vendor, device or class fields of a device
+ * are set. Devices with those fields 0 are not indexed.
+ *
+ * @param dev The device.
+ */
+void dev_index_ids(struct device *dev)
+{
+	spin_lock(&dev_index_lock);
+	index_unlink(dev, DEV_INDEX_ID);
+	index_unlink(dev, DEV_INDEX_CLASS);
+	if (dev->vendor || dev->device)
+		index_link(dev, DEV_INDEX_ID, dev->vendor << 16 ^ dev->device);
+	if (dev->class >> 8)
+		index_link(dev, DEV_INDEX_CLASS, dev->class >> 8);
+	spin_unlock(&dev_index_lock);
+}
+
 /**
  * Given a PCI bus and a devfn number, find the device structure.
  *
@@ -56,18 +208,20 @@ device_t find_dev_path(struct bus *parent, struct device_path *path)
  */
 struct device *dev_find_slot(unsigned int bus, unsigned int devfn)
 {
-	struct device *dev, *result;
+	struct device *dev;
+	LOOKUP_BEGIN();
 
-	result = 0;
-	for (dev = all_devices; dev; dev = dev->next) {
+	for (dev = index_head(DEV_INDEX_PATH, devfn << 16); dev;
+	     dev = dev->index_next[DEV_INDEX_PATH]) {
+		LOOKUP_STEP();
 		if ((dev->path.type == DEVICE_PATH_PCI) &&
 		    (dev->bus->secondary == bus) &&
-		    (dev->path.pci.devfn == devfn)) {
-			result = dev;
+		    (dev->path.pci.devfn == devfn))
 			break;
-		}
 	}
-	return result;
+
+	LOOKUP_END(LOOKUP_SLOT);
+	return dev;
 }
 
 /**
@@ -79,18 +233,20 @@ struct device *dev_find_slot(unsigned int bus, unsigned int devfn)
  */
 struct device *dev_find_slot_on_smbus(unsigned int bus, unsigned int addr)
 {
-	struct device *dev, *result;
+	struct device *dev;
+	LOOKUP_BEGIN();
 
-	result = 0;
-	for (dev = all_devices; dev; dev = dev->next) {
+	for (dev = index_head(DEV_INDEX_PATH, addr << 16); dev;
+	     dev = dev->index_next[DEV_INDEX_PATH]) {
+		LOOKUP_STEP();
 		if ((dev->path.type == DEVICE_PATH_I2C) &&
 		    (dev->bus->secondary == bus) &&
-		    (dev->path.i2c.device == addr)) {
-			result = dev;
+		    (dev->path.i2c.device == addr))
 			break;
-		}
 	}
-	return result;
+
+	LOOKUP_END(LOOKUP_SMBUS);
+	return dev;
 }
 
 /**
@@ -103,15 +259,19 @@ struct device *dev_find_slot_on_smbus(unsigned int bus, unsigned int addr)
 struct device *dev_find_slot_pnp(u16 port, u16 device)
 {
 	struct device *dev;
+	LOOKUP_BEGIN();
 
-	for (dev = all_devices; dev; dev = dev->next) {
+	for (dev = index_head(DEV_INDEX_PATH, port << 16 ^ device); dev;
+	     dev = dev->index_next[DEV_INDEX_PATH]) {
+		LOOKUP_STEP();
 		if ((dev->path.type == DEVICE_PATH_PNP) &&
 		    (dev->path.pnp.port == port) &&
-		    (dev->path.pnp.device == device)) {
-			return dev;
-		}
+		    (dev->path.pnp.device == device))
+			break;
 	}
-	return 0;
+
+	LOOKUP_END(LOOKUP_PNP);
+	return dev;
 }
 
 /**
@@ -122,16 +282,19 @@ struct device *dev_find_slot_pnp(u16 port, u16 device)
  */
 device_t dev_find_lapic(unsigned apic_id)
 {
-	device_t dev, result = NULL;
+	device_t dev;
+	LOOKUP_BEGIN();
 
-	for (dev = all_devices; dev; dev = dev->next) {
+	for (dev = index_head(DEV_INDEX_PATH, apic_id << 16); dev;
+	     dev = dev->index_next[DEV_INDEX_PATH]) {
+		LOOKUP_STEP();
 		if (dev->path.type == DEVICE_PATH_APIC &&
-		    dev->path.apic.apic_id == apic_id) {
-			result = dev;
+		    dev->path.apic.apic_id == apic_id)
 			break;
-		}
 	}
-	return result;
+
+	LOOKUP_END(LOOKUP_LAPIC);
+	return dev;
 }
 
 /**
@@ -146,15 +309,28 @@ device_t dev_find_lapic(unsigned apic_id)
  */
 struct device *dev_find_device(u16 vendor, u16 device, struct device *from)
 {
-	if (!from)
-		from = all_devices;
-	else
-		from = from->next;
-
-	while (from && (from->vendor != vendor || from->device != device))
-		from = from->next;
+	struct device *dev;
+	LOOKUP_BEGIN();
+
+	if (!vendor && !device) {
+		/* Devices without IDs are not indexed. */
+		dev = from ? from->next : all_devices;
+		while (dev && (dev->vendor || dev->device)) {
+			LOOKUP_STEP();
+			dev = dev->next;
+		}
+	} else {
+		for (dev = index_head(DEV_INDEX_ID, vendor << 16 ^ device);
+		     dev; dev = dev->index_next[DEV_INDEX_ID]) {
+			LOOKUP_STEP();
+			if (dev->vendor == vendor && dev->device == device &&
+			    (!from || dev->seq > from->seq))
+				break;
+		}
+	}
 
-	return from;
+	LOOKUP_END(LOOKUP_DEVICE);
+	return dev;
 }
 
 /**
@@ -168,17 +344,48 @@ struct device *dev_find_device(u16 vendor, u16 device, struct device *from)
  */
 struct device *dev_find_class(unsigned int class, struct device *from)
 {
-	if (!from)
-		from = all_devices;
-	else
-		from = from->next;
+	struct device *dev;
+	LOOKUP_BEGIN();
+
+	if (!(class >> 8)) {
+		/* Devices without a class are not indexed. */
+		dev = from ? from->next : all_devices;
+		while (dev && (dev->class & 0xffffff00) != class) {
+			LOOKUP_STEP();
+			dev = dev->next;
+		}
+	} else {
+		for (dev = index_head(DEV_INDEX_CLASS, class >> 8); dev;
+		     dev = dev->index_next[DEV_INDEX_CLASS]) {
+			LOOKUP_STEP();
+			if ((dev->class & 0xffffff00) == class &&
+			    (!from || dev->seq > from->seq))
+				break;
+		}
+	}
 
-	while (from && (from->class & 0xffffff00) != class)
-		from = from->next;
+	LOOKUP_END(LOOKUP_CLASS);
+	return dev;
+}
 
-	return from;
+#if IS_ENABLED(CONFIG_DEVICE_LOOKUP_STATS)
+static void print_lookup_stats(void *unused)
+{
+	int i;
+
+	printk(BIOS_DEBUG, "Device lookups:\n");
+	for (i = 0; i < LOOKUP_COUNT; i++)
+		printk(BIOS_DEBUG, "%24s: %6u calls, %7u devices looked at, "
+		       "%llu ticks\n", lookup_names[i], lookup_stats[i].calls,
+		       lookup_stats[i].steps, lookup_stats[i].ticks);
 }
 
+BOOT_STATE_INIT_ENTRIES(lookup_stats_bscb) = {
+	BOOT_STATE_INIT_ENTRY(BS_PAYLOAD_BOOT, BS_ON_ENTRY,
+			      print_lookup_stats, NULL),
+};
+#endif
+
 /**
  * Encode the device path into 3 bytes for logging to CMOS.
  *
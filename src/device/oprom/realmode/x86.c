@@ -31,6 +31,7 @@
 #include <device/pci_ids.h>
 #include <lib/jpeg.h>
 #include <pc80/i8259.h>
+#include <profiler.h>
 #include <string.h>
 #include <vbe.h>
 
@@ -283,15 +284,19 @@ void vbe_set_graphics(void)
 	}
 	decdata = malloc(sizeof(*decdata));
 	int ret = 0;
-	ret = jpeg_decode(jpeg, framebuffer, 1024, 768, 16, decdata);
+	ret = jpeg_decode_scaled(jpeg, framebuffer, 1024, 768, 16,
+				 le16_to_cpu(mode_info.vesa.bytes_per_scanline),
+				 0, decdata);
 #endif
 }
 
 void vbe_textmode_console(void)
 {
 	delay(2);
+	profiler_pause();
 	realmode_interrupt(0x10, 0x0003, 0x0000, 0x0000,
 				0x0000, 0x0000, 0x0000);
+	profiler_resume();
 }
 
 void fill_lb_framebuffer(struct lb_framebuffer *framebuffer)
@@ -322,6 +327,9 @@ void run_bios(struct device *dev, unsigned long addr)
 {
 	u32 num_dev = (dev->bus->secondary << 8) | dev->path.pci.devfn;
 
+	/* The option ROM runs with its own IDT and may enable interrupts. */
+	profiler_pause();
+
 	/* Setting up required hardware.
 	 * Removing this will cause random illegal instruction exceptions
 	 * in some option roms.
@@ -350,6 +358,8 @@ void run_bios(struct device *dev, unsigned long addr)
 	if ((dev->class >> 8)== PCI_CLASS_DISPLAY_VGA)
 		vbe_set_graphics();
 #endif
+
+	profiler_resume();
 }
 
 #if CONFIG_GEODE_VSA
@@ -411,8 +421,10 @@ void do_vsmbios(void)
 	printk(BIOS_DEBUG, "Calling VSA module...\n");
 
 	/* ECX gets SMM, EDX gets SYSMEM */
+	profiler_pause();
 	realmode_call(VSA2_ENTRY_POINT, 0x0, 0x0, MSR_GLIU0_SMM,
 			MSR_GLIU0_SYSMEM, 0x0, 0x0);
+	profiler_resume();
 
 	printk(BIOS_DEBUG, "... VSA module returned.\n");
 
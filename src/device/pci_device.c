@@ -1036,6 +1036,7 @@ device_t pci_probe_dev(device_t dev, struct bus *bus, unsigned devfn)
 
 	/* Class code, the upper 3 bytes of PCI_CLASS_REVISION. */
 	dev->class = class >> 8;
+	dev_index_ids(dev);
 
 	/* Architectural/System devices always need to be bus masters. */
 	if ((dev->class >> 16) == PCI_BASE_CLASS_SYSTEM)
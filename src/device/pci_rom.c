@@ -28,6 +28,7 @@
 #include <device/pci_ops.h>
 #include <string.h>
 #include <cbfs.h>
+#include <measured_boot.h>
 
 /* Rmodules don't like weak symbols. */
 u32 __attribute__((weak)) map_oprom_vendev(u32 vendev) { return vendev; }
@@ -164,8 +165,12 @@ struct rom_header *pci_rom_load(struct device *dev,
 			printk(BIOS_DEBUG, "Copying VGA ROM Image from %p to "
 			       "0x%x, 0x%x bytes\n", rom_header,
 			       PCI_VGA_RAM_IMAGE_START, rom_size);
-			memcpy((void *)PCI_VGA_RAM_IMAGE_START, rom_header,
-			       rom_size);
+			measure_copy(MEASURE_PCR_OPTION_ROM, dev_path(dev),
+				     (void *)PCI_VGA_RAM_IMAGE_START, rom_header,
+				     rom_size);
+		} else {
+			measure_data(MEASURE_PCR_OPTION_ROM, dev_path(dev),
+				     rom_header, rom_size);
 		}
 		return (struct rom_header *) (PCI_VGA_RAM_IMAGE_START);
 	}
@@ -173,7 +178,8 @@ struct rom_header *pci_rom_load(struct device *dev,
 	printk(BIOS_DEBUG, "Copying non-VGA ROM image from %p to %p, 0x%x "
 	       "bytes\n", rom_header, pci_ram_image_start, rom_size);
 
-	memcpy(pci_ram_image_start, rom_header, rom_size);
+	measure_copy(MEASURE_PCR_OPTION_ROM, dev_path(dev), pci_ram_image_start,
+		     rom_header, rom_size);
 	pci_ram_image_start += rom_size;
 	return (struct rom_header *) (pci_ram_image_start-rom_size);
 }
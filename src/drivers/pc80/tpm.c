@@ -34,6 +34,8 @@
 #include <arch/byteorder.h>
 #include <console/console.h>
 #include <tpm.h>
+#include <timer.h>
+#include <cbmem.h>
 #include <arch/early_variables.h>
 
 #define PREFIX "lpc_tpm: "
@@ -54,6 +56,8 @@
 #define writeb(_v, _a) (*(volatile unsigned char *) (_a) = (_v))
 #define readl(_a) (*(volatile unsigned long *) (_a))
 #define writel(_v, _a) (*(volatile unsigned long *) (_a) = (_v))
+#define read32(_a) (*(volatile u32 *) (_a))
+#define write32(_v, _a) (*(volatile u32 *) (_a) = (_v))
 /* coreboot wrapper for TPM driver (end) */
 
 #ifndef CONFIG_TPM_TIS_BASE_ADDRESS
@@ -93,6 +97,9 @@
 #define TIS_ACCESS_REQUEST_USE         (1 << 1) /* 0x02 */
 #define TIS_ACCESS_TPM_ESTABLISHMENT   (1 << 0) /* 0x01 */
 
+#define TIS_CAP_INTERFACE_VERSION(c)   (((c) >> 28) & 0x7)
+#define TIS_INTERFACE_VERSION_1_3      2
+
 /*
  * Error value returned if a tpm register does not enter the expected state
  * after continuous polling. No actual TPM register reading ever returns ~0,
@@ -107,6 +114,12 @@
  /* 1 second is plenty for anything TPM does.*/
 #define MAX_DELAY_US	(1000 * 1000)
 
+/*
+ * Polls back off up to this interval. Commands take milliseconds to run, so
+ * there is no point in asking every microsecond.
+ */
+#define MAX_POLL_US	64
+
 /*
  * Structures defined below allow creating descriptions of TPM vendor/device
  * ID information for run time discovery. The only device the system knows
@@ -156,6 +169,42 @@ static const struct vendor_name vendor_names[] = {
  */
 static u32 vendor_dev_id CAR_GLOBAL;
 
+/*
+ * Set if the TPM implements the 1.3 interface, which allows 32-bit accesses
+ * to the data FIFO and the status register.
+ */
+static int wide_fifo CAR_GLOBAL;
+
+/*
+ * Timed waits between polls of a register. The time is accounted for by
+ * the delays alone, so no timer is needed. udelay() lets other threads run
+ * while the TPM is busy.
+ */
+struct tis_poll {
+	u32 waited_us;
+	u32 step_us;
+};
+
+static inline void tis_poll_init(struct tis_poll *poll)
+{
+	poll->waited_us = 0;
+	poll->step_us = 1;
+}
+
+/* Returns 0 after waiting or TPM_TIMEOUT_ERR once the time is up. */
+static int tis_poll_wait(struct tis_poll *poll)
+{
+	if (poll->waited_us >= MAX_DELAY_US)
+		return TPM_TIMEOUT_ERR;
+
+	udelay(poll->step_us);
+	poll->waited_us += poll->step_us;
+	if (poll->step_us < MAX_POLL_US)
+		poll->step_us <<= 1;
+
+	return 0;
+}
+
 static inline u8 tpm_read_status(int locality)
 {
 	u8 value = readb(TIS_REG(locality, TIS_REG_STS));
@@ -182,11 +231,53 @@ static inline void tpm_write_data(u8 data, int locality)
 	writeb(data, TIS_REG(locality, TIS_REG_DATA_FIFO));
 }
 
+/* Move count bytes through the FIFO, 32 bits at a time if it allows so. */
+static void tpm_write_fifo(const u8 *data, u32 count, int locality)
+{
+	u32 value;
+
+	if (car_get_var(wide_fifo)) {
+		for (; count >= sizeof(value); count -= sizeof(value)) {
+			memcpy(&value, data, sizeof(value));
+			TPM_DEBUG_IO_WRITE(TIS_REG_DATA_FIFO, value);
+			write32(value, TIS_REG(locality, TIS_REG_DATA_FIFO));
+			data += sizeof(value);
+		}
+	}
+
+	while (count--)
+		tpm_write_data(*data++, locality);
+}
+
+static void tpm_read_fifo(u8 *data, u32 count, int locality)
+{
+	u32 value;
+
+	if (car_get_var(wide_fifo)) {
+		for (; count >= sizeof(value); count -= sizeof(value)) {
+			value = read32(TIS_REG(locality, TIS_REG_DATA_FIFO));
+			TPM_DEBUG_IO_READ(TIS_REG_DATA_FIFO, value);
+			memcpy(data, &value, sizeof(value));
+			data += sizeof(value);
+		}
+	}
+
+	while (count--)
+		*data++ = tpm_read_data(locality);
+}
+
 static inline u16 tpm_read_burst_count(int locality)
 {
 	u16 count;
-	count = readb(TIS_REG(locality, TIS_REG_BURST_COUNT));
-	count |= readb(TIS_REG(locality, TIS_REG_BURST_COUNT + 1)) << 8;
+
+	/* The status register and the burst count in one go. */
+	if (car_get_var(wide_fifo))
+		count = read32(TIS_REG(locality, TIS_REG_STS)) >> 8;
+	else {
+		count = readb(TIS_REG(locality, TIS_REG_BURST_COUNT));
+		count |= readb(TIS_REG(locality,
+				       TIS_REG_BURST_COUNT + 1)) << 8;
+	}
 	TPM_DEBUG_IO_READ(TIS_REG_BURST_COUNT, count);
 	return count;
 }
@@ -211,11 +302,19 @@ static inline u32 tpm_read_did_vid(int locality)
 	return value;
 }
 
+static inline u32 tpm_read_intf_capability(int locality)
+{
+	u32 value = read32(TIS_REG(locality, TIS_REG_INTF_CAPABILITY));
+	TPM_DEBUG_IO_READ(TIS_REG_INTF_CAPABILITY, value);
+	return value;
+}
+
 /*
  * tis_wait_sts()
  *
  * Wait for at least a second for a status to change its state to match the
- * expected state. Normally the transition happens within microseconds.
+ * expected state. Normally the transition happens within microseconds, but
+ * a command takes milliseconds to complete.
  *
  * @locality - locality
  * @mask - bitmask for the bitfield(s) to watch
@@ -225,14 +324,15 @@ static inline u32 tpm_read_did_vid(int locality)
  */
 static int tis_wait_sts(int locality, u8 mask, u8 expected)
 {
-	u32 time_us = MAX_DELAY_US;
-	while (time_us > 0) {
+	struct tis_poll poll;
+
+	tis_poll_init(&poll);
+	do {
 		u8 value = tpm_read_status(locality);
 		if ((value & mask) == expected)
 			return 0;
-		udelay(1); /* 1 us */
-		time_us--;
-	}
+	} while (!tis_poll_wait(&poll));
+
 	return TPM_TIMEOUT_ERR;
 }
 
@@ -278,14 +378,15 @@ static inline int tis_expect_data(int locality)
  */
 static int tis_wait_access(int locality, u8 mask, u8 expected)
 {
-	u32 time_us = MAX_DELAY_US;
-	while (time_us > 0) {
+	struct tis_poll poll;
+
+	tis_poll_init(&poll);
+	do {
 		u8 value = tpm_read_access(locality);
 		if ((value & mask) == expected)
 			return 0;
-		udelay(1); /* 1 us */
-		time_us--;
-	}
+	} while (!tis_poll_wait(&poll));
+
 	return TPM_TIMEOUT_ERR;
 }
 
@@ -375,6 +476,10 @@ static u32 tis_probe(void)
 
 	car_set_var(vendor_dev_id, didvid);
 
+	if (TIS_CAP_INTERFACE_VERSION(tpm_read_intf_capability(0)) >=
+	    TIS_INTERFACE_VERSION_1_3)
+		car_set_var(wide_fifo, 1);
+
 	vid = didvid & 0xffff;
 	did = (didvid >> 16) & 0xffff;
 	for (i = 0; i < ARRAY_SIZE(vendor_names); i++) {
@@ -400,12 +505,33 @@ static u32 tis_probe(void)
 	return 0;
 }
 
+/*
+ * tis_wait_burst()
+ *
+ * Wait for the TPM to accept or offer another burst of data.
+ *
+ * Returns the burst count, or 0 on timeout.
+ */
+static u16 tis_wait_burst(int locality)
+{
+	struct tis_poll poll;
+	u16 burst;
+
+	tis_poll_init(&poll);
+	while ((burst = tpm_read_burst_count(locality)) == 0) {
+		if (tis_poll_wait(&poll))
+			return 0;
+	}
+
+	return burst;
+}
+
 /*
  * tis_senddata()
  *
  * send the passed in data to the TPM device.
  *
- * @data - address of the data to send, byte by byte
+ * @data - address of the data to send, a burst at a time
  * @len - length of the data to send
  *
  * Returns 0 on success, TPM_DRIVER_ERR on error (in case the device does
@@ -414,8 +540,7 @@ static u32 tis_probe(void)
 static u32 tis_senddata(const u8 * const data, u32 len)
 {
 	u32 offset = 0;
-	u16 burst = 0;
-	u32 max_cycles = 0;
+	u16 burst;
 	u8 locality = 0;
 
 	if (tis_wait_ready(locality)) {
@@ -423,54 +548,38 @@ static u32 tis_senddata(const u8 * const data, u32 len)
 		       __FILE__, __LINE__);
 		return TPM_DRIVER_ERR;
 	}
-	burst = tpm_read_burst_count(locality);
-
-	while (1) {
-		unsigned count;
-
-		/* Wait till the device is ready to accept more data. */
-		while (!burst) {
-			if (max_cycles++ == MAX_DELAY_US) {
-				printf("%s:%d failed to feed %d bytes of %d\n",
-				       __FILE__, __LINE__, len - offset, len);
-				return TPM_DRIVER_ERR;
-			}
-			udelay(1);
-			burst = tpm_read_burst_count(locality);
-		}
-
-		max_cycles = 0;
-
-		/*
-		 * Calculate number of bytes the TPM is ready to accept in one
-		 * shot.
-		 *
-		 * We want to send the last byte outside of the loop (hence
-		 * the -1 below) to make sure that the 'expected' status bit
-		 * changes to zero exactly after the last byte is fed into the
-		 * FIFO.
-		 */
-		count = min(burst, len - offset - 1);
-		while (count--)
-			tpm_write_data(data[offset++], locality);
 
-		if (tis_wait_valid(locality) || !tis_expect_data(locality)) {
-			printf("%s:%d TPM command feed overflow\n",
-			       __FILE__, __LINE__);
+	/*
+	 * Feed all but the last byte, as many bytes as the TPM is ready to
+	 * take at a time. The last byte is sent outside of the loop to make
+	 * sure that the 'expected' status bit changes to zero exactly after
+	 * it is fed into the FIFO.
+	 */
+	while (offset < len - 1) {
+		burst = tis_wait_burst(locality);
+		if (!burst) {
+			printf("%s:%d failed to feed %d bytes of %d\n",
+			       __FILE__, __LINE__, len - offset, len);
 			return TPM_DRIVER_ERR;
 		}
 
-		burst = tpm_read_burst_count(locality);
-		if ((offset == (len - 1)) && burst)
-			/*
-			 * We need to be able to send the last byte to the
-			 * device, so burst size must be nonzero before we
-			 * break out.
-			 */
-			break;
+		burst = min(burst, len - offset - 1);
+		tpm_write_fifo(data + offset, burst, locality);
+		offset += burst;
+	}
+
+	if (tis_wait_valid(locality) || !tis_expect_data(locality)) {
+		printf("%s:%d TPM command feed overflow\n",
+		       __FILE__, __LINE__);
+		return TPM_DRIVER_ERR;
 	}
 
 	/* Send the last byte. */
+	if (!tis_wait_burst(locality)) {
+		printf("%s:%d failed to feed the last byte of %d\n",
+		       __FILE__, __LINE__, len);
+		return TPM_DRIVER_ERR;
+	}
 	tpm_write_data(data[offset++], locality);
 
 	/*
@@ -494,7 +603,7 @@ static u32 tis_senddata(const u8 * const data, u32 len)
  *
  * read the TPM device response after a command was issued.
  *
- * @buffer - address where to read the response, byte by byte.
+ * @buffer - address where to read the response, a burst at a time.
  * @len - pointer to the size of buffer
  *
  * On success stores the number of received bytes to len and returns 0. On
@@ -503,11 +612,15 @@ static u32 tis_senddata(const u8 * const data, u32 len)
  */
 static u32 tis_readresponse(u8 *buffer, size_t *len)
 {
-	u16 burst_count;
+	u16 burst;
 	u32 offset = 0;
 	u8 locality = 0;
-	u32 expected_count = *len;
-	int max_cycles = 0;
+	u32 expected_count = 0;
+	u32 real_length;
+	u32 want;
+
+	if (*len < 6)
+		return TPM_DRIVER_ERR;
 
 	/* Wait for the TPM to process the command */
 	if (tis_wait_valid_data(locality)) {
@@ -515,61 +628,64 @@ static u32 tis_readresponse(u8 *buffer, size_t *len)
 		return TPM_DRIVER_ERR;
 	}
 
-	do {
-		while ((burst_count = tpm_read_burst_count(locality)) == 0) {
-			if (max_cycles++ == MAX_DELAY_US) {
-				printf("%s:%d TPM stuck on read\n",
-				       __FILE__, __LINE__);
-				return TPM_DRIVER_ERR;
-			}
-			udelay(1);
+	for (;;) {
+		burst = tis_wait_burst(locality);
+		if (!burst) {
+			printf("%s:%d TPM stuck on read\n",
+			       __FILE__, __LINE__);
+			return TPM_DRIVER_ERR;
 		}
 
-		max_cycles = 0;
-
-		while (burst_count-- && (offset < expected_count)) {
-			buffer[offset++] = tpm_read_data(locality);
-			if (offset == 6) {
-				/*
-				 * We got the first six bytes of the reply,
-				 * let's figure out how many bytes to expect
-				 * total - it is stored as a 4 byte number in
-				 * network order, starting with offset 2 into
-				 * the body of the reply.
-				 */
-				u32 real_length;
-				memcpy(&real_length,
-				       buffer + 2,
-				       sizeof(real_length));
-				expected_count = be32_to_cpu(real_length);
-
-				if ((expected_count < offset) ||
-				    (expected_count > *len)) {
-					printf("%s:%d bad response size %d\n",
-					       __FILE__, __LINE__,
-					       expected_count);
-					return TPM_DRIVER_ERR;
-				}
+		/*
+		 * Until the first six bytes are in, the size of the reply is
+		 * not known. It is stored as a 4 byte number in network
+		 * order, starting with offset 2 into the body of the reply.
+		 */
+		want = (expected_count ? expected_count : 6) - offset;
+		burst = min(burst, want);
+		tpm_read_fifo(buffer + offset, burst, locality);
+		offset += burst;
+
+		if (!expected_count && offset == 6) {
+			memcpy(&real_length, buffer + 2, sizeof(real_length));
+			expected_count = be32_to_cpu(real_length);
+
+			if ((expected_count < offset) ||
+			    (expected_count > *len)) {
+				printf("%s:%d bad response size %d\n",
+				       __FILE__, __LINE__, expected_count);
+				return TPM_DRIVER_ERR;
 			}
+
+			/* The burst was cut at the header, read on. */
+			if (offset < expected_count)
+				continue;
 		}
 
-		/* Wait for the next portion */
+		if (offset == expected_count)
+			break;	/* We got all we need */
+
+		/*
+		 * The burst ran out before the response did. dataAvail only
+		 * means something once stsValid is set.
+		 */
 		if (tis_wait_valid(locality)) {
 			printf("%s:%d failed to read response\n",
 			       __FILE__, __LINE__);
 			return TPM_DRIVER_ERR;
 		}
+		if (!tis_has_valid_data(locality)) {
+			printf("%s:%d short response: %d bytes of %d\n",
+			       __FILE__, __LINE__, offset, expected_count);
+			return TPM_DRIVER_ERR;
+		}
+	}
 
-		if (offset == expected_count)
-			break;	/* We got all we need */
-
-	} while (tis_has_valid_data(locality));
-
-	/* * Make sure we indeed read all there was. */
-	if (tis_has_valid_data(locality)) {
+	/* Make sure we indeed read all there was. */
+	if (tis_wait_valid(locality) || tis_has_valid_data(locality)) {
 		printf("%s:%d wrong receive status: %x %d bytes left\n",
 		       __FILE__, __LINE__, tpm_read_status(locality),
-	               tpm_read_burst_count(locality));
+		       tpm_read_burst_count(locality));
 		return TPM_DRIVER_ERR;
 	}
 
@@ -662,8 +778,8 @@ int tis_close(void)
  * Returns 0 on success (and places the number of response bytes at recv_len)
  * or TPM_DRIVER_ERR on failure.
  */
-int tis_sendrecv(const uint8_t *sendbuf, size_t send_size,
-		 uint8_t *recvbuf, size_t *recv_len)
+static int tis_transfer(const uint8_t *sendbuf, size_t send_size,
+			uint8_t *recvbuf, size_t *recv_len)
 {
 	if (tis_senddata(sendbuf, send_size)) {
 		printf("%s:%d failed sending data to TPM\n",
@@ -673,3 +789,99 @@ int tis_sendrecv(const uint8_t *sendbuf, size_t send_size,
 
 	return tis_readresponse(recvbuf, recv_len);
 }
+
+#if CONFIG_LPC_TPM_STATS
+static struct tpm_latency_stats car_stats CAR_GLOBAL;
+static struct tpm_latency_stats *stats_table CAR_GLOBAL;
+
+static struct tpm_latency_stats *tpm_stats(void)
+{
+	struct tpm_latency_stats *stats = car_get_var(stats_table);
+
+	if (stats != NULL)
+		return stats;
+
+#ifdef __PRE_RAM__
+	/* Kept in CAR until CBMEM is up. */
+	return car_get_var_ptr(&car_stats);
+#else
+	stats = cbmem_find(CBMEM_ID_TPM_STATS);
+	if (stats == NULL) {
+		stats = cbmem_add(CBMEM_ID_TPM_STATS, sizeof(*stats));
+		if (stats == NULL)
+			return car_get_var_ptr(&car_stats);
+		memset(stats, 0, sizeof(*stats));
+	}
+	car_set_var(stats_table, stats);
+	return stats;
+#endif
+}
+
+#ifdef __PRE_RAM__
+static void tpm_stats_migrate(void)
+{
+	struct tpm_latency_stats *stats;
+
+	stats = cbmem_add(CBMEM_ID_TPM_STATS, sizeof(*stats));
+	if (stats == NULL)
+		return;
+
+	memcpy(stats, car_get_var_ptr(&car_stats), sizeof(*stats));
+	car_set_var(stats_table, stats);
+}
+CAR_MIGRATE(tpm_stats_migrate)
+#endif
+
+static void tpm_stats_add(u32 ordinal, u32 us, int failed)
+{
+	struct tpm_latency_stats *stats = tpm_stats();
+	struct tpm_ordinal_stats *o;
+	int i;
+
+	stats->commands++;
+	if (failed)
+		stats->errors++;
+
+	i = us ? 32 - __builtin_clz(us) : 0;
+	stats->buckets[MIN(i, TPM_STATS_BUCKETS - 1)]++;
+
+	for (i = 0; i < TPM_STATS_ORDINALS; i++) {
+		o = &stats->ordinals[i];
+		if (o->count && o->ordinal != ordinal)
+			continue;
+		o->ordinal = ordinal;
+		o->count++;
+		o->total_us += us;
+		o->max_us = MAX(o->max_us, us);
+		break;
+	}
+}
+#endif
+
+int tis_sendrecv(const uint8_t *sendbuf, size_t send_size,
+		 uint8_t *recvbuf, size_t *recv_len)
+{
+#if CONFIG_LPC_TPM_STATS
+	struct mono_time start, end;
+	u32 ordinal = 0, us;
+	int ret;
+
+	/* The ordinal follows the tag and the size. */
+	if (send_size >= 10) {
+		memcpy(&ordinal, sendbuf + 6, sizeof(ordinal));
+		ordinal = be32_to_cpu(ordinal);
+	}
+
+	timer_monotonic_get(&start);
+	ret = tis_transfer(sendbuf, send_size, recvbuf, recv_len);
+	timer_monotonic_get(&end);
+
+	us = mono_time_diff_microseconds(&start, &end);
+	TPM_DEBUG("command 0x%x took %u us\n", ordinal, us);
+	tpm_stats_add(ordinal, us, ret != 0);
+
+	return ret;
+#else
+	return tis_transfer(sendbuf, send_size, recvbuf, recv_len);
+#endif
+}
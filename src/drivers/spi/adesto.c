@@ -147,7 +147,11 @@ out:
 
 static int adesto_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
-	return spi_flash_cmd_erase(flash, CMD_AT25DF_SE, offset, len);
+	struct adesto_spi_flash *stm = to_adesto_spi_flash(flash);
+
+	return spi_flash_cmd_erase_blocks(flash, CMD_AT25DF_SE, CMD_AT25DF_BE,
+			flash->sector_size * stm->params->sectors_per_block,
+			offset, len);
 }
 
 struct spi_flash *spi_flash_probe_adesto(struct spi_slave *spi, u8 *idcode)
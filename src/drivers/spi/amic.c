@@ -129,7 +129,11 @@ out:
 
 static int amic_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
-	return spi_flash_cmd_erase(flash, CMD_A25_SE, offset, len);
+	struct amic_spi_flash *amic = to_amic_spi_flash(flash);
+
+	return spi_flash_cmd_erase_blocks(flash, CMD_A25_SE, CMD_A25_BE,
+			flash->sector_size * amic->params->sectors_per_block,
+			offset, len);
 }
 
 struct spi_flash *spi_flash_probe_amic(struct spi_slave *spi, u8 *idcode)
@@ -174,7 +174,11 @@ out:
 
 static int atmel_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
-	return spi_flash_cmd_erase(flash, CMD_AT25_SE, offset, len);
+	struct atmel_spi_flash *stm = to_atmel_spi_flash(flash);
+
+	return spi_flash_cmd_erase_blocks(flash, CMD_AT25_SE, CMD_AT25_BE,
+			flash->sector_size * stm->params->sectors_per_block,
+			offset, len);
 }
 
 struct spi_flash *spi_flash_probe_atmel(struct spi_slave *spi, u8 *idcode)
@@ -140,7 +140,11 @@ out:
 
 static int eon_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
-	return spi_flash_cmd_erase(flash, CMD_EN25_SE, offset, len);
+	struct eon_spi_flash *eon = to_eon_spi_flash(flash);
+
+	return spi_flash_cmd_erase_blocks(flash, CMD_EN25_SE, CMD_EN25_BE,
+			flash->sector_size * eon->params->sectors_per_block,
+			offset, len);
 }
 
 struct spi_flash *spi_flash_probe_eon(struct spi_slave *spi, u8 *idcode)
@@ -186,7 +186,11 @@ out:
 
 static int gigadevice_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
-	return spi_flash_cmd_erase(flash, CMD_GD25_SE, offset, len);
+	struct gigadevice_spi_flash *stm = to_gigadevice_spi_flash(flash);
+
+	return spi_flash_cmd_erase_blocks(flash, CMD_GD25_SE, CMD_GD25_BE,
+			flash->sector_size * stm->params->sectors_per_block,
+			offset, len);
 }
 
 struct spi_flash *spi_flash_probe_gigadevice(struct spi_slave *spi, u8 *idcode)
@@ -214,7 +214,11 @@ static int macronix_write(struct spi_flash *flash,
 
 static int macronix_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
-	return spi_flash_cmd_erase(flash, CMD_MX25XX_SE, offset, len);
+	struct macronix_spi_flash *mcx = to_macronix_spi_flash(flash);
+
+	return spi_flash_cmd_erase_blocks(flash, CMD_MX25XX_SE, CMD_MX25XX_BE,
+			flash->sector_size * mcx->params->sectors_per_block,
+			offset, len);
 }
 
 struct spi_flash *spi_flash_probe_macronix(struct spi_slave *spi, u8 *idcode)
@@ -15,6 +15,7 @@
 #include <spi_flash.h>
 
 #include "spi_flash_internal.h"
+#include <thread.h>
 #include <timer.h>
 
 static void spi_flash_addr(u32 addr, u8 *cmd)
@@ -163,6 +164,8 @@ int spi_flash_cmd_poll_bit(struct spi_flash *flash, unsigned long timeout,
 			return -1;
 		if ((status & poll_bit) == 0)
 			return 0;
+		/* Let other threads run while the part is busy. */
+		thread_yield_microseconds(SPI_FLASH_POLL_USECS);
 		timer_monotonic_get(&current);
 	} while (!mono_time_after(&current, &end));
 
@@ -178,8 +181,16 @@ int spi_flash_cmd_wait_ready(struct spi_flash *flash, unsigned long timeout)
 
 int spi_flash_cmd_erase(struct spi_flash *flash, u8 erase_cmd,
 			u32 offset, size_t len)
+{
+	return spi_flash_cmd_erase_blocks(flash, erase_cmd, 0, 0, offset, len);
+}
+
+int spi_flash_cmd_erase_blocks(struct spi_flash *flash, u8 erase_cmd,
+			       u8 block_cmd, u32 block_size,
+			       u32 offset, size_t len)
 {
 	u32 start, end, erase_size;
+	unsigned long timeout;
 	int ret;
 	u8 cmd[4];
 
@@ -191,11 +202,21 @@ int spi_flash_cmd_erase(struct spi_flash *flash, u8 erase_cmd,
 
 	flash->spi->rw = SPI_WRITE_FLAG;
 
-	cmd[0] = erase_cmd;
 	start = offset;
 	end = start + len;
 
 	while (offset < end) {
+		/* One block erase is much faster than its sectors one by one. */
+		if (block_size && offset % block_size == 0 &&
+		    end - offset >= block_size) {
+			cmd[0] = block_cmd;
+			erase_size = block_size;
+			timeout = SPI_FLASH_BLOCK_ERASE_TIMEOUT;
+		} else {
+			cmd[0] = erase_cmd;
+			erase_size = flash->sector_size;
+			timeout = SPI_FLASH_PAGE_ERASE_TIMEOUT;
+		}
 		spi_flash_addr(offset, cmd);
 		offset += erase_size;
 
@@ -211,7 +232,7 @@ int spi_flash_cmd_erase(struct spi_flash *flash, u8 erase_cmd,
 		if (ret)
 			goto out;
 
-		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PAGE_ERASE_TIMEOUT);
+		ret = spi_flash_cmd_wait_ready(flash, timeout);
 		if (ret)
 			goto out;
 	}
@@ -15,6 +15,10 @@
 #define SPI_FLASH_PROG_TIMEOUT		(2 * CONFIG_SYS_HZ)
 #define SPI_FLASH_PAGE_ERASE_TIMEOUT	(5 * CONFIG_SYS_HZ)
 #define SPI_FLASH_SECTOR_ERASE_TIMEOUT	(10 * CONFIG_SYS_HZ)
+#define SPI_FLASH_BLOCK_ERASE_TIMEOUT	(20 * CONFIG_SYS_HZ)
+
+/* How long to let other threads run between two status polls. */
+#define SPI_FLASH_POLL_USECS		100
 
 /* Common commands */
 #define CMD_READ_ID			0x9f
@@ -73,6 +77,14 @@ int spi_flash_cmd_wait_ready(struct spi_flash *flash, unsigned long timeout);
 int spi_flash_cmd_erase(struct spi_flash *flash, u8 erase_cmd,
 			u32 offset, size_t len);
 
+/*
+ * Erase sectors, using block_cmd for every block_size aligned block that
+ * is erased as a whole and erase_cmd for the sectors around them.
+ */
+int spi_flash_cmd_erase_blocks(struct spi_flash *flash, u8 erase_cmd,
+			       u8 block_cmd, u32 block_size,
+			       u32 offset, size_t len);
+
 /* Manufacturer-specific probe functions */
 struct spi_flash *spi_flash_probe_spansion(struct spi_slave *spi, u8 *idcode);
 struct spi_flash *spi_flash_probe_amic(struct spi_slave *spi, u8 *idcode);
@@ -0,0 +1,211 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <console/console.h>
+#include <stdlib.h>
+#include <string.h>
+#include <spi_flash.h>
+
+/*
+ * The unit the contents are compared and programmed in. It is the page size
+ * of all supported parts, so a chunk never crosses a page boundary.
+ */
+#define CHUNK_SIZE	256
+
+/* What a piece of flash needs to end up holding the new data. */
+enum {
+	UPDATE_SAME,		/* Nothing. */
+	UPDATE_PROGRAM,		/* Only bits going from 1 to 0, no erase. */
+	UPDATE_ERASE,		/* An erase first. */
+};
+
+struct update_stats {
+	u32 programmed;
+	u32 skipped;
+	u32 erased;
+};
+
+static u8 chunk[CHUNK_SIZE];
+
+/* The contents of a partially updated sector while it is being erased. */
+static u8 *sector_buf;
+static u32 sector_buf_size;
+
+static int classify(struct spi_flash *flash, u32 offset, size_t len,
+		    const u8 *data)
+{
+	int state = UPDATE_SAME;
+	size_t n, i;
+
+	for (; len; offset += n, data += n, len -= n) {
+		n = MIN(len, CHUNK_SIZE - offset % CHUNK_SIZE);
+		if (flash->read(flash, offset, n, chunk))
+			return -1;
+		for (i = 0; i < n; i++) {
+			if (chunk[i] == data[i])
+				continue;
+			if ((chunk[i] & data[i]) != data[i])
+				return UPDATE_ERASE;
+			state = UPDATE_PROGRAM;
+		}
+	}
+
+	return state;
+}
+
+static int is_erased(const u8 *data, size_t len)
+{
+	while (len--)
+		if (*data++ != 0xff)
+			return 0;
+	return 1;
+}
+
+/*
+ * Programs the chunks that differ from data. Right after an erase the
+ * flash is known to read 0xff, so it doesn't need to be read back.
+ */
+static int program(struct spi_flash *flash, u32 offset, size_t len,
+		   const u8 *data, int erased, struct update_stats *stats)
+{
+	size_t n;
+
+	for (; len; offset += n, data += n, len -= n) {
+		n = MIN(len, CHUNK_SIZE - offset % CHUNK_SIZE);
+		if (erased) {
+			if (is_erased(data, n)) {
+				stats->skipped++;
+				continue;
+			}
+		} else {
+			if (flash->read(flash, offset, n, chunk))
+				return -1;
+			if (!memcmp(chunk, data, n)) {
+				stats->skipped++;
+				continue;
+			}
+		}
+		if (flash->write(flash, offset, n, data))
+			return -1;
+		stats->programmed++;
+	}
+
+	return 0;
+}
+
+static int erase_and_program(struct spi_flash *flash, u32 offset, size_t len,
+			     const u8 *data, struct update_stats *stats)
+{
+	if (flash->erase(flash, offset, len))
+		return -1;
+	stats->erased += len;
+
+	return program(flash, offset, len, data, 1, stats);
+}
+
+/* Erases a sector that is only partially updated, keeping the rest of it. */
+static int update_sector(struct spi_flash *flash, u32 offset, size_t len,
+			 const u8 *data, struct update_stats *stats)
+{
+	u32 base = ALIGN_DOWN(offset, flash->sector_size);
+
+	if (sector_buf_size < flash->sector_size) {
+		sector_buf = malloc(flash->sector_size);
+		if (sector_buf == NULL) {
+			printk(BIOS_WARNING, "SF: Failed to allocate memory\n");
+			return -1;
+		}
+		sector_buf_size = flash->sector_size;
+	}
+
+	if (flash->read(flash, base, flash->sector_size, sector_buf))
+		return -1;
+	memcpy(sector_buf + offset - base, data, len);
+
+	return erase_and_program(flash, base, flash->sector_size, sector_buf,
+				 stats);
+}
+
+int spi_flash_update(struct spi_flash *flash, u32 offset, size_t len,
+		     const void *buf)
+{
+	struct update_stats stats = { 0 };
+	const u8 *data = buf;
+	const u8 *run_data = NULL;
+	u32 start = offset;
+	u32 end = offset + len;
+	u32 run_start = 0;
+	u32 run_len = 0;
+	int state, ret;
+
+	while (offset < end) {
+		u32 n = MIN(end, ALIGN_DOWN(offset, flash->sector_size) +
+			    flash->sector_size) - offset;
+
+		state = classify(flash, offset, n, data);
+		if (state < 0)
+			return -1;
+
+		/*
+		 * Collect the whole sectors that need an erase, so the driver
+		 * can erase them with the largest blocks the part has.
+		 */
+		if (state == UPDATE_ERASE && n == flash->sector_size) {
+			if (run_len == 0) {
+				run_start = offset;
+				run_data = data;
+			}
+			run_len += n;
+			offset += n;
+			data += n;
+			continue;
+		}
+
+		if (run_len) {
+			ret = erase_and_program(flash, run_start, run_len,
+						run_data, &stats);
+			if (ret)
+				return ret;
+			run_len = 0;
+		}
+
+		if (state == UPDATE_ERASE)
+			ret = update_sector(flash, offset, n, data, &stats);
+		else if (state == UPDATE_PROGRAM)
+			ret = program(flash, offset, n, data, 0, &stats);
+		else
+			ret = 0;
+		if (ret)
+			return ret;
+
+		offset += n;
+		data += n;
+	}
+
+	if (run_len) {
+		ret = erase_and_program(flash, run_start, run_len, run_data,
+					&stats);
+		if (ret)
+			return ret;
+	}
+
+	printk(BIOS_DEBUG, "SF: Updated %zu bytes @ %#x: %u bytes erased, "
+	       "%u chunks programmed, %u skipped\n", len, start,
+	       stats.erased, stats.programmed, stats.skipped);
+
+	return 0;
+}
@@ -191,7 +191,11 @@ out:
 
 static int winbond_erase(struct spi_flash *flash, u32 offset, size_t len)
 {
-	return spi_flash_cmd_erase(flash, CMD_W25_SE, offset, len);
+	struct winbond_spi_flash *stm = to_winbond_spi_flash(flash);
+
+	return spi_flash_cmd_erase_blocks(flash, CMD_W25_SE, CMD_W25_BE,
+			flash->sector_size * stm->params->sectors_per_block,
+			offset, len);
 }
 
 struct spi_flash *spi_flash_probe_winbond(struct spi_slave *spi, u8 *idcode)
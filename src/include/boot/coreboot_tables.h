@@ -255,6 +255,15 @@ struct lb_x86_rom_mtrr {
 	uint32_t index;
 };
 
+#define LB_TAG_TSC_INFO		0x0027
+struct lb_tsc_info {
+	uint32_t tag;
+	uint32_t size;
+	/* The TSC frequency as measured by coreboot, so the payload doesn't
+	 * have to. */
+	uint32_t freq_khz;
+};
+
 /* The following structures are for the cmos definitions table */
 #define LB_TAG_CMOS_OPTION_TABLE 200
 /* cmos header record */
@@ -0,0 +1,35 @@
+#ifndef BOOT_TABLE_CACHE_H
+#define BOOT_TABLE_CACHE_H
+
+#include <stdint.h>
+
+/*
+ * With CONFIG_TABLE_CACHE the tables write_tables() generates are saved to
+ * flash together with a fingerprint of what they are generated from: the
+ * firmware build, the cpu, the device tree with its resources and the CMOS
+ * options. As long as the fingerprint matches, the next boot copies them
+ * back instead of generating them again.
+ */
+
+#if CONFIG_TABLE_CACHE
+/*
+ * Copies the cached table id to start if it was generated for the same
+ * fingerprint at the same address. Returns the end of the table or 0 if it
+ * has to be generated.
+ */
+unsigned long table_cache_restore(u32 id, unsigned long start);
+/* Adds a freshly generated table to the cache. */
+void table_cache_add(u32 id, unsigned long start, unsigned long end);
+/* Writes the cache to flash if any table was added. */
+void table_cache_save(void);
+#else
+static inline unsigned long table_cache_restore(u32 id, unsigned long start)
+{
+	return 0;
+}
+static inline void table_cache_add(u32 id, unsigned long start,
+				   unsigned long end) {}
+static inline void table_cache_save(void) {}
+#endif
+
+#endif /* BOOT_TABLE_CACHE_H */
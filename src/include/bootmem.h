@@ -36,6 +36,13 @@ void bootmem_add_range(uint64_t start, uint64_t size, uint32_t type);
 /* Write memory coreboot table. */
 void bootmem_write_memory_table(struct lb_memory *mem);
 
+/*
+ * Call action for each range in the bootmem address space in ascending
+ * order. The walk stops early when action returns 0.
+ */
+typedef int (*bootmem_action_t)(const struct range_entry *r, void *arg);
+void bootmem_walk(bootmem_action_t action, void *arg);
+
 /* Print current range map of boot memory. */
 void bootmem_dump_ranges(void);
 
@@ -62,7 +62,7 @@
 #define CBMEM_ID_ROMSTAGE_INFO	0x47545352
 #define CBMEM_ID_ROMSTAGE_RAM_STACK 0x90357ac4
 #define CBMEM_ID_RAMSTAGE	0x9a357a9e
-#define CBMEM_ID_RAMSTAGE_CACHE	0x9a3ca54e
+#define CBMEM_ID_STAGEx_CACHE	0x57a9e100
 #define CBMEM_ID_ROOT		0xff4007ff
 #define CBMEM_ID_VBOOT_HANDOFF	0x780074f0
 #define CBMEM_ID_CAR_GLOBALS	0xcac4e6a3
@@ -76,6 +76,13 @@
 #define CBMEM_ID_AGESA_RUNTIME	0x41474553
 #define CBMEM_ID_HOB_POINTER	0x484f4221
 #define CBMEM_ID_FILE  			0x46494c45 //'FILE'
+#define CBMEM_ID_DRAM_SCREEN	0x4452414d
+#define CBMEM_ID_TRACE		0x54524345
+#define CBMEM_ID_PROFILE	0x50524f46
+#define CBMEM_ID_TCPA_LOG	0x54435041
+#define CBMEM_ID_TPM_STATS	0x54504d53
+#define CBMEM_ID_TIMER_STATS	0x544d5253
+#define CBMEM_ID_TSC_INFO	0x54534349
 
 #ifndef __ASSEMBLER__
 #include <stddef.h>
@@ -106,7 +113,8 @@ struct cbmem_id_to_name {
 	{ CBMEM_ID_ROMSTAGE_INFO,	"ROMSTAGE   " }, \
 	{ CBMEM_ID_ROMSTAGE_RAM_STACK,	"ROMSTG STCK" }, \
 	{ CBMEM_ID_RAMSTAGE,		"RAMSTAGE   " }, \
-	{ CBMEM_ID_RAMSTAGE_CACHE,	"RAMSTAGE $ " }, \
+	{ CBMEM_ID_STAGEx_CACHE,	"RAMSTAGE $ " }, \
+	{ CBMEM_ID_STAGEx_CACHE + 1,	"PAYLOAD $  " }, \
 	{ CBMEM_ID_ROOT,		"CBMEM ROOT " }, \
 	{ CBMEM_ID_VBOOT_HANDOFF,	"VBOOT      " }, \
 	{ CBMEM_ID_CAR_GLOBALS,		"CAR GLOBALS" }, \
@@ -117,7 +125,14 @@ struct cbmem_id_to_name {
 	{ CBMEM_ID_REFCODE_CACHE,	"REFCODE $  " }, \
 	{ CBMEM_ID_POWER_STATE,		"POWER STATE" }, \
 	{ CBMEM_ID_RAM_OOPS,		"RAMOOPS    " }, \
-	{ CBMEM_ID_FILE,			"FILE       " },
+	{ CBMEM_ID_FILE,			"FILE       " }, \
+	{ CBMEM_ID_DRAM_SCREEN,		"DRAM SCREEN" }, \
+	{ CBMEM_ID_TRACE,		"TRACE      " }, \
+	{ CBMEM_ID_PROFILE,		"PROFILE    " }, \
+	{ CBMEM_ID_TCPA_LOG,		"TCPA LOG   " }, \
+	{ CBMEM_ID_TPM_STATS,		"TPM STATS  " }, \
+	{ CBMEM_ID_TIMER_STATS,		"TIMER STATS" }, \
+	{ CBMEM_ID_TSC_INFO,		"TSC INFO   " },
 
 struct cbmem_entry;
 
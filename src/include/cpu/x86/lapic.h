@@ -5,6 +5,7 @@
 #include <cpu/x86/msr.h>
 #include <halt.h>
 #include <smp/node.h>
+#include <stdint.h>
 
 /* See if I need to initialize the local apic */
 #if CONFIG_SMP || CONFIG_IOAPIC
@@ -145,6 +146,12 @@ static inline int lapic_remote_read(int apicid, int reg, unsigned long *pvalue)
 
 void setup_lapic(void);
 
+/* Returns the LAPIC timer ticks per second with a divider of 1. */
+uint32_t lapic_timer_calibrate(void);
+/* Halt until the LAPIC timer fires after usecs, or something else wakes
+ * the CPU up first. */
+void lapic_idle_usecs(uint32_t usecs);
+
 #if CONFIG_SMP
 struct device;
 int start_cpu(struct device *cpu);
@@ -18,6 +18,7 @@
 #define	LAPIC_TASKPRI	0x80
 #define		LAPIC_TPRI_MASK		0xFF
 #define LAPIC_ARBID	0x090
+#define LAPIC_EOI	0x0B0
 #define	LAPIC_RRR	0x0C0
 #define LAPIC_SVR	0x0f0
 #define LAPIC_SPIV	0x0f0
@@ -55,6 +56,9 @@
 #define		GET_LAPIC_DEST_FIELD(x)	(((x)>>24)&0xFF)
 #define		SET_LAPIC_DEST_FIELD(x)	((x)<<24)
 #define LAPIC_LVTT	0x320
+/* The timer vector in ramstage, above the exceptions and the 8259. Used
+ * by both SAMPLING_PROFILER and TICKLESS_IDLE, which exclude each other. */
+#define		LAPIC_TIMER_VECTOR		0x40
 #define LAPIC_LVTPC	0x340
 #define LAPIC_LVT0	0x350
 #define		LAPIC_LVT_TIMER_BASE_MASK	(0x3<<18)
@@ -117,6 +117,45 @@ void mp_initialize_cpu(void *unused);
 /* Returns apic id for coreboot cpu number or < 0 on failure. */
 int mp_get_apic_id(int cpu_slot);
 
+/*
+ * Hand func(arg) to every AP that is waiting for work. This requires
+ * CONFIG_PARALLEL_MP_AP_WORK so that the APs keep polling after the flight
+ * plan instead of being parked. The call returns as soon as each AP has
+ * picked up the callback, not when the callback has finished; callers need
+ * to provide their own completion tracking. expire_us bounds the time spent
+ * waiting for the APs to pick up the work, 0 waits forever.
+ *
+ * Returns the number of APs that picked up the callback, < 0 on timeout.
+ */
+int mp_run_on_aps(mp_callback_t func, void *arg, long expire_us);
+
+/*
+ * Run func(arg) on the BSP and on every AP, and wait for all of them to
+ * return. Each cpu runs on its own stack, the one mp_init() gave it. Without
+ * CONFIG_PARALLEL_MP_AP_WORK only the BSP runs func. expire_us bounds the
+ * whole call, 0 waits forever.
+ *
+ * Returns 0 once every cpu has finished, < 0 on timeout.
+ */
+int mp_run_on_all_cpus(mp_callback_t func, void *arg, long expire_us);
+
+/* An independent piece of work for mp_run_work(). */
+struct mp_work {
+	mp_callback_t func;
+	void *arg;
+};
+
+/*
+ * Run each of the count items in work once. The BSP and the APs take items
+ * off the list in order until it is empty, so uneven items balance out on
+ * their own. The call returns when every item has finished. Items are still
+ * all run, on the BSP alone, when no APs are available. expire_us bounds the
+ * whole call, 0 waits forever; work[] must outlive an expired call.
+ *
+ * Returns 0 once every item has finished, < 0 on timeout.
+ */
+int mp_run_work(const struct mp_work *work, int count, long expire_us);
+
 /*
  * SMM helpers to use with initializing CPUs.
  */
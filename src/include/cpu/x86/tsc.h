@@ -64,4 +64,16 @@ static inline uint64_t tsc_to_uint64(tsc_t tstamp)
 unsigned long tsc_freq_mhz(void);
 #endif
 
+/* The TSC frequency of this boot, kept in CBMEM_ID_TSC_INFO so it isn't
+ * measured again on S3 resume, and passed on to the payload. */
+struct tsc_info {
+	uint32_t freq_khz;
+} __attribute__((packed));
+
+#if (CONFIG_UDELAY_TSC || CONFIG_TSC_FREQ_FROM_MONOTONIC) && \
+	!defined(__PRE_RAM__)
+/* Measured at the first use, unless the rate is known. */
+unsigned long tsc_freq_khz(void);
+#endif
+
 #endif /* CPU_X86_TSC_H */
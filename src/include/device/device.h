@@ -89,6 +89,27 @@ struct bus {
 	unsigned	disable_relaxed_ordering : 1;
 };
 
+/*
+ * The dev_find_*() lookups don't walk all_devices but short hash chains, one
+ * set for each of these keys. The path chains of the static devices are laid
+ * out by sconfig, see dev_index_path() and dev_index_ids() for the rest.
+ */
+enum {
+	DEV_INDEX_PATH,		/* PCI, PNP, I2C and APIC paths */
+	DEV_INDEX_ID,		/* Vendor and device ID */
+	DEV_INDEX_CLASS,	/* Class and subclass */
+	DEV_INDEX_COUNT
+};
+
+#define DEV_INDEX_BITS		6
+#define DEV_INDEX_SIZE		(1 << DEV_INDEX_BITS)
+
+/* util/sconfig has a copy of this for the static devices. */
+static inline unsigned int dev_index_hash(uint32_t key)
+{
+	return (key * 0x9e3779b1) >> (32 - DEV_INDEX_BITS);
+}
+
 /*
  * There is one device structure for each slot-number/function-number
  * combination:
@@ -134,6 +155,11 @@ struct device {
 #ifndef __PRE_RAM__
 	struct chip_operations *chip_ops;
 	const char *name;
+
+	/* Lookup chains, see DEV_INDEX_PATH. */
+	unsigned int	seq;		/* Position in all_devices */
+	struct device	*index_next[DEV_INDEX_COUNT];
+	u8		index_slot[DEV_INDEX_COUNT]; /* Bucket + 1, 0 if none */
 #endif
 	ROMSTAGE_CONST void *chip_info;
 };
@@ -147,6 +173,7 @@ extern ROMSTAGE_CONST struct device	dev_root;
 #ifndef __SIMPLE_DEVICE__
 
 extern struct device	*all_devices;	/* list of all devices */
+extern struct device	*dev_index[DEV_INDEX_COUNT][DEV_INDEX_SIZE];
 extern struct resource	*free_resources;
 extern struct bus	*free_links;
 
@@ -195,6 +222,9 @@ device_t dev_find_slot_on_smbus (unsigned int bus, unsigned int addr);
 device_t dev_find_slot_pnp(u16 port, u16 device);
 device_t dev_find_lapic(unsigned apic_id);
 int dev_count_cpu(void);
+/* Call after changing the path or the IDs of a device that is in the tree. */
+void dev_index_path(struct device *dev);
+void dev_index_ids(struct device *dev);
 
 void remap_bsp_lapic(struct bus *cpu_bus);
 device_t add_cpu_device(struct bus *cpu_bus, unsigned apic_id, int enabled);
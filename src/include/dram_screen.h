@@ -0,0 +1,52 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _DRAM_SCREEN_H_
+#define _DRAM_SCREEN_H_
+
+#include <stdint.h>
+
+/*
+ * With CONFIG_DRAM_SCREEN the ramstage tests all usable RAM below 4GiB just
+ * before the payload is loaded. The outcome is left in CBMEM under
+ * CBMEM_ID_DRAM_SCREEN so the OS or a provisioning tool can pick it up.
+ */
+
+/* Patterns, used as bits in dram_screen_result.patterns. */
+#define DRAM_SCREEN_ADDRESS		(1 << 0)
+#define DRAM_SCREEN_ADDRESS_INV		(1 << 1)
+#define DRAM_SCREEN_WALKING_ONES	(1 << 2)
+#define DRAM_SCREEN_WALKING_ZEROS	(1 << 3)
+
+struct dram_screen_bad {
+	uint64_t address;
+	uint32_t expected;
+	uint32_t actual;
+} __attribute__((packed));
+
+struct dram_screen_result {
+	uint32_t patterns;
+	uint32_t cpus;		/* Number of cpus that took part. */
+	uint32_t elapsed_ms;
+	uint32_t max_bad;	/* Capacity of bad[]. */
+	uint64_t bytes_tested;
+	uint32_t error_count;	/* Total, may exceed num_bad. */
+	uint32_t num_bad;
+	struct dram_screen_bad bad[0];
+} __attribute__((packed));
+
+#endif /* _DRAM_SCREEN_H_ */
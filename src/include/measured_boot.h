@@ -0,0 +1,91 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef MEASURED_BOOT_H
+#define MEASURED_BOOT_H
+
+#include <rules.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sha1.h>
+#include <sha256.h>
+
+/* The PCRs as assigned by the TCG PC client specification. */
+#define MEASURE_PCR_FIRMWARE	0	/* romstage and ramstage */
+#define MEASURE_PCR_OPTION_ROM	2
+#define MEASURE_PCR_PAYLOAD	4
+
+struct cbfs_stage;
+
+#define MEASURE_NAME_LENGTH	32
+#define MEASURE_MAX_ENTRIES	32
+
+/*
+ * The log of all measurements of a boot, kept in CBMEM_ID_TCPA_LOG. The
+ * PCRs of a TPM 1.2 are extended with the SHA-1 digest, the SHA-256 digest
+ * is only logged.
+ */
+struct measure_entry {
+	uint32_t pcr;
+	uint32_t extended;	/* 0 while the extend is still queued. */
+	uint8_t sha1[SHA1_DIGEST_SIZE];
+	uint8_t sha256[SHA256_DIGEST_SIZE];
+	char name[MEASURE_NAME_LENGTH];
+} __attribute__((packed));
+
+struct measure_log {
+	uint32_t num_entries;
+	uint32_t max_entries;
+	struct measure_entry entries[0];
+} __attribute__((packed));
+
+#if CONFIG_MEASURED_BOOT && (ENV_ROMSTAGE || ENV_RAMSTAGE)
+/*
+ * Hash len bytes at data and extend pcr with it. In ramstage the extend is
+ * queued and done in the background, but before the payload or the OS
+ * resume vector runs.
+ */
+void measure_data(int pcr, const char *name, const void *data, size_t len);
+
+/*
+ * Copy len bytes from src to dst and measure them, hashing each piece as
+ * it arrives while it is still in the cache.
+ */
+void measure_copy(int pcr, const char *name, void *dst, const void *src,
+		  size_t len);
+
+/*
+ * Measure a stage as the header it was loaded with followed by the len
+ * bytes of image it was decompressed to, which is what is going to run.
+ */
+void measure_stage(int pcr, const char *name, const struct cbfs_stage *header,
+		   const void *image, size_t len);
+#else
+static inline void measure_data(int pcr, const char *name, const void *data,
+				size_t len) {}
+static inline void measure_copy(int pcr, const char *name, void *dst,
+				const void *src, size_t len)
+{
+	memcpy(dst, src, len);
+}
+static inline void measure_stage(int pcr, const char *name,
+				 const struct cbfs_stage *header,
+				 const void *image, size_t len) {}
+#endif
+
+#endif /* MEASURED_BOOT_H */
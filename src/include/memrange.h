@@ -25,6 +25,8 @@
  * is exposed so that a memranges can be used on the stack if needed. */
 struct memranges {
 	struct range_entry *entries;
+	/* Most recently inserted entry, NULL if it may have been freed. */
+	struct range_entry *hint;
 };
 
 /* Each region within a memranges structure is represented by a
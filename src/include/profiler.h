@@ -0,0 +1,60 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+/*
+ * With CONFIG_SAMPLING_PROFILER the local APIC timer of the BSP interrupts
+ * ramstage at a fixed rate and the interrupted EIP is counted in a histogram
+ * over the ramstage text. The histogram is left in CBMEM under
+ * CBMEM_ID_PROFILE, "cbmem -P ramstage.elf" maps it back to functions.
+ */
+
+#define PROFILER_MAGIC		0x464f5250	/* "PROF" */
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+struct profile_histogram {
+	uint32_t magic;
+	uint32_t base;		/* Run time address of counts[0]. */
+	uint32_t link_base;	/* The same address in the ramstage ELF. */
+	uint32_t shift;		/* Each bucket covers 1 << shift bytes. */
+	uint32_t buckets;
+	uint32_t rate_hz;
+	uint32_t samples;	/* Including the ones in outside. */
+	uint32_t outside;	/* EIP was not in the ramstage text. */
+	uint32_t counts[0];
+} __attribute__((packed));
+
+#if IS_ENABLED(CONFIG_SAMPLING_PROFILER) && !defined(__PRE_RAM__) && \
+	!defined(__SMM__)
+struct eregs;
+/* Called from the exception handler for LAPIC_TIMER_VECTOR. */
+void profiler_sample(struct eregs *info);
+/* Stop sampling around code that runs with its own IDT, e.g. option ROMs. */
+void profiler_pause(void);
+void profiler_resume(void);
+#else
+static inline void profiler_pause(void) {}
+static inline void profiler_resume(void) {}
+#endif
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* _PROFILER_H_ */
@@ -24,6 +24,20 @@
 
 #define RMODULE_MAGIC 0xf8fe
 #define RMODULE_VERSION_1 1
+#define RMODULE_VERSION_2 2
+
+/*
+ * Version 1 relocations are an array of uintptr_t link addresses. Version 2
+ * relocations are a stream of page groups sorted by address. Every group
+ * starts with a 32-bit word holding the distance in pages to the previous
+ * group (the first group counts from the link start address) in the upper
+ * bits and the number of relocations minus one in the lower bits. It is
+ * followed by that many 16-bit byte offsets into the page, padded to a
+ * 32-bit boundary.
+ */
+#define RMODULE_RELOC_PAGE_SHIFT	12
+#define RMODULE_RELOC_PAGE_SIZE		(1 << RMODULE_RELOC_PAGE_SHIFT)
+#define RMODULE_RELOC_COUNT_MASK	(RMODULE_RELOC_PAGE_SIZE - 1)
 
 /* All fields with '_offset' in the name are byte offsets into the flat blob.
  * The linker and the linker script takes are of assigning the values.  */
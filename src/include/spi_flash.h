@@ -47,4 +47,12 @@ struct spi_flash {
 
 struct spi_flash *spi_flash_probe(unsigned int bus, unsigned int cs);
 
+/*
+ * Makes the flash at offset read back as buf. Only the pages that differ
+ * are programmed, and sectors are only erased if a bit has to go from 0 to
+ * 1. The rest of a partially updated sector is preserved.
+ */
+int spi_flash_update(struct spi_flash *flash, u32 offset, size_t len,
+		     const void *buf);
+
 #endif /* _SPI_FLASH_H_ */
@@ -0,0 +1,88 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * Copyright (C) 2013 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _STAGE_CACHE_H_
+#define _STAGE_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The stage cache keeps copies of loaded programs so that they can be put
+ * back in place without going to CBFS and decompressing them again. The
+ * relocated ramstage is cached for S3 resume. With CONFIG_STAGE_CACHE_PAYLOAD
+ * the loaded payload is cached as well, which helps warm reboots when the
+ * board provides a region that survives them.
+ *
+ * Cached copies live either in CBMEM or, for the payload and when
+ * CONFIG_CACHE_RELOCATED_RAMSTAGE_OUTSIDE_CBMEM is selected for the ramstage,
+ * in a region provided by the board. Memory outside of CBMEM is not trusted:
+ * every entry carries a hash over its segment table and contents which is
+ * checked before anything is copied back. */
+
+enum {
+	STAGE_RAMSTAGE,
+	STAGE_PAYLOAD,
+};
+
+#define STAGE_CACHE_MAGIC 0x5c4ec0de
+
+struct stage_cache_segment {
+	uint32_t load_address;
+	uint32_t size;
+} __attribute__((packed));
+
+struct stage_cache {
+	uint32_t magic;
+	uint32_t stage_id;
+	/* Identifies what was cached, e.g. a hash of the CBFS file. */
+	uint32_t tag;
+	uint32_t entry_point;
+	uint32_t num_segments;
+	/* Total size including this header. */
+	uint32_t size;
+	/* Hash over everything following this header. */
+	uint32_t hash;
+	struct stage_cache_segment segments[0];
+	/* Segment contents follow the segment table back to back. */
+} __attribute__((packed));
+
+/* Add a copy of the given segments to the cache. Any previous copy of the
+ * stage is replaced. Returns 0 on success, < 0 on error. */
+int stage_cache_add(int stage_id, uint32_t tag, void *entry_point,
+		    const struct stage_cache_segment *segs, int num_segs);
+
+/* Return the cached stage if present, tagged with tag and intact, or NULL
+ * otherwise. */
+const struct stage_cache *stage_cache_find(int stage_id, uint32_t tag);
+
+/* Copy all segments of a stage returned by stage_cache_find() back to their
+ * load addresses. Returns the entry point. */
+void *stage_cache_restore(const struct stage_cache *c);
+
+/* Hash used for the integrity check, also handy to compute tags. */
+uint32_t stage_cache_hash(const void *data, size_t size);
+
+/* Board or chipset provided region for caching outside of CBMEM. The default
+ * implementation provides none. */
+void *stage_cache_external_region(size_t *size);
+/* Board or chipset hook called when the cached ramstage is not usable on
+ * resume. The default implementation does nothing. */
+void stage_cache_invalid(int stage_id);
+
+#endif /* _STAGE_CACHE_H_ */
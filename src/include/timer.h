@@ -19,6 +19,8 @@
 #ifndef TIMER_H
 #define TIMER_H
 
+#include <stdint.h>
+
 #define USECS_PER_SEC 1000000
 #define MSECS_PER_SEC 1000
 #define USECS_PER_MSEC (USECS_PER_SEC / MSECS_PER_SEC)
@@ -47,8 +49,23 @@ struct timeout_callback {
 	void (*callback)(struct timeout_callback *tocb);
 	/* Not for public use. The timer library uses the fields below. */
 	struct mono_time expiration;
+	struct timeout_callback *next;
 };
 
+/* Counters of the timer library, with CONFIG_TIMER_QUEUE_STATS they are
+ * left in CBMEM under CBMEM_ID_TIMER_STATS. */
+struct timer_queue_stats {
+	uint32_t wheel_inserts;
+	uint32_t heap_inserts;
+	uint32_t cascades;	/* Callbacks moved down a level of the wheel. */
+	uint32_t callbacks;	/* Callbacks called. */
+	uint32_t polls;		/* Calls to timers_run(). */
+	uint32_t empty_polls;	/* Of which found nothing to call. */
+	uint32_t halts;		/* Times the CPU was halted until a timer. */
+	uint32_t halted_usecs;
+	uint32_t max_pending;
+} __attribute__((packed));
+
 /* Obtain the current monotonic time. The assumption is that the time counts
  * up from the value 0 with value 0 being the point when the timer was
  * initialized.  Additionally, the timer is assumed to only be valid for the
@@ -63,6 +80,16 @@ void timer_monotonic_get(struct mono_time *mt);
 /* Returns 1 if callbacks still present in the queue. 0 if no timers left. */
 int timers_run(void);
 
+/* Wait for the next callback to be due. With CONFIG_TICKLESS_IDLE the CPU
+ * is halted until then if that is long enough to be worth it, otherwise
+ * this returns right away. */
+void timers_idle(void);
+
+/* Fill in the expiration of the callback that is due next. 0 returned on
+ * success, < 0 if there are no callbacks. For callbacks far out the time
+ * may be earlier, the queue needs to be run then to keep track of them. */
+int timer_next_expiration(struct mono_time *mt);
+
 /* Schedule a callback to be ran microseconds from time of invocation.
  * 0 returned on success, < 0 on error. */
 int timer_sched_callback(struct timeout_callback *tocb, unsigned long us);
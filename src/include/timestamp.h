@@ -44,6 +44,8 @@ enum timestamp_id {
 	TS_START_COPYRAM = 8,
 	TS_END_COPYRAM = 9,
 	TS_START_RAMSTAGE = 10,
+	TS_MEM_CONTEXT_HIT = 11,
+	TS_MEM_CONTEXT_MISS = 12,
 	TS_DEVICE_ENUMERATE = 30,
 	TS_FSP_BEFORE_ENUMERATE,
 	TS_FSP_AFTER_ENUMERATE,
@@ -66,4 +66,27 @@ int tis_close(void);
 int tis_sendrecv(const u8 *sendbuf, size_t send_size, u8 *recvbuf,
 			size_t *recv_len);
 
+/*
+ * Command latencies kept in CBMEM_ID_TPM_STATS. Bucket 0 counts the
+ * commands that took less than a microsecond, bucket n those that took
+ * from 2^(n-1) up to 2^n microseconds. The last bucket takes everything
+ * slower.
+ */
+#define TPM_STATS_BUCKETS	21
+#define TPM_STATS_ORDINALS	16
+
+struct tpm_ordinal_stats {
+	uint32_t ordinal;
+	uint32_t count;
+	uint32_t total_us;
+	uint32_t max_us;
+} __attribute__((packed));
+
+struct tpm_latency_stats {
+	uint32_t commands;
+	uint32_t errors;
+	uint32_t buckets[TPM_STATS_BUCKETS];
+	struct tpm_ordinal_stats ordinals[TPM_STATS_ORDINALS];
+} __attribute__((packed));
+
 #endif /* TPM_H_ */
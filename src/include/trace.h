@@ -20,6 +20,38 @@
 #ifndef __TRACE_H
 #define __TRACE_H
 
+#include <stdint.h>
+
+/*
+ * With CONFIG_TRACE every function entry and exit in ramstage is recorded
+ * in a per cpu ring of trace_event records. Small rings in the ramstage
+ * take the events until CBMEM is up, then the full rings continue in CBMEM
+ * under CBMEM_ID_TRACE, where util/cbmem can dump them for util/genprof.
+ */
+#define TRACE_MAGIC		0x45435254	/* "TRCE" */
+#define TRACE_EXIT		(1ULL << 63)	/* Set in tsc for an exit. */
+
+struct trace_event {
+	uint32_t func;
+	uint32_t callsite;
+	uint64_t tsc;
+} __attribute__((packed));
+
+/* Each ring is followed by trace_buffer.entries events. */
+struct trace_ring {
+	uint32_t next;		/* Slot the next event goes to. */
+	uint32_t total;		/* Events written, may exceed entries. */
+	struct trace_event events[0];
+} __attribute__((packed));
+
+/* Followed by trace_buffer.rings rings, one per cpu index. */
+struct trace_buffer {
+	uint32_t magic;
+	uint32_t rings;
+	uint32_t entries;
+	uint32_t reserved;
+} __attribute__((packed));
+
 
 #ifdef __PRE_RAM__
 
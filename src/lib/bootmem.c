@@ -69,6 +69,16 @@ void bootmem_write_memory_table(struct lb_memory *mem)
 	}
 }
 
+void bootmem_walk(bootmem_action_t action, void *arg)
+{
+	const struct range_entry *r;
+
+	memranges_each_entry(r, &bootmem) {
+		if (!action(r, arg))
+			break;
+	}
+}
+
 struct range_strings {
 	unsigned long tag;
 	const char *str;
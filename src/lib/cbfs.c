@@ -20,6 +20,7 @@
 
 
 #include "cbfs_core.h"
+#include <measured_boot.h>
 
 #ifndef __SMM__
 static inline int tohex4(unsigned int c)
@@ -77,6 +78,7 @@ void * cbfs_load_stage(struct cbfs_media *media, const char *name)
 {
 	struct cbfs_stage *stage = (struct cbfs_stage *)
 	cbfs_get_file_content(media, name, CBFS_TYPE_STAGE, NULL);
+	struct cbfs_stage header;
 	/* this is a mess. There is no ntohll. */
 	/* for now, assume compatible byte order until we solve this. */
 	uintptr_t entry;
@@ -85,26 +87,33 @@ void * cbfs_load_stage(struct cbfs_media *media, const char *name)
 	if (stage == NULL)
 		return (void *) -1;
 
+	/* Read the header from flash only once, it is measured as used. */
+	memcpy(&header, stage, sizeof(header));
+
 	LOG("loading stage %s @ 0x%llx (%d bytes), entry @ 0x%llx\n",
 			name,
-			stage->load, stage->memlen,
-			stage->entry);
+			header.load, header.memlen,
+			header.entry);
 
-	final_size = cbfs_decompress(stage->compression,
+	final_size = cbfs_decompress(header.compression,
 				     ((unsigned char *) stage) +
 				     sizeof(struct cbfs_stage),
-				     (void *) (uintptr_t) stage->load,
-				     stage->len);
+				     (void *) (uintptr_t) header.load,
+				     header.len);
 	if (!final_size)
 		return (void *) -1;
 
+	/* Hash what was loaded, flash may change after it was read. */
+	measure_stage(MEASURE_PCR_FIRMWARE, name, &header,
+		      (void *) (uintptr_t) header.load, final_size);
+
 	/* Stages rely the below clearing so that the bss is initialized. */
-	memset((void *)((uintptr_t)stage->load + final_size), 0,
-	       stage->memlen - final_size);
+	memset((void *)((uintptr_t)header.load + final_size), 0,
+	       header.memlen - final_size);
 
 	DEBUG("stage loaded.\n");
 
-	entry = stage->entry;
+	entry = header.entry;
 	// entry = ntohll(stage->entry);
 
 	return (void *) entry;
@@ -41,6 +41,9 @@
 #if CONFIG_ARCH_X86
 #include <cpu/x86/mtrr.h>
 #endif
+#if CONFIG_UDELAY_TSC || CONFIG_TSC_FREQ_FROM_MONOTONIC
+#include <cpu/x86/tsc.h>
+#endif
 
 static struct lb_header *lb_table_init(unsigned long addr)
 {
@@ -308,6 +311,20 @@ static void lb_record_version_timestamp(struct lb_header *header)
 	rec->timestamp = coreboot_version_timestamp;
 }
 
+#if CONFIG_UDELAY_TSC || CONFIG_TSC_FREQ_FROM_MONOTONIC
+static void lb_tsc_info(struct lb_header *header)
+{
+	struct lb_tsc_info *rec;
+
+	rec = (struct lb_tsc_info *)lb_new_record(header);
+	rec->tag = LB_TAG_TSC_INFO;
+	rec->size = sizeof(*rec);
+	rec->freq_khz = tsc_freq_khz();
+}
+#else
+static inline void lb_tsc_info(struct lb_header *header) {}
+#endif
+
 void __attribute__((weak)) lb_board(struct lb_header *header) { /* NOOP */ }
 
 static struct lb_forward *lb_forward(struct lb_header *header, struct lb_header *next_header)
@@ -420,6 +437,8 @@ unsigned long write_coreboot_table(
 	/* Record our various random string information */
 	lb_strings(head);
 	lb_record_version_timestamp(head);
+	/* Record the TSC frequency */
+	lb_tsc_info(head);
 	/* Record our framebuffer */
 	lb_framebuffer(head);
 
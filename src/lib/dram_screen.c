@@ -0,0 +1,299 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <arch/cpu.h>
+#include <bootmem.h>
+#include <bootstate.h>
+#include <cbmem.h>
+#include <console/console.h>
+#include <cpu/x86/mp.h>
+#include <dram_screen.h>
+#include <smp/atomic.h>
+#include <smp/spinlock.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timer.h>
+
+/*
+ * The memory to be tested is split into chunks which the cpus claim one at
+ * a time, so any number of cpus can take part without having to agree on a
+ * partitioning up front. A chunk is larger than the L2 cache so that the
+ * verify pass really reads back from DRAM.
+ */
+#define CHUNK_SIZE		(4 * MiB)
+#define MAX_RANGES		16
+#define LOW_MEMORY_END		(1 * MiB)
+#define HIGH_MEMORY_END		0xfffff000ULL
+
+/* The ramstage including heap and stacks. */
+extern unsigned char _ram_seg;
+extern unsigned char _eram_seg;
+
+struct screen_range {
+	uintptr_t base;
+	size_t size;
+};
+
+struct screen_job {
+	spinlock_t lock;
+	struct screen_range ranges[MAX_RANGES];
+	int num_ranges;
+	int cur_range;
+	size_t cur_offset;
+	int streaming;
+	atomic_t cpus;
+	struct dram_screen_result *result;
+};
+
+static const uint32_t patterns[] = {
+	DRAM_SCREEN_ADDRESS,
+	DRAM_SCREEN_ADDRESS_INV,
+	DRAM_SCREEN_WALKING_ONES,
+	DRAM_SCREEN_WALKING_ZEROS,
+};
+
+static struct screen_job job = {
+	.lock = SPIN_LOCK_UNLOCKED,
+};
+
+static inline __attribute__((always_inline))
+uint32_t pattern_word(uint32_t pattern, uintptr_t addr)
+{
+	switch (pattern) {
+	case DRAM_SCREEN_ADDRESS:
+		return addr;
+	case DRAM_SCREEN_ADDRESS_INV:
+		return ~addr;
+	case DRAM_SCREEN_WALKING_ONES:
+		return 1U << ((addr >> 2) & 31);
+	default:
+		return ~(1U << ((addr >> 2) & 31));
+	}
+}
+
+static void record_error(struct screen_job *j, uintptr_t addr,
+			 uint32_t expected, uint32_t actual)
+{
+	struct dram_screen_result *res = j->result;
+
+	spin_lock(&j->lock);
+	res->error_count++;
+	if (res->num_bad < res->max_bad) {
+		res->bad[res->num_bad].address = addr;
+		res->bad[res->num_bad].expected = expected;
+		res->bad[res->num_bad].actual = actual;
+		res->num_bad++;
+	}
+	spin_unlock(&j->lock);
+}
+
+/*
+ * Always inlined with a constant pattern so that each pattern gets its own
+ * tight fill and verify loop.
+ */
+static inline __attribute__((always_inline))
+void fill_and_verify(struct screen_job *j, uint32_t pattern,
+		     uintptr_t base, size_t size)
+{
+	uintptr_t end = base + size;
+	uintptr_t addr;
+
+	if (j->streaming) {
+		/* Non-temporal stores don't pull the chunk into the cache. */
+		for (addr = base; addr < end; addr += sizeof(uint32_t))
+			asm volatile ("movnti %1, %0"
+				      : "=m" (*(uint32_t *)addr)
+				      : "r" (pattern_word(pattern, addr)));
+		asm volatile ("sfence" ::: "memory");
+	} else {
+		for (addr = base; addr < end; addr += sizeof(uint32_t))
+			*(volatile uint32_t *)addr = pattern_word(pattern, addr);
+	}
+
+	for (addr = base; addr < end; addr += sizeof(uint32_t)) {
+		uint32_t expected = pattern_word(pattern, addr);
+		uint32_t actual = *(volatile uint32_t *)addr;
+
+		if (actual != expected)
+			record_error(j, addr, expected, actual);
+	}
+}
+
+static void screen_chunk(struct screen_job *j, uintptr_t base, size_t size)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(patterns); i++) {
+		switch (patterns[i]) {
+		case DRAM_SCREEN_ADDRESS:
+			fill_and_verify(j, DRAM_SCREEN_ADDRESS, base, size);
+			break;
+		case DRAM_SCREEN_ADDRESS_INV:
+			fill_and_verify(j, DRAM_SCREEN_ADDRESS_INV, base, size);
+			break;
+		case DRAM_SCREEN_WALKING_ONES:
+			fill_and_verify(j, DRAM_SCREEN_WALKING_ONES, base,
+					size);
+			break;
+		case DRAM_SCREEN_WALKING_ZEROS:
+			fill_and_verify(j, DRAM_SCREEN_WALKING_ZEROS, base,
+					size);
+			break;
+		}
+	}
+}
+
+/* Returns 1 and the next chunk to test, 0 once all chunks are handed out. */
+static int claim_chunk(struct screen_job *j, uintptr_t *base, size_t *size)
+{
+	int ret = 0;
+
+	spin_lock(&j->lock);
+	while (j->cur_range < j->num_ranges) {
+		const struct screen_range *r = &j->ranges[j->cur_range];
+
+		if (j->cur_offset < r->size) {
+			*base = r->base + j->cur_offset;
+			*size = MIN(r->size - j->cur_offset, CHUNK_SIZE);
+			j->cur_offset += *size;
+			ret = 1;
+			break;
+		}
+
+		j->cur_range++;
+		j->cur_offset = 0;
+	}
+	spin_unlock(&j->lock);
+
+	return ret;
+}
+
+static void screen_worker(void *arg)
+{
+	struct screen_job *j = arg;
+	uintptr_t base;
+	size_t size;
+
+	atomic_inc(&j->cpus);
+	while (claim_chunk(j, &base, &size))
+		screen_chunk(j, base, size);
+}
+
+static void add_range(struct screen_job *j, uint64_t base, uint64_t end)
+{
+	if (base >= end)
+		return;
+
+	if (j->num_ranges == MAX_RANGES) {
+		printk(BIOS_WARNING, "DRAM screen: skipping %llx-%llx\n",
+		       base, end - 1);
+		return;
+	}
+
+	j->ranges[j->num_ranges].base = base;
+	j->ranges[j->num_ranges].size = end - base;
+	j->num_ranges++;
+	j->result->bytes_tested += end - base;
+}
+
+static int collect_range(const struct range_entry *r, void *arg)
+{
+	struct screen_job *j = arg;
+	const uint64_t ram_seg = (uintptr_t)&_ram_seg;
+	const uint64_t eram_seg = (uintptr_t)&_eram_seg;
+	uint64_t base, end;
+
+	if (range_entry_tag(r) != LB_MEM_RAM)
+		return 1;
+
+	/* Leave the legacy area alone and skip what is not mapped. */
+	base = MAX(range_entry_base(r), LOW_MEMORY_END);
+	end = MIN(range_entry_end(r), HIGH_MEMORY_END);
+
+	/* Punch out the running ramstage. */
+	add_range(j, base, MIN(end, ram_seg));
+	add_range(j, MAX(base, eram_seg), end);
+
+	return range_entry_base(r) < HIGH_MEMORY_END;
+}
+
+static void dram_screen_alloc(void *unused)
+{
+	size_t size;
+
+	/* Allocate the result before bootmem takes its snapshot of cbmem. */
+	size = sizeof(struct dram_screen_result);
+	size += CONFIG_DRAM_SCREEN_MAX_ERRORS * sizeof(struct dram_screen_bad);
+	job.result = cbmem_add(CBMEM_ID_DRAM_SCREEN, size);
+	if (job.result == NULL) {
+		printk(BIOS_ERR, "DRAM screen: no room for results.\n");
+		return;
+	}
+	memset(job.result, 0, size);
+	job.result->max_bad = CONFIG_DRAM_SCREEN_MAX_ERRORS;
+}
+
+static void dram_screen_run(void *unused)
+{
+	struct dram_screen_result *res = job.result;
+	struct mono_time start, end;
+	int i;
+
+	if (res == NULL)
+		return;
+
+	bootmem_walk(collect_range, &job);
+
+	/* movnti is part of SSE2. */
+	job.streaming = !!(cpuid_edx(1) & (1 << 26));
+
+	for (i = 0; i < ARRAY_SIZE(patterns); i++)
+		res->patterns |= patterns[i];
+
+	printk(BIOS_INFO, "DRAM screen: testing %llu MiB in %d ranges.\n",
+	       res->bytes_tested / MiB, job.num_ranges);
+
+	if (IS_ENABLED(CONFIG_HAVE_MONOTONIC_TIMER))
+		timer_monotonic_get(&start);
+
+	if (IS_ENABLED(CONFIG_PARALLEL_MP))
+		mp_run_on_all_cpus(screen_worker, &job, 0);
+	else
+		screen_worker(&job);
+
+	if (IS_ENABLED(CONFIG_HAVE_MONOTONIC_TIMER)) {
+		timer_monotonic_get(&end);
+		res->elapsed_ms = mono_time_diff_microseconds(&start, &end) /
+				  1000;
+	}
+	res->cpus = atomic_read(&job.cpus);
+
+	printk(BIOS_INFO, "DRAM screen: %d cpus, %u ms, %u errors.\n",
+	       res->cpus, res->elapsed_ms, res->error_count);
+	for (i = 0; i < res->num_bad; i++)
+		printk(BIOS_ERR, "DRAM screen: 0x%08llx: got 0x%08x "
+		       "expected 0x%08x\n", res->bad[i].address,
+		       res->bad[i].actual, res->bad[i].expected);
+}
+
+BOOT_STATE_INIT_ENTRIES(dram_screen_bscb) = {
+	BOOT_STATE_INIT_ENTRY(BS_WRITE_TABLES, BS_ON_ENTRY,
+			      dram_screen_alloc, NULL),
+	BOOT_STATE_INIT_ENTRY(BS_WRITE_TABLES, BS_ON_EXIT,
+			      dram_screen_run, NULL),
+};
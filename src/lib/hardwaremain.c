@@ -295,6 +295,8 @@ static void bs_run_timers(int drain)
 	do {
 		if (!timers_run())
 			break;
+		if (drain)
+			timers_idle();
 	} while (drain);
 }
 #else
@@ -24,7 +24,7 @@
  *
  */
 
-#define __LITTLE_ENDIAN
+#include <stdint.h>
 #include <string.h>
 #include "jpeg.h"
 #define ISHIFT 11
@@ -101,9 +101,8 @@ static void scaleidctqtab __P((PREC *, PREC));
 
 static void initcol __P((PREC[][64]));
 
-static void col221111 __P((int *, unsigned char *, int));
-static void col221111_16 __P((int *, unsigned char *, int));
-static void col221111_32 __P((int *, unsigned char *, int));
+static void col221111 __P((int *, unsigned char *, int, int));
+static void col221111_scaled __P((int *, unsigned char *, int, int, int));
 
 /*********************************/
 
@@ -272,14 +271,29 @@ int jpeg_check_size(unsigned char *buf, int width, int height)
 
 int jpeg_decode(unsigned char *buf, unsigned char *pic,
 		int width, int height, int depth, struct jpeg_decdata *decdata)
+{
+	return jpeg_decode_scaled(buf, pic, width, height, depth,
+				  width * depth / 8, 0, decdata);
+}
+
+int jpeg_decode_scaled(unsigned char *buf, unsigned char *pic,
+		int width, int height, int depth, int bytes_per_line,
+		int scale, struct jpeg_decdata *decdata)
 {
 	int i, j, m, tac, tdc;
 	int mcusx, mcusy, mx, my;
 	int max[6];
+	int mcu_size;
 
 	if (!decdata || !buf || !pic)
 		return -1;
+	if (scale < 0 || scale > 3)
+		return -1;
+	if (depth != 16 && depth != 24 && depth != 32)
+		return ERR_DEPTH_MISMATCH;
 	datap = buf;
+	/* The restart interval is only set if the image has a DRI marker. */
+	info.dri = 0;
 	if (getbyte() != 0xff)
 		return ERR_NO_SOI;
 	if (getbyte() != M_SOI)
@@ -370,13 +384,23 @@ int jpeg_decode(unsigned char *buf, unsigned char *pic,
 	dscans[0].next = 6 - 4;
 	dscans[1].next = 6 - 4 - 1;
 	dscans[2].next = 6 - 4 - 1 - 1;	/* 411 encoding */
+	mcu_size = 16 >> scale;
 	for (my = 0; my < mcusy; my++) {
+		unsigned char *row = pic + my * mcu_size * bytes_per_line;
+
 		for (mx = 0; mx < mcusx; mx++) {
+			unsigned char *p = row + mx * mcu_size * depth / 8;
+
 			if (info.dri && !--info.nm)
 				if (dec_checkmarker())
 					return ERR_WRONG_MARKER;
 
 			decode_mcus(&glob_in, decdata->dcts, 6, dscans, max);
+
+			/* At 1/8 each luma block is a single pixel, its DC. */
+			if (scale == 3)
+				max[0] = max[1] = max[2] = max[3] = 1;
+
 			idct(decdata->dcts, decdata->out, decdata->dquant[0], IFIX(128.5), max[0]);
 			idct(decdata->dcts + 64, decdata->out + 64, decdata->dquant[0], IFIX(128.5), max[1]);
 			idct(decdata->dcts + 128, decdata->out + 128, decdata->dquant[0], IFIX(128.5), max[2]);
@@ -384,20 +408,12 @@ int jpeg_decode(unsigned char *buf, unsigned char *pic,
 			idct(decdata->dcts + 256, decdata->out + 256, decdata->dquant[1], IFIX(0.5), max[4]);
 			idct(decdata->dcts + 320, decdata->out + 320, decdata->dquant[2], IFIX(0.5), max[5]);
 
-			switch (depth) {
-			case 32:
-				col221111_32(decdata->out, pic + (my * 16 * mcusx + mx) * 16 * 4, mcusx * 16 * 4);
-				break;
-			case 24:
-				col221111(decdata->out, pic + (my * 16 * mcusx + mx) * 16 * 3, mcusx * 16 * 3);
-				break;
-			case 16:
-				col221111_16(decdata->out, pic + (my * 16 * mcusx + mx) * (16 * 2), mcusx * (16 * 2));
-				break;
-			default:
-				return ERR_DEPTH_MISMATCH;
-				break;
-			}
+			if (scale)
+				col221111_scaled(decdata->out, p, depth,
+						 bytes_per_line, scale);
+			else
+				col221111(decdata->out, p, depth,
+					  bytes_per_line);
 		}
 	}
 
@@ -697,6 +713,14 @@ void idct(int *in, int *out, PREC *lquant, PREC off, int max)
 		t3 = in[j] * lquant[j];
 		j = *zig2p++;
 		t6 = in[j] * lquant[j];
+		/* Columns without AC coefficients are flat. */
+		if ((t1 | t2 | t3 | t4 | t5 | t6 | t7) == 0) {
+			for (j = 0; j < 8; j++)
+				tmpp[j * 8] = t0;
+			tmpp++;
+			t0 = 0;
+			continue;
+		}
 		IDCT;
 		tmpp[0 * 8] = t0;
 		tmpp[1 * 8] = t1;
@@ -800,187 +824,127 @@ static void initcol(PREC q[][64])
 	scaleidctqtab(q[2], IFIX(1.40200));
 }
 
-/* This is optimized for the stupid sun SUNWspro compiler. */
-#define STORECLAMP(a,x)				\
-(						\
-  (a) = (x),					\
-  (unsigned int)(x) >= 256 ? 			\
-    ((a) = (x) < 0 ? 0 : 255)			\
-  :						\
-    0						\
-)
-
 #define CLAMP(x) ((unsigned int)(x) >= 256 ? ((x) < 0 ? 0 : 255) : (x))
 
 #ifdef ROUND
-
-#define CBCRCG(yin, xin)			\
-(						\
-  cb = outc[0 +yin*8+xin],			\
-  cr = outc[64+yin*8+xin],			\
-  cg = (50 * cb + 130 * cr + 128) >> 8		\
-)
-
+#define CG(cb, cr) ((50 * (cb) + 130 * (cr) + 128) >> 8)
 #else
-
-#define CBCRCG(yin, xin)			\
-(						\
-  cb = outc[0 +yin*8+xin],			\
-  cr = outc[64+yin*8+xin],			\
-  cg = (3 * cb + 8 * cr) >> 4			\
-)
-
+#define CG(cb, cr) ((3 * (cb) + 8 * (cr)) >> 4)
 #endif
 
-#define PIC(yin, xin, p, xout)			\
-(						\
-  y = outy[(yin) * 8 + xin],			\
-  STORECLAMP(p[(xout) * 3 + 0], y + cr),	\
-  STORECLAMP(p[(xout) * 3 + 1], y - cg),	\
-  STORECLAMP(p[(xout) * 3 + 2], y + cb)		\
-)
-
-#ifdef __LITTLE_ENDIAN
-#define PIC_16(yin, xin, p, xout, add)		 \
-(                                                \
-  y = outy[(yin) * 8 + xin],                     \
-  y = ((CLAMP(y + cr + add*2+1) & 0xf8) <<  8) | \
-      ((CLAMP(y - cg + add    ) & 0xfc) <<  3) | \
-      ((CLAMP(y + cb + add*2+1)       ) >>  3),  \
-  p[(xout) * 2 + 0] = y & 0xff,                  \
-  p[(xout) * 2 + 1] = y >> 8                     \
-)
-#else
-#ifdef CONFIG_PPC
-#define PIC_16(yin, xin, p, xout, add)		 \
-(                                                \
-  y = outy[(yin) * 8 + xin],                     \
-  y = ((CLAMP(y + cr + add*2+1) & 0xf8) <<  7) | \
-      ((CLAMP(y - cg + add*2+1) & 0xf8) <<  2) | \
-      ((CLAMP(y + cb + add*2+1)       ) >>  3),  \
-  p[(xout) * 2 + 0] = y >> 8,                    \
-  p[(xout) * 2 + 1] = y & 0xff                   \
-)
-#else
-#define PIC_16(yin, xin, p, xout, add)	 	 \
-(                                                \
-  y = outy[(yin) * 8 + xin],                     \
-  y = ((CLAMP(y + cr + add*2+1) & 0xf8) <<  8) | \
-      ((CLAMP(y - cg + add    ) & 0xfc) <<  3) | \
-      ((CLAMP(y + cb + add*2+1)       ) >>  3),  \
-  p[(xout) * 2 + 0] = y >> 8,                    \
-  p[(xout) * 2 + 1] = y & 0xff                   \
-)
-#endif
-#endif
-
-#define PIC_32(yin, xin, p, xout)		\
-(						\
-  y = outy[(yin) * 8 + xin],			\
-  STORECLAMP(p[(xout) * 4 + 0], y + cr),	\
-  STORECLAMP(p[(xout) * 4 + 1], y - cg),	\
-  STORECLAMP(p[(xout) * 4 + 2], y + cb),	\
-  p[(xout) * 4 + 3] = 0				\
-)
-
-#define PIC221111(xin)						\
-(								\
-  CBCRCG(0, xin),						\
-  PIC(xin / 4 * 8 + 0, (xin & 3) * 2 + 0, pic0, xin * 2 + 0),	\
-  PIC(xin / 4 * 8 + 0, (xin & 3) * 2 + 1, pic0, xin * 2 + 1),	\
-  PIC(xin / 4 * 8 + 1, (xin & 3) * 2 + 0, pic1, xin * 2 + 0),	\
-  PIC(xin / 4 * 8 + 1, (xin & 3) * 2 + 1, pic1, xin * 2 + 1)	\
-)
-
-#define PIC221111_16(xin)                                               \
-(                                                               	\
-  CBCRCG(0, xin),                                               	\
-  PIC_16(xin / 4 * 8 + 0, (xin & 3) * 2 + 0, pic0, xin * 2 + 0, 3),     \
-  PIC_16(xin / 4 * 8 + 0, (xin & 3) * 2 + 1, pic0, xin * 2 + 1, 0),     \
-  PIC_16(xin / 4 * 8 + 1, (xin & 3) * 2 + 0, pic1, xin * 2 + 0, 1),     \
-  PIC_16(xin / 4 * 8 + 1, (xin & 3) * 2 + 1, pic1, xin * 2 + 1, 2)      \
-)
+/*
+ * Store one pixel. The 16 bit mode dithers with an ordered 2x2 pattern,
+ * add is the pattern value for the pixel's position.
+ */
+static inline __attribute__((always_inline))
+void put_pixel(unsigned char *p, int x, int depth, int y, int cr, int cg,
+	       int cb, int add)
+{
+	switch (depth) {
+	case 32:
+		((uint32_t *)p)[x] = CLAMP(y + cr) | CLAMP(y - cg) << 8 |
+				     CLAMP(y + cb) << 16;
+		break;
+	case 24:
+		p[x * 3 + 0] = CLAMP(y + cr);
+		p[x * 3 + 1] = CLAMP(y - cg);
+		p[x * 3 + 2] = CLAMP(y + cb);
+		break;
+	case 16:
+		((uint16_t *)p)[x] = (CLAMP(y + cr + add * 2 + 1) & 0xf8) << 8 |
+				     (CLAMP(y - cg + add) & 0xfc) << 3 |
+				     CLAMP(y + cb + add * 2 + 1) >> 3;
+		break;
+	}
+}
 
-#define PIC221111_32(xin)					\
-(								\
-  CBCRCG(0, xin),						\
-  PIC_32(xin / 4 * 8 + 0, (xin & 3) * 2 + 0, pic0, xin * 2 + 0),\
-  PIC_32(xin / 4 * 8 + 0, (xin & 3) * 2 + 1, pic0, xin * 2 + 1),\
-  PIC_32(xin / 4 * 8 + 1, (xin & 3) * 2 + 0, pic1, xin * 2 + 0),\
-  PIC_32(xin / 4 * 8 + 1, (xin & 3) * 2 + 1, pic1, xin * 2 + 1)	\
-)
+/* Dither values for even and odd pixels of even and odd lines. */
+static const unsigned char dither16[2][2] = { { 3, 0 }, { 1, 2 } };
 
-static void col221111(int *out, unsigned char *pic, int width)
+/*
+ * Convert one 16 pixel line of a 2x2 subsampled MCU. The luma blocks are
+ * laid out top left, top right, bottom left, bottom right in out, followed
+ * by the Cb and the Cr block. Each line is written out in one go so the
+ * stores to the framebuffer stay sequential.
+ */
+static inline __attribute__((always_inline))
+void col221111_line(int *out, unsigned char *pic, int line, int depth)
 {
-	int i, j, k;
-	unsigned char *pic0, *pic1;
 	int *outy, *outc;
-	int cr, cg, cb, y;
-
-	pic0 = pic;
-	pic1 = pic + width;
-	outy = out;
-	outc = out + 64 * 4;
-	for (i = 2; i > 0; i--) {
-		for (j = 4; j > 0; j--) {
-			for (k = 0; k < 8; k++) {
-				PIC221111(k);
-			}
-			outc += 8;
-			outy += 16;
-			pic0 += 2 * width;
-			pic1 += 2 * width;
-		}
-		outy += 64 * 2 - 16 * 4;
+	int x, cr, cg, cb;
+
+	outy = out + (line >> 3) * 128 + (line & 7) * 8;
+	outc = out + 64 * 4 + (line >> 1) * 8;
+	for (x = 0; x < 8; x++) {
+		cb = outc[x];
+		cr = outc[64 + x];
+		cg = CG(cb, cr);
+		put_pixel(pic, x * 2 + 0, depth, outy[(x >> 2) * 64 +
+			  (x & 3) * 2 + 0], cr, cg, cb, dither16[line & 1][0]);
+		put_pixel(pic, x * 2 + 1, depth, outy[(x >> 2) * 64 +
+			  (x & 3) * 2 + 1], cr, cg, cb, dither16[line & 1][1]);
 	}
 }
 
-static void col221111_16(int *out, unsigned char *pic, int width)
+static void col221111(int *out, unsigned char *pic, int depth,
+		      int bytes_per_line)
 {
-	int i, j, k;
-	unsigned char *pic0, *pic1;
-	int *outy, *outc;
-	int cr, cg, cb, y;
-
-	pic0 = pic;
-	pic1 = pic + width;
-	outy = out;
-	outc = out + 64 * 4;
-	for (i = 2; i > 0; i--) {
-		for (j = 4; j > 0; j--) {
-			for (k = 0; k < 8; k++) {
-			    PIC221111_16(k);
-			}
-			outc += 8;
-			outy += 16;
-			pic0 += 2 * width;
-			pic1 += 2 * width;
-		}
-		outy += 64 * 2 - 16 * 4;
+	int line;
+
+	/* Keep the depth a constant in each copy of the line loop. */
+	switch (depth) {
+	case 32:
+		for (line = 0; line < 16; line++, pic += bytes_per_line)
+			col221111_line(out, pic, line, 32);
+		break;
+	case 24:
+		for (line = 0; line < 16; line++, pic += bytes_per_line)
+			col221111_line(out, pic, line, 24);
+		break;
+	case 16:
+		for (line = 0; line < 16; line++, pic += bytes_per_line)
+			col221111_line(out, pic, line, 16);
+		break;
 	}
 }
 
-static void col221111_32(int *out, unsigned char *pic, int width)
+/* Average a size x size box of a block, the result is rounded. */
+static int box_average(int *block, int stride, int size, int shift)
 {
-	int i, j, k;
-	unsigned char *pic0, *pic1;
-	int *outy, *outc;
-	int cr, cg, cb, y;
-
-	pic0 = pic;
-	pic1 = pic + width;
-	outy = out;
-	outc = out + 64 * 4;
-	for (i = 2; i > 0; i--) {
-		for (j = 4; j > 0; j--) {
-			for (k = 0; k < 8; k++) {
-				PIC221111_32(k);
-			}
-			outc += 8;
-			outy += 16;
-			pic0 += 2 * width;
-			pic1 += 2 * width;
+	int x, y, sum = 0;
+
+	for (y = 0; y < size; y++, block += stride)
+		for (x = 0; x < size; x++)
+			sum += block[x];
+
+	return (sum + (1 << shift >> 1)) >> shift;
+}
+
+/*
+ * Downscale an MCU by 1 << scale in both directions while converting it.
+ * Each output pixel is the average of the box of samples it covers.
+ */
+static void col221111_scaled(int *out, unsigned char *pic, int depth,
+			     int bytes_per_line, int scale)
+{
+	int n = 1 << scale, m = n >> 1;
+	int size = 16 >> scale;
+	int ox, oy, lx, ly, y, cr, cg, cb;
+
+	for (oy = 0; oy < size; oy++, pic += bytes_per_line) {
+		for (ox = 0; ox < size; ox++) {
+			lx = ox * n;
+			ly = oy * n;
+			y = box_average(out + (ly >> 3) * 128 + (lx >> 3) * 64 +
+					(ly & 7) * 8 + (lx & 7), 8, n,
+					2 * scale);
+			cb = box_average(out + 64 * 4 + oy * m * 8 + ox * m, 8,
+					 m, 2 * (scale - 1));
+			cr = box_average(out + 64 * 5 + oy * m * 8 + ox * m, 8,
+					 m, 2 * (scale - 1));
+			cg = CG(cb, cr);
+			put_pixel(pic, ox, depth, y, cr, cg, cb,
+				  dither16[oy & 1][ox & 1]);
 		}
-		outy += 64 * 2 - 16 * 4;
 	}
 }
@@ -49,6 +49,12 @@ struct jpeg_decdata {
 };
 
 int jpeg_decode(unsigned char *, unsigned char *, int, int, int, struct jpeg_decdata *);
+/*
+ * Decode into a linear framebuffer with the given pitch, shrinking the
+ * image by 1 << scale (0 to 3) in both directions.
+ */
+int jpeg_decode_scaled(unsigned char *, unsigned char *, int, int, int, int,
+		       int, struct jpeg_decdata *);
 int jpeg_check_size(unsigned char *, int, int);
 
 #endif
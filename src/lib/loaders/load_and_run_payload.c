@@ -19,9 +19,11 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <bootmem.h>
 #include <console/console.h>
 #include <fallback.h>
 #include <lib.h>
+#include <measured_boot.h>
 #include <payload_loader.h>
 #include <timestamp.h>
 
@@ -44,6 +46,27 @@ void __attribute__((weak)) mirror_payload(struct payload *payload)
 	return;
 }
 
+/*
+ * Copy the payload to RAM, hashing it on the way, and load it from there.
+ * selfload() then reads exactly what was measured, not the flash again.
+ */
+static int measure_payload(struct payload *payload)
+{
+	void *buffer;
+
+	buffer = bootmem_allocate_buffer(payload->backing_store.size);
+	if (buffer == NULL) {
+		printk(BIOS_ERR, "No buffer to measure the payload in.\n");
+		return -1;
+	}
+
+	measure_copy(MEASURE_PCR_PAYLOAD, payload->name, buffer,
+		     payload->backing_store.data, payload->backing_store.size);
+	payload->backing_store.data = buffer;
+
+	return 0;
+}
+
 struct payload *payload_load(void)
 {
 	int i;
@@ -69,6 +92,9 @@ struct payload *payload_load(void)
 
 	mirror_payload(payload);
 
+	if (IS_ENABLED(CONFIG_MEASURED_BOOT) && measure_payload(payload) < 0)
+		return NULL;
+
 	entry = selfload(payload);
 
 	if (entry == NULL)
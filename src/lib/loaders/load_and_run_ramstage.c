@@ -22,6 +22,7 @@
 #include <arch/stages.h>
 #include <cbfs.h>
 #include <cbmem.h>
+#include <measured_boot.h>
 #include <ramstage_loader.h>
 #include <romstage_handoff.h>
 #include <timestamp.h>
@@ -80,6 +81,22 @@ static void run_ramstage_from_resume(struct romstage_handoff *handoff)
 	}
 }
 
+/*
+ * The bootblock can't measure romstage, so it measures itself. That is no
+ * root of trust, see the MEASURED_BOOT help.
+ */
+static void measure_romstage(void)
+{
+	const char *name = CONFIG_CBFS_PREFIX "/romstage";
+	struct cbfs_stage *stage;
+
+	stage = cbfs_get_file_content(CBFS_DEFAULT_MEDIA, name,
+				      CBFS_TYPE_STAGE, NULL);
+	if (stage != NULL)
+		measure_data(MEASURE_PCR_FIRMWARE, name, stage,
+			     sizeof(*stage) + stage->len);
+}
+
 void run_ramstage(void)
 {
 	struct romstage_handoff *handoff;
@@ -90,6 +107,9 @@ void run_ramstage(void)
 
 	run_ramstage_from_resume(handoff);
 
+	if (IS_ENABLED(CONFIG_MEASURED_BOOT))
+		measure_romstage();
+
 	for (i = 0; i < ARRAY_SIZE(loaders); i++) {
 		ops = loaders[i];
 		printk(BIOS_DEBUG, "Trying %s ramstage loader.\n", ops->name);
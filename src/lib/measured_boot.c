@@ -0,0 +1,309 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <arch/acpi.h>
+#include <arch/early_variables.h>
+#include <bootstate.h>
+#include <cbfs.h>
+#include <cbmem.h>
+#include <console/console.h>
+#include <measured_boot.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread.h>
+#include <tpm.h>
+
+#define TPM_TAG_RQU_COMMAND	0x00c1
+#define TPM_ORD_EXTEND		0x00000014
+#define TPM_ORD_STARTUP		0x00000099
+#define TPM_ST_CLEAR		0x0001
+#define TPM_SUCCESS		0x00000000
+#define TPM_INVALID_POSTINIT	0x00000026
+
+#define TPM_HEADER_SIZE		10
+
+/* The piece measure_copy() copies before hashing it, well within L1. */
+#define COPY_CHUNK		4096
+
+/* 0 until the TPM is first used, then 1 if it is usable or -1 if not. */
+static int tpm_state CAR_GLOBAL;
+
+/* Set while a thread owns the TPM, see measure_queue(). */
+static int worker_running;
+
+static void put_be16(u8 *p, u16 v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static void put_be32(u8 *p, u32 v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static u32 get_be32(const u8 *p)
+{
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/* Returns the TPM result code, or -1 if the command didn't go through. */
+static int tpm_command(u8 *cmd, size_t len, u32 ordinal, u8 *resp,
+		       size_t resp_size)
+{
+	size_t resp_len = resp_size;
+
+	put_be16(cmd, TPM_TAG_RQU_COMMAND);
+	put_be32(cmd + 2, len);
+	put_be32(cmd + 6, ordinal);
+
+	if (tis_sendrecv(cmd, len, resp, &resp_len) ||
+	    resp_len < TPM_HEADER_SIZE)
+		return -1;
+
+	return get_be32(resp + 6);
+}
+
+static int tpm_setup(void)
+{
+	u8 cmd[TPM_HEADER_SIZE + 2];
+	u8 resp[TPM_HEADER_SIZE];
+	int state = car_get_var(tpm_state);
+	int ret;
+
+	if (state)
+		return state > 0 ? 0 : -1;
+
+	car_set_var(tpm_state, -1);
+
+	if (tis_init() || tis_open()) {
+		printk(BIOS_ERR, "Measured boot: no TPM.\n");
+		return -1;
+	}
+
+	/* Whoever comes first starts the TPM up, later stages are refused. */
+	put_be16(cmd + TPM_HEADER_SIZE, TPM_ST_CLEAR);
+	ret = tpm_command(cmd, sizeof(cmd), TPM_ORD_STARTUP, resp,
+			  sizeof(resp));
+	if (ret != TPM_SUCCESS && ret != TPM_INVALID_POSTINIT) {
+		printk(BIOS_ERR, "Measured boot: TPM startup failed: %#x\n",
+		       ret);
+		return -1;
+	}
+
+	car_set_var(tpm_state, 1);
+	return 0;
+}
+
+static int tpm_extend(u32 pcr, const u8 *digest)
+{
+	u8 cmd[TPM_HEADER_SIZE + 4 + SHA1_DIGEST_SIZE];
+	u8 resp[TPM_HEADER_SIZE + SHA1_DIGEST_SIZE];
+	int ret;
+
+	if (tpm_setup())
+		return -1;
+
+	put_be32(cmd + TPM_HEADER_SIZE, pcr);
+	memcpy(cmd + TPM_HEADER_SIZE + 4, digest, SHA1_DIGEST_SIZE);
+	ret = tpm_command(cmd, sizeof(cmd), TPM_ORD_EXTEND, resp,
+			  sizeof(resp));
+	if (ret != TPM_SUCCESS) {
+		printk(BIOS_ERR, "Measured boot: extending PCR %u failed: "
+		       "%#x\n", pcr, ret);
+		return -1;
+	}
+
+	return 0;
+}
+
+static struct measure_log *measure_log(void)
+{
+	struct measure_log *log;
+	size_t size;
+
+	log = cbmem_find(CBMEM_ID_TCPA_LOG);
+	if (log != NULL)
+		return log;
+
+	size = sizeof(*log) + MEASURE_MAX_ENTRIES * sizeof(log->entries[0]);
+	log = cbmem_add(CBMEM_ID_TCPA_LOG, size);
+	if (log == NULL)
+		return NULL;
+
+	memset(log, 0, size);
+	log->max_entries = MEASURE_MAX_ENTRIES;
+	return log;
+}
+
+/* Extend the PCRs with the entries that are still queued, in order. */
+static void measure_flush(void)
+{
+	struct measure_log *log = cbmem_find(CBMEM_ID_TCPA_LOG);
+	struct measure_entry *e;
+	u32 i;
+
+	if (log == NULL)
+		return;
+
+	/* Entries can be added while an extend waits for the TPM. */
+	for (i = 0; i < log->num_entries; i++) {
+		e = &log->entries[i];
+		if (e->extended)
+			continue;
+		if (tpm_extend(e->pcr, e->sha1))
+			return;
+		e->extended = 1;
+	}
+}
+
+#if ENV_RAMSTAGE && CONFIG_COOP_MULTITASKING
+static void measure_worker(void *unused)
+{
+	measure_flush();
+	worker_running = 0;
+}
+#endif
+
+/*
+ * The TPM is slow, an extend takes milliseconds on LPC. In ramstage the
+ * extends are done by a thread, which gets to run whenever the main thread
+ * waits in udelay() and the other way around. The thread keeps the payload
+ * from being started until the queue is empty.
+ */
+static void measure_queue(void)
+{
+#if ENV_RAMSTAGE && CONFIG_COOP_MULTITASKING
+	if (worker_running)
+		return;
+
+	worker_running = 1;
+	if (!thread_run_until(measure_worker, NULL, BS_PAYLOAD_BOOT,
+			      BS_ON_ENTRY))
+		return;
+	worker_running = 0;
+#endif
+	measure_flush();
+}
+
+static void measure_digest(int pcr, const char *name, const u8 *sha1_digest,
+			   const u8 *sha256_digest)
+{
+	struct measure_log *log;
+	struct measure_entry *e;
+	int i;
+
+	printk(BIOS_DEBUG, "Measured %s into PCR %d: ", name, pcr);
+	for (i = 0; i < SHA1_DIGEST_SIZE; i++)
+		printk(BIOS_DEBUG, "%02x", sha1_digest[i]);
+	printk(BIOS_DEBUG, "\n");
+
+	log = measure_log();
+	if (log == NULL || log->num_entries == log->max_entries) {
+		printk(BIOS_ERR, "Measured boot: no room to log %s.\n", name);
+		/* Still leave a trace of it in the PCR, if the TPM is free. */
+		if (!worker_running)
+			tpm_extend(pcr, sha1_digest);
+		return;
+	}
+
+	e = &log->entries[log->num_entries];
+	e->pcr = pcr;
+	e->extended = 0;
+	memcpy(e->sha1, sha1_digest, SHA1_DIGEST_SIZE);
+	memcpy(e->sha256, sha256_digest, SHA256_DIGEST_SIZE);
+	strncpy(e->name, name, MEASURE_NAME_LENGTH - 1);
+	e->name[MEASURE_NAME_LENGTH - 1] = '\0';
+	log->num_entries++;
+
+	measure_queue();
+}
+
+static int measure_skipped(void)
+{
+	/* The OS expects the PCRs the way it left them. */
+	return acpi_is_wakeup_s3();
+}
+
+void measure_data(int pcr, const char *name, const void *data, size_t len)
+{
+	u8 sha1_digest[SHA1_DIGEST_SIZE];
+	u8 sha256_digest[SHA256_DIGEST_SIZE];
+
+	if (measure_skipped())
+		return;
+
+	sha1(data, len, sha1_digest);
+	sha256(data, len, sha256_digest);
+	measure_digest(pcr, name, sha1_digest, sha256_digest);
+}
+
+void measure_copy(int pcr, const char *name, void *dst, const void *src,
+		  size_t len)
+{
+	struct sha1_ctx sha1_ctx;
+	struct sha256_ctx sha256_ctx;
+	u8 sha1_digest[SHA1_DIGEST_SIZE];
+	u8 sha256_digest[SHA256_DIGEST_SIZE];
+	size_t n, offset;
+
+	if (measure_skipped()) {
+		memcpy(dst, src, len);
+		return;
+	}
+
+	/* Hash what was copied, that is what is going to run. */
+	sha1_init(&sha1_ctx);
+	sha256_init(&sha256_ctx);
+	for (offset = 0; offset < len; offset += n) {
+		n = MIN(len - offset, COPY_CHUNK);
+		memcpy(dst + offset, src + offset, n);
+		sha1_update(&sha1_ctx, dst + offset, n);
+		sha256_update(&sha256_ctx, dst + offset, n);
+	}
+	sha1_final(&sha1_ctx, sha1_digest);
+	sha256_final(&sha256_ctx, sha256_digest);
+
+	measure_digest(pcr, name, sha1_digest, sha256_digest);
+}
+
+void measure_stage(int pcr, const char *name, const struct cbfs_stage *header,
+		   const void *image, size_t len)
+{
+	struct sha1_ctx sha1_ctx;
+	struct sha256_ctx sha256_ctx;
+	u8 sha1_digest[SHA1_DIGEST_SIZE];
+	u8 sha256_digest[SHA256_DIGEST_SIZE];
+
+	if (measure_skipped())
+		return;
+
+	sha1_init(&sha1_ctx);
+	sha1_update(&sha1_ctx, header, sizeof(*header));
+	sha1_update(&sha1_ctx, image, len);
+	sha1_final(&sha1_ctx, sha1_digest);
+
+	sha256_init(&sha256_ctx);
+	sha256_update(&sha256_ctx, header, sizeof(*header));
+	sha256_update(&sha256_ctx, image, len);
+	sha256_final(&sha256_ctx, sha256_digest);
+
+	measure_digest(pcr, name, sha1_digest, sha256_digest);
+}
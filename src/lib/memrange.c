@@ -24,6 +24,12 @@
  * free'd entries.  */
 static struct range_entry *free_list;
 
+/* Entries are carved out of the heap this many at a time. */
+#define RANGE_POOL_ENTRIES 16
+
+/* Resources collected before they are sorted and inserted as a batch. */
+#define RESOURCE_BATCH_SIZE 32
+
 static inline void range_entry_link(struct range_entry **prev_ptr,
                                     struct range_entry *r)
 {
@@ -47,14 +53,22 @@ static inline void range_entry_unlink_and_free(struct range_entry **prev_ptr,
 
 static struct range_entry *alloc_range(void)
 {
-	if (free_list != NULL) {
-		struct range_entry *r;
+	struct range_entry *r;
 
-		r = free_list;
-		range_entry_unlink(&free_list, r);
-		return r;
+	if (free_list == NULL) {
+		struct range_entry *pool;
+		int i;
+
+		pool = malloc(RANGE_POOL_ENTRIES * sizeof(struct range_entry));
+		if (pool == NULL)
+			return NULL;
+		for (i = 0; i < RANGE_POOL_ENTRIES; i++)
+			range_entry_link(&free_list, &pool[i]);
 	}
-	return malloc(sizeof(struct range_entry));
+
+	r = free_list;
+	range_entry_unlink(&free_list, r);
+	return r;
 }
 
 static inline struct range_entry *
@@ -106,16 +120,14 @@ static void merge_neighbor_entries(struct memranges *ranges)
 	}
 }
 
-static void remove_memranges(struct memranges *ranges,
-                             resource_t begin, resource_t end,
-                             unsigned long unused)
+/* Removes [begin, end] from the entries starting at *prev_ptr. */
+static void remove_ranges_from(struct range_entry **prev_ptr,
+                               resource_t begin, resource_t end)
 {
 	struct range_entry *cur;
 	struct range_entry *next;
-	struct range_entry **prev_ptr;
 
-	prev_ptr = &ranges->entries;
-	for (cur = ranges->entries; cur != NULL; cur = next) {
+	for (cur = *prev_ptr; cur != NULL; cur = next) {
 		resource_t tmp_end;
 
 		/* Cache the next value to handle unlinks. */
@@ -170,38 +182,69 @@ static void remove_memranges(struct memranges *ranges,
 	}
 }
 
+static void remove_memranges(struct memranges *ranges,
+                             resource_t begin, resource_t end,
+                             unsigned long unused)
+{
+	remove_ranges_from(&ranges->entries, begin, end);
+	ranges->hint = NULL;
+}
+
 static void merge_add_memranges(struct memranges *ranges,
                                    resource_t begin, resource_t end,
                                    unsigned long tag)
 {
 	struct range_entry *cur;
+	struct range_entry *prev;
+	struct range_entry *new_entry;
 	struct range_entry **prev_ptr;
 
-	prev_ptr = &ranges->entries;
+	/*
+	 * Entries up to the previous insertion are untouched when this range
+	 * starts after it. Ranges added in address order thus never walk the
+	 * list, and only the entries past the hint can change.
+	 */
+	prev = ranges->hint;
+	if (prev == NULL || prev->end >= begin)
+		prev = NULL;
+	prev_ptr = prev == NULL ? &ranges->entries : &prev->next;
 
 	/* Remove all existing entries covered by the range. */
-	remove_memranges(ranges, begin, end, -1);
+	remove_ranges_from(prev_ptr, begin, end);
 
 	/* Find the entry to place the new entry after. Since
-	 * remove_memranges() was called above there is a guaranteed
+	 * remove_ranges_from() was called above there is a guaranteed
 	 * spot for this new entry. */
-	for (cur = ranges->entries; cur != NULL; cur = cur->next) {
+	for (cur = *prev_ptr; cur != NULL; cur = cur->next) {
 		/* Found insertion spot before current entry. */
 		if (end < cur->begin)
 			break;
 
 		/* Keep track of previous entry to insert new entry after it. */
+		prev = cur;
 		prev_ptr = &cur->next;
+	}
 
-		/* The new entry starts after this one. */
-		if (begin > cur->end)
-			continue;
+	new_entry = range_list_add(prev_ptr, begin, end, tag);
+	if (new_entry == NULL) {
+		ranges->hint = NULL;
+		return;
+	}
 
+	/* The rest of the list is already merged, so only the new entry's
+	 * neighbors can merge with it. */
+	cur = new_entry->next;
+	if (cur != NULL && end + 1 == cur->begin && cur->tag == tag) {
+		new_entry->end = cur->end;
+		range_entry_unlink_and_free(&new_entry->next, cur);
+	}
+	if (prev != NULL && prev->end + 1 == begin && prev->tag == tag) {
+		prev->end = new_entry->end;
+		range_entry_unlink_and_free(&prev->next, new_entry);
+		new_entry = prev;
 	}
 
-	/* Add new entry and merge with neighbors. */
-	range_list_add(prev_ptr, begin, end, tag);
-	merge_neighbor_entries(ranges);
+	ranges->hint = new_entry;
 }
 
 void memranges_update_tag(struct memranges *ranges, unsigned long old_tag,
@@ -215,6 +258,7 @@ void memranges_update_tag(struct memranges *ranges, unsigned long old_tag,
 	}
 
 	merge_neighbor_entries(ranges);
+	ranges->hint = NULL;
 }
 
 typedef void (*range_action_t)(struct memranges *ranges,
@@ -253,8 +297,34 @@ struct collect_context {
 	struct memranges *ranges;
 	unsigned long tag;
 	memrange_filter_t filter;
+	int num_batched;
+	struct resource *batch[RESOURCE_BATCH_SIZE];
 };
 
+/*
+ * All resources of a batch get the same tag, so the order they are inserted
+ * in doesn't change the result. Sorting them by base first lets most of
+ * them take the append path in merge_add_memranges().
+ */
+static void flush_batch(struct collect_context *ctx)
+{
+	int i, j;
+
+	for (i = 1; i < ctx->num_batched; i++) {
+		struct resource *res = ctx->batch[i];
+
+		for (j = i; j > 0 && ctx->batch[j - 1]->base > res->base; j--)
+			ctx->batch[j] = ctx->batch[j - 1];
+		ctx->batch[j] = res;
+	}
+
+	for (i = 0; i < ctx->num_batched; i++)
+		memranges_insert(ctx->ranges, ctx->batch[i]->base,
+				 ctx->batch[i]->size, ctx->tag);
+
+	ctx->num_batched = 0;
+}
+
 static void collect_ranges(void *gp, struct device *dev, struct resource *res)
 {
 	struct collect_context *ctx = gp;
@@ -262,8 +332,12 @@ static void collect_ranges(void *gp, struct device *dev, struct resource *res)
 	if (res->size == 0)
 		return;
 
-	if (ctx->filter == NULL || ctx->filter(dev, res))
-		memranges_insert(ctx->ranges, res->base, res->size, ctx->tag);
+	if (ctx->filter != NULL && !ctx->filter(dev, res))
+		return;
+
+	if (ctx->num_batched == RESOURCE_BATCH_SIZE)
+		flush_batch(ctx);
+	ctx->batch[ctx->num_batched++] = res;
 }
 
 void memranges_add_resources_filter(struct memranges *ranges,
@@ -280,7 +354,9 @@ void memranges_add_resources_filter(struct memranges *ranges,
 	context.ranges = ranges;
 	context.tag = tag;
 	context.filter = filter;
+	context.num_batched = 0;
 	search_global_resources(mask, match, collect_ranges, &context);
+	flush_batch(&context);
 }
 
 void memranges_add_resources(struct memranges *ranges,
@@ -295,6 +371,7 @@ void memranges_init(struct memranges *ranges,
                     unsigned long tag)
 {
 	ranges->entries = NULL;
+	ranges->hint = NULL;
 	memranges_add_resources(ranges, mask, match, tag);
 }
 
@@ -303,6 +380,7 @@ void memranges_teardown(struct memranges *ranges)
 	while (ranges->entries != NULL) {
 		range_entry_unlink_and_free(&ranges->entries, ranges->entries);
 	}
+	ranges->hint = NULL;
 }
 
 void memranges_fill_holes_up_to(struct memranges *ranges,
@@ -319,6 +397,11 @@ void memranges_fill_holes_up_to(struct memranges *ranges,
 			continue;
 		}
 
+		/* Nothing left to fill once the previous entry reaches the
+		 * limit. */
+		if (range_entry_end(prev) >= limit)
+			break;
+
 		/* If the previous entry does not directly precede the current
 		 * entry then add a new entry just after the previous one. */
 		if (range_entry_end(prev) != cur->begin) {
@@ -347,6 +430,7 @@ void memranges_fill_holes_up_to(struct memranges *ranges,
 
 	/* Merge all entries that were newly added. */
 	merge_neighbor_entries(ranges);
+	ranges->hint = NULL;
 }
 
 struct range_entry *memranges_next_entry(struct memranges *ranges,
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <arch/cache.h>
 #include <console/console.h>
+#include <measured_boot.h>
 #include <rmodule.h>
 
 /* Change this define to get more verbose debugging for module loading. */
@@ -57,7 +58,8 @@ int rmodule_parse(void *ptr, struct rmodule *module)
 	/* Sanity check the raw data. */
 	if (rhdr->magic != RMODULE_MAGIC)
 		return -1;
-	if (rhdr->version != RMODULE_VERSION_1)
+	if (rhdr->version != RMODULE_VERSION_1 &&
+	    rhdr->version != RMODULE_VERSION_2)
 		return -1;
 
 	/* Indicate the module hasn't been loaded yet. */
@@ -116,13 +118,12 @@ static void rmodule_clear_bss(struct rmodule *module)
 	memset(begin, 0, size);
 }
 
-static inline size_t rmodule_number_relocations(const struct rmodule *module)
+static inline size_t rmodule_relocations_size(const struct rmodule *module)
 {
 	size_t r;
 
 	r = module->header->relocations_end_offset;
 	r -= module->header->relocations_begin_offset;
-	r /= sizeof(uintptr_t);
 	return r;
 }
 
@@ -141,36 +142,90 @@ static void rmodule_copy_payload(const struct rmodule *module)
 	memcpy(module->location, module->payload, module->payload_size);
 }
 
-static int rmodule_relocate(const struct rmodule *module)
+/* Apply version 1 relocations, one link address per entry. */
+static size_t rmodule_relocate_v1(const struct rmodule *module,
+                                  uintptr_t adjustment)
 {
 	size_t num_relocations;
 	const uintptr_t *reloc;
-	uintptr_t adjustment;
-
-	/* Each relocation needs to be adjusted relative to the beginning of
-	 * the loaded program. */
-	adjustment = (uintptr_t)rmodule_load_addr(module, 0);
 
 	reloc = module->relocations;
-	num_relocations = rmodule_number_relocations(module);
-
-	printk(BIOS_DEBUG, "Processing %zu relocs. Offset value of 0x%08lx\n",
-	       num_relocations, (unsigned long)adjustment);
+	num_relocations = rmodule_relocations_size(module) / sizeof(uintptr_t);
 
 	while (num_relocations > 0) {
 		uintptr_t *adjust_loc;
 
-		/* If the adjustment location is non-NULL adjust it. */
 		adjust_loc = rmodule_load_addr(module, *reloc);
 		printk(PK_ADJ_LEVEL, "Adjusting %p: 0x%08lx -> 0x%08lx\n",
 		       adjust_loc, (unsigned long) *adjust_loc,
 		       (unsigned long) (*adjust_loc + adjustment));
-			*adjust_loc += adjustment;
+		*adjust_loc += adjustment;
 
 		reloc++;
 		num_relocations--;
 	}
 
+	return rmodule_relocations_size(module) / sizeof(uintptr_t);
+}
+
+/* Apply the version 2 page grouped stream. See rmodule-defs.h. */
+static size_t rmodule_relocate_v2(const struct rmodule *module,
+                                  uintptr_t adjustment)
+{
+	const uint32_t *group;
+	const uint32_t *end;
+	char *page;
+	size_t total = 0;
+
+	group = module->relocations;
+	end = (void *)((char *)module->relocations +
+	               rmodule_relocations_size(module));
+	page = module->location;
+
+	while (group < end) {
+		const uint16_t *offset;
+		size_t count;
+
+		page += (*group >> RMODULE_RELOC_PAGE_SHIFT) *
+		        RMODULE_RELOC_PAGE_SIZE;
+		count = (*group & RMODULE_RELOC_COUNT_MASK) + 1;
+		offset = (const uint16_t *)&group[1];
+		total += count;
+
+		while (count--)
+			*(uintptr_t *)&page[*offset++] += adjustment;
+
+		/* The next group is 32-bit aligned. */
+		group = (const uint32_t *)ALIGN_UP((uintptr_t)offset,
+		                                   sizeof(uint32_t));
+	}
+
+	return total;
+}
+
+static int rmodule_relocate(const struct rmodule *module)
+{
+	size_t num_relocations;
+	uintptr_t adjustment;
+
+	/* Each relocation needs to be adjusted relative to the beginning of
+	 * the loaded program. */
+	adjustment = (uintptr_t)rmodule_load_addr(module, 0);
+
+	/* Nothing to do when the module runs where it was linked. */
+	if (adjustment == 0) {
+		printk(BIOS_DEBUG, "Module loaded at its link address.\n");
+		return 0;
+	}
+
+	if (module->header->version == RMODULE_VERSION_1)
+		num_relocations = rmodule_relocate_v1(module, adjustment);
+	else
+		num_relocations = rmodule_relocate_v2(module, adjustment);
+
+	printk(BIOS_DEBUG, "Processed %zu relocs. Offset value of 0x%08lx\n",
+	       num_relocations, (unsigned long)adjustment);
+
 	return 0;
 }
 
@@ -254,18 +309,23 @@ int rmodule_calc_region(unsigned int region_alignment, size_t rmodule_size,
 int rmodule_stage_load(struct rmod_stage_load *rsl, struct cbfs_stage *stage)
 {
 	struct rmodule rmod_stage;
+	struct cbfs_stage header;
 	size_t region_size;
 	char *stage_region;
 	int rmodule_offset;
 	int load_offset;
+	int final_size;
 	const struct cbmem_entry *cbmem_entry;
 
 	if (stage == NULL || rsl->name == NULL)
 		return -1;
 
+	/* Read the header from flash only once, it is measured as used. */
+	memcpy(&header, stage, sizeof(header));
+
 	rmodule_offset =
 		rmodule_calc_region(DYN_CBMEM_ALIGN_SIZE,
-		                    stage->memlen, &region_size, &load_offset);
+		                    header.memlen, &region_size, &load_offset);
 
 	cbmem_entry = cbmem_entry_add(rsl->cbmem_id, region_size);
 
@@ -275,12 +335,20 @@ int rmodule_stage_load(struct rmod_stage_load *rsl, struct cbfs_stage *stage)
 	stage_region = cbmem_entry_start(cbmem_entry);
 
 	printk(BIOS_INFO, "Decompressing stage %s @ 0x%p (%d bytes)\n",
-	       rsl->name, &stage_region[rmodule_offset], stage->memlen);
+	       rsl->name, &stage_region[rmodule_offset], header.memlen);
 
-	if (!cbfs_decompress(stage->compression, &stage[1],
-	                    &stage_region[rmodule_offset], stage->len))
+	final_size = cbfs_decompress(header.compression, &stage[1],
+	                             &stage_region[rmodule_offset], header.len);
+	if (!final_size)
 		return -1;
 
+	/*
+	 * Hash the rmodule before it is relocated, flash may change after it
+	 * was read.
+	 */
+	measure_stage(MEASURE_PCR_FIRMWARE, rsl->name, &header,
+		      &stage_region[rmodule_offset], final_size);
+
 	if (rmodule_parse(&stage_region[rmodule_offset], &rmod_stage))
 		return -1;
 
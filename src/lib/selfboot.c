@@ -28,6 +28,7 @@
 #include <lib.h>
 #include <bootmem.h>
 #include <payload_loader.h>
+#include <stage_cache.h>
 
 /* from ramstage.ld: */
 extern unsigned char _ram_seg;
@@ -64,6 +65,9 @@ struct segment {
  * - Coreboot is preserved, so it can be returned to.
  * - The implementation is still relatively simple,
  *   and much simpler than the general case implemented in kexec.
+ *
+ * Most payloads don't go near coreboot though. Those are checked up front
+ * and then decompressed straight to where they run without a bounce buffer.
  */
 
 static unsigned long bounce_size, bounce_buffer;
@@ -212,12 +216,27 @@ static int relocate_segment(unsigned long buffer, struct segment *seg)
 }
 
 
+/* Keep the list sorted by destination so overlaps are between neighbours. */
+static void insert_segment(struct segment *head, struct segment *new)
+{
+	struct segment *ptr;
+
+	for(ptr = head->next; ptr != head; ptr = ptr->next) {
+		if (new->s_dstaddr < ptr->s_dstaddr)
+			break;
+	}
+
+	new->next = ptr;
+	new->prev = ptr->prev;
+	ptr->prev->next = new;
+	ptr->prev = new;
+}
+
 static int build_self_segment_list(
 	struct segment *head,
 	struct payload *payload, uintptr_t *entry)
 {
 	struct segment *new;
-	struct segment *ptr;
 	struct cbfs_payload_segment *segment, *first_segment;
 	struct cbfs_payload *cbfs_payload;
 	cbfs_payload = payload->backing_store.data;
@@ -293,51 +312,157 @@ static int build_self_segment_list(
 		/* We have found another CODE, DATA or BSS segment */
 		segment++;
 
-		/* Find place where to insert our segment */
-		for(ptr = head->next; ptr != head; ptr = ptr->next) {
-			if (new->s_srcaddr < ntohll(segment->load_addr))
+		insert_segment(head, new);
+	}
+
+	return 1;
+}
+
+static int segment_targets_ram(const struct segment *seg)
+{
+	const unsigned long one_meg = (1UL << 20);
+
+	if (bootmem_region_targets_usable_ram(seg->s_dstaddr, seg->s_memsz))
+		return 1;
+
+	if (seg->s_dstaddr < one_meg &&
+	    (seg->s_dstaddr + seg->s_memsz) <= one_meg) {
+		printk(BIOS_DEBUG,
+			"Payload being loaded below 1MiB "
+			"without region being marked as RAM usable.\n");
+		return 1;
+	}
+
+	/* Payload segment not targeting RAM. */
+	printk(BIOS_ERR, "SELF Payload doesn't target RAM:\n");
+	printk(BIOS_ERR, "Failed Segment: 0x%lx, %lu bytes\n",
+		seg->s_dstaddr, seg->s_memsz);
+	bootmem_dump_ranges();
+	return 0;
+}
+
+/*
+ * Check every segment against the bootmem map, the other segments and the
+ * payload itself before anything is written. Returns < 0 if the payload
+ * can't be loaded, 0 if all segments can be loaded in place and 1 if some
+ * of them want the memory the ramstage runs from.
+ */
+static int plan_self_segments(struct segment *head, struct payload *payload)
+{
+	struct segment *ptr;
+	unsigned long src_start, src_end;
+	int bounce = 0;
+
+	src_start = (uintptr_t)payload->backing_store.data;
+	src_end = src_start + payload->backing_store.size;
+
+	for(ptr = head->next; ptr != head; ptr = ptr->next) {
+		unsigned long start = ptr->s_dstaddr;
+		unsigned long end = start + ptr->s_memsz;
+
+		if (!segment_targets_ram(ptr))
+			return -1;
+
+		if (ptr->next != head && end > ptr->next->s_dstaddr) {
+			printk(BIOS_ERR, "SELF segments overlap at 0x%lx\n",
+				ptr->next->s_dstaddr);
+			return -1;
+		}
+
+		if (end > src_start && start < src_end) {
+			printk(BIOS_ERR, "SELF segment 0x%lx overlaps the "
+				"payload itself.\n", start);
+			return -1;
+		}
+
+		if (overlaps_coreboot(ptr))
+			bounce = 1;
+	}
+
+	return bounce;
+}
+
+/*
+ * Decompress or copy a segment straight to its destination and clear the
+ * rest of it. Returns the number of bytes written from the file, < 0 on
+ * error.
+ */
+static long load_segment(const struct segment *seg)
+{
+	unsigned char *dest, *src, *middle, *end;
+	size_t len = 0;
+
+	dest = (unsigned char *)(seg->s_dstaddr);
+	src = (unsigned char *)(seg->s_srcaddr);
+	end = dest + seg->s_memsz;
+
+	if (seg->s_filesz) {
+		switch(seg->compression) {
+			case CBFS_COMPRESS_LZMA: {
+				printk(BIOS_DEBUG, "using LZMA\n");
+				len = ulzma(src, dest);
+				if (!len) /* Decompression Error. */
+					return -1;
 				break;
+			}
+			case CBFS_COMPRESS_NONE: {
+				printk(BIOS_DEBUG, "it's not compressed!\n");
+				len = seg->s_filesz;
+				memcpy(dest, src, len);
+				break;
+			}
+			default:
+				printk(BIOS_INFO,  "CBFS:  Unknown compression type %d\n", seg->compression);
+				return -1;
 		}
+	}
 
-		/* Order by stream offset */
-		new->next = ptr;
-		new->prev = ptr->prev;
-		ptr->prev->next = new;
-		ptr->prev = new;
+	middle = dest + len;
+	printk(BIOS_SPEW, "[ 0x%08lx, %08lx, 0x%08lx) <- %08lx\n",
+		(unsigned long)dest,
+		(unsigned long)middle,
+		(unsigned long)end,
+		(unsigned long)src);
+
+	/* Zero the extra bytes between middle & end */
+	if (middle < end) {
+		printk(BIOS_DEBUG, "Clearing Segment: addr: 0x%016lx memsz: 0x%016lx\n",
+			(unsigned long)middle, (unsigned long)(end - middle));
+
+		/* Zero the extra bytes */
+		memset(middle, 0, end - middle);
 	}
 
-	return 1;
+	return len;
 }
 
-static int load_self_segments(
-	struct segment *head,
+/* Single pass over the segments, each one ends up where it runs. */
+static int load_self_segments_in_place(struct segment *head,
 	struct payload *payload)
 {
 	struct segment *ptr;
-	const unsigned long one_meg = (1UL << 20);
-	unsigned long bounce_high = lb_end;
 
-	for(ptr = head->next; ptr != head; ptr = ptr->next) {
-		if (bootmem_region_targets_usable_ram(ptr->s_dstaddr,
-							ptr->s_memsz))
-			continue;
+	payload->bounce.data = NULL;
+	payload->bounce.size = 0;
 
-		if (ptr->s_dstaddr < one_meg &&
-		    (ptr->s_dstaddr + ptr->s_memsz) <= one_meg) {
-			printk(BIOS_DEBUG,
-				"Payload being loaded below 1MiB "
-				"without region being marked as RAM usable.\n");
-			continue;
-		}
+	for(ptr = head->next; ptr != head; ptr = ptr->next) {
+		printk(BIOS_DEBUG, "Loading Segment: addr: 0x%016lx memsz: 0x%016lx filesz: 0x%016lx\n",
+			ptr->s_dstaddr, ptr->s_memsz, ptr->s_filesz);
 
-		/* Payload segment not targeting RAM. */
-		printk(BIOS_ERR, "SELF Payload doesn't target RAM:\n");
-		printk(BIOS_ERR, "Failed Segment: 0x%lx, %lu bytes\n",
-			ptr->s_dstaddr, ptr->s_memsz);
-		bootmem_dump_ranges();
-		return 0;
+		if (load_segment(ptr) < 0)
+			return 0;
 	}
 
+	return 1;
+}
+
+static int load_self_segments_bounce(
+	struct segment *head,
+	struct payload *payload)
+{
+	struct segment *ptr;
+	unsigned long bounce_high = lb_end;
+
 	for(ptr = head->next; ptr != head; ptr = ptr->next) {
 		/*
 		 * Add segments to bootmem memory map before a bounce buffer is
@@ -363,7 +488,6 @@ static int load_self_segments(
 	payload->bounce.size = bounce_size;
 
 	for(ptr = head->next; ptr != head; ptr = ptr->next) {
-		unsigned char *dest, *src;
 		printk(BIOS_DEBUG, "Loading Segment: addr: 0x%016lx memsz: 0x%016lx filesz: 0x%016lx\n",
 			ptr->s_dstaddr, ptr->s_memsz, ptr->s_filesz);
 
@@ -377,48 +501,14 @@ static int load_self_segments(
 		printk(BIOS_DEBUG, "Post relocation: addr: 0x%016lx memsz: 0x%016lx filesz: 0x%016lx\n",
 			ptr->s_dstaddr, ptr->s_memsz, ptr->s_filesz);
 
-		/* Compute the boundaries of the segment */
-		dest = (unsigned char *)(ptr->s_dstaddr);
-		src = (unsigned char *)(ptr->s_srcaddr);
+		if (load_segment(ptr) < 0)
+			return 0;
 
-		/* Copy data from the initial buffer */
 		if (ptr->s_filesz) {
-			unsigned char *middle, *end;
-			size_t len;
-			len = ptr->s_filesz;
-			switch(ptr->compression) {
-				case CBFS_COMPRESS_LZMA: {
-					printk(BIOS_DEBUG, "using LZMA\n");
-					len = ulzma(src, dest);
-					if (!len) /* Decompression Error. */
-						return 0;
-					break;
-				}
-				case CBFS_COMPRESS_NONE: {
-					printk(BIOS_DEBUG, "it's not compressed!\n");
-					memcpy(dest, src, len);
-					break;
-				}
-				default:
-					printk(BIOS_INFO,  "CBFS:  Unknown compression type %d\n", ptr->compression);
-					return -1;
-			}
+			unsigned char *dest, *end;
+
+			dest = (unsigned char *)(ptr->s_dstaddr);
 			end = dest + ptr->s_memsz;
-			middle = dest + len;
-			printk(BIOS_SPEW, "[ 0x%08lx, %08lx, 0x%08lx) <- %08lx\n",
-				(unsigned long)dest,
-				(unsigned long)middle,
-				(unsigned long)end,
-				(unsigned long)src);
-
-			/* Zero the extra bytes between middle & end */
-			if (middle < end) {
-				printk(BIOS_DEBUG, "Clearing Segment: addr: 0x%016lx memsz: 0x%016lx\n",
-					(unsigned long)middle, (unsigned long)(end - middle));
-
-				/* Zero the extra bytes */
-				memset(middle, 0, end - middle);
-			}
 			/* Copy the data that's outside the area that shadows ramstage */
 			printk(BIOS_DEBUG, "dest %p, end %p, bouncebuffer %lx\n", dest, end, bounce_buffer);
 			if ((unsigned long)end > bounce_buffer) {
@@ -442,21 +532,114 @@ static int load_self_segments(
 	return 1;
 }
 
+/* Segments of a cached payload have to fit without a bounce buffer. */
+#define MAX_CACHED_SEGMENTS 16
+
+static int payload_cacheable(struct segment *head)
+{
+	struct segment *ptr;
+	int num_segs = 0;
+
+	for(ptr = head->next; ptr != head; ptr = ptr->next) {
+		if (overlaps_coreboot(ptr))
+			return 0;
+		num_segs++;
+	}
+
+	return num_segs <= MAX_CACHED_SEGMENTS;
+}
+
+static void cache_payload(struct segment *head, uintptr_t entry, uint32_t tag)
+{
+	struct stage_cache_segment segs[MAX_CACHED_SEGMENTS];
+	struct segment *ptr;
+	int num_segs = 0;
+
+	for(ptr = head->next; ptr != head; ptr = ptr->next) {
+		segs[num_segs].load_address = ptr->s_dstaddr;
+		segs[num_segs].size = ptr->s_memsz;
+		num_segs++;
+	}
+
+	stage_cache_add(STAGE_PAYLOAD, tag, (void *)entry, segs, num_segs);
+}
+
+static void *load_cached_payload(uint32_t tag)
+{
+	const struct stage_cache *c;
+	int i;
+
+	c = stage_cache_find(STAGE_PAYLOAD, tag);
+	if (c == NULL)
+		return NULL;
+
+	for (i = 0; i < c->num_segments; i++) {
+		const struct stage_cache_segment *seg = &c->segments[i];
+		struct segment tmp = {
+			.s_dstaddr = seg->load_address,
+			.s_memsz = seg->size,
+		};
+
+		if (overlaps_coreboot(&tmp) ||
+		    !bootmem_region_targets_usable_ram(seg->load_address,
+						       seg->size))
+			return NULL;
+	}
+
+	printk(BIOS_DEBUG, "Loading payload from cache at %p.\n", c);
+
+	return stage_cache_restore(c);
+}
+
 void *selfload(struct payload *payload)
 {
 	uintptr_t entry = 0;
 	struct segment head;
+	uint32_t tag = 0;
+	int cacheable;
+	void *cached;
+	int bounce;
+	int loaded;
+
+	if (IS_ENABLED(CONFIG_STAGE_CACHE_PAYLOAD)) {
+		/* Tag the copy with the payload it was made from. Hashing
+		 * the compressed payload is much cheaper than decompressing
+		 * it again. */
+		tag = stage_cache_hash(payload->backing_store.data,
+				       payload->backing_store.size);
+		cached = load_cached_payload(tag);
+		if (cached != NULL) {
+			/* Cached segments never overlap coreboot. */
+			payload->bounce.data = NULL;
+			payload->bounce.size = 0;
+			return cached;
+		}
+	}
 
 	/* Preprocess the self segments */
-	if (!build_self_segment_list(&head, payload, &entry))
+	if (build_self_segment_list(&head, payload, &entry) <= 0)
+		goto out;
+
+	bounce = plan_self_segments(&head, payload);
+	if (bounce < 0)
 		goto out;
 
+	/* Loading may split segments around coreboot, so check up front. */
+	cacheable = payload_cacheable(&head);
+
 	/* Load the segments */
-	if (!load_self_segments(&head, payload))
+	if (bounce)
+		loaded = load_self_segments_bounce(&head, payload);
+	else
+		loaded = load_self_segments_in_place(&head, payload);
+	if (!loaded)
 		goto out;
 
 	printk(BIOS_SPEW, "Loaded segments\n");
 
+	if (IS_ENABLED(CONFIG_STAGE_CACHE_PAYLOAD) && cacheable)
+		cache_payload(&head, entry, tag);
+
 	return (void *)entry;
 
 out:
@@ -0,0 +1,151 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* SHA-1 as in FIPS 180-4, for the PCRs of a TPM 1.2. */
+
+#include <sha1.h>
+#include <string.h>
+
+#define ROL(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+
+/* The message schedule is kept as a ring of 16 words, as in sha256.c. */
+#define W(i)		w[(i) & 15]
+#define EXPAND(i)	(W(i) = ROL(W((i) - 3) ^ W((i) - 8) ^ W((i) - 14) ^ \
+				    W((i) - 16), 1))
+
+static void sha1_blocks(uint32_t *state, const uint8_t *data, size_t blocks)
+{
+	uint32_t a, b, c, d, e, f, k, t;
+	uint32_t w[16];
+	int i;
+
+	for (; blocks; blocks--, data += SHA1_BLOCK_SIZE) {
+		for (i = 0; i < 16; i++)
+			w[i] = (data[4 * i] << 24) | (data[4 * i + 1] << 16) |
+			       (data[4 * i + 2] << 8) | data[4 * i + 3];
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+
+		for (i = 0; i < 80; i++) {
+			if (i >= 16)
+				EXPAND(i);
+
+			if (i < 20) {
+				f = d ^ (b & (c ^ d));
+				k = 0x5a827999;
+			} else if (i < 40) {
+				f = b ^ c ^ d;
+				k = 0x6ed9eba1;
+			} else if (i < 60) {
+				f = (b & c) | (d & (b | c));
+				k = 0x8f1bbcdc;
+			} else {
+				f = b ^ c ^ d;
+				k = 0xca62c1d6;
+			}
+
+			t = ROL(a, 5) + f + e + k + W(i);
+			e = d;
+			d = c;
+			c = ROL(b, 30);
+			b = a;
+			a = t;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+void sha1_init(struct sha1_ctx *ctx)
+{
+	ctx->state[0] = 0x67452301;
+	ctx->state[1] = 0xefcdab89;
+	ctx->state[2] = 0x98badcfe;
+	ctx->state[3] = 0x10325476;
+	ctx->state[4] = 0xc3d2e1f0;
+	ctx->count = 0;
+}
+
+void sha1_update(struct sha1_ctx *ctx, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t used = ctx->count % SHA1_BLOCK_SIZE;
+	size_t n;
+
+	ctx->count += len;
+
+	if (used) {
+		n = SHA1_BLOCK_SIZE - used;
+		if (len < n) {
+			memcpy(ctx->buf + used, p, len);
+			return;
+		}
+		memcpy(ctx->buf + used, p, n);
+		sha1_blocks(ctx->state, ctx->buf, 1);
+		p += n;
+		len -= n;
+	}
+
+	n = len / SHA1_BLOCK_SIZE;
+	sha1_blocks(ctx->state, p, n);
+	p += n * SHA1_BLOCK_SIZE;
+	len -= n * SHA1_BLOCK_SIZE;
+
+	memcpy(ctx->buf, p, len);
+}
+
+void sha1_final(struct sha1_ctx *ctx, uint8_t *digest)
+{
+	size_t used = ctx->count % SHA1_BLOCK_SIZE;
+	uint64_t bits = ctx->count * 8;
+	int i;
+
+	ctx->buf[used++] = 0x80;
+	if (used > SHA1_BLOCK_SIZE - 8) {
+		memset(ctx->buf + used, 0, SHA1_BLOCK_SIZE - used);
+		sha1_blocks(ctx->state, ctx->buf, 1);
+		used = 0;
+	}
+	memset(ctx->buf + used, 0, SHA1_BLOCK_SIZE - 8 - used);
+	for (i = 0; i < 8; i++)
+		ctx->buf[SHA1_BLOCK_SIZE - 1 - i] = bits >> (8 * i);
+	sha1_blocks(ctx->state, ctx->buf, 1);
+
+	for (i = 0; i < 5; i++) {
+		digest[4 * i] = ctx->state[i] >> 24;
+		digest[4 * i + 1] = ctx->state[i] >> 16;
+		digest[4 * i + 2] = ctx->state[i] >> 8;
+		digest[4 * i + 3] = ctx->state[i];
+	}
+}
+
+void sha1(const void *data, size_t len, uint8_t *digest)
+{
+	struct sha1_ctx ctx;
+
+	sha1_init(&ctx);
+	sha1_update(&ctx, data, len);
+	sha1_final(&ctx, digest);
+}
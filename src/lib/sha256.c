@@ -0,0 +1,185 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* SHA-256 as in FIPS 180-4. */
+
+#include <sha256.h>
+#include <string.h>
+
+static const uint32_t k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z)	(((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z)	(((x) & (y)) | ((z) & ((x) | (y))))
+#define S0(x)		(ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define S1(x)		(ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define s0(x)		(ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define s1(x)		(ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+
+/*
+ * The message schedule is kept as a ring of 16 words and extended as the
+ * rounds go, so it stays in registers and the stack as far as possible.
+ */
+#define W(i)		w[(i) & 15]
+#define EXPAND(i)	(W(i) += s1(W((i) - 2)) + W((i) - 7) + s0(W((i) - 15)))
+
+#define ROUND(a, b, c, d, e, f, g, h, i, wi) do {			\
+		uint32_t t = h + S1(e) + CH(e, f, g) + k[i] + (wi);	\
+		d += t;							\
+		h = t + S0(a) + MAJ(a, b, c);				\
+	} while (0)
+
+/* Eight rounds rotate the working variables back into place. */
+#define ROUNDS8(i, wi) do {						\
+		ROUND(a, b, c, d, e, f, g, h, (i) + 0, wi((i) + 0));	\
+		ROUND(h, a, b, c, d, e, f, g, (i) + 1, wi((i) + 1));	\
+		ROUND(g, h, a, b, c, d, e, f, (i) + 2, wi((i) + 2));	\
+		ROUND(f, g, h, a, b, c, d, e, (i) + 3, wi((i) + 3));	\
+		ROUND(e, f, g, h, a, b, c, d, (i) + 4, wi((i) + 4));	\
+		ROUND(d, e, f, g, h, a, b, c, (i) + 5, wi((i) + 5));	\
+		ROUND(c, d, e, f, g, h, a, b, (i) + 6, wi((i) + 6));	\
+		ROUND(b, c, d, e, f, g, h, a, (i) + 7, wi((i) + 7));	\
+	} while (0)
+
+static void sha256_blocks(uint32_t *state, const uint8_t *data, size_t blocks)
+{
+	uint32_t a, b, c, d, e, f, g, h;
+	uint32_t w[16];
+	int i;
+
+	for (; blocks; blocks--, data += SHA256_BLOCK_SIZE) {
+		for (i = 0; i < 16; i++)
+			w[i] = (data[4 * i] << 24) | (data[4 * i + 1] << 16) |
+			       (data[4 * i + 2] << 8) | data[4 * i + 3];
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+		f = state[5];
+		g = state[6];
+		h = state[7];
+
+		ROUNDS8(0, W);
+		ROUNDS8(8, W);
+		for (i = 16; i < 64; i += 8)
+			ROUNDS8(i, EXPAND);
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+	}
+}
+
+void sha256_init(struct sha256_ctx *ctx)
+{
+	ctx->state[0] = 0x6a09e667;
+	ctx->state[1] = 0xbb67ae85;
+	ctx->state[2] = 0x3c6ef372;
+	ctx->state[3] = 0xa54ff53a;
+	ctx->state[4] = 0x510e527f;
+	ctx->state[5] = 0x9b05688c;
+	ctx->state[6] = 0x1f83d9ab;
+	ctx->state[7] = 0x5be0cd19;
+	ctx->count = 0;
+}
+
+void sha256_update(struct sha256_ctx *ctx, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t used = ctx->count % SHA256_BLOCK_SIZE;
+	size_t n;
+
+	ctx->count += len;
+
+	if (used) {
+		n = SHA256_BLOCK_SIZE - used;
+		if (len < n) {
+			memcpy(ctx->buf + used, p, len);
+			return;
+		}
+		memcpy(ctx->buf + used, p, n);
+		sha256_blocks(ctx->state, ctx->buf, 1);
+		p += n;
+		len -= n;
+	}
+
+	/* Whole blocks are hashed straight from the caller's buffer. */
+	n = len / SHA256_BLOCK_SIZE;
+	sha256_blocks(ctx->state, p, n);
+	p += n * SHA256_BLOCK_SIZE;
+	len -= n * SHA256_BLOCK_SIZE;
+
+	memcpy(ctx->buf, p, len);
+}
+
+void sha256_final(struct sha256_ctx *ctx, uint8_t *digest)
+{
+	size_t used = ctx->count % SHA256_BLOCK_SIZE;
+	uint64_t bits = ctx->count * 8;
+	int i;
+
+	ctx->buf[used++] = 0x80;
+	if (used > SHA256_BLOCK_SIZE - 8) {
+		memset(ctx->buf + used, 0, SHA256_BLOCK_SIZE - used);
+		sha256_blocks(ctx->state, ctx->buf, 1);
+		used = 0;
+	}
+	memset(ctx->buf + used, 0, SHA256_BLOCK_SIZE - 8 - used);
+	for (i = 0; i < 8; i++)
+		ctx->buf[SHA256_BLOCK_SIZE - 1 - i] = bits >> (8 * i);
+	sha256_blocks(ctx->state, ctx->buf, 1);
+
+	for (i = 0; i < 8; i++) {
+		digest[4 * i] = ctx->state[i] >> 24;
+		digest[4 * i + 1] = ctx->state[i] >> 16;
+		digest[4 * i + 2] = ctx->state[i] >> 8;
+		digest[4 * i + 3] = ctx->state[i];
+	}
+}
+
+void sha256(const void *data, size_t len, uint8_t *digest)
+{
+	struct sha256_ctx ctx;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, len);
+	sha256_final(&ctx, digest);
+}
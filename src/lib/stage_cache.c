@@ -0,0 +1,308 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * Copyright (C) 2013 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <cbfs.h>
+#include <cbmem.h>
+#include <console/console.h>
+#include <stage_cache.h>
+#include <romstage_handoff.h>
+
+#define HASH_PRIME1 0x9e3779b1
+#define HASH_PRIME2 0x85ebca77
+#define HASH_PRIME3 0xc2b2ae3d
+
+/* Entries in the external region are kept back to back at this alignment. */
+#define EXTERNAL_ALIGN 16
+
+static inline uint32_t rotl32(uint32_t x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+/* A multiply-rotate hash in the spirit of xxHash32. It only has to catch
+ * memory that was clobbered or lost across a reboot, so it trades strength
+ * for speed: four independent lanes consume 16 bytes per iteration. The data
+ * needs to be 32-bit aligned. */
+uint32_t stage_cache_hash(const void *data, size_t size)
+{
+	const uint32_t *p = data;
+	const uint8_t *tail;
+	uint32_t v0 = HASH_PRIME1 + HASH_PRIME2;
+	uint32_t v1 = HASH_PRIME2;
+	uint32_t v2 = 0;
+	uint32_t v3 = -HASH_PRIME1;
+	size_t blocks = size / 16;
+	uint32_t h;
+
+	while (blocks--) {
+		v0 = rotl32(v0 + p[0] * HASH_PRIME2, 13) * HASH_PRIME1;
+		v1 = rotl32(v1 + p[1] * HASH_PRIME2, 13) * HASH_PRIME1;
+		v2 = rotl32(v2 + p[2] * HASH_PRIME2, 13) * HASH_PRIME1;
+		v3 = rotl32(v3 + p[3] * HASH_PRIME2, 13) * HASH_PRIME1;
+		p += 4;
+	}
+
+	h = rotl32(v0, 1) + rotl32(v1, 7) + rotl32(v2, 12) + rotl32(v3, 18);
+	h += size;
+
+	for (tail = (const uint8_t *)p; tail < (const uint8_t *)data + size;
+	     tail++)
+		h = rotl32(h + *tail * HASH_PRIME3, 11) * HASH_PRIME1;
+
+	h ^= h >> 15;
+	h *= HASH_PRIME2;
+	h ^= h >> 13;
+	h *= HASH_PRIME3;
+	h ^= h >> 16;
+
+	return h;
+}
+
+void * __attribute__((weak)) stage_cache_external_region(size_t *size)
+{
+	*size = 0;
+	return NULL;
+}
+
+void __attribute__((weak)) stage_cache_invalid(int stage_id)
+{
+}
+
+static int uses_external_region(int stage_id)
+{
+	if (stage_id == STAGE_PAYLOAD)
+		return 1;
+	return IS_ENABLED(CONFIG_CACHE_RELOCATED_RAMSTAGE_OUTSIDE_CBMEM);
+}
+
+static inline int entry_is_sane(const struct stage_cache *c, uintptr_t end)
+{
+	return ((uintptr_t)c + sizeof(*c) <= end &&
+		c->magic == STAGE_CACHE_MAGIC &&
+		c->size >= sizeof(*c) && c->size <= end - (uintptr_t)c);
+}
+
+/* Walk the external region up to the entry of stage_id or the first
+ * unused spot. */
+static struct stage_cache *external_walk(int stage_id, uintptr_t *end)
+{
+	struct stage_cache *c;
+	size_t region_size;
+
+	c = stage_cache_external_region(&region_size);
+	if (c == NULL)
+		return NULL;
+
+	*end = (uintptr_t)c + region_size;
+
+	while (entry_is_sane(c, *end) && c->stage_id != stage_id)
+		c = (void *)ALIGN((uintptr_t)c + c->size, EXTERNAL_ALIGN);
+
+	return c;
+}
+
+static struct stage_cache *cache_alloc(int stage_id, size_t size)
+{
+	struct stage_cache *c;
+	uintptr_t end;
+	const struct cbmem_entry *e;
+
+	if (!uses_external_region(stage_id)) {
+		/* cbmem_entry_add() does a find() before add(). */
+		e = cbmem_entry_add(CBMEM_ID_STAGEx_CACHE + stage_id, size);
+		if (e == NULL || cbmem_entry_size(e) < size)
+			return NULL;
+		return cbmem_entry_start(e);
+	}
+
+	c = external_walk(stage_id, &end);
+	if (c == NULL)
+		return NULL;
+
+	/* Replacing an entry drops all entries following it. */
+	if ((uintptr_t)c + size > end || (uintptr_t)c + size < (uintptr_t)c) {
+		if ((uintptr_t)c + sizeof(*c) <= end)
+			c->magic = ~STAGE_CACHE_MAGIC;
+		return NULL;
+	}
+
+	return c;
+}
+
+/* Mark the spot after a freshly written entry as unused. */
+static void terminate_external(struct stage_cache *c)
+{
+	struct stage_cache *next;
+	size_t region_size;
+	uintptr_t end;
+
+	end = (uintptr_t)stage_cache_external_region(&region_size);
+	end += region_size;
+	next = (void *)ALIGN((uintptr_t)c + c->size, EXTERNAL_ALIGN);
+	if ((uintptr_t)next + sizeof(*next) <= end)
+		next->magic = ~STAGE_CACHE_MAGIC;
+}
+
+int stage_cache_add(int stage_id, uint32_t tag, void *entry_point,
+		    const struct stage_cache_segment *segs, int num_segs)
+{
+	struct stage_cache *c;
+	size_t size;
+	uint8_t *data;
+	int i;
+
+	size = sizeof(*c) + num_segs * sizeof(*segs);
+	for (i = 0; i < num_segs; i++)
+		size += segs[i].size;
+
+	c = cache_alloc(stage_id, size);
+	if (c == NULL) {
+		printk(BIOS_DEBUG, "No room to cache stage %d (%zu bytes).\n",
+		       stage_id, size);
+		return -1;
+	}
+
+	/* Only mark the entry valid once it is complete. */
+	c->magic = ~STAGE_CACHE_MAGIC;
+	c->stage_id = stage_id;
+	c->tag = tag;
+	c->entry_point = (uintptr_t)entry_point;
+	c->num_segments = num_segs;
+	c->size = size;
+
+	data = (uint8_t *)&c->segments[num_segs];
+	for (i = 0; i < num_segs; i++) {
+		c->segments[i] = segs[i];
+		memcpy(data, (void *)(uintptr_t)segs[i].load_address,
+		       segs[i].size);
+		data += segs[i].size;
+	}
+
+	c->hash = stage_cache_hash(&c->segments[0], size - sizeof(*c));
+	c->magic = STAGE_CACHE_MAGIC;
+
+	if (uses_external_region(stage_id))
+		terminate_external(c);
+
+	printk(BIOS_DEBUG, "Cached stage %d at %p, %zu bytes.\n", stage_id,
+	       c, size);
+
+	return 0;
+}
+
+const struct stage_cache *stage_cache_find(int stage_id, uint32_t tag)
+{
+	const struct stage_cache *c;
+	uintptr_t end;
+	size_t size;
+	int i;
+
+	if (uses_external_region(stage_id)) {
+		c = external_walk(stage_id, &end);
+		if (c == NULL || !entry_is_sane(c, end))
+			return NULL;
+	} else {
+		c = cbmem_find(CBMEM_ID_STAGEx_CACHE + stage_id);
+		if (c == NULL || c->magic != STAGE_CACHE_MAGIC)
+			return NULL;
+	}
+
+	if (c->tag != tag)
+		return NULL;
+
+	/* Make sure the segment table adds up before trusting it. */
+	size = sizeof(*c);
+	if (c->num_segments > (c->size - size) / sizeof(c->segments[0]))
+		return NULL;
+	size += c->num_segments * sizeof(c->segments[0]);
+	for (i = 0; i < c->num_segments; i++) {
+		if (c->segments[i].size > c->size - size)
+			return NULL;
+		size += c->segments[i].size;
+	}
+	if (size != c->size)
+		return NULL;
+
+	if (stage_cache_hash(&c->segments[0], size - sizeof(*c)) != c->hash) {
+		printk(BIOS_ERR, "Stage %d cache is corrupted.\n", stage_id);
+		return NULL;
+	}
+
+	return c;
+}
+
+void *stage_cache_restore(const struct stage_cache *c)
+{
+	const uint8_t *data;
+	int i;
+
+	data = (const uint8_t *)&c->segments[c->num_segments];
+	for (i = 0; i < c->num_segments; i++) {
+		memcpy((void *)(uintptr_t)c->segments[i].load_address, data,
+		       c->segments[i].size);
+		data += c->segments[i].size;
+	}
+
+	return (void *)(uintptr_t)c->entry_point;
+}
+
+#if IS_ENABLED(CONFIG_RELOCATABLE_RAMSTAGE) && defined(__PRE_RAM__)
+
+void cache_loaded_ramstage(struct romstage_handoff *handoff,
+			   const struct cbmem_entry *ramstage,
+			   void *entry_point)
+{
+	struct stage_cache_segment seg;
+
+	seg.load_address = (uintptr_t)cbmem_entry_start(ramstage);
+	seg.size = cbmem_entry_size(ramstage);
+
+	if (stage_cache_add(STAGE_RAMSTAGE, 0, entry_point, &seg, 1))
+		return;
+
+	/* Keep track of the entry point in the handoff structure. */
+	if (handoff != NULL)
+		handoff->ramstage_entry_point = (uint32_t)entry_point;
+}
+
+void *load_cached_ramstage(struct romstage_handoff *handoff,
+			   const struct cbmem_entry *ramstage)
+{
+	const struct stage_cache *c;
+
+	c = stage_cache_find(STAGE_RAMSTAGE, 0);
+
+	/* The cached copy has to land where the ramstage was relocated to. */
+	if (c == NULL || c->num_segments != 1 ||
+	    c->segments[0].load_address !=
+	    (uintptr_t)cbmem_entry_start(ramstage) ||
+	    c->segments[0].size > cbmem_entry_size(ramstage)) {
+		printk(BIOS_DEBUG, "Invalid ramstage cache found.\n");
+		stage_cache_invalid(STAGE_RAMSTAGE);
+		return NULL;
+	}
+
+	printk(BIOS_DEBUG, "Loading ramstage from %p.\n", c);
+
+	return stage_cache_restore(c);
+}
+
+#endif
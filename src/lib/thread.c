@@ -120,13 +120,14 @@ static inline void free_thread(struct thread *t)
 
 /* The idle thread is ran whenever there isn't anything else that is runnable.
  * It's sole responsibility is to ensure progress is made by running the timer
- * callbacks. */
+ * callbacks. In between it waits for the next one to be due. */
 static void idle_thread(void *unused)
 {
 	/* This thread never voluntarily yields. */
 	thread_prevent_coop();
 	while (1) {
 		timers_run();
+		timers_idle();
 	}
 }
 
@@ -16,11 +16,30 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
  */
+#include <bootstate.h>
+#include <cbmem.h>
+#include <console/console.h>
 #include <stddef.h>
+#include <string.h>
 #include <timer.h>
+#if CONFIG_TICKLESS_IDLE
+#include <cpu/x86/lapic.h>
+#endif
 
 #define MAX_TIMER_QUEUE_ENTRIES 64
 
+/* Callbacks due within 64^3 us, about 262ms, go into a timing wheel where
+ * inserting and expiring them is O(1). Only the ones further out go into
+ * the heap. */
+#define WHEEL_LEVELS	3
+#define WHEEL_BITS	6
+#define WHEEL_SLOTS	(1 << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(l)	((l) * WHEEL_BITS)
+
+/* Don't bother halting for less than this. */
+#define IDLE_MIN_USECS	20
+
 /* The timer queue is implemented using a min heap. Therefore the first
  * element is the one with smallest time to expiration. */
 struct timer_queue {
@@ -165,9 +184,193 @@ timer_queue_expired(struct timer_queue *tq, struct mono_time *current_time)
 	return tocb;
 }
 
+/*
+ * Level 0 of the wheel has a slot for each of the next 64us, level 1 one for
+ * each of the next 64 stretches of 64us and so on. A callback goes into the
+ * lowest level that reaches far enough, in the slot its expiration falls
+ * into. Whenever time enters a new stretch of a level, the callbacks in its
+ * slot are handed down to the levels below. Slots with callbacks are kept in
+ * a bitmap for each level, so time can skip ahead to the next one.
+ */
+struct timer_wheel {
+	unsigned long time;	/* The next microsecond to look at. */
+	int num_entries;	/* Including the expired ones. */
+	uint64_t occupied[WHEEL_LEVELS];
+	struct timeout_callback *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+	/* Due callbacks in the order of their expiration. */
+	struct timeout_callback *expired;
+	struct timeout_callback **expired_tail;
+};
+
+static struct timer_wheel global_timer_wheel = {
+	.expired_tail = &global_timer_wheel.expired,
+};
+
+static struct timer_queue_stats early_stats;
+static struct timer_queue_stats *stats = &early_stats;
+
+#define STATS_INC(field) do {						\
+		if (IS_ENABLED(CONFIG_TIMER_QUEUE_STATS))		\
+			stats->field++;					\
+	} while (0)
+
+static void wheel_add_expired(struct timer_wheel *tw,
+                              struct timeout_callback *tocb)
+{
+	tocb->next = NULL;
+	*tw->expired_tail = tocb;
+	tw->expired_tail = &tocb->next;
+}
+
+static void wheel_add(struct timer_wheel *tw, int level,
+                      struct timeout_callback *tocb)
+{
+	unsigned long expiration = tocb->expiration.microseconds;
+	int index = (expiration >> LEVEL_SHIFT(level)) & WHEEL_MASK;
+
+	tocb->next = tw->slots[level][index];
+	tw->slots[level][index] = tocb;
+	tw->occupied[level] |= 1ULL << index;
+}
+
+/* Returns the lowest level that reaches out to the callback, or -1 if none
+ * do. Callbacks that are already due go straight to the expired list. */
+static int wheel_place(struct timer_wheel *tw, struct timeout_callback *tocb)
+{
+	unsigned long delta = tocb->expiration.microseconds - tw->time;
+	int level;
+
+	if ((long)delta < 0) {
+		wheel_add_expired(tw, tocb);
+		return 0;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		if (!(delta >> LEVEL_SHIFT(level + 1))) {
+			wheel_add(tw, level, tocb);
+			return level;
+		}
+	}
+
+	return -1;
+}
+
+static struct timeout_callback *wheel_take(struct timer_wheel *tw, int level,
+                                           int index)
+{
+	struct timeout_callback *list = tw->slots[level][index];
+
+	tw->slots[level][index] = NULL;
+	tw->occupied[level] &= ~(1ULL << index);
+
+	return list;
+}
+
+/* Hand down the slots of the levels that time t enters a new stretch of,
+ * the highest level first as its callbacks may land in the next one down. */
+static void wheel_cascade(struct timer_wheel *tw, unsigned long t)
+{
+	struct timeout_callback *tocb, *next;
+	int level;
+
+	for (level = 1; level < WHEEL_LEVELS; level++) {
+		if (t & ((1UL << LEVEL_SHIFT(level)) - 1))
+			break;
+	}
+
+	while (--level > 0) {
+		tocb = wheel_take(tw, level, (t >> LEVEL_SHIFT(level)) &
+				  WHEEL_MASK);
+		for (; tocb != NULL; tocb = next) {
+			next = tocb->next;
+			wheel_place(tw, tocb);
+			STATS_INC(cascades);
+		}
+	}
+}
+
+/* Done in halves, there is no 64-bit bsf to build on in 32-bit code. */
+static int ctz64(uint64_t x)
+{
+	if ((uint32_t)x)
+		return __builtin_ctz(x);
+	return __builtin_ctz(x >> 32) + 32;
+}
+
+/* How many slots after index the next occupied one comes, the slot at
+ * index itself counts as 64 as its current stretch has been handled. */
+static int slot_distance(uint64_t occupied, int index)
+{
+	uint64_t later = occupied >> index >> 1;
+
+	if (later)
+		return ctz64(later) + 1;
+
+	return ctz64(occupied) + WHEEL_SLOTS - index;
+}
+
+/* The first time after t at which a slot needs looking at, or limit if
+ * that is earlier. */
+static unsigned long wheel_next_event(struct timer_wheel *tw, unsigned long t,
+                                      unsigned long limit)
+{
+	unsigned long event;
+	int level, shift;
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		if (!tw->occupied[level])
+			continue;
+
+		shift = LEVEL_SHIFT(level);
+		event = ((t >> shift) + slot_distance(tw->occupied[level],
+				(t >> shift) & WHEEL_MASK)) << shift;
+		if ((long)(event - limit) < 0)
+			limit = event;
+	}
+
+	return limit;
+}
+
+/* Move everything that is due at now to the expired list. */
+static void wheel_advance(struct timer_wheel *tw, unsigned long now)
+{
+	struct timeout_callback *tocb, *next;
+	unsigned long t;
+
+	while ((long)(now - tw->time) >= 0) {
+		t = tw->time;
+		wheel_cascade(tw, t);
+
+		/* All callbacks in a level 0 slot expire at the same time. */
+		tocb = wheel_take(tw, 0, t & WHEEL_MASK);
+		for (; tocb != NULL; tocb = next) {
+			next = tocb->next;
+			wheel_add_expired(tw, tocb);
+		}
+
+		tw->time = wheel_next_event(tw, t, now + 1);
+	}
+}
+
+static struct timeout_callback *wheel_pop_expired(struct timer_wheel *tw)
+{
+	struct timeout_callback *tocb = tw->expired;
+
+	if (tocb == NULL)
+		return NULL;
+
+	tw->expired = tocb->next;
+	if (tw->expired == NULL)
+		tw->expired_tail = &tw->expired;
+	tw->num_entries--;
+
+	return tocb;
+}
+
 int timer_sched_callback(struct timeout_callback *tocb, unsigned long us)
 {
 	struct mono_time current_time;
+	int pending;
 
 	if ((long)us< 0)
 		return -1;
@@ -180,19 +383,140 @@ int timer_sched_callback(struct timeout_callback *tocb, unsigned long us)
 	if (us != 0 && !mono_time_before(&current_time, &tocb->expiration))
 		return -1;
 
-	return timer_queue_insert(&global_timer_queue, tocb);
+	/* Place it relative to the current time, not the last poll. */
+	wheel_advance(&global_timer_wheel, current_time.microseconds);
+
+	if (wheel_place(&global_timer_wheel, tocb) >= 0) {
+		global_timer_wheel.num_entries++;
+		STATS_INC(wheel_inserts);
+	} else {
+		if (timer_queue_insert(&global_timer_queue, tocb))
+			return -1;
+		STATS_INC(heap_inserts);
+	}
+
+	pending = global_timer_wheel.num_entries +
+		  global_timer_queue.num_entries;
+	if (IS_ENABLED(CONFIG_TIMER_QUEUE_STATS) && pending > stats->max_pending)
+		stats->max_pending = pending;
+
+	return 0;
 }
 
 int timers_run(void)
 {
-	struct timeout_callback *tocb;
+	struct timeout_callback *tocb, *head;
 	struct mono_time current_time;
 
-	timer_monotonic_get(&current_time);
-	tocb = timer_queue_expired(&global_timer_queue, &current_time);
+	STATS_INC(polls);
 
-	if (tocb != NULL)
+	timer_monotonic_get(&current_time);
+	wheel_advance(&global_timer_wheel, current_time.microseconds);
+
+	/* Of the wheel and the heap, the one due first goes first. */
+	tocb = global_timer_wheel.expired;
+	head = timer_queue_head(&global_timer_queue);
+	if (head != NULL && (tocb == NULL ||
+	    mono_time_before(&head->expiration, &tocb->expiration)))
+		tocb = timer_queue_expired(&global_timer_queue, &current_time);
+	else
+		tocb = wheel_pop_expired(&global_timer_wheel);
+
+	if (tocb != NULL) {
+		STATS_INC(callbacks);
 		tocb->callback(tocb);
+	} else {
+		STATS_INC(empty_polls);
+	}
+
+	return global_timer_wheel.num_entries != 0 ||
+	       !timer_queue_empty(&global_timer_queue);
+}
+
+int timer_next_expiration(struct mono_time *mt)
+{
+	struct timer_wheel *tw = &global_timer_wheel;
+	struct timeout_callback *head = timer_queue_head(&global_timer_queue);
+	unsigned long limit;
 
-	return !timer_queue_empty(&global_timer_queue);
+	if (tw->expired != NULL) {
+		*mt = tw->expired->expiration;
+		return 0;
+	}
+
+	if (tw->num_entries != 0) {
+		/* No level reaches further than this. */
+		limit = tw->time + (1UL << LEVEL_SHIFT(WHEEL_LEVELS));
+		mono_time_set_usecs(mt, wheel_next_event(tw, tw->time - 1,
+							 limit));
+		if (head == NULL || mono_time_before(mt, &head->expiration))
+			return 0;
+	}
+
+	if (head == NULL)
+		return -1;
+
+	*mt = head->expiration;
+	return 0;
 }
+
+void timers_idle(void)
+{
+#if CONFIG_TICKLESS_IDLE
+	struct mono_time current_time, expiration, woken;
+	long us;
+
+	if (timer_next_expiration(&expiration))
+		return;
+
+	timer_monotonic_get(&current_time);
+	us = mono_time_diff_microseconds(&current_time, &expiration);
+	if (us < IDLE_MIN_USECS)
+		return;
+
+	lapic_idle_usecs(us);
+
+	if (IS_ENABLED(CONFIG_TIMER_QUEUE_STATS)) {
+		timer_monotonic_get(&woken);
+		stats->halts++;
+		stats->halted_usecs += mono_time_diff_microseconds(
+						&current_time, &woken);
+	}
+#endif
+}
+
+#if CONFIG_TIMER_QUEUE_STATS
+/* Keep counting in CBMEM so the rest of ramstage shows up. */
+static void timer_stats_move_to_cbmem(void *unused)
+{
+	struct timer_queue_stats *s;
+
+	s = cbmem_add(CBMEM_ID_TIMER_STATS, sizeof(*s));
+	if (s == NULL) {
+		printk(BIOS_ERR, "Timer stats: no room in CBMEM.\n");
+		return;
+	}
+
+	memcpy(s, stats, sizeof(*s));
+	stats = s;
+}
+
+static void timer_stats_report(void *unused)
+{
+	printk(BIOS_DEBUG, "Timers: %u wheel and %u heap inserts, %u "
+	       "cascades, %u callbacks, %u of %u polls empty, max %u "
+	       "pending.\n", stats->wheel_inserts, stats->heap_inserts,
+	       stats->cascades, stats->callbacks, stats->empty_polls,
+	       stats->polls, stats->max_pending);
+	if (IS_ENABLED(CONFIG_TICKLESS_IDLE))
+		printk(BIOS_DEBUG, "Timers: halted %u times for %u us.\n",
+		       stats->halts, stats->halted_usecs);
+}
+
+BOOT_STATE_INIT_ENTRIES(timer_stats_bscb) = {
+	BOOT_STATE_INIT_ENTRY(BS_WRITE_TABLES, BS_ON_ENTRY,
+			      timer_stats_move_to_cbmem, NULL),
+	BOOT_STATE_INIT_ENTRY(BS_PAYLOAD_BOOT, BS_ON_ENTRY,
+			      timer_stats_report, NULL),
+};
+#endif
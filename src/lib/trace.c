@@ -18,22 +18,146 @@
  */
 
 #include <types.h>
+#include <arch/cpu.h>
+#include <bootstate.h>
+#include <cbmem.h>
 #include <console/console.h>
+#include <string.h>
 #include <trace.h>
 
+#define RING_SIZE(entries)	(sizeof(struct trace_ring) + \
+				 (entries) * sizeof(struct trace_event))
+#define BUFFER_SIZE(entries)	(sizeof(struct trace_buffer) + \
+				 CONFIG_MAX_CPUS * RING_SIZE(entries))
+
+/*
+ * Until CBMEM is up the events go to small rings in the ramstage image,
+ * which only keep the most recent ones.
+ */
+#define EARLY_ENTRIES	256
+
 int volatile trace_dis = 0;
 
-void __cyg_profile_func_enter( void *func, void *callsite)
+static struct {
+	struct trace_buffer buf;
+	u8 rings[CONFIG_MAX_CPUS * RING_SIZE(EARLY_ENTRIES)];
+} __attribute__((packed, aligned(8))) trace_early = {
+	.buf = {
+		.magic = TRACE_MAGIC,
+		.rings = CONFIG_MAX_CPUS,
+		.entries = EARLY_ENTRIES,
+	},
+};
+static struct trace_buffer *trace_buf = &trace_early.buf;
+
+/*
+ * This runs for every instrumented call, so it sticks to inline assembly:
+ * inline functions get instrumented as well and would recurse back into
+ * the hooks.
+ */
+static inline __attribute__((always_inline, no_instrument_function))
+void trace_event(void *func, void *callsite, uint64_t flags)
 {
+	struct trace_buffer *buf = trace_buf;
+	struct trace_ring *ring;
+	struct trace_event *ev;
+	struct cpu_info *ci;
+	uint32_t lo, hi;
 
 	if (trace_dis)
 		return;
 
-	DISABLE_TRACE
-	printk(BIOS_INFO, "~0x%08x(0x%08x)\n", (uint32_t) func, (uint32_t) callsite);
-	ENABLE_TRACE
+	/* Same as cpu_info(), each cpu only ever writes its own ring. */
+	__asm__("andl %%esp,%0; "
+		"orl  %2, %0 "
+		: "=r" (ci)
+		: "0" (~(CONFIG_STACK_SIZE - 1)),
+		  "r" (CONFIG_STACK_SIZE - sizeof(struct cpu_info)));
+	if (ci->index >= CONFIG_MAX_CPUS)
+		return;
+
+	ring = (struct trace_ring *)((u8 *)(buf + 1) +
+				     ci->index * RING_SIZE(buf->entries));
+	ev = &ring->events[ring->next];
+
+	__asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+	ev->func = (uint32_t)func;
+	ev->callsite = (uint32_t)callsite;
+	ev->tsc = ((uint64_t)hi << 32 | lo) | flags;
+
+	if (++ring->next == buf->entries)
+		ring->next = 0;
+	ring->total++;
+}
+
+void __cyg_profile_func_enter( void *func, void *callsite)
+{
+	trace_event(func, callsite, 0);
 }
 
 void __cyg_profile_func_exit( void *func, void *callsite )
 {
+	trace_event(func, callsite, TRACE_EXIT);
+}
+
+/* Copies an early ring to the start of a full one, oldest event first. */
+static u32 trace_copy_ring(struct trace_ring *to, const struct trace_ring *from)
+{
+	u32 count = MIN(from->total, EARLY_ENTRIES);
+	u32 first = from->total > EARLY_ENTRIES ? from->next : 0;
+	u32 n = MIN(count, EARLY_ENTRIES - first);
+
+	memcpy(to->events, &from->events[first], n * sizeof(from->events[0]));
+	memcpy(&to->events[n], from->events,
+	       (count - n) * sizeof(from->events[0]));
+	to->next = count;
+	to->total = count;
+
+	return from->total - count;
 }
+
+/* Continue in CBMEM with the full rings as soon as it is there. */
+static void trace_move_to_cbmem(void *unused)
+{
+	const struct trace_ring *from;
+	struct trace_buffer *buf;
+	u32 dropped = 0;
+	int i;
+
+	DISABLE_TRACE
+	buf = cbmem_add(CBMEM_ID_TRACE,
+			BUFFER_SIZE(CONFIG_TRACE_BUFFER_ENTRIES));
+	if (buf != NULL) {
+		memset(buf, 0, BUFFER_SIZE(CONFIG_TRACE_BUFFER_ENTRIES));
+		buf->magic = TRACE_MAGIC;
+		buf->rings = CONFIG_MAX_CPUS;
+		buf->entries = CONFIG_TRACE_BUFFER_ENTRIES;
+		for (i = 0; i < CONFIG_MAX_CPUS; i++) {
+			from = (struct trace_ring *)(trace_early.rings +
+					i * RING_SIZE(EARLY_ENTRIES));
+			dropped += trace_copy_ring((struct trace_ring *)
+				((u8 *)(buf + 1) +
+				 i * RING_SIZE(CONFIG_TRACE_BUFFER_ENTRIES)),
+				from);
+		}
+		trace_buf = buf;
+	}
+	ENABLE_TRACE
+
+	if (buf == NULL)
+		printk(BIOS_ERR, "Trace: no room in CBMEM.\n");
+	else if (dropped)
+		printk(BIOS_DEBUG, "Trace: %u events before CBMEM were lost.\n",
+		       dropped);
+}
+
+/* CBMEM comes up on entry to these states, see dynamic_cbmem.c. */
+BOOT_STATE_INIT_ENTRIES(trace_bscb) = {
+#if IS_ENABLED(CONFIG_EARLY_CBMEM_INIT)
+	BOOT_STATE_INIT_ENTRY(BS_PRE_DEVICE, BS_ON_EXIT,
+			      trace_move_to_cbmem, NULL),
+#else
+	BOOT_STATE_INIT_ENTRY(BS_POST_DEVICE, BS_ON_EXIT,
+			      trace_move_to_cbmem, NULL),
+#endif
+};
@@ -41,6 +41,14 @@
 #include <device/device.h>
 #include "hudson.h"
 #include <lib.h> /* memory test prototypes */
+#include <cpu/amd/pi/mem_context.h>
+#include <cpu/x86/tsc.h>
+#include <delay.h>
+#include <halt.h>
+#include <reset.h>
+#include <fchgpio.h>
+#include <timestamp.h>
+#include "apu2.h"
 
 VOID FchInitS3LateRestore (IN FCH_DATA_BLOCK *FchDataPtr);
 VOID FchInitS3EarlyRestore (IN FCH_DATA_BLOCK *FchDataPtr);
@@ -132,6 +140,35 @@ static void *AcpiAlib    = NULL;
 static void *AcpiIvrs    = NULL;
 #endif
 
+#if IS_ENABLED(CONFIG_AGESA_MEM_CONTEXT_CACHE)
+/*
+ * Romstage tells ramstage in BIOSRAM whether the saved memory context was
+ * used and how long AmdInitPost took. BIOSRAM survives a reset, which is
+ * how a failed restore makes the next boot train memory.
+ */
+#define MEM_CONTEXT_BIOSRAM_STATE	0xe0
+#define MEM_CONTEXT_BIOSRAM_USECS	0xe1
+
+enum {
+	MEM_CONTEXT_NONE = 0,
+	MEM_CONTEXT_MISS = 1,
+	MEM_CONTEXT_HIT = 2,
+	MEM_CONTEXT_FAILED = 3,
+};
+
+static int get_mem_context_key(struct mem_context_key *key)
+{
+	memset(key, 0, sizeof(*key));
+	if (ReadFchGpio(APU2_SPD_STRAP0_GPIO))
+		key->strap |= BIT0;
+	if (ReadFchGpio(APU2_SPD_STRAP1_GPIO))
+		key->strap |= BIT1;
+
+	return read_spd_from_cbfs(key->spd, key->strap);
+}
+
+#endif
+
 AGESA_STATUS agesawrapper_amdinitcpuio(void)
 {
 	AGESA_STATUS                  Status;
@@ -290,6 +327,12 @@ AGESA_STATUS agesawrapper_amdinitpost(void)
 	AGESA_STATUS status;
 	AMD_INTERFACE_PARAMS  AmdParamStruct;
 	AMD_POST_PARAMS       *PostParams;
+#if IS_ENABLED(CONFIG_AGESA_MEM_CONTEXT_CACHE) && defined(__PRE_RAM__)
+	struct mem_context_key key;
+	const struct mem_context_header *ctx = NULL;
+	u64 start;
+	u32 state = 0;
+#endif
 
 	LibAmdMemFill (&AmdParamStruct,
 		       0,
@@ -318,7 +361,43 @@ AGESA_STATUS agesawrapper_amdinitpost(void)
 	//
 	PostParams->MemConfig.PlatformMemoryConfiguration = OurPlatformMemoryConfiguration;
 
+#if IS_ENABLED(CONFIG_AGESA_MEM_CONTEXT_CACHE) && defined(__PRE_RAM__)
+	s3_load_nvram_early(1, &state, MEM_CONTEXT_BIOSRAM_STATE);
+	if (state == MEM_CONTEXT_FAILED)
+		printk(BIOS_WARNING, "Memory context: last restore failed.\n");
+	else if (get_mem_context_key(&key) == 0)
+		ctx = mem_context_find(&key);
+
+	if (ctx) {
+		printk(BIOS_INFO, "Memory context: restoring, training skipped.\n");
+		PostParams->MemConfig.MemRestoreCtl = TRUE;
+		PostParams->MemConfig.MemContext.NvStorage =
+			(void *)mem_context_data(ctx);
+		PostParams->MemConfig.MemContext.NvStorageSize = ctx->data_size;
+	}
+
+	start = rdtscll();
+#endif
+
+	timestamp_add_now(TS_BEFORE_INITRAM);
 	status = AmdInitPost (PostParams);
+	timestamp_add_now(TS_AFTER_INITRAM);
+
+#if IS_ENABLED(CONFIG_AGESA_MEM_CONTEXT_CACHE) && defined(__PRE_RAM__)
+	if (ctx && status > AGESA_WARNING) {
+		/* Record the failure so the next boot trains, and start over. */
+		printk(BIOS_ERR, "Memory context: restore failed, resetting.\n");
+		s3_save_nvram_early(MEM_CONTEXT_FAILED, 1,
+				    MEM_CONTEXT_BIOSRAM_STATE);
+		hard_reset();
+		halt();
+	}
+
+	s3_save_nvram_early(ctx ? MEM_CONTEXT_HIT : MEM_CONTEXT_MISS, 1,
+			    MEM_CONTEXT_BIOSRAM_STATE);
+	s3_save_nvram_early((rdtscll() - start) / tsc_freq_mhz(), 4,
+			    MEM_CONTEXT_BIOSRAM_USECS);
+#endif
 
 	printk(
 			BIOS_SPEW,
@@ -733,6 +812,69 @@ AGESA_STATUS agesawrapper_amdS3Save(void)
 #endif  /* #ifndef __PRE_RAM__ */
 #endif  /* CONFIG_HAVE_ACPI_RESUME */
 
+#if IS_ENABLED(CONFIG_AGESA_MEM_CONTEXT_CACHE) && !defined(__PRE_RAM__)
+AGESA_STATUS agesawrapper_amdsavememcontext(void)
+{
+	AGESA_STATUS Status;
+	AMD_S3SAVE_PARAMS *AmdS3SaveParamsPtr;
+	AMD_INTERFACE_PARAMS  AmdInterfaceParams;
+	const struct mem_context_header *old;
+	struct mem_context_key key;
+	u32 state = 0, usecs = 0;
+
+	s3_load_nvram_early(1, &state, MEM_CONTEXT_BIOSRAM_STATE);
+	s3_load_nvram_early(4, &usecs, MEM_CONTEXT_BIOSRAM_USECS);
+	s3_save_nvram_early(MEM_CONTEXT_NONE, 1, MEM_CONTEXT_BIOSRAM_STATE);
+
+	if (get_mem_context_key(&key) < 0)
+		return AGESA_UNSUPPORTED;
+
+	old = mem_context_find(&key);
+	if (state == MEM_CONTEXT_HIT && old) {
+		timestamp_add_now(TS_MEM_CONTEXT_HIT);
+		printk(BIOS_INFO, "Memory context: restored in %u ms, "
+		       "training took %u ms.\n", usecs / 1000,
+		       old->train_usecs / 1000);
+		/* Keep the time of the boot that actually trained. */
+		usecs = old->train_usecs;
+	} else {
+		timestamp_add_now(TS_MEM_CONTEXT_MISS);
+		printk(BIOS_INFO, "Memory context: trained in %u ms.\n",
+		       usecs / 1000);
+	}
+
+	LibAmdMemFill (&AmdInterfaceParams,
+		       0,
+		       sizeof (AMD_INTERFACE_PARAMS),
+		       &(AmdInterfaceParams.StdHeader));
+
+	AmdInterfaceParams.StdHeader.ImageBasePtr = 0;
+	AmdInterfaceParams.StdHeader.HeapStatus = HEAP_SYSTEM_MEM;
+	AmdInterfaceParams.StdHeader.CalloutPtr = (CALLOUT_ENTRY) &GetBiosCallout;
+	AmdInterfaceParams.AllocationMethod = PostMemDram;
+	AmdInterfaceParams.AgesaFunctionName = AMD_S3_SAVE;
+	AmdInterfaceParams.StdHeader.AltImageBasePtr = 0;
+	AmdInterfaceParams.StdHeader.Func = 0;
+
+	AmdCreateStruct(&AmdInterfaceParams);
+	AmdS3SaveParamsPtr = (AMD_S3SAVE_PARAMS *)AmdInterfaceParams.NewStructPtr;
+	AmdS3SaveParamsPtr->StdHeader = AmdInterfaceParams.StdHeader;
+
+	/* The memory context is part of the non volatile S3 data. */
+	Status = AmdS3Save(AmdS3SaveParamsPtr);
+	if (Status != AGESA_SUCCESS)
+		agesawrapper_amdreadeventlog(AmdInterfaceParams.StdHeader.HeapStatus);
+	else
+		mem_context_save(&key, usecs,
+				 AmdS3SaveParamsPtr->S3DataBlock.NvStorage,
+				 AmdS3SaveParamsPtr->S3DataBlock.NvStorageSize);
+
+	AmdReleaseStruct (&AmdInterfaceParams);
+
+	return Status;
+}
+#endif
+
 AGESA_STATUS agesawrapper_amdreadeventlog (UINT8 HeapStatus)
 {
 	AGESA_STATUS Status;
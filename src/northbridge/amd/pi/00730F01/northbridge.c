@@ -29,6 +29,7 @@
 #include <string.h>
 #include <lib.h>
 #include <cpu/cpu.h>
+#include <cpu/x86/mp.h>
 #include <cbmem.h>
 
 #include <Porting.h>
@@ -1202,9 +1203,25 @@ static u32 cpu_bus_scan(device_t dev, u32 max)
 	return max;
 }
 
+static struct mp_flight_record mp_steps[] = {
+	MP_FR_BLOCK_APS(mp_initialize_cpu, NULL, mp_initialize_cpu, NULL),
+};
+
 static void cpu_bus_init(device_t dev)
 {
-	initialize_cpus(dev->link_list);
+	struct mp_params mp_params = {
+		.flight_plan = mp_steps,
+		.num_records = ARRAY_SIZE(mp_steps),
+	};
+	device_t cpu;
+
+	/* cpu_bus_scan() has added a device for every enabled core. */
+	for (cpu = dev->link_list->children; cpu; cpu = cpu->sibling)
+		if (cpu->path.type == DEVICE_PATH_APIC && cpu->enabled)
+			mp_params.num_cpus++;
+
+	if (mp_init(dev->link_list, &mp_params) < 0)
+		printk(BIOS_ERR, "MP initialization failure.\n");
 }
 
 static void cpu_bus_read_resources(device_t dev)
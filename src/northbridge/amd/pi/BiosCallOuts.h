@@ -38,15 +38,34 @@
 
 #endif
 
+/* Free nodes are kept in one list per power of two of their size. */
+#define BIOS_HEAP_FREE_LISTS		32
+/* Open addressed index of the allocated handles, a power of two. */
+#define BIOS_HEAP_HANDLE_SLOTS		1024
+
+typedef struct _BIOS_HEAP_HANDLE {
+	UINT32 BufferHandle;
+	UINT32 NodeOffset;		/* 0 if empty, 1 if deleted */
+} BIOS_HEAP_HANDLE;
+
 typedef struct _BIOS_HEAP_MANAGER {
-	UINT32 StartOfAllocatedNodes;
-	UINT32 StartOfFreedNodes;
+	UINT32 StartOfNodes;		/* 0 until the first allocation */
+	UINT32 UsedHandles;
+	UINT32 DeletedHandles;
+	UINT32 FreeListMap;		/* Bit n set if FreeLists[n] is not empty */
+	UINT32 FreeLists[BIOS_HEAP_FREE_LISTS];
+	BIOS_HEAP_HANDLE Handles[BIOS_HEAP_HANDLE_SLOTS];
 } BIOS_HEAP_MANAGER;
 
+/*
+ * The nodes tile the heap. NodeSize and PrevNodeSize are boundary tags that
+ * let a freed node merge with both neighbours without walking any list.
+ */
 typedef struct _BIOS_BUFFER_NODE {
 	UINT32 BufferHandle;
 	UINT32 BufferSize;
-	UINT32 NextNodeOffset;
+	UINT32 NodeSize;		/* Including this header, bit 0 set if free */
+	UINT32 PrevNodeSize;		/* NodeSize of the node below, 0 if first */
 } BIOS_BUFFER_NODE;
 
 UINT32 GetHeapBase(AMD_CONFIG_PARAMS *StdHeader);
@@ -171,14 +171,15 @@ u16 pm_read16(u16 reg);
 void pm2_write8(u8 reg, u8 value);
 u8 pm2_read8(u8 reg);
 
+/* BIOSRAM survives a reset. Both return the position after the value. */
+int s3_save_nvram_early(u32 dword, int size, int  nvram_pos);
+int s3_load_nvram_early(int size, u32 *old_dword, int nvram_pos);
+
 #ifdef __PRE_RAM__
 void hudson_lpc_port80(void);
 void hudson_pci_port80(void);
 void hudson_clk_output_48Mhz(void);
 
-int s3_save_nvram_early(u32 dword, int size, int  nvram_pos);
-int s3_load_nvram_early(int size, u32 *old_dword, int nvram_pos);
-
 #else
 void hudson_enable(device_t dev);
 void s3_resume_init_data(void *FchParams);
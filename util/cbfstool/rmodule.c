@@ -420,14 +420,60 @@ add_section(struct elf_writer *ew, struct buffer *data, const char *name,
 	return ret;
 }
 
+/*
+ * Walk the sorted relocations in page groups as described in rmodule-defs.h.
+ * Returns the size of the encoded stream and writes it out if relocs is
+ * non-NULL.
+ */
+static size_t
+encode_relocations(const struct rmod_context *ctx, struct buffer *relocs)
+{
+	size_t size = 0;
+	Elf64_Xword i, j, count;
+	Elf64_Addr page, prev_page = 0;
+
+	for (i = 0; i < ctx->nrelocs; i += count) {
+		page = (ctx->emitted_relocs[i] - ctx->link_addr) >>
+		       RMODULE_RELOC_PAGE_SHIFT;
+
+		for (count = 1; i + count < ctx->nrelocs; count++) {
+			Elf64_Addr next = ctx->emitted_relocs[i + count];
+
+			next = (next - ctx->link_addr) >>
+			       RMODULE_RELOC_PAGE_SHIFT;
+			if (next != page)
+				break;
+		}
+
+		size += sizeof(uint32_t) + count * sizeof(uint16_t);
+		size = ALIGN(size, sizeof(uint32_t));
+
+		if (relocs == NULL) {
+			prev_page = page;
+			continue;
+		}
+
+		ctx->xdr->put32(relocs,
+		                (page - prev_page) << RMODULE_RELOC_PAGE_SHIFT |
+		                (count - 1));
+		for (j = i; j < i + count; j++)
+			ctx->xdr->put16(relocs, (ctx->emitted_relocs[j] -
+			                ctx->link_addr) & RMODULE_RELOC_COUNT_MASK);
+		if (count & 1)
+			ctx->xdr->put16(relocs, 0);
+		prev_page = page;
+	}
+
+	return size;
+}
+
 static int
 write_elf(const struct rmod_context *ctx, const struct buffer *in,
           struct buffer *out)
 {
-	int i;
 	int ret;
-	int bit64;
 	size_t loc;
+	size_t relocs_size;
 	size_t rmod_data_size;
 	struct elf_writer *ew;
 	struct buffer rmod_data;
@@ -438,8 +484,6 @@ write_elf(const struct rmod_context *ctx, const struct buffer *in,
 	Elf64_Addr addr;
 	Elf64_Ehdr ehdr;
 
-	bit64 = ctx->pelf.ehdr.e_ident[EI_CLASS] == ELFCLASS64;
-
 	/*
 	 * 3 sections will be added  to the ELF file.
 	 * +------------------+
@@ -452,11 +496,8 @@ write_elf(const struct rmod_context *ctx, const struct buffer *in,
 	 */
 
 	/* Create buffer for header and relocations. */
-	rmod_data_size = sizeof(struct rmodule_header);
-	if (bit64)
-		rmod_data_size += ctx->nrelocs * sizeof(Elf64_Addr);
-	else
-		rmod_data_size += ctx->nrelocs * sizeof(Elf32_Addr);
+	relocs_size = encode_relocations(ctx, NULL);
+	rmod_data_size = sizeof(struct rmodule_header) + relocs_size;
 
 	if (buffer_create(&rmod_data, rmod_data_size, "rmod"))
 		return -1;
@@ -486,7 +527,7 @@ write_elf(const struct rmod_context *ctx, const struct buffer *in,
 
 	/* Write out rmodule_header. */
 	ctx->xdr->put16(&rmod_header, RMODULE_MAGIC);
-	ctx->xdr->put8(&rmod_header, RMODULE_VERSION_1);
+	ctx->xdr->put8(&rmod_header, RMODULE_VERSION_2);
 	ctx->xdr->put8(&rmod_header, 0);
 	/* payload_begin_offset */
 	loc = sizeof(struct rmodule_header);
@@ -497,10 +538,7 @@ write_elf(const struct rmod_context *ctx, const struct buffer *in,
 	/* relocations_begin_offset */
 	ctx->xdr->put32(&rmod_header, loc);
 	/* relocations_end_offset */
-	if (bit64)
-		loc += ctx->nrelocs * sizeof(Elf64_Addr);
-	else
-		loc += ctx->nrelocs * sizeof(Elf32_Addr);
+	loc += relocs_size;
 	ctx->xdr->put32(&rmod_header, loc);
 	/* module_link_start_address */
 	ctx->xdr->put32(&rmod_header, ctx->link_addr);
@@ -523,12 +561,9 @@ write_elf(const struct rmod_context *ctx, const struct buffer *in,
 	ctx->xdr->put32(&rmod_header, 0);
 
 	/* Write the relocations. */
-	for (i = 0; i < ctx->nrelocs; i++) {
-		if (bit64)
-			ctx->xdr->put64(&relocs, ctx->emitted_relocs[i]);
-		else
-			ctx->xdr->put32(&relocs, ctx->emitted_relocs[i]);
-	}
+	encode_relocations(ctx, &relocs);
+	INFO("%zu bytes of relocations for %zu entries.\n", relocs_size,
+	     (size_t)ctx->nrelocs);
 
 	total_size = 0;
 	addr = 0;
@@ -34,6 +34,7 @@
 #include <sys/mman.h>
 #include <libgen.h>
 #include <assert.h>
+#include <elf.h>
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 #define MAP_BYTES (1024*1024)
@@ -48,6 +49,8 @@ typedef uint64_t u64;
 
 #include "cbmem.h"
 #include "timestamp.h"
+#include "trace.h"
+#include "profiler.h"
 
 #define CBMEM_VERSION "1.1"
 
@@ -383,6 +386,8 @@ static const struct timestamp_id_to_name {
 	{ TS_START_COPYRAM,	"start of copying ram stage" },
 	{ TS_END_COPYRAM,	"end of copying ram stage" },
 	{ TS_START_RAMSTAGE,	"start of ramstage" },
+	{ TS_MEM_CONTEXT_HIT,	"memory context restored" },
+	{ TS_MEM_CONTEXT_MISS,	"memory trained" },
 	{ TS_DEVICE_ENUMERATE,	"device enumeration" },
 	{ TS_DEVICE_CONFIGURE,	"device configuration" },
 	{ TS_DEVICE_ENABLE,	"device enable" },
@@ -689,6 +694,254 @@ static void dump_cbmem_toc(void)
 	unmap_memory();
 }
 
+/* Looks up a CBMEM entry in either the static or the dynamic layout. */
+static int find_cbmem_entry(uint32_t id, uint64_t *addr, uint64_t *size)
+{
+	uint64_t start, rootptr;
+	struct cbmem_entry *entries;
+	struct cbmem_root_pointer *r;
+	struct cbmem_root *root;
+	int i, found = 0;
+
+	if (cbmem.type != LB_MEM_TABLE)
+		return 0;
+
+	start = unpack_lb64(cbmem.start);
+	entries = (struct cbmem_entry *)map_memory(start);
+
+	if (entries[0].magic == CBMEM_MAGIC) {
+		for (i = 0; i < MAX_CBMEM_ENTRIES; i++) {
+			if (entries[i].magic != CBMEM_MAGIC)
+				break;
+			if (entries[i].id == id) {
+				*addr = entries[i].base;
+				*size = entries[i].size;
+				found = 1;
+				break;
+			}
+		}
+		unmap_memory();
+		return found;
+	}
+	unmap_memory();
+
+	rootptr = start + unpack_lb64(cbmem.size);
+	rootptr &= ~(DYN_CBMEM_ALIGN_SIZE - 1);
+	rootptr -= sizeof(struct cbmem_root_pointer);
+	r = (struct cbmem_root_pointer *)map_memory(rootptr);
+	if (r->magic != CBMEM_POINTER_MAGIC) {
+		unmap_memory();
+		return 0;
+	}
+	start = r->root;
+	unmap_memory();
+
+	root = (struct cbmem_root *)map_memory(start);
+	for (i = 0; i < root->num_entries; i++) {
+		if (root->entries[i].magic != CBMEM_ENTRY_MAGIC)
+			break;
+		if (root->entries[i].id == id) {
+			*addr = root->entries[i].start;
+			*size = root->entries[i].size;
+			found = 1;
+			break;
+		}
+	}
+	unmap_memory();
+
+	return found;
+}
+
+/* Saves the function trace rings as they are for util/genprof. */
+static void dump_trace(const char *filename)
+{
+	uint64_t start, size;
+	struct trace_buffer *buf;
+	FILE *f;
+
+	if (!find_cbmem_entry(CBMEM_ID_TRACE, &start, &size)) {
+		fprintf(stderr, "No function trace found in CBMEM area.\n");
+		return;
+	}
+
+	buf = map_memory_size(start, size);
+	if (buf->magic != TRACE_MAGIC) {
+		fprintf(stderr, "Function trace is empty.\n");
+		unmap_memory();
+		return;
+	}
+
+	f = fopen(filename, "wb");
+	if (!f || fwrite(buf, size, 1, f) != 1) {
+		fprintf(stderr, "Could not write %s: %s\n", filename,
+			strerror(errno));
+		exit(1);
+	}
+	fclose(f);
+	printf("Saved %" PRIu64 " bytes of trace from %u cpus to %s.\n",
+	       size, buf->rings, filename);
+
+	unmap_memory();
+}
+
+struct profile_symbol {
+	uint32_t addr;
+	uint32_t size;
+	const char *name;
+	uint32_t samples;
+};
+
+static int compare_symbol_addr(const void *a, const void *b)
+{
+	const struct profile_symbol *x = a, *y = b;
+
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static int compare_symbol_samples(const void *a, const void *b)
+{
+	const struct profile_symbol *x = a, *y = b;
+
+	return x->samples < y->samples ? 1 : x->samples > y->samples ? -1 : 0;
+}
+
+/* Reads the function symbols of a 32 bit ELF file, sorted by address. */
+static struct profile_symbol *read_elf_symbols(const char *filename,
+					       size_t *count)
+{
+	struct profile_symbol *syms;
+	const Elf32_Ehdr *ehdr;
+	const Elf32_Shdr *shdr;
+	const Elf32_Sym *sym;
+	const char *strtab;
+	struct stat st;
+	char *elf;
+	size_t i, n;
+	FILE *f;
+
+	f = fopen(filename, "rb");
+	if (!f || fstat(fileno(f), &st)) {
+		fprintf(stderr, "Could not open %s: %s\n", filename,
+			strerror(errno));
+		exit(1);
+	}
+	elf = malloc(st.st_size);
+	if (!elf || fread(elf, st.st_size, 1, f) != 1) {
+		fprintf(stderr, "Could not read %s\n", filename);
+		exit(1);
+	}
+	fclose(f);
+
+	ehdr = (const Elf32_Ehdr *)elf;
+	if (st.st_size < sizeof(*ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) ||
+	    ehdr->e_ident[EI_CLASS] != ELFCLASS32 ||
+	    ehdr->e_shoff + ehdr->e_shnum * sizeof(*shdr) > st.st_size) {
+		fprintf(stderr, "%s is not a 32 bit ELF file\n", filename);
+		exit(1);
+	}
+
+	shdr = (const Elf32_Shdr *)(elf + ehdr->e_shoff);
+	for (i = 0; i < ehdr->e_shnum; i++)
+		if (shdr[i].sh_type == SHT_SYMTAB)
+			break;
+	if (i == ehdr->e_shnum || shdr[i].sh_link >= ehdr->e_shnum) {
+		fprintf(stderr, "%s has no symbol table\n", filename);
+		exit(1);
+	}
+
+	sym = (const Elf32_Sym *)(elf + shdr[i].sh_offset);
+	n = shdr[i].sh_size / sizeof(*sym);
+	strtab = elf + shdr[shdr[i].sh_link].sh_offset;
+
+	syms = malloc(n * sizeof(*syms));
+	for (i = 0, *count = 0; i < n; i++) {
+		if (ELF32_ST_TYPE(sym[i].st_info) != STT_FUNC)
+			continue;
+		syms[*count].addr = sym[i].st_value;
+		syms[*count].size = sym[i].st_size;
+		syms[*count].name = strtab + sym[i].st_name;
+		syms[*count].samples = 0;
+		(*count)++;
+	}
+
+	/* The string table stays around for the names. */
+	qsort(syms, *count, sizeof(*syms), compare_symbol_addr);
+	return syms;
+}
+
+/* Returns the function containing addr or NULL. */
+static struct profile_symbol *find_symbol(struct profile_symbol *syms,
+					  size_t count, uint32_t addr)
+{
+	size_t lo = 0, hi = count;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+
+		if (syms[mid].addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo || addr - syms[lo - 1].addr >= syms[lo - 1].size)
+		return NULL;
+	return &syms[lo - 1];
+}
+
+static void dump_profile(const char *elf_file)
+{
+	uint64_t start, size;
+	struct profile_histogram *hist;
+	struct profile_symbol *syms, *s;
+	uint32_t i, unknown = 0;
+	size_t count;
+
+	if (!find_cbmem_entry(CBMEM_ID_PROFILE, &start, &size)) {
+		fprintf(stderr, "No profile found in CBMEM area.\n");
+		return;
+	}
+
+	hist = map_memory_size(start, size);
+	if (hist->magic != PROFILER_MAGIC ||
+	    sizeof(*hist) + hist->buckets * sizeof(uint32_t) > size) {
+		fprintf(stderr, "Profile is corrupt.\n");
+		unmap_memory();
+		return;
+	}
+
+	syms = read_elf_symbols(elf_file, &count);
+
+	/* A bucket is charged to the function it starts in. */
+	for (i = 0; i < hist->buckets; i++) {
+		if (!hist->counts[i])
+			continue;
+		s = find_symbol(syms, count,
+				hist->link_base + (i << hist->shift));
+		if (s)
+			s->samples += hist->counts[i];
+		else
+			unknown += hist->counts[i];
+	}
+
+	printf("%u samples at %u Hz, %u bytes per bucket.\n\n",
+	       hist->samples, hist->rate_hz, 1 << hist->shift);
+	printf("  samples       %%  function\n");
+
+	qsort(syms, count, sizeof(*syms), compare_symbol_samples);
+	for (i = 0; i < count && syms[i].samples; i++)
+		printf("%9u  %5.1f%%  %s\n", syms[i].samples,
+		       100.0 * syms[i].samples / hist->samples, syms[i].name);
+	if (unknown)
+		printf("%9u  %5.1f%%  [unknown]\n", unknown,
+		       100.0 * unknown / hist->samples);
+	if (hist->outside)
+		printf("%9u  %5.1f%%  [outside ramstage]\n", hist->outside,
+		       100.0 * hist->outside / hist->samples);
+
+	free(syms);
+	unmap_memory();
+}
+
 #define COVERAGE_MAGIC 0x584d4153
 struct file {
 	uint32_t magic;
@@ -811,13 +1064,16 @@ static void print_version(void)
 
 static void print_usage(const char *name)
 {
-	printf("usage: %s [-cCltxVvh?]\n", name);
+	printf("usage: %s [-cCltxVvh?] [-T file] [-P elf]\n", name);
 	printf("\n"
 	     "   -c | --console:                   print cbmem console\n"
 	     "   -C | --coverage:                  dump coverage information\n"
 	     "   -l | --list:                      print cbmem table of contents\n"
 	     "   -x | --hexdump:                   print hexdump of cbmem area\n"
 	     "   -t | --timestamps:                print timestamp information\n"
+	     "   -T | --trace <file>:              save function trace to file\n"
+	     "   -P | --profile <elf>:             print ramstage profile, using\n"
+	     "                                     the symbols in the ramstage ELF\n"
 	     "   -V | --verbose:                   verbose (debugging) output\n"
 	     "   -v | --version:                   print the version\n"
 	     "   -h | --help:                      print this help\n"
@@ -948,6 +1204,8 @@ int main(int argc, char** argv)
 	int print_list = 0;
 	int print_hexdump = 0;
 	int print_timestamps = 0;
+	const char *trace_file = NULL;
+	const char *profile_elf = NULL;
 
 	int opt, option_index = 0;
 	static struct option long_options[] = {
@@ -955,13 +1213,15 @@ int main(int argc, char** argv)
 		{"coverage", 0, 0, 'C'},
 		{"list", 0, 0, 'l'},
 		{"timestamps", 0, 0, 't'},
+		{"trace", 1, 0, 'T'},
+		{"profile", 1, 0, 'P'},
 		{"hexdump", 0, 0, 'x'},
 		{"verbose", 0, 0, 'V'},
 		{"version", 0, 0, 'v'},
 		{"help", 0, 0, 'h'},
 		{0, 0, 0, 0}
 	};
-	while ((opt = getopt_long(argc, argv, "cCltxVvh?",
+	while ((opt = getopt_long(argc, argv, "cCltT:P:xVvh?",
 				  long_options, &option_index)) != EOF) {
 		switch (opt) {
 		case 'c':
@@ -984,6 +1244,14 @@ int main(int argc, char** argv)
 			print_timestamps = 1;
 			print_defaults = 0;
 			break;
+		case 'T':
+			trace_file = optarg;
+			print_defaults = 0;
+			break;
+		case 'P':
+			profile_elf = optarg;
+			print_defaults = 0;
+			break;
 		case 'V':
 			verbose = 1;
 			break;
@@ -1074,6 +1342,12 @@ int main(int argc, char** argv)
 	if (print_hexdump)
 		dump_cbmem_hex();
 
+	if (trace_file)
+		dump_trace(trace_file);
+
+	if (profile_elf)
+		dump_profile(profile_elf);
+
 	if (print_defaults || print_timestamps)
 		dump_timestamps();
 
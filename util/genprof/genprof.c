@@ -1,68 +1,285 @@
 #include <stdio.h>
+#include <string.h>
 #include <uthash.h>
 #include <sys/gmon_out.h>
 #include <stdlib.h>
+#include "trace.h"
 
 #define GMON_SEC "seconds        s"
+#define GMON_MCYCLES "Mcycles        M"
+#define FOLDED_FILE "trace.folded"
+#define MAX_DEPTH 256
 uint32_t mineip = 0xffffffff;
 uint32_t maxeip = 0;
 
 /* a hash structure to hold the arc */
-struct arec {
+struct arc_key {
 	uint32_t eip;
 	uint32_t from;
+};
+
+struct arec {
+	struct arc_key key;
 	uint32_t count;
 	UT_hash_handle hh;
 };
 
+/* per function times from a binary trace, in TSC ticks */
+struct frec {
+	uint32_t eip;
+	uint32_t calls;
+	uint64_t inclusive;
+	uint64_t exclusive;
+	UT_hash_handle hh;
+};
+
+/* exclusive time per call stack, for flame graphs */
+struct srec {
+	char *stack;
+	uint64_t ticks;
+	UT_hash_handle hh;
+};
+
+struct frame {
+	uint32_t eip;
+	uint64_t enter;
+	uint64_t children;
+};
+
 struct arec *arc = NULL;
+struct frec *funcs = NULL;
+struct srec *stacks = NULL;
+
+/* The hash records are needed until the end, running out is fatal. */
+static void *xzalloc(size_t size)
+{
+	void *p = calloc(1, size);
+
+	if (p == NULL) {
+		perror("Out of memory");
+		exit(1);
+	}
+	return p;
+}
+
+static void free_records(void)
+{
+	struct arec *a, *atmp;
+	struct frec *f, *ftmp;
+	struct srec *s, *stmp;
+
+	HASH_ITER(hh, arc, a, atmp) {
+		HASH_DEL(arc, a);
+		free(a);
+	}
+	HASH_ITER(hh, funcs, f, ftmp) {
+		HASH_DEL(funcs, f);
+		free(f);
+	}
+	HASH_ITER(hh, stacks, s, stmp) {
+		HASH_DEL(stacks, s);
+		free(s->stack);
+		free(s);
+	}
+}
 
 void note_arc(uint32_t eip, uint32_t from)
 {
 	struct arec *s;
+	struct arc_key key;
 
-	HASH_FIND_INT(arc, &eip, s);
+	memset(&key, 0, sizeof(key));
+	key.eip = eip;
+	key.from = from;
+
+	HASH_FIND(hh, arc, &key, sizeof(key), s);
 	if (s == NULL) {
-		s = malloc(sizeof(struct arec));
-		s->eip = eip;
-		s->from = from;
+		s = xzalloc(sizeof(struct arec));
+		s->key = key;
 		s->count = 1;
 		if (eip > maxeip)
 			maxeip = eip;
 		if (eip < mineip)
-			maxeip = eip;
+			mineip = eip;
 
-		HASH_ADD_INT(arc, eip, s);
+		HASH_ADD(hh, arc, key, sizeof(key), s);
 	} else {
 		s->count++;
 	}
 }
 
-int main(int argc, char* argv[])
+static struct frec *get_func(uint32_t eip)
 {
-	FILE *f, *fo;
-	struct arec *s;
-	uint32_t eip, from, tmp;
-	uint8_t tag;
-	uint16_t hit;
+	struct frec *f;
 
-	if (argc != 2) {
-		fprintf(stderr, "Please specify the coreboot trace log as parameter\n");
-		return 1;
+	HASH_FIND_INT(funcs, &eip, f);
+	if (f == NULL) {
+		f = xzalloc(sizeof(struct frec));
+		f->eip = eip;
+		HASH_ADD_INT(funcs, eip, f);
 	}
+	return f;
+}
+
+static void note_stack(const struct frame *stack, int depth, uint64_t ticks)
+{
+	char buf[MAX_DEPTH * 11 + 1];
+	struct srec *s;
+	int i, len = 0;
 
-	f = fopen(argv[1], "r");
+	for (i = 0; i < depth; i++)
+		len += sprintf(buf + len, "%s0x%08x", i ? ";" : "",
+			       stack[i].eip);
+
+	HASH_FIND_STR(stacks, buf, s);
+	if (s == NULL) {
+		s = xzalloc(sizeof(struct srec));
+		s->stack = xzalloc(len + 1);
+		memcpy(s->stack, buf, len + 1);
+		HASH_ADD_KEYPTR(hh, stacks, s->stack, len, s);
+	}
+	s->ticks += ticks;
+}
+
+/* Pops the top frame of the stack at time tsc. */
+static void leave(struct frame *stack, int *depth, uint64_t tsc)
+{
+	struct frame *fr = &stack[*depth - 1];
+	uint64_t inclusive = tsc - fr->enter;
+	uint64_t exclusive = inclusive - fr->children;
+	struct frec *f = get_func(fr->eip);
+	int i;
+
+	/* Recursive calls are already counted by the outermost one. */
+	for (i = 0; i < *depth - 1; i++)
+		if (stack[i].eip == fr->eip)
+			break;
+	if (i == *depth - 1)
+		f->inclusive += inclusive;
+	f->exclusive += exclusive;
+
+	note_stack(stack, *depth, exclusive);
+
+	(*depth)--;
+	if (*depth)
+		stack[*depth - 1].children += inclusive;
+}
+
+static void replay_ring(const struct trace_buffer *buf,
+			const struct trace_ring *ring)
+{
+	struct frame stack[MAX_DEPTH];
+	int depth = 0, skipped = 0;
+	uint32_t count, first, i;
+
+	count = ring->total < buf->entries ? ring->total : buf->entries;
+	first = ring->total < buf->entries ? 0 : ring->next;
+
+	for (i = 0; i < count; i++) {
+		const struct trace_event *ev =
+			&ring->events[(first + i) % buf->entries];
+		uint64_t tsc = ev->tsc & ~TRACE_EXIT;
+		int j;
+
+		if (!(ev->tsc & TRACE_EXIT)) {
+			note_arc(ev->func, ev->callsite);
+			get_func(ev->func)->calls++;
+			if (depth == MAX_DEPTH) {
+				skipped++;
+				continue;
+			}
+			stack[depth].eip = ev->func;
+			stack[depth].enter = tsc;
+			stack[depth].children = 0;
+			depth++;
+			continue;
+		}
+
+		if (skipped) {
+			skipped--;
+			continue;
+		}
+
+		/*
+		 * Exits of calls entered before the ring wrapped have no
+		 * frame. Frames whose exit is missing are closed here.
+		 */
+		for (j = depth - 1; j >= 0; j--)
+			if (stack[j].eip == ev->func)
+				break;
+		if (j < 0)
+			continue;
+		while (depth > j)
+			leave(stack, &depth, tsc);
+	}
+}
+
+static int read_binary_trace(const char *filename)
+{
+	struct trace_buffer *buf;
+	FILE *f;
+	long size;
+	size_t ring_size;
+	uint32_t i;
+
+	f = fopen(filename, "rb");
 	if (f == NULL) {
 		perror("Unable to open the input file");
 		return 1;
 	}
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	rewind(f);
+	if (size < (long)sizeof(*buf)) {
+		fprintf(stderr, "Trace file is truncated\n");
+		fclose(f);
+		return 1;
+	}
 
-	fo = fopen("gmon.out", "w+");
-	if (fo == NULL) {
-		perror("Unable to open the output file");
+	buf = malloc(size);
+	if (buf == NULL) {
+		perror("Unable to allocate the trace buffer");
+		fclose(f);
+		return 1;
+	}
+	if (fread(buf, size, 1, f) != 1) {
+		perror("Unable to read the input file");
+		free(buf);
 		fclose(f);
 		return 1;
 	}
+	fclose(f);
+
+	ring_size = sizeof(struct trace_ring) +
+		    (size_t)buf->entries * sizeof(struct trace_event);
+	if (sizeof(*buf) + buf->rings * ring_size > size) {
+		fprintf(stderr, "Trace file is truncated\n");
+		free(buf);
+		return 1;
+	}
+
+	for (i = 0; i < buf->rings; i++) {
+		const struct trace_ring *ring = (const void *)((char *)(buf + 1)
+							       + i * ring_size);
+		if (ring->total)
+			replay_ring(buf, ring);
+	}
+
+	free(buf);
+	return 0;
+}
+
+static int read_text_log(const char *filename)
+{
+	FILE *f;
+	uint32_t eip, from;
+	int tmp;
+
+	f = fopen(filename, "r");
+	if (f == NULL) {
+		perror("Unable to open the input file");
+		return 1;
+	}
 
 	while (!feof(f)) {
 		if (fscanf(f, "~%x(%x)%*[^\n]\n", &eip, &from) == 2) {
@@ -72,9 +289,134 @@ int main(int argc, char* argv[])
 		} else {
 			/* just drop a line */
 			tmp = fscanf(f, "%*[^\n]\n");
+			(void)tmp;
 		}
 	}
 
+	fclose(f);
+	return 0;
+}
+
+static int by_exclusive(struct frec *a, struct frec *b)
+{
+	if (a->exclusive == b->exclusive)
+		return 0;
+	return a->exclusive < b->exclusive ? 1 : -1;
+}
+
+static int write_histogram(FILE *fo)
+{
+	struct frec *f;
+	uint64_t max = 0, scale;
+	uint32_t low, high, bins, tmp;
+	uint16_t *hist;
+	uint8_t tag;
+
+	low = mineip & ~3;
+	high = (maxeip | 3) + 1;
+	bins = (high - low) / 4;
+
+	/* Scale the exclusive times so the largest fits a bin. */
+	for (f = funcs; f != NULL; f = f->hh.next)
+		if (f->exclusive > max)
+			max = f->exclusive;
+	scale = max / 0xffff + 1;
+
+	hist = calloc(bins, sizeof(*hist));
+	if (hist == NULL) {
+		perror("Unable to allocate the histogram");
+		return 1;
+	}
+	for (f = funcs; f != NULL; f = f->hh.next)
+		if (f->eip >= low && f->eip < high)
+			hist[(f->eip - low) / 4] = f->exclusive / scale;
+
+	tag = GMON_TAG_TIME_HIST;
+	fwrite(&tag, 1, sizeof(tag), fo);
+	fwrite(&low, 1, sizeof(low), fo);
+	fwrite(&high, 1, sizeof(high), fo);
+	fwrite(&bins, 1, sizeof(bins), fo);
+	/* prof rate, in bins per million cycles */
+	tmp = scale < 1000000 ? 1000000 / scale : 1;
+	fwrite(&tmp, 1, sizeof(tmp), fo);
+	fwrite(GMON_MCYCLES, 1, sizeof(GMON_MCYCLES) - 1, fo);
+	fwrite(hist, bins, sizeof(*hist), fo);
+
+	free(hist);
+	return 0;
+}
+
+static int write_folded(void)
+{
+	struct srec *s;
+	FILE *fo;
+
+	fo = fopen(FOLDED_FILE, "w");
+	if (fo == NULL) {
+		perror("Unable to open the folded stacks file");
+		return 1;
+	}
+	for (s = stacks; s != NULL; s = s->hh.next)
+		if (s->ticks)
+			fprintf(fo, "%s %llu\n", s->stack,
+				(unsigned long long)s->ticks);
+	fclose(fo);
+
+	return 0;
+}
+
+static void print_times(void)
+{
+	struct frec *f;
+
+	HASH_SORT(funcs, by_exclusive);
+	printf("  function        calls     inclusive     exclusive\n");
+	for (f = funcs; f != NULL; f = f->hh.next)
+		printf("0x%08x %12u %13llu %13llu\n", f->eip, f->calls,
+		       (unsigned long long)f->inclusive,
+		       (unsigned long long)f->exclusive);
+}
+
+int main(int argc, char* argv[])
+{
+	FILE *f, *fo;
+	struct arec *s;
+	uint32_t magic = 0, tmp;
+	uint8_t tag;
+	uint16_t hit;
+	int binary, ret;
+
+	if (argc != 2) {
+		fprintf(stderr, "Please specify the coreboot trace log or the "
+			"file saved with cbmem -T as parameter\n");
+		return 1;
+	}
+
+	f = fopen(argv[1], "rb");
+	if (f == NULL) {
+		perror("Unable to open the input file");
+		return 1;
+	}
+	binary = fread(&magic, sizeof(magic), 1, f) == 1 &&
+		 magic == TRACE_MAGIC;
+	fclose(f);
+
+	if (binary)
+		ret = read_binary_trace(argv[1]);
+	else
+		ret = read_text_log(argv[1]);
+	if (ret) {
+		free_records();
+		return ret;
+	}
+
+	fo = fopen("gmon.out", "w+");
+	if (fo == NULL) {
+		perror("Unable to open the output file");
+		free_records();
+		return 1;
+	}
+
 	/* write gprof header */
 	fwrite(GMON_MAGIC, 1, sizeof(GMON_MAGIC) - 1, fo);
 	tmp = GMON_VERSION;
@@ -83,32 +425,47 @@ int main(int argc, char* argv[])
 	fwrite(&tmp, 1, sizeof(tmp), fo);
 	fwrite(&tmp, 1, sizeof(tmp), fo);
 	fwrite(&tmp, 1, sizeof(tmp), fo);
-	/* write fake histogram */
-	tag = GMON_TAG_TIME_HIST;
-	fwrite(&tag, 1, sizeof(tag), fo);
-	fwrite(&mineip, 1, sizeof(mineip), fo);
-	fwrite(&maxeip, 1, sizeof(maxeip), fo);
-	/* size of histogram */
-	tmp = 1;
-	fwrite(&tmp, 1, sizeof(tmp), fo);
-	/* prof rate */
-	tmp = 1000;
-	fwrite(&tmp, 1, sizeof(tmp), fo);
-	fwrite(GMON_SEC, 1, sizeof(GMON_SEC) - 1, fo);
-	hit = 1;
-	fwrite(&hit, 1, sizeof(hit), fo);
+
+	if (binary && arc != NULL) {
+		if (write_histogram(fo)) {
+			fclose(fo);
+			free_records();
+			return 1;
+		}
+	} else {
+		/* write fake histogram */
+		tag = GMON_TAG_TIME_HIST;
+		fwrite(&tag, 1, sizeof(tag), fo);
+		fwrite(&mineip, 1, sizeof(mineip), fo);
+		fwrite(&maxeip, 1, sizeof(maxeip), fo);
+		/* size of histogram */
+		tmp = 1;
+		fwrite(&tmp, 1, sizeof(tmp), fo);
+		/* prof rate */
+		tmp = 1000;
+		fwrite(&tmp, 1, sizeof(tmp), fo);
+		fwrite(GMON_SEC, 1, sizeof(GMON_SEC) - 1, fo);
+		hit = 1;
+		fwrite(&hit, 1, sizeof(hit), fo);
+	}
 
 	/* write call graph data */
 	tag = GMON_TAG_CG_ARC;
 	for (s = arc; s != NULL; s = s->hh.next) {
 		fwrite(&tag, 1, sizeof(tag), fo);
-		fwrite(&s->from, 1, sizeof(s->from), fo);
-		fwrite(&s->eip, 1, sizeof(s->eip), fo);
+		fwrite(&s->key.from, 1, sizeof(s->key.from), fo);
+		fwrite(&s->key.eip, 1, sizeof(s->key.eip), fo);
 		fwrite(&s->count, 1, sizeof(s->count), fo);
 	}
 
 	fclose(fo);
-	fclose(f);
 
-	return 0;
+	if (binary) {
+		ret = write_folded();
+		if (!ret)
+			print_times();
+	}
+
+	free_records();
+	return ret;
 }
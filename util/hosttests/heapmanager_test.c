@@ -0,0 +1,529 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <northbridge/amd/pi/BiosCallOuts.h>
+
+/*
+ * The heap lives at the address the firmware uses, since GetHeapBase()
+ * hands it out as a 32-bit number. A model of the live buffers is checked
+ * against the node list, the free lists and the buffer contents.
+ */
+#define NUM_HANDLES	1000
+#define MAX_LIVE	(BIOS_HEAP_HANDLE_SLOTS * 3 / 4)
+#define NODE_HEADER	sizeof(BIOS_BUFFER_NODE)
+#define FIRST_NODE	ALIGN_UP(sizeof(BIOS_HEAP_MANAGER), 8)
+#define TRACE_LENGTH	20000
+#define MAX_ERRORS	20
+
+static int errors;
+
+#define check(cond, ...) do {						\
+		if (!(cond)) {						\
+			printf("%s: ", __func__);			\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			if (++errors == MAX_ERRORS)			\
+				exit(1);				\
+		}							\
+	} while (0)
+
+VOID LibAmdMemFill(VOID *Destination, UINT8 Value, UINTN FillLength,
+		   AMD_CONFIG_PARAMS *StdHeader)
+{
+	memset(Destination, Value, FillLength);
+}
+
+static UINT8 *heap;
+
+struct buffer {
+	int live;
+	UINT8 *ptr;
+	UINT32 len;
+};
+
+static struct buffer buffers[NUM_HANDLES];
+static int num_live;
+
+/* Spread out like the AGESA handles, which carry a module id up top. */
+static UINT32 handle(int i)
+{
+	return 0x00010000 + i * 0x10001;
+}
+
+static UINT8 fill(int i)
+{
+	return 0x5a ^ i;
+}
+
+static AGESA_STATUS allocate(UINT32 h, UINT32 len, UINT8 **ptr)
+{
+	AGESA_BUFFER_PARAMS params = {
+		.BufferLength = len,
+		.BufferHandle = h,
+	};
+	AGESA_STATUS status;
+
+	status = agesa_AllocateBuffer(0, 0, &params);
+	*ptr = params.BufferPointer;
+	return status;
+}
+
+static AGESA_STATUS deallocate(UINT32 h)
+{
+	AGESA_BUFFER_PARAMS params = { .BufferHandle = h };
+
+	return agesa_DeallocateBuffer(0, 0, &params);
+}
+
+static AGESA_STATUS locate(UINT32 h, UINT8 **ptr, UINT32 *len)
+{
+	AGESA_BUFFER_PARAMS params = { .BufferHandle = h };
+	AGESA_STATUS status;
+
+	status = agesa_LocateBuffer(0, 0, &params);
+	*ptr = params.BufferPointer;
+	*len = params.BufferLength;
+	return status;
+}
+
+static void reset_heap(void)
+{
+	EmptyHeap();
+	memset(buffers, 0, sizeof(buffers));
+	num_live = 0;
+}
+
+static int all_bytes(const UINT8 *p, UINT32 len, UINT8 v)
+{
+	while (len--)
+		if (*p++ != v)
+			return 0;
+	return 1;
+}
+
+static struct buffer *find_buffer(UINT32 h)
+{
+	int i;
+
+	for (i = 0; i < NUM_HANDLES; i++)
+		if (buffers[i].live && handle(i) == h)
+			return &buffers[i];
+	return NULL;
+}
+
+/*
+ * The nodes must tile the heap with correct boundary tags, no two free
+ * nodes next to each other, free memory zeroed apart from the list links,
+ * and exactly the live buffers of the model allocated.
+ */
+static void check_heap(const char *when)
+{
+	BIOS_HEAP_MANAGER *mgr = (BIOS_HEAP_MANAGER *)heap;
+	UINT32 offset, size, prev_size = 0;
+	int prev_free = 0, free_nodes = 0, listed = 0, used = 0;
+	UINT32 list;
+
+	if (mgr->StartOfNodes == 0) {
+		check(num_live == 0, "%s: no nodes", when);
+		return;
+	}
+
+	for (offset = mgr->StartOfNodes; offset < BIOS_HEAP_SIZE;
+	     offset += size) {
+		BIOS_BUFFER_NODE *node = (BIOS_BUFFER_NODE *)(heap + offset);
+		UINT8 *data = heap + offset + NODE_HEADER;
+		int is_free = node->NodeSize & 1;
+
+		size = node->NodeSize & ~1;
+		if (size < NODE_HEADER + 8 || size % 8 ||
+		    offset + size > BIOS_HEAP_SIZE) {
+			check(0, "%s: node %#x has size %#x", when, offset,
+			      size);
+			return;
+		}
+		check(node->PrevNodeSize == prev_size,
+		      "%s: node %#x: previous size %#x, expected %#x", when,
+		      offset, node->PrevNodeSize, prev_size);
+		check(!(is_free && prev_free), "%s: node %#x: not merged",
+		      when, offset);
+
+		if (is_free) {
+			free_nodes++;
+			check(node->BufferHandle == 0 && node->BufferSize == 0 &&
+			      all_bytes(data + 8, size - NODE_HEADER - 8, 0),
+			      "%s: node %#x: free memory not cleared", when,
+			      offset);
+		} else {
+			struct buffer *b = find_buffer(node->BufferHandle);
+
+			used++;
+			if (b == NULL) {
+				check(0, "%s: node %#x: unknown handle %#x",
+				      when, offset, node->BufferHandle);
+			} else {
+				check(b->ptr == data &&
+				      b->len == node->BufferSize,
+				      "%s: node %#x: handle %#x moved", when,
+				      offset, node->BufferHandle);
+				check(all_bytes(data, b->len,
+						fill(b - buffers)),
+				      "%s: node %#x: handle %#x overwritten",
+				      when, offset, node->BufferHandle);
+			}
+		}
+
+		prev_size = size;
+		prev_free = is_free;
+	}
+	check(offset == BIOS_HEAP_SIZE, "%s: nodes end at %#x", when, offset);
+	check(used == num_live, "%s: %d nodes in use, expected %d", when,
+	      used, num_live);
+
+	for (list = 0; list < BIOS_HEAP_FREE_LISTS; list++) {
+		UINT32 *links;
+
+		check(!(mgr->FreeListMap & 1 << list) == !mgr->FreeLists[list],
+		      "%s: list %d doesn't match the map", when, list);
+		for (offset = mgr->FreeLists[list]; offset != 0;
+		     offset = links[0]) {
+			BIOS_BUFFER_NODE *node =
+				(BIOS_BUFFER_NODE *)(heap + offset);
+
+			links = (UINT32 *)(heap + offset + NODE_HEADER);
+			size = node->NodeSize & ~1;
+			check((node->NodeSize & 1) &&
+			      31 - __builtin_clz(size) == list,
+			      "%s: node %#x in list %d", when, offset, list);
+			if (++listed > free_nodes)
+				break;
+		}
+	}
+	check(listed == free_nodes, "%s: %d free nodes listed, %d found",
+	      when, listed, free_nodes);
+}
+
+/* Whether a free node could hold len bytes. */
+static int fits(UINT32 len)
+{
+	BIOS_HEAP_MANAGER *mgr = (BIOS_HEAP_MANAGER *)heap;
+	UINT32 need = ALIGN_UP(len + NODE_HEADER, 8);
+	UINT32 offset, size;
+
+	if (mgr->StartOfNodes == 0)
+		return need <= BIOS_HEAP_SIZE - FIRST_NODE;
+	for (offset = mgr->StartOfNodes; offset < BIOS_HEAP_SIZE;
+	     offset += size) {
+		BIOS_BUFFER_NODE *node = (BIOS_BUFFER_NODE *)(heap + offset);
+
+		size = node->NodeSize & ~1;
+		if ((node->NodeSize & 1) && size >= need)
+			return 1;
+	}
+	return 0;
+}
+
+static UINT32 random_length(void)
+{
+	if (rand() % 8)
+		return rand() % 256;
+	if (rand() % 16)
+		return rand() % 4096;
+	return rand() % 32768;
+}
+
+static void do_allocate(int i, UINT32 len)
+{
+	struct buffer *b = &buffers[i];
+	AGESA_STATUS status;
+	int could_fit = fits(len) && num_live < MAX_LIVE;
+	UINT8 *ptr;
+
+	status = allocate(handle(i), len, &ptr);
+
+	if (b->live) {
+		check(status == AGESA_BOUNDS_CHK && ptr == NULL,
+		      "handle %#x allocated twice", handle(i));
+		return;
+	}
+	if (status != AGESA_SUCCESS) {
+		check(!could_fit, "%#x bytes for handle %#x failed", len,
+		      handle(i));
+		check(ptr == NULL, "failed allocation returned a buffer");
+		return;
+	}
+
+	check(ptr >= heap + FIRST_NODE + NODE_HEADER &&
+	      ptr + len <= heap + BIOS_HEAP_SIZE && (uintptr_t)ptr % 8 == 0,
+	      "handle %#x got %p", handle(i), ptr);
+	check(all_bytes(ptr, len, 0), "handle %#x not cleared", handle(i));
+
+	memset(ptr, fill(i), len);
+	b->live = 1;
+	b->ptr = ptr;
+	b->len = len;
+	num_live++;
+}
+
+static void do_deallocate(int i)
+{
+	struct buffer *b = &buffers[i];
+	AGESA_STATUS status;
+
+	if (b->live)
+		check(all_bytes(b->ptr, b->len, fill(i)),
+		      "handle %#x overwritten", handle(i));
+
+	status = deallocate(handle(i));
+	if (!b->live) {
+		check(status == AGESA_BOUNDS_CHK, "handle %#x freed twice",
+		      handle(i));
+		return;
+	}
+
+	check(status == AGESA_SUCCESS, "handle %#x not freed", handle(i));
+	b->live = 0;
+	num_live--;
+}
+
+static void do_locate(int i)
+{
+	struct buffer *b = &buffers[i];
+	AGESA_STATUS status;
+	UINT8 *ptr;
+	UINT32 len;
+
+	status = locate(handle(i), &ptr, &len);
+	if (b->live)
+		check(status == AGESA_SUCCESS && ptr == b->ptr &&
+		      len == b->len, "handle %#x not found", handle(i));
+	else
+		check(status == AGESA_BOUNDS_CHK && ptr == NULL && len == 0,
+		      "freed handle %#x found", handle(i));
+}
+
+static void test_random(void)
+{
+	int round, op;
+
+	for (round = 0; round < 100; round++) {
+		reset_heap();
+
+		for (op = 0; op < 4000; op++) {
+			int i = rand() % NUM_HANDLES;
+
+			switch (rand() % 20) {
+			case 0 ... 8:
+				do_allocate(i, random_length());
+				break;
+			case 9 ... 15:
+				do_deallocate(i);
+				break;
+			default:
+				do_locate(i);
+			}
+			if (op % 64 == 0)
+				check_heap("random");
+		}
+		check_heap("random");
+	}
+}
+
+/* Freed in any order, the heap must merge back into one node. */
+static void test_coalesce(void)
+{
+	int order[NUM_HANDLES];
+	UINT8 *ptr;
+	int i, j, t;
+
+	reset_heap();
+	for (i = 0; i < MAX_LIVE; i++) {
+		do_allocate(i, rand() % 200);
+		check(buffers[i].live, "buffer %d of %d failed", i, MAX_LIVE);
+	}
+
+	for (i = 0; i < MAX_LIVE; i++)
+		order[i] = i;
+	for (i = MAX_LIVE - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+	for (i = 0; i < MAX_LIVE; i++)
+		do_deallocate(order[i]);
+	check_heap("coalesce");
+
+	check(allocate(handle(0), BIOS_HEAP_SIZE - FIRST_NODE - NODE_HEADER,
+		       &ptr) == AGESA_SUCCESS, "the whole heap is not free");
+	check(deallocate(handle(0)) == AGESA_SUCCESS, "can't free the heap");
+}
+
+/*
+ * The handle index holds up to MAX_LIVE handles. Churning through many
+ * more than it has slots must reuse the deleted ones.
+ */
+static void test_handles(void)
+{
+	UINT32 len;
+	UINT8 *ptr;
+	int i;
+
+	reset_heap();
+	for (i = 0; i < MAX_LIVE; i++)
+		do_allocate(i, 8);
+	check(num_live == MAX_LIVE, "only %d handles", num_live);
+	check(allocate(handle(MAX_LIVE), 8, &ptr) == AGESA_BOUNDS_CHK,
+	      "more than %d handles", MAX_LIVE);
+
+	for (i = 0; i < 100000; i++) {
+		UINT32 h = 0x80000000 + i;
+
+		check(deallocate(handle(i % MAX_LIVE)) == AGESA_SUCCESS &&
+		      allocate(h, 8, &ptr) == AGESA_SUCCESS &&
+		      locate(h, &ptr, &len) == AGESA_SUCCESS &&
+		      deallocate(h) == AGESA_SUCCESS &&
+		      allocate(handle(i % MAX_LIVE), 8, &ptr) == AGESA_SUCCESS,
+		      "round %d failed", i);
+		buffers[i % MAX_LIVE].ptr = ptr;
+		memset(ptr, fill(i % MAX_LIVE), 8);
+	}
+	check_heap("handles");
+
+	for (i = 0; i < MAX_LIVE; i++)
+		do_locate(i);
+}
+
+enum trace_op {
+	TRACE_ALLOCATE,
+	TRACE_LOCATE,
+	TRACE_DEALLOCATE,
+};
+
+static struct {
+	enum trace_op op;
+	UINT32 handle;
+	UINT32 len;
+} trace[TRACE_LENGTH];
+
+/*
+ * A boot as AGESA runs it: a few hundred live buffers at a time, most of
+ * them small, freed roughly in the order they came, and several lookups
+ * for every allocation.
+ */
+static void make_trace(void)
+{
+	int live[NUM_HANDLES];
+	int num = 0, next = 0, n = 0;
+	int i, j;
+
+	while (n < TRACE_LENGTH) {
+		int r = rand() % 10;
+
+		if (num < 300 && (r < 2 || num < 20)) {
+			live[num++] = next;
+			trace[n].op = TRACE_ALLOCATE;
+			trace[n].handle = handle(next);
+			trace[n].len = rand() % 8 ? rand() % 256 :
+				       rand() % 4096;
+			next = (next + 1) % NUM_HANDLES;
+		} else if (r < 4 && num) {
+			i = rand() % (num < 8 ? num : 8);
+			trace[n].op = TRACE_DEALLOCATE;
+			trace[n].handle = handle(live[i]);
+			for (j = i; j < num - 1; j++)
+				live[j] = live[j + 1];
+			num--;
+		} else if (num) {
+			trace[n].op = TRACE_LOCATE;
+			trace[n].handle = handle(live[rand() % num]);
+		} else {
+			continue;
+		}
+		n++;
+	}
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void benchmark(void)
+{
+	const int rounds = 20;
+	AGESA_STATUS status = AGESA_SUCCESS;
+	double start, elapsed;
+	UINT32 len;
+	UINT8 *ptr;
+	int r, i;
+
+	make_trace();
+
+	start = now_us();
+	for (r = 0; r < rounds; r++) {
+		EmptyHeap();
+		for (i = 0; i < TRACE_LENGTH; i++) {
+			switch (trace[i].op) {
+			case TRACE_ALLOCATE:
+				status |= allocate(trace[i].handle,
+						   trace[i].len, &ptr);
+				break;
+			case TRACE_LOCATE:
+				status |= locate(trace[i].handle, &ptr, &len);
+				break;
+			case TRACE_DEALLOCATE:
+				status |= deallocate(trace[i].handle);
+				break;
+			}
+		}
+	}
+	elapsed = now_us() - start;
+
+	check(status == AGESA_SUCCESS, "the trace failed");
+	printf("heapmanager_test: replay of %d calls: %.1f ns per call\n",
+	       TRACE_LENGTH, elapsed * 1000 / rounds / TRACE_LENGTH);
+}
+
+int main(void)
+{
+	heap = mmap((void *)BIOS_HEAP_START_ADDRESS, BIOS_HEAP_SIZE,
+		    PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (heap != (UINT8 *)BIOS_HEAP_START_ADDRESS) {
+		printf("heapmanager_test: can't map the heap at %#x\n",
+		       BIOS_HEAP_START_ADDRESS);
+		return 1;
+	}
+
+	srand(1);
+
+	test_random();
+	test_coalesce();
+	test_handles();
+	benchmark();
+
+	printf("heapmanager_test: %s\n", errors ? "FAILED" : "passed");
+	return errors != 0;
+}
@@ -0,0 +1,26 @@
+/* Only the buffer call-out interface of the AGESA headers. */
+#ifndef AGESA_H
+#define AGESA_H
+
+#include "Porting.h"
+
+typedef enum {
+	AGESA_SUCCESS = 0,
+	AGESA_UNSUPPORTED,
+	AGESA_BOUNDS_CHK,
+} AGESA_STATUS;
+
+typedef struct {
+	UINT32 ImageBasePtr;
+	UINT32 Func;
+	UINT32 AltImageBasePtr;
+} AMD_CONFIG_PARAMS;
+
+typedef struct {
+	AMD_CONFIG_PARAMS StdHeader;
+	UINT32 BufferLength;
+	UINT32 BufferHandle;
+	VOID *BufferPointer;
+} AGESA_BUFFER_PARAMS;
+
+#endif
@@ -0,0 +1,12 @@
+/* The AGESA types heapmanager.c uses. */
+#ifndef PORTING_H
+#define PORTING_H
+
+#include <stdint.h>
+
+typedef uint8_t UINT8;
+typedef uint32_t UINT32;
+typedef uintptr_t UINTN;
+typedef void VOID;
+
+#endif
@@ -0,0 +1,5 @@
+/* The test provides the library calls heapmanager.c makes. */
+#include "AGESA.h"
+
+VOID LibAmdMemFill(VOID *Destination, UINT8 Value, UINTN FillLength,
+		   AMD_CONFIG_PARAMS *StdHeader);
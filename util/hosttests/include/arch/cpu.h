@@ -0,0 +1,21 @@
+#ifndef ARCH_CPU_H
+#define ARCH_CPU_H
+
+/* Each simulated cpu is a host thread with its own cpu_info. */
+struct device;
+
+struct cpu_info {
+	struct device *cpu;
+	unsigned int index;
+};
+
+struct cpu_info *cpu_info(void);
+
+static inline unsigned long cpu_index(void)
+{
+	return cpu_info()->index;
+}
+
+#define asmlinkage
+
+#endif
@@ -0,0 +1 @@
+#include "../../../../../src/arch/x86/include/arch/smp/spinlock.h"
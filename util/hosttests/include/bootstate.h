@@ -0,0 +1,15 @@
+#ifndef BOOTSTATE_H
+#define BOOTSTATE_H
+
+/* Boot state callbacks are only collected, the test calls them. */
+struct boot_state_init_entry {
+	void (*callback)(void *arg);
+	void *arg;
+};
+
+#define BOOT_STATE_INIT_ENTRIES(name_) \
+	struct boot_state_init_entry name_[]
+#define BOOT_STATE_INIT_ENTRY(state_, when_, func_, arg_) \
+	{ .callback = func_, .arg = arg_ }
+
+#endif
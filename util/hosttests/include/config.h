@@ -0,0 +1,14 @@
+/* The options the code under test is built with. */
+#define CONFIG_TIMER_QUEUE_STATS 0
+#define CONFIG_TICKLESS_IDLE 0
+#define CONFIG_X86_AMD_FIXED_MTRRS 0
+#define CONFIG_RAMTOP 0x200000
+#define CONFIG_XIP_ROM_SIZE 0x10000
+#define CONFIG_SMP 1
+#define CONFIG_MAX_CPUS 4
+#define CONFIG_STACK_SIZE 0x1000
+#define CONFIG_COOP_MULTITASKING 0
+#define CONFIG_PARALLEL_MP_AP_WORK 1
+#define CONFIG_NORTHBRIDGE_AMD_PI_00730F01 1
+#define CONFIG_HAVE_ACPI_RESUME 0
+#define CONFIG_AGESA_HEAP_MEMTEST 0
@@ -0,0 +1,2 @@
+int cpu_phys_address_size(void);
+void cpu_initialize(unsigned int cpu_index);
@@ -0,0 +1 @@
+/* Nothing needed on the host. */
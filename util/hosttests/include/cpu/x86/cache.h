@@ -0,0 +1,4 @@
+/* There is no cache to flush on the host. */
+static inline void disable_cache(void) {}
+static inline void enable_cache(void) {}
+static inline void wbinvd(void) {}
@@ -0,0 +1,8 @@
+/* The local apic only starts the APs, which the tests do themselves. */
+#include "../../../../../src/include/cpu/x86/lapic_def.h"
+
+void enable_lapic(void);
+unsigned long lapicid(void);
+unsigned long lapic_read(unsigned long reg);
+void lapic_write_around(unsigned long reg, unsigned long v);
+void stop_this_cpu(void);
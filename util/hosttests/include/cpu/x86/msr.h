@@ -0,0 +1,8 @@
+/* The MSRs are simulated by the test. */
+typedef struct msr_struct {
+	unsigned int lo;
+	unsigned int hi;
+} msr_t;
+
+msr_t rdmsr(unsigned int index);
+void wrmsr(unsigned int index, msr_t msr);
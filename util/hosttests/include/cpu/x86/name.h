@@ -0,0 +1 @@
+#include "../../../../../src/include/cpu/x86/name.h"
@@ -0,0 +1,3 @@
+/* Only where mp_init() puts the SIPI vector. */
+#define SMM_DEFAULT_BASE	0x30000
+#define SMM_DEFAULT_SIZE	0x10000
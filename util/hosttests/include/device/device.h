@@ -0,0 +1,13 @@
+/* Only the fields the MTRR range filter and mp_init() look at. */
+#include <device/path.h>
+#include <device/resource.h>
+
+struct bus;
+
+struct device {
+	struct device_path path;
+	unsigned int class;
+};
+
+struct device *alloc_find_dev(struct bus *parent, struct device_path *path);
+void dev_index_path(struct device *dev);
@@ -0,0 +1 @@
+#include "../../../../src/include/device/path.h"
@@ -0,0 +1 @@
+#define PCI_CLASS_DISPLAY_VGA	0x0300
@@ -0,0 +1,3 @@
+/* The host stddef.h doesn't know about coreboot's stages. */
+#define ROMSTAGE_CONST
+#include "../../../../src/include/device/resource.h"
@@ -0,0 +1 @@
+#define HEAP_CALLOUT_RUNTIME	1
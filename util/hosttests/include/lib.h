@@ -0,0 +1,4 @@
+/* Only what mp_init() uses. */
+#include <stdlib.h>
+
+extern unsigned char _estack[];
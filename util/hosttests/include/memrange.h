@@ -0,0 +1 @@
+#include "../../../src/include/memrange.h"
@@ -0,0 +1 @@
+#include "../../../../../../src/northbridge/amd/pi/BiosCallOuts.h"
@@ -0,0 +1 @@
+#include "../../../src/include/rmodule-defs.h"
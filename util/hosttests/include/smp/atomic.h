@@ -0,0 +1 @@
+#include "../../../../src/include/smp/atomic.h"
@@ -0,0 +1 @@
+#include "../../../../src/include/smp/spinlock.h"
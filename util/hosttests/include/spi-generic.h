@@ -0,0 +1,2 @@
+/* Only the flash ops are simulated, there is no bus. */
+struct spi_slave;
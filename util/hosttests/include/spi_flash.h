@@ -0,0 +1 @@
+#include "../../../src/include/spi_flash.h"
@@ -0,0 +1,7 @@
+#include_next <stdint.h>
+
+/* The short names coreboot code uses. */
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;	/* Printed with %ll like on x86. */
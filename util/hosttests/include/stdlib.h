@@ -0,0 +1,8 @@
+#include_next <stdlib.h>
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define ALIGN(x,a)		__ALIGN_MASK(x,(typeof(x))(a)-1UL)
+#define __ALIGN_MASK(x,mask)	(((x)+(mask))&~(mask))
+#define ALIGN_UP(x,a)		ALIGN((x),(a))
+#define ALIGN_DOWN(x,a)		((x) & ~((typeof(x))(a)-1UL))
+#define MIN(a,b)		((a) < (b) ? (a) : (b))
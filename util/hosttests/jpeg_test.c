@@ -0,0 +1,650 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../src/lib/jpeg.h"
+
+/*
+ * The reference images are made by a small baseline encoder below, from
+ * synthetic pictures, so the test needs no image files. The encoder writes
+ * what the decoder supports: 4:2:0 YCbCr, two sets of Huffman tables and
+ * optional restart markers. Its Huffman codes go up to 16 bits, which
+ * takes the decoder's slow path past the lookup table.
+ */
+#define MAX_WIDTH	1024
+#define MAX_HEIGHT	768
+#define MAX_JPEG	(MAX_WIDTH * MAX_HEIGHT * 4)
+#define MAX_ERRORS	20
+
+static int errors;
+
+#define check(cond, ...) do {						\
+		if (!(cond)) {						\
+			printf("%s: ", __func__);			\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			if (++errors == MAX_ERRORS)			\
+				exit(1);				\
+		}							\
+	} while (0)
+
+enum pattern {
+	GRADIENT,
+	BARS,
+	NOISE,
+};
+
+struct image {
+	const char *name;
+	int width;
+	int height;
+	enum pattern pattern;
+	int quant_step;		/* 0 keeps every coefficient as it is. */
+	int restart;		/* MCUs between restart markers, 0 for none. */
+	int max_error;		/* Mean error from the picture at 24 bpp. */
+	/* FNV-1a of the 16, 24 and 32 bpp output at full size. */
+	uint32_t sum[3];
+	/* FNV-1a of the 32 bpp output at 1/2, 1/4 and 1/8. */
+	uint32_t scaled_sum[3];
+};
+
+/*
+ * The full size sums come from the decoder as it was before the line based
+ * colour conversion, which gave the same output.
+ */
+static const struct image images[] = {
+	{ "gradient", 64, 48, GRADIENT, 2, 0, 2,
+	  { 0x84e56483, 0x881dc3f7, 0xd6d8a9bf },
+	  { 0x6d5c5653, 0xaa3a3095, 0xffb7c09a } },
+	{ "bars", 128, 64, BARS, 4, 0, 2,
+	  { 0x66a051e5, 0x1d10cde5, 0xeee5ed25 },
+	  { 0x4971c8a5, 0x13d26ca5, 0xf8ac2529 } },
+	/* At full quality the error is what the chroma subsampling loses. */
+	{ "noise", 48, 32, NOISE, 0, 0, 48,
+	  { 0x8c5fcea0, 0x11d9038e, 0xb15cde3a },
+	  { 0x4deec25e, 0xf47b6c7c, 0x4243e37a } },
+	{ "restart", 80, 64, GRADIENT, 3, 3, 2,
+	  { 0xb6be0ecc, 0x955f2c79, 0xc67c04bf },
+	  { 0x8fb2ed01, 0x33138ec0, 0xd684c9c5 } },
+};
+
+static unsigned char rgb[MAX_WIDTH * MAX_HEIGHT * 3];
+static unsigned char jpeg[MAX_JPEG];
+static unsigned char pic[MAX_WIDTH * MAX_HEIGHT * 4 + 64];
+static unsigned char full[MAX_WIDTH * MAX_HEIGHT * 4];
+static struct jpeg_decdata decdata;
+
+static void make_picture(enum pattern pattern, int width, int height)
+{
+	unsigned int seed = 1;
+	int x, y, c;
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			unsigned char *p = &rgb[(y * width + x) * 3];
+
+			switch (pattern) {
+			case GRADIENT:
+				p[0] = x * 255 / (width - 1);
+				p[1] = y * 255 / (height - 1);
+				p[2] = 255 - (x + y) * 255 /
+				       (width + height - 2);
+				break;
+			case BARS:
+				/* Eight colour bars over a grey ramp. */
+				c = x * 8 / width;
+				p[0] = c & 1 ? 235 : 16 + y;
+				p[1] = c & 2 ? 235 : 16 + y;
+				p[2] = c & 4 ? 235 : 16 + y;
+				break;
+			case NOISE:
+				for (c = 0; c < 3; c++) {
+					seed = seed * 1103515245 + 12345;
+					p[c] = seed >> 16;
+				}
+				break;
+			}
+		}
+	}
+}
+
+/**************** Encoder ****************/
+
+static unsigned char *out;
+static unsigned int bitbuf;
+static int bitcnt;
+
+static void put_byte(int b)
+{
+	*out++ = b;
+}
+
+static void put_word(int w)
+{
+	put_byte(w >> 8);
+	put_byte(w & 0xff);
+}
+
+static void put_bits(unsigned int bits, int n)
+{
+	while (n--) {
+		bitbuf = bitbuf << 1 | ((bits >> n) & 1);
+		if (++bitcnt == 8) {
+			put_byte(bitbuf);
+			/* Stuff a zero after every 0xff in the entropy data. */
+			if ((bitbuf & 0xff) == 0xff)
+				put_byte(0);
+			bitbuf = 0;
+			bitcnt = 0;
+		}
+	}
+}
+
+/* Pad the last byte with ones, as before a marker. */
+static void flush_bits(void)
+{
+	if (bitcnt)
+		put_bits(0x7f, 8 - bitcnt);
+}
+
+struct huff {
+	unsigned char bits[16];
+	unsigned char vals[256];
+	int num_vals;
+	unsigned short code[256];
+	unsigned char len[256];
+};
+
+/* Code lengths of the JPEG example tables, the symbols are ours. */
+static const unsigned char dc_bits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1 };
+static const unsigned char ac_bits[16] = {
+	0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d
+};
+
+static struct huff dc_huff[2], ac_huff[2];
+
+/* Assign canonical codes to vals in order of their code length. */
+static void make_huff(struct huff *h, const unsigned char *bits)
+{
+	unsigned int code = 0;
+	int i, j, k = 0;
+
+	memcpy(h->bits, bits, 16);
+	for (i = 0; i < 16; i++, code <<= 1)
+		for (j = 0; j < bits[i]; j++, k++) {
+			h->code[h->vals[k]] = code++;
+			h->len[h->vals[k]] = i + 1;
+		}
+}
+
+/*
+ * Table 0 gives the short codes to small sizes and short runs, table 1
+ * hands them out in the opposite order, so a mixed up table selector makes
+ * garbage.
+ */
+static void make_tables(void)
+{
+	int t, i, run, size;
+
+	for (t = 0; t < 2; t++) {
+		struct huff *dc = &dc_huff[t], *ac = &ac_huff[t];
+
+		dc->num_vals = 12;
+		for (i = 0; i < 12; i++)
+			dc->vals[i] = t ? 11 - i : i;
+		make_huff(dc, dc_bits);
+
+		ac->num_vals = 0;
+		ac->vals[ac->num_vals++] = 0x00;
+		ac->vals[ac->num_vals++] = 0xf0;
+		for (i = 0; i < 25; i++)
+			for (run = 0; run < 16; run++) {
+				size = i - run + 1;
+				if (size >= 1 && size <= 10)
+					ac->vals[ac->num_vals++] =
+						run << 4 | size;
+			}
+		if (t)
+			for (i = 0; i < ac->num_vals / 2; i++) {
+				unsigned char v = ac->vals[i];
+
+				ac->vals[i] = ac->vals[ac->num_vals - 1 - i];
+				ac->vals[ac->num_vals - 1 - i] = v;
+			}
+		make_huff(ac, ac_bits);
+	}
+}
+
+static int zigzag[64];
+
+/* zigzag[k] is the natural index of the k-th coefficient in scan order. */
+static void make_zigzag(void)
+{
+	int k = 0, s, i;
+
+	for (s = 0; s < 15; s++)
+		for (i = 0; i < 8; i++) {
+			int r = s & 1 ? i : s - i;
+			int c = s - r;
+
+			if (r >= 0 && r < 8 && c >= 0 && c < 8 && i <= s)
+				zigzag[k++] = r * 8 + c;
+		}
+}
+
+static int quant[2][64];
+
+static void make_quant(int step)
+{
+	int t, i;
+
+	for (t = 0; t < 2; t++)
+		for (i = 0; i < 64; i++)
+			quant[t][i] = 1 + step * ((i >> 3) + (i & 7) + t * 2) / 2;
+}
+
+static int bit_size(int v)
+{
+	int n = 0;
+
+	if (v < 0)
+		v = -v;
+	while (v) {
+		n++;
+		v >>= 1;
+	}
+	return n;
+}
+
+static void put_value(const struct huff *h, int sym, int v, int size)
+{
+	put_bits(h->code[sym], h->len[sym]);
+	if (size)
+		put_bits(v < 0 ? v - 1 : v, size);
+}
+
+/* Transform, quantise and code one 8x8 block of level shifted samples. */
+static void encode_block(const double *block, int t, int *pred)
+{
+	static double cosines[8][8];
+	int coef[64];
+	int u, v, x, y, k, run;
+
+	if (cosines[0][0] == 0)
+		for (x = 0; x < 8; x++)
+			for (u = 0; u < 8; u++)
+				cosines[x][u] = cos((2 * x + 1) * u * M_PI / 16) *
+						(u ? 1 : M_SQRT1_2);
+
+	for (v = 0; v < 8; v++)
+		for (u = 0; u < 8; u++) {
+			double sum = 0;
+
+			for (y = 0; y < 8; y++)
+				for (x = 0; x < 8; x++)
+					sum += block[y * 8 + x] *
+					       cosines[x][u] * cosines[y][v];
+			coef[v * 8 + u] = lround(sum / 4 / quant[t][v * 8 + u]);
+		}
+
+	put_value(&dc_huff[t], bit_size(coef[0] - *pred), coef[0] - *pred,
+		  bit_size(coef[0] - *pred));
+	*pred = coef[0];
+
+	run = 0;
+	for (k = 1; k < 64; k++) {
+		int c = coef[zigzag[k]];
+
+		if (c == 0) {
+			run++;
+			continue;
+		}
+		while (run > 15) {
+			put_value(&ac_huff[t], 0xf0, 0, 0);
+			run -= 16;
+		}
+		put_value(&ac_huff[t], run << 4 | bit_size(c), c, bit_size(c));
+		run = 0;
+	}
+	if (run)
+		put_value(&ac_huff[t], 0x00, 0, 0);
+}
+
+static void put_tables(void)
+{
+	int t, i;
+
+	put_word(0xffdb);
+	put_word(2 + 2 * 65);
+	for (t = 0; t < 2; t++) {
+		put_byte(t);
+		for (i = 0; i < 64; i++)
+			put_byte(quant[t][zigzag[i]]);
+	}
+
+	put_word(0xffc4);
+	put_word(2 + 2 * (17 + 12) + 2 * (17 + 162));
+	for (t = 0; t < 2; t++) {
+		put_byte(t);
+		for (i = 0; i < 16; i++)
+			put_byte(dc_huff[t].bits[i]);
+		for (i = 0; i < dc_huff[t].num_vals; i++)
+			put_byte(dc_huff[t].vals[i]);
+		put_byte(0x10 | t);
+		for (i = 0; i < 16; i++)
+			put_byte(ac_huff[t].bits[i]);
+		for (i = 0; i < ac_huff[t].num_vals; i++)
+			put_byte(ac_huff[t].vals[i]);
+	}
+}
+
+/* Encode the picture in rgb[], returns the length of the JPEG. */
+static int encode(int width, int height, int quant_step, int restart)
+{
+	static double ycc[3][MAX_WIDTH * MAX_HEIGHT];
+	double block[64];
+	int pred[3] = { 0, 0, 0 };
+	int mx, my, i, x, y, b, c, mcus = 0, rst = 0;
+
+	make_quant(quant_step);
+
+	for (i = 0; i < width * height; i++) {
+		const unsigned char *p = &rgb[i * 3];
+
+		ycc[0][i] = 0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2] - 128;
+		ycc[1][i] = -0.168736 * p[0] - 0.331264 * p[1] + 0.5 * p[2];
+		ycc[2][i] = 0.5 * p[0] - 0.418688 * p[1] - 0.081312 * p[2];
+	}
+
+	out = jpeg;
+	bitbuf = 0;
+	bitcnt = 0;
+
+	put_word(0xffd8);
+	put_tables();
+	if (restart) {
+		put_word(0xffdd);
+		put_word(4);
+		put_word(restart);
+	}
+
+	put_word(0xffc0);
+	put_word(8 + 3 * 3);
+	put_byte(8);
+	put_word(height);
+	put_word(width);
+	put_byte(3);
+	put_byte(1); put_byte(0x22); put_byte(0);
+	put_byte(2); put_byte(0x11); put_byte(1);
+	put_byte(3); put_byte(0x11); put_byte(1);
+
+	put_word(0xffda);
+	put_word(6 + 2 * 3);
+	put_byte(3);
+	put_byte(1); put_byte(0x00);
+	put_byte(2); put_byte(0x11);
+	put_byte(3); put_byte(0x11);
+	put_byte(0); put_byte(63); put_byte(0);
+
+	for (my = 0; my < height / 16; my++)
+		for (mx = 0; mx < width / 16; mx++) {
+			if (restart && mcus && mcus % restart == 0) {
+				flush_bits();
+				put_word(0xffd0 + (rst++ & 7));
+				pred[0] = pred[1] = pred[2] = 0;
+			}
+			mcus++;
+
+			/* Four luma blocks, then the averaged chroma. */
+			for (b = 0; b < 4; b++) {
+				for (y = 0; y < 8; y++)
+					for (x = 0; x < 8; x++)
+						block[y * 8 + x] = ycc[0][
+							(my * 16 + (b >> 1) * 8 + y) * width +
+							mx * 16 + (b & 1) * 8 + x];
+				encode_block(block, 0, &pred[0]);
+			}
+			for (c = 1; c < 3; c++) {
+				for (y = 0; y < 8; y++)
+					for (x = 0; x < 8; x++) {
+						int o = (my * 16 + y * 2) * width +
+							mx * 16 + x * 2;
+
+						block[y * 8 + x] = (ycc[c][o] +
+							ycc[c][o + 1] +
+							ycc[c][o + width] +
+							ycc[c][o + width + 1]) / 4;
+					}
+				encode_block(block, 1, &pred[c]);
+			}
+		}
+
+	flush_bits();
+	put_word(0xffd9);
+
+	return out - jpeg;
+}
+
+static void encode_image(const struct image *img)
+{
+	make_picture(img->pattern, img->width, img->height);
+	encode(img->width, img->height, img->quant_step, img->restart);
+}
+
+/**************** Checks ****************/
+
+static uint32_t fnv1a(const unsigned char *p, int len)
+{
+	uint32_t h = 0x811c9dc5;
+
+	while (len--)
+		h = (h ^ *p++) * 0x01000193;
+	return h;
+}
+
+/* Decode into a buffer with a larger pitch, the padding must stay as is. */
+static uint32_t decode(const struct image *img, int depth, int scale)
+{
+	int w = img->width >> scale, h = img->height >> scale;
+	int line = w * depth / 8, pitch = line + 16;
+	int ret, x, y;
+
+	memset(pic, 0xaa, sizeof(pic));
+	ret = jpeg_decode_scaled(jpeg, pic, img->width, img->height, depth,
+				 pitch, scale, &decdata);
+	check(ret == 0, "%s: %d bpp, scale %d: error %d", img->name, depth,
+	      scale, ret);
+
+	for (y = 0; y < h; y++) {
+		for (x = line; x < pitch; x++)
+			if (pic[y * pitch + x] != 0xaa)
+				break;
+		check(x == pitch, "%s: %d bpp, scale %d: line %d overrun",
+		      img->name, depth, scale, y);
+		memmove(pic + y * line, pic + y * pitch, line);
+	}
+	check(pic[h * pitch] == 0xaa, "%s: %d bpp, scale %d: overrun",
+	      img->name, depth, scale);
+
+	return fnv1a(pic, h * line);
+}
+
+/* The full size 24 bpp output must be close to the picture it came from. */
+static void check_fidelity(const struct image *img)
+{
+	int n = img->width * img->height * 3;
+	long total = 0;
+	int i;
+
+	decode(img, 24, 0);
+	for (i = 0; i < n; i++)
+		total += abs(pic[i] - rgb[i]);
+
+	check(total / n <= img->max_error, "%s: mean error %ld", img->name,
+	      total / n);
+}
+
+/* Each scaled pixel must be close to the average of the full size box. */
+static void check_scaled(const struct image *img, int scale)
+{
+	int n = 1 << scale;
+	int w = img->width >> scale, h = img->height >> scale;
+	long total = 0;
+	int x, y, c, i, j;
+
+	decode(img, 32, 0);
+	memcpy(full, pic, img->width * img->height * 4);
+	decode(img, 32, scale);
+
+	for (y = 0; y < h; y++)
+		for (x = 0; x < w; x++)
+			for (c = 0; c < 3; c++) {
+				int sum = 0;
+
+				for (j = 0; j < n; j++)
+					for (i = 0; i < n; i++)
+						sum += full[((y * n + j) *
+							img->width + x * n + i) *
+							4 + c];
+				total += abs(pic[(y * w + x) * 4 + c] -
+					     sum / (n * n));
+			}
+
+	check(total / (w * h * 3) <= 2, "%s: scale %d: mean error %ld",
+	      img->name, scale, total / (w * h * 3));
+}
+
+static void test_images(void)
+{
+	static const int depths[] = { 16, 24, 32 };
+	int i, d, s;
+
+	for (i = 0; i < ARRAY_SIZE(images); i++) {
+		const struct image *img = &images[i];
+		uint32_t sum;
+
+		encode_image(img);
+
+		for (d = 0; d < ARRAY_SIZE(depths); d++) {
+			sum = decode(img, depths[d], 0);
+			check(sum == img->sum[d], "%s: %d bpp: sum %#x, "
+			      "expected %#x", img->name, depths[d], sum,
+			      img->sum[d]);
+		}
+		for (s = 1; s <= 3; s++) {
+			sum = decode(img, 32, s);
+			check(sum == img->scaled_sum[s - 1], "%s: scale %d: "
+			      "sum %#x, expected %#x", img->name, s, sum,
+			      img->scaled_sum[s - 1]);
+			check_scaled(img, s);
+		}
+		check_fidelity(img);
+	}
+}
+
+/* A restart interval must not stick to the next image. */
+static void test_restart_reset(void)
+{
+	const struct image *plain = &images[0];
+	uint32_t sum;
+
+	encode_image(&images[3]);
+	decode(&images[3], 32, 0);
+
+	encode_image(plain);
+	sum = decode(plain, 32, 0);
+	check(sum == plain->sum[2], "sum %#x, expected %#x", sum,
+	      plain->sum[2]);
+}
+
+static void test_errors(void)
+{
+	encode_image(&images[0]);
+
+	check(jpeg_decode(jpeg, pic, 64, 48, 8, &decdata) ==
+	      ERR_DEPTH_MISMATCH, "8 bpp accepted");
+	check(jpeg_decode(jpeg, pic, 48, 48, 32, &decdata) ==
+	      ERR_WIDTH_MISMATCH, "wrong width accepted");
+	check(jpeg_decode(jpeg, pic, 64, 64, 32, &decdata) ==
+	      ERR_HEIGHT_MISMATCH, "wrong height accepted");
+	check(jpeg_decode_scaled(jpeg, pic, 64, 48, 32, 256, 4, &decdata) < 0,
+	      "scale 4 accepted");
+	check(jpeg_check_size(jpeg, 64, 48) == 1, "size not recognised");
+	check(jpeg_check_size(jpeg, 64, 32) == 0, "wrong size accepted");
+
+	jpeg[1] = 0;
+	check(jpeg_decode(jpeg, pic, 64, 48, 32, &decdata) == ERR_NO_SOI,
+	      "missing SOI accepted");
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Decode a bootsplash sized picture the way the option ROM code does. */
+static void benchmark(void)
+{
+	static const struct {
+		int depth;
+		int scale;
+	} runs[] = { { 16, 0 }, { 32, 0 }, { 32, 1 }, { 32, 3 } };
+	const int rounds = 10;
+	double start, elapsed;
+	int i, r, ret = 0;
+
+	make_picture(BARS, MAX_WIDTH, MAX_HEIGHT);
+	encode(MAX_WIDTH, MAX_HEIGHT, 4, 0);
+
+	for (r = 0; r < ARRAY_SIZE(runs); r++) {
+		start = now_us();
+		for (i = 0; i < rounds; i++)
+			ret |= jpeg_decode_scaled(jpeg, pic, MAX_WIDTH, MAX_HEIGHT,
+					   runs[r].depth, (MAX_WIDTH >>
+					   runs[r].scale) * runs[r].depth / 8,
+					   runs[r].scale, &decdata);
+		elapsed = (now_us() - start) / rounds;
+		check(ret == 0, "%d bpp, scale %d: error %d", runs[r].depth,
+		      runs[r].scale, ret);
+		printf("jpeg_test: %dx%d, %d bpp, 1/%d: %.1f ms, "
+		       "%.1f Mpixel/s\n", MAX_WIDTH, MAX_HEIGHT, runs[r].depth,
+		       1 << runs[r].scale, elapsed / 1000,
+		       MAX_WIDTH * MAX_HEIGHT / elapsed);
+	}
+}
+
+int main(void)
+{
+	make_zigzag();
+	make_tables();
+
+	test_images();
+	test_restart_reset();
+	test_errors();
+	benchmark();
+
+	printf("jpeg_test: %s\n", errors ? "FAILED" : "passed");
+	return errors != 0;
+}
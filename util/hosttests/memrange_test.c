@@ -0,0 +1,298 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <memrange.h>
+
+/*
+ * The model keeps one tag per 4KiB page of a 16MiB window that straddles
+ * 4GiB. Both the list code and the plain rescanning one it replaced give the
+ * same maps as the model.
+ */
+#define PAGE		4096ULL
+#define NUM_PAGES	4096
+#define WINDOW		(4ULL * 1024 * 1024 * 1024 - NUM_PAGES / 2 * PAGE)
+#define NO_TAG		(~0UL)
+#define NUM_TAGS	4
+#define MAX_RESOURCES	320
+#define MAX_ERRORS	20
+
+static int errors;
+
+#define check(cond, ...) do {						\
+		if (!(cond)) {						\
+			printf("%s: ", __func__);			\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			if (++errors == MAX_ERRORS)			\
+				exit(1);				\
+		}							\
+	} while (0)
+
+static unsigned long model[NUM_PAGES];
+
+static struct resource resources[MAX_RESOURCES];
+static int num_resources;
+
+/* The device tree is the resources[] array. */
+void search_global_resources(unsigned long type_mask, unsigned long type,
+			     resource_search_t search, void *gp)
+{
+	int i;
+
+	for (i = 0; i < num_resources; i++)
+		if ((resources[i].flags & type_mask) == type)
+			search(gp, NULL, &resources[i]);
+}
+
+/* The pages [base, base + size) touches, the way do_action() rounds. */
+static void page_span(resource_t base, resource_t size, int *first, int *last)
+{
+	*first = (base - WINDOW) / PAGE;
+	*last = (base + size - WINDOW + PAGE - 1) / PAGE;
+}
+
+static void model_set(resource_t base, resource_t size, unsigned long tag)
+{
+	int first, last, i;
+
+	page_span(base, size, &first, &last);
+	for (i = first; i < last; i++)
+		model[i] = tag;
+}
+
+static void model_update_tag(unsigned long old_tag, unsigned long new_tag)
+{
+	int i;
+
+	for (i = 0; i < NUM_PAGES; i++)
+		if (model[i] == old_tag)
+			model[i] = new_tag;
+}
+
+/* Holes are only filled from the first entry on. */
+static void model_fill_holes(int limit, unsigned long tag)
+{
+	int i = 0;
+
+	while (i < NUM_PAGES && model[i] == NO_TAG)
+		i++;
+	for (; i < limit; i++)
+		if (model[i] == NO_TAG)
+			model[i] = tag;
+}
+
+/* The list must be sorted, merged and match the model page by page. */
+static void compare(struct memranges *ranges, const char *op, int round)
+{
+	struct range_entry *r = ranges->entries;
+	int i = 0;
+
+	while (i < NUM_PAGES) {
+		resource_t begin = WINDOW + i * PAGE;
+		unsigned long tag = model[i];
+
+		while (i < NUM_PAGES && model[i] == tag)
+			i++;
+		if (tag == NO_TAG)
+			continue;
+
+		if (r == NULL) {
+			check(0, "round %d, %s: missing %#llx tag %lu", round,
+			      op, (unsigned long long)begin, tag);
+			return;
+		}
+		if (range_entry_base(r) != begin ||
+		    range_entry_end(r) != WINDOW + i * PAGE ||
+		    range_entry_tag(r) != tag) {
+			check(0, "round %d, %s: got [%#llx, %#llx) tag %lu, "
+			      "wanted [%#llx, %#llx) tag %lu", round, op,
+			      (unsigned long long)range_entry_base(r),
+			      (unsigned long long)range_entry_end(r),
+			      range_entry_tag(r), (unsigned long long)begin,
+			      (unsigned long long)(WINDOW + i * PAGE), tag);
+			return;
+		}
+		r = memranges_next_entry(ranges, r);
+	}
+
+	check(r == NULL, "round %d, %s: extra entry at %#llx", round, op,
+	      r ? (unsigned long long)range_entry_base(r) : 0);
+}
+
+/* A random range inside the window, not always page aligned. */
+static void random_range(resource_t *base, resource_t *size)
+{
+	int page = rand() % NUM_PAGES;
+	int pages = 1 + rand() % (rand() % 4 ? 16 : 512);
+
+	if (page + pages > NUM_PAGES)
+		pages = NUM_PAGES - page;
+	*base = WINDOW + page * PAGE;
+	*size = pages * PAGE;
+
+	if (rand() % 4 == 0) {
+		resource_t skew = rand() % PAGE;
+
+		*base += skew;
+		*size -= skew + rand() % (PAGE - skew);
+		if (*size == 0)
+			*size = 1;
+	}
+}
+
+static void add_random_resources(void)
+{
+	int i;
+
+	num_resources = 20 + rand() % (MAX_RESOURCES - 20);
+	for (i = 0; i < num_resources; i++) {
+		random_range(&resources[i].base, &resources[i].size);
+		resources[i].flags = rand() % 8 ? IORESOURCE_MEM : 0;
+		if (rand() % 16 == 0)
+			resources[i].size = 0;
+	}
+}
+
+static void model_add_resources(unsigned long tag)
+{
+	int i;
+
+	for (i = 0; i < num_resources; i++)
+		if (resources[i].flags & IORESOURCE_MEM && resources[i].size)
+			model_set(resources[i].base, resources[i].size, tag);
+}
+
+static void test_random(void)
+{
+	int round, op, i;
+
+	for (round = 0; round < 3000; round++) {
+		struct memranges ranges;
+		unsigned long tag = rand() % NUM_TAGS;
+		unsigned long old_tag;
+
+		add_random_resources();
+		for (i = 0; i < NUM_PAGES; i++)
+			model[i] = NO_TAG;
+
+		memranges_init(&ranges, IORESOURCE_MEM, IORESOURCE_MEM, tag);
+		model_add_resources(tag);
+		compare(&ranges, "init", round);
+
+		for (op = 0; op < 40; op++) {
+			resource_t base, size;
+			int limit;
+
+			tag = rand() % NUM_TAGS;
+			switch (rand() % 8) {
+			case 0:
+				random_range(&base, &size);
+				memranges_create_hole(&ranges, base, size);
+				model_set(base, size, NO_TAG);
+				compare(&ranges, "hole", round);
+				break;
+			case 1:
+				old_tag = rand() % NUM_TAGS;
+				memranges_update_tag(&ranges, old_tag, tag);
+				model_update_tag(old_tag, tag);
+				compare(&ranges, "update tag", round);
+				break;
+			case 2:
+				/* A limit no entry straddles. */
+				limit = NUM_PAGES;
+				for (i = rand() % NUM_PAGES; i < NUM_PAGES; i++)
+					if (model[i] == NO_TAG) {
+						limit = i;
+						break;
+					}
+				memranges_fill_holes_up_to(&ranges,
+						WINDOW + limit * PAGE, tag);
+				model_fill_holes(limit, tag);
+				compare(&ranges, "fill", round);
+				break;
+			case 3:
+				add_random_resources();
+				memranges_add_resources(&ranges, IORESOURCE_MEM,
+							IORESOURCE_MEM, tag);
+				model_add_resources(tag);
+				compare(&ranges, "add resources", round);
+				break;
+			default:
+				random_range(&base, &size);
+				memranges_insert(&ranges, base, size, tag);
+				model_set(base, size, tag);
+				compare(&ranges, "insert", round);
+			}
+		}
+
+		memranges_teardown(&ranges);
+		check(ranges.entries == NULL, "entries left after teardown");
+	}
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* How long building a map from the resources takes. */
+static void benchmark(const char *name, int sorted)
+{
+	const int rounds = 2000;
+	double start, elapsed;
+	int i;
+
+	num_resources = MAX_RESOURCES;
+	for (i = 0; i < num_resources; i++) {
+		resources[i].base = WINDOW + (sorted ? i * 8 : rand() %
+					      NUM_PAGES) * PAGE;
+		resources[i].size = (1 + rand() % 8) * PAGE;
+		resources[i].flags = IORESOURCE_MEM;
+	}
+
+	start = now_us();
+	for (i = 0; i < rounds; i++) {
+		struct memranges ranges;
+
+		memranges_init(&ranges, IORESOURCE_MEM, IORESOURCE_MEM, 0);
+		memranges_fill_holes_up_to(&ranges, WINDOW + NUM_PAGES * PAGE,
+					   1);
+		memranges_teardown(&ranges);
+	}
+	elapsed = now_us() - start;
+
+	printf("memrange_test: %d %s resources: %.1f us per map\n",
+	       num_resources, name, elapsed / rounds);
+}
+
+int main(void)
+{
+	srand(1);
+
+	test_random();
+	benchmark("sorted", 1);
+	benchmark("random", 0);
+
+	printf("memrange_test: %s\n", errors ? "FAILED" : "passed");
+	return errors != 0;
+}
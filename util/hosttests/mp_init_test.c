@@ -0,0 +1,355 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* The AP state is static, so build the MP code into the test. */
+#include "../../src/cpu/x86/mp_init.c"
+
+#define NUM_APS		(CONFIG_MAX_CPUS - 1)
+#define NUM_WORK	4000
+#define MAX_ERRORS	20
+
+static int errors;
+
+#define check(cond, ...) do {						\
+		if (!(cond)) {						\
+			printf("%s: ", __func__);			\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			if (++errors == MAX_ERRORS)			\
+				exit(1);				\
+		}							\
+	} while (0)
+
+/* Every cpu is a host thread, the BSP is the main thread. */
+static __thread struct cpu_info host_cpu_info;
+static pthread_t ap_threads[CONFIG_MAX_CPUS];
+
+struct cpu_info *cpu_info(void)
+{
+	return &host_cpu_info;
+}
+
+void stop_this_cpu(void)
+{
+	pthread_exit(NULL);
+}
+
+/* Time is counted in calls, each lets the AP threads run. */
+void udelay(unsigned usecs)
+{
+	sched_yield();
+}
+
+void mdelay(unsigned msecs)
+{
+	sched_yield();
+}
+
+/* The tests start the APs themselves, so the bring-up path is not run. */
+char gdt[1], gdt_end[1], idtarg[1];
+unsigned char _estack[1];
+
+msr_t rdmsr(unsigned int index)
+{
+	msr_t msr = { 0, 0 };
+	return msr;
+}
+
+void wrmsr(unsigned int index, msr_t msr)
+{
+}
+
+void enable_lapic(void)
+{
+}
+
+unsigned long lapicid(void)
+{
+	return 0;
+}
+
+unsigned long lapic_read(unsigned long reg)
+{
+	return 0;
+}
+
+void lapic_write_around(unsigned long reg, unsigned long v)
+{
+}
+
+int rmodule_parse(void *ptr, struct rmodule *m)
+{
+	return -1;
+}
+
+void *rmodule_parameters(const struct rmodule *m)
+{
+	return NULL;
+}
+
+int rmodule_entry_offset(const struct rmodule *m)
+{
+	return -1;
+}
+
+int rmodule_memory_size(const struct rmodule *m)
+{
+	return 0;
+}
+
+int rmodule_load(void *loc, struct rmodule *m)
+{
+	return -1;
+}
+
+int rmodule_load_alignment(const struct rmodule *m)
+{
+	return 0;
+}
+
+struct device *alloc_find_dev(struct bus *parent, struct device_path *path)
+{
+	return NULL;
+}
+
+void dev_index_path(struct device *dev)
+{
+}
+
+void cpu_initialize(unsigned int cpu_index)
+{
+}
+
+void fill_processor_name(char *processor_name)
+{
+}
+
+static void *ap_thread(void *arg)
+{
+	host_cpu_info.index = (long)arg;
+	ap_wait_for_instruction();
+	return NULL;
+}
+
+/* Start the APs the way ap_init() leaves them once the flight plan is done. */
+static void start_ap_threads(void)
+{
+	long i;
+
+	host_cpu_info.index = 0;
+	for (i = 1; i <= NUM_APS; i++)
+		pthread_create(&ap_threads[i], NULL, ap_thread, (void *)i);
+	num_aps_started = NUM_APS;
+}
+
+/* How often each cpu ran a callback. */
+static atomic_t runs[CONFIG_MAX_CPUS];
+
+static void clear_runs(void)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_MAX_CPUS; i++)
+		atomic_set(&runs[i], 0);
+}
+
+static int total_runs(void)
+{
+	int i, total = 0;
+
+	for (i = 0; i < CONFIG_MAX_CPUS; i++)
+		total += atomic_read(&runs[i]);
+	return total;
+}
+
+static void count_run(void *unused)
+{
+	atomic_inc(&runs[cpu_index()]);
+}
+
+/* Slow enough that the caller would notice returning early. */
+static void count_slow_run(void *unused)
+{
+	usleep(2000);
+	count_run(NULL);
+}
+
+/* Waits for the callbacks that mp_run_on_aps() doesn't wait for. */
+static void wait_for_runs(int target)
+{
+	int i;
+
+	for (i = 0; i < 1000000 && total_runs() < target; i++)
+		sched_yield();
+}
+
+static void test_run_on_aps(void)
+{
+	int i;
+
+	clear_runs();
+	check(mp_run_on_aps(count_run, NULL, 0) == NUM_APS,
+	      "not every AP took the callback");
+	wait_for_runs(NUM_APS);
+
+	check(atomic_read(&runs[0]) == 0, "the BSP ran the callback");
+	for (i = 1; i <= NUM_APS; i++)
+		check(atomic_read(&runs[i]) == 1, "AP %d ran it %d times", i,
+		      atomic_read(&runs[i]));
+}
+
+static void test_all_cpus(void)
+{
+	int i;
+
+	clear_runs();
+	check(mp_run_on_all_cpus(count_slow_run, NULL, 0) == 0,
+	      "call failed");
+
+	/* Every cpu must have finished before the call returned. */
+	for (i = 0; i < CONFIG_MAX_CPUS; i++)
+		check(atomic_read(&runs[i]) == 1, "cpu %d ran it %d times", i,
+		      atomic_read(&runs[i]));
+}
+
+static atomic_t hits[NUM_WORK];
+
+static void work_item(void *arg)
+{
+	atomic_t *hit = arg;
+
+	if ((hit - hits) % 100 == 0)
+		usleep(100);
+	atomic_inc(hit);
+	count_run(NULL);
+}
+
+static void test_work(void)
+{
+	static struct mp_work work[NUM_WORK];
+	int counts[] = { 0, 1, NUM_APS, NUM_WORK };
+	int busy_cpus;
+	int i, j;
+
+	for (i = 0; i < NUM_WORK; i++) {
+		work[i].func = work_item;
+		work[i].arg = &hits[i];
+	}
+
+	for (j = 0; j < ARRAY_SIZE(counts); j++) {
+		for (i = 0; i < NUM_WORK; i++)
+			atomic_set(&hits[i], 0);
+		clear_runs();
+
+		check(mp_run_work(work, counts[j], 0) == 0,
+		      "%d items: call failed", counts[j]);
+
+		for (i = 0; i < NUM_WORK; i++)
+			check(atomic_read(&hits[i]) == (i < counts[j]),
+			      "%d items: item %d ran %d times", counts[j], i,
+			      atomic_read(&hits[i]));
+	}
+
+	/* The last round was long enough to be shared out. */
+	busy_cpus = 0;
+	for (i = 0; i < CONFIG_MAX_CPUS; i++)
+		busy_cpus += atomic_read(&runs[i]) != 0;
+	check(busy_cpus > 1, "only %d cpu took work", busy_cpus);
+}
+
+/* Keeps AP 1 busy until released. */
+static volatile int ap1_released;
+
+static void hold_ap1(void *unused)
+{
+	count_run(NULL);
+	if (cpu_index() == 1)
+		while (!ap1_released)
+			sched_yield();
+}
+
+static void test_expired(void)
+{
+	int i;
+
+	/* AP 1 is stuck in a callback, so it can't take the next one. */
+	ap1_released = 0;
+	clear_runs();
+	check(mp_run_on_aps(hold_ap1, NULL, 0) == NUM_APS,
+	      "not every AP took the callback");
+	wait_for_runs(NUM_APS);
+
+	clear_runs();
+	check(mp_run_on_aps(count_run, NULL, 100) < 0,
+	      "the call did not expire");
+	wait_for_runs(NUM_APS - 1);
+	ap1_released = 1;
+
+	/* The work was retracted from AP 1, it must never run it. */
+	clear_runs();
+	check(mp_run_on_all_cpus(count_run, NULL, 0) == 0, "call failed");
+	check(atomic_read(&runs[1]) == 1, "AP 1 ran %d callbacks",
+	      atomic_read(&runs[1]));
+
+	/* An expired call must be waited for by the next one. */
+	ap1_released = 0;
+	clear_runs();
+	check(mp_run_on_all_cpus(hold_ap1, NULL, 100) < 0,
+	      "the call did not expire");
+	check(mp_run_work(NULL, 0, 100) < 0,
+	      "the next call did not wait for AP 1");
+	ap1_released = 1;
+
+	clear_runs();
+	check(mp_run_on_all_cpus(count_run, NULL, 0) == 0, "call failed");
+	for (i = 0; i < CONFIG_MAX_CPUS; i++)
+		check(atomic_read(&runs[i]) == 1, "cpu %d ran it %d times", i,
+		      atomic_read(&runs[i]));
+}
+
+/* The payload boot entry must leave every AP parked. */
+static void test_park(void)
+{
+	int i;
+
+	mp_park_bscb[0].callback(mp_park_bscb[0].arg);
+
+	check(atomic_read(&aps_parked) == NUM_APS, "%d of %d APs parked",
+	      atomic_read(&aps_parked), NUM_APS);
+	for (i = 1; i <= NUM_APS; i++)
+		pthread_join(ap_threads[i], NULL);
+}
+
+int main(void)
+{
+	start_ap_threads();
+
+	test_run_on_aps();
+	test_all_cpus();
+	test_work();
+	test_expired();
+	test_park();
+
+	printf("mp_init_test: %s\n", errors ? "FAILED" : "passed");
+	return errors != 0;
+}
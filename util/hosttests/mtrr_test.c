@@ -0,0 +1,340 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+
+/* The solver is static, so build it into the test. */
+#include "../../src/cpu/x86/mtrr/mtrr.c"
+
+#define ADDRESS_BITS	36
+#define MiB		(1ULL << 20)
+#define GiB		(1ULL << 30)
+#define MAX_POINTS	256
+#define MAX_ERRORS	20
+
+static int errors;
+
+#define check(cond, ...) do {						\
+		if (!(cond)) {						\
+			printf("%s: ", __func__);			\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			if (++errors == MAX_ERRORS)			\
+				exit(1);				\
+		}							\
+	} while (0)
+
+/* The solver never touches the hardware or the device tree. */
+msr_t rdmsr(unsigned int index)
+{
+	msr_t msr = { 0, 0 };
+	return msr;
+}
+
+void wrmsr(unsigned int index, msr_t msr)
+{
+}
+
+int cpu_phys_address_size(void)
+{
+	return ADDRESS_BITS;
+}
+
+void search_global_resources(unsigned long type_mask, unsigned long type,
+			     resource_search_t search, void *gp)
+{
+}
+
+struct layout_range {
+	uint64_t base;
+	uint64_t size;
+	int type;
+};
+
+/* Legacy memory below 1MiB, which the fixed MTRRs take care of. */
+#define LOW_MEM \
+	{ 0, 0xa0000, MTRR_TYPE_WRBACK }, \
+	{ 0xa0000, 0x20000, MTRR_TYPE_UNCACHEABLE }, \
+	{ 0xc0000, 0x40000, MTRR_TYPE_WRBACK }
+
+static const struct {
+	const char *name;
+	int above4gb;
+	/* Variable MTRRs needed with UC as the default type. */
+	int uc_count;
+	struct layout_range r[8];
+} layouts[] = {
+	{ "hole up to 4GiB", 0, 3, {
+		LOW_MEM,
+		{ 1 * MiB, 0xd0000000 - 1 * MiB, MTRR_TYPE_WRBACK } } },
+	{ "odd top of memory", 0, 3, {
+		LOW_MEM,
+		{ 1 * MiB, 0xdf800000 - 1 * MiB, MTRR_TYPE_WRBACK } } },
+	{ "stolen memory", 0, 3, {
+		LOW_MEM,
+		{ 1 * MiB, 0x7f000000 - 1 * MiB, MTRR_TYPE_WRBACK },
+		{ 0x7f000000, 16 * MiB, MTRR_TYPE_UNCACHEABLE },
+		{ 2 * GiB, 1 * GiB, MTRR_TYPE_WRBACK } } },
+	{ "hole below", 0, 3, {
+		LOW_MEM,
+		{ 1 * MiB, 512 * MiB - 1 * MiB, MTRR_TYPE_WRBACK },
+		{ 512 * MiB, 1 * MiB, MTRR_TYPE_UNCACHEABLE },
+		{ 513 * MiB, 511 * MiB, MTRR_TYPE_WRBACK } } },
+	{ "write combining", 0, 5, {
+		LOW_MEM,
+		{ 1 * MiB, 0xdf800000 - 1 * MiB, MTRR_TYPE_WRBACK },
+		{ 0xe0000000, 256 * MiB, MTRR_TYPE_WRCOMB } } },
+	{ "above 4GiB", 1, 3, {
+		LOW_MEM,
+		{ 1 * MiB, 3 * GiB - 1 * MiB, MTRR_TYPE_WRBACK },
+		{ 4 * GiB, 1 * GiB, MTRR_TYPE_WRBACK } } },
+};
+
+static const char *type_name(int type)
+{
+	switch (type) {
+	case MTRR_TYPE_UNCACHEABLE:
+		return "UC";
+	case MTRR_TYPE_WRCOMB:
+		return "WC";
+	case MTRR_TYPE_WRBACK:
+		return "WB";
+	default:
+		return "undefined";
+	}
+}
+
+/* Fill the address space the way get_physical_address_space() does. */
+static void fill_holes(struct memranges *ranges)
+{
+	memranges_fill_holes_up_to(ranges, RANGE_TO_PHYS_ADDR(RANGE_4GB),
+				   MTRR_TYPE_UNCACHEABLE);
+}
+
+static uint64_t msr_value(msr_t msr)
+{
+	return ((uint64_t)msr.hi << 32 | msr.lo) & ~0xfffULL;
+}
+
+/* The memory type the processor uses for addr, -1 if it is undefined. */
+static int effective_type(const struct var_mtrr_solution *sol, uint64_t addr)
+{
+	int type = -1;
+	int i;
+
+	for (i = 0; i < sol->num_used; i++) {
+		uint64_t base = msr_value(sol->regs[i].base);
+		uint64_t mask = msr_value(sol->regs[i].mask);
+		int t = sol->regs[i].base.lo & 0xff;
+
+		if ((addr & mask) != (base & mask))
+			continue;
+		if (t == MTRR_TYPE_UNCACHEABLE)
+			return t;
+		if (type >= 0 && type != t)
+			return -1;
+		type = t;
+	}
+
+	return type < 0 ? sol->mtrr_default_type : type;
+}
+
+/* The memory type the address space asks for, -1 if it has no say. */
+static int wanted_type(struct memranges *ranges, uint64_t addr)
+{
+	struct range_entry *r;
+
+	memranges_each_entry(r, ranges)
+		if (addr >= range_entry_base(r) && addr < range_entry_end(r))
+			return range_entry_mtrr_type(r);
+	return -1;
+}
+
+static void add_point(uint64_t *points, int *n, uint64_t addr)
+{
+	if (*n < MAX_POINTS)
+		points[(*n)++] = addr;
+	else
+		check(0, "too many points");
+}
+
+/*
+ * Check every address from 1MiB up. The types only change at range and
+ * MTRR boundaries, so it's enough to look at those.
+ */
+static void verify(const char *name, struct memranges *ranges, int above4gb,
+		   const struct var_mtrr_solution *sol)
+{
+	uint64_t points[MAX_POINTS];
+	uint64_t limit = above4gb ? 1ULL << ADDRESS_BITS : 4 * GiB;
+	struct range_entry *r;
+	int n = 0;
+	int i;
+
+	/* Layouts that don't fit are only counted. */
+	if (sol->num_used > total_mtrrs)
+		return;
+
+	memranges_each_entry(r, ranges) {
+		add_point(points, &n, range_entry_base(r));
+		add_point(points, &n, range_entry_end(r));
+	}
+	for (i = 0; i < sol->num_used; i++) {
+		uint64_t base = msr_value(sol->regs[i].base);
+		uint64_t mask = msr_value(sol->regs[i].mask);
+
+		add_point(points, &n, base);
+		add_point(points, &n, base + (~mask &
+					((1ULL << ADDRESS_BITS) - 1)) + 1);
+	}
+
+	for (i = 0; i < n; i++) {
+		uint64_t addr = points[i];
+		int want;
+		int got;
+
+		if (addr < 1 * MiB || addr >= limit)
+			continue;
+		want = wanted_type(ranges, addr);
+		if (want < 0)
+			continue;
+		got = effective_type(sol, addr);
+		check(got == want, "%s: default %s, %#llx is %s, wanted %s",
+		      name, type_name(sol->mtrr_default_type),
+		      (unsigned long long)addr, type_name(got),
+		      type_name(want));
+	}
+}
+
+/*
+ * Solve the address space and check the solution the solver picks as well
+ * as the one with UC as the default type, which is where the holes are
+ * used. Returns the number of MTRRs the latter needs.
+ */
+static int solve(const char *name, struct memranges *ranges, int above4gb)
+{
+	struct var_mtrr_solution sol;
+
+	sol.mtrr_default_type = calc_var_mtrrs(ranges, above4gb,
+					       ADDRESS_BITS);
+	prepare_var_mtrrs(ranges, sol.mtrr_default_type, above4gb,
+			  ADDRESS_BITS, &sol);
+	verify(name, ranges, above4gb, &sol);
+
+	sol.mtrr_default_type = MTRR_TYPE_UNCACHEABLE;
+	prepare_var_mtrrs(ranges, sol.mtrr_default_type, above4gb,
+			  ADDRESS_BITS, &sol);
+	verify(name, ranges, above4gb, &sol);
+
+	return sol.num_used;
+}
+
+static void test_layouts(void)
+{
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(layouts); i++) {
+		struct memranges ranges = { NULL, NULL };
+		int count;
+
+		for (j = 0; j < ARRAY_SIZE(layouts[i].r); j++) {
+			const struct layout_range *lr = &layouts[i].r[j];
+
+			if (lr->size)
+				memranges_insert(&ranges, lr->base, lr->size,
+						 lr->type);
+		}
+		fill_holes(&ranges);
+
+		count = solve(layouts[i].name, &ranges, layouts[i].above4gb);
+		check(count == layouts[i].uc_count,
+		      "%s: %d MTRRs with UC default, expected %d",
+		      layouts[i].name, count, layouts[i].uc_count);
+
+		memranges_teardown(&ranges);
+	}
+}
+
+/* Random layouts of WB, UC and WC ranges, with all MTRRs available. */
+static void test_random(void)
+{
+	int checked = 0;
+	int i;
+
+	total_mtrrs = NUM_MTRR_STATIC_STORAGE;
+	bios_mtrrs = total_mtrrs - OS_MTRRS;
+
+	for (i = 0; i < 2000; i++) {
+		struct memranges ranges = { NULL, NULL };
+		int above4gb = rand() % 2;
+		uint64_t top = 4 * GiB + (above4gb ? (rand() % 4096) * MiB : 0);
+		uint64_t base = 0;
+		char name[32];
+		int count = 0;
+
+		while (base < top && count < 8) {
+			uint64_t size;
+			int type;
+
+			if (rand() % 2)
+				size = (1ULL << (rand() % 12)) * MiB;
+			else
+				size = (rand() % 1024 + 1) * MiB;
+			if (size > top - base)
+				size = top - base;
+
+			switch (rand() % 8) {
+			case 0:
+				type = MTRR_TYPE_WRCOMB;
+				break;
+			case 1:
+			case 2:
+			case 3:
+				type = MTRR_TYPE_UNCACHEABLE;
+				break;
+			default:
+				type = MTRR_TYPE_WRBACK;
+			}
+
+			memranges_insert(&ranges, base, size, type);
+			base += size;
+			count++;
+		}
+		fill_holes(&ranges);
+
+		snprintf(name, sizeof(name), "random %d", i);
+		if (solve(name, &ranges, above4gb) <= total_mtrrs)
+			checked++;
+
+		memranges_teardown(&ranges);
+	}
+	check(checked >= 1000, "only %d of %d layouts fit", checked, i);
+
+	total_mtrrs = MTRRS;
+	bios_mtrrs = BIOS_MTRRS;
+}
+
+int main(void)
+{
+	srand(1);
+
+	test_layouts();
+	test_random();
+
+	printf("mtrr_test: %s\n", errors ? "FAILED" : "passed");
+	return errors != 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <spi_flash.h>
+
+#define CHIP_SIZE	(64 * 1024)
+#define SECTOR_SIZE	4096
+#define PAGE_SIZE	256
+#define MAX_ERRORS	20
+
+static int errors;
+
+/* A NOR chip: programming only clears bits and never crosses a page. */
+static u8 chip[CHIP_SIZE];
+
+static struct {
+	unsigned int reads;
+	unsigned int writes;
+	unsigned int erase_calls;
+	unsigned int erased;	/* Bytes. */
+} ops;
+
+#define check(cond, ...) do {						\
+		if (!(cond)) {						\
+			printf("%s: ", __func__);			\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			if (++errors == MAX_ERRORS)			\
+				exit(1);				\
+		}							\
+	} while (0)
+
+static int chip_read(struct spi_flash *flash, u32 offset, size_t len,
+		     void *buf)
+{
+	check(offset + len <= CHIP_SIZE, "read past the end at %#x", offset);
+	memcpy(buf, chip + offset, len);
+	ops.reads++;
+	return 0;
+}
+
+static int chip_write(struct spi_flash *flash, u32 offset, size_t len,
+		      const void *buf)
+{
+	const u8 *data = buf;
+	size_t i;
+
+	check(offset + len <= CHIP_SIZE, "write past the end at %#x", offset);
+	check(offset / PAGE_SIZE == (offset + len - 1) / PAGE_SIZE,
+	      "write of %zu bytes at %#x crosses a page", len, offset);
+	for (i = 0; i < len; i++) {
+		check((chip[offset + i] & data[i]) == data[i],
+		      "write sets bits at %#zx", offset + i);
+		chip[offset + i] &= data[i];
+	}
+	ops.writes++;
+	return 0;
+}
+
+static int chip_erase(struct spi_flash *flash, u32 offset, size_t len)
+{
+	check(offset % SECTOR_SIZE == 0 && len % SECTOR_SIZE == 0,
+	      "unaligned erase of %zu bytes at %#x", len, offset);
+	check(offset + len <= CHIP_SIZE, "erase past the end at %#x", offset);
+	memset(chip + offset, 0xff, len);
+	ops.erase_calls++;
+	ops.erased += len;
+	return 0;
+}
+
+static struct spi_flash flash = {
+	.name = "simulated",
+	.size = CHIP_SIZE,
+	.sector_size = SECTOR_SIZE,
+	.read = chip_read,
+	.write = chip_write,
+	.erase = chip_erase,
+};
+
+/* What the chip has to hold after each update. */
+static u8 expect[CHIP_SIZE];
+
+static void fill_random(u8 *buf, size_t len)
+{
+	while (len--)
+		*buf++ = rand();
+}
+
+static void reset(void)
+{
+	fill_random(chip, sizeof(chip));
+	memcpy(expect, chip, sizeof(chip));
+	memset(&ops, 0, sizeof(ops));
+}
+
+static void update(u32 offset, size_t len, const u8 *data)
+{
+	memcpy(expect + offset, data, len);
+	check(spi_flash_update(&flash, offset, len, data) == 0,
+	      "update of %zu bytes at %#x failed", len, offset);
+	check(!memcmp(chip, expect, sizeof(chip)),
+	      "chip contents wrong after %zu bytes at %#x", len, offset);
+}
+
+static void test_same(void)
+{
+	reset();
+	update(1000, 10000, chip + 1000);
+	check(ops.writes == 0 && ops.erase_calls == 0,
+	      "%u writes and %u erases for unchanged data", ops.writes,
+	      ops.erase_calls);
+}
+
+static void test_program_only(void)
+{
+	u8 data[3 * PAGE_SIZE];
+
+	reset();
+	memcpy(data, chip + 2 * PAGE_SIZE, sizeof(data));
+	/* Only clear bits, and only in the middle page. */
+	data[PAGE_SIZE + 7] &= 0x0f;
+	data[PAGE_SIZE + 9] = 0;
+	update(2 * PAGE_SIZE, sizeof(data), data);
+	check(ops.erase_calls == 0, "%u erases without a bit set",
+	      ops.erase_calls);
+	check(ops.writes == 1, "%u writes for one changed page", ops.writes);
+}
+
+static void test_partial_sector(void)
+{
+	u8 data[100];
+
+	reset();
+	memset(data, 0xff, sizeof(data));
+	update(SECTOR_SIZE + 300, sizeof(data), data);
+	check(ops.erase_calls == 1 && ops.erased == SECTOR_SIZE,
+	      "%u erases of %u bytes for part of a sector", ops.erase_calls,
+	      ops.erased);
+}
+
+static void test_sector_run(void)
+{
+	static u8 data[4 * SECTOR_SIZE];
+
+	reset();
+	memset(data, 0xff, sizeof(data));
+	data[0] = 0;
+	update(2 * SECTOR_SIZE, sizeof(data), data);
+	check(ops.erase_calls == 1 && ops.erased == sizeof(data),
+	      "%u erases of %u bytes for a run of whole sectors",
+	      ops.erase_calls, ops.erased);
+	/* All but the first page were left erased. */
+	check(ops.writes == 1, "%u writes after the erase", ops.writes);
+}
+
+static void test_random(void)
+{
+	static u8 data[CHIP_SIZE];
+	u32 offset;
+	size_t len;
+	int i, j;
+
+	reset();
+	for (i = 0; i < 2000; i++) {
+		offset = rand() % CHIP_SIZE;
+		len = 1 + rand() % (CHIP_SIZE - offset);
+		if (rand() % 2)
+			len = 1 + len % (2 * SECTOR_SIZE);
+		memcpy(data, chip + offset, len);
+
+		/* Mix changes that need an erase and ones that don't. */
+		switch (rand() % 4) {
+		case 0:
+			break;
+		case 1:
+			for (j = 0; j < 8; j++)
+				data[rand() % len] &= rand();
+			break;
+		case 2:
+			for (j = 0; j < 8; j++)
+				data[rand() % len] = rand();
+			break;
+		case 3:
+			fill_random(data, len);
+			break;
+		}
+		update(offset, len, data);
+	}
+}
+
+int main(void)
+{
+	srand(1);
+
+	test_same();
+	test_program_only();
+	test_partial_sector();
+	test_sector_run();
+	test_random();
+
+	printf("spi_flash_update_test: %s\n", errors ? "FAILED" : "passed");
+	return errors != 0;
+}
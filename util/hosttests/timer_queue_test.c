@@ -0,0 +1,249 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <timer.h>
+#include <unistd.h>
+
+#define NUM_CALLBACKS	64
+#define MAX_ERRORS	20
+
+static long now;
+static int errors;
+
+static struct test_callback {
+	struct timeout_callback tocb;
+	long due;
+	long fired_at;
+	int pending;
+} callbacks[NUM_CALLBACKS];
+
+/* The due time of the last callback of the current drain. */
+static long last_due;
+
+void timer_monotonic_get(struct mono_time *mt)
+{
+	mono_time_set_usecs(mt, now);
+}
+
+#define check(cond, ...) do {						\
+		if (!(cond)) {						\
+			printf("%s: ", __func__);			\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			if (++errors == MAX_ERRORS)			\
+				exit(1);				\
+		}							\
+	} while (0)
+
+static void fired(struct timeout_callback *tocb)
+{
+	struct test_callback *tc = (struct test_callback *)tocb;
+
+	check(tc->pending, "callback %d called twice", (int)(tc - callbacks));
+	check(now >= tc->due, "callback due at %ld called at %ld", tc->due,
+	      now);
+	check(tc->due >= last_due, "callback due at %ld called after one "
+	      "due at %ld", tc->due, last_due);
+	last_due = tc->due;
+	tc->pending = 0;
+	tc->fired_at = now;
+}
+
+static void schedule(int i, unsigned long us)
+{
+	struct test_callback *tc = &callbacks[i];
+
+	tc->tocb.callback = fired;
+	tc->due = now + us;
+	tc->fired_at = -1;
+	tc->pending = 1;
+	if (timer_sched_callback(&tc->tocb, us)) {
+		check(0, "scheduling %lu us failed", us);
+		tc->pending = 0;
+	}
+}
+
+/* Call everything that is due, then check nothing due was left behind. */
+static void drain(void)
+{
+	int i;
+
+	/* Each run calls one callback at most. */
+	last_due = now - (1L << 30);
+	for (i = 0; i <= NUM_CALLBACKS; i++)
+		if (!timers_run())
+			break;
+
+	for (i = 0; i < NUM_CALLBACKS; i++)
+		check(!callbacks[i].pending || callbacks[i].due > now,
+		      "callback due at %ld not called at %ld",
+		      callbacks[i].due, now);
+}
+
+static int any_pending(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_CALLBACKS; i++)
+		if (callbacks[i].pending)
+			return 1;
+	return 0;
+}
+
+/* Step one microsecond at a time, everything has to go off exactly. */
+static void run_exact(void)
+{
+	long end = now + 1000000;
+	int i;
+
+	for (drain(); any_pending() && now < end; now++, drain())
+		;
+	check(!any_pending(), "callbacks lost");
+
+	for (i = 0; i < NUM_CALLBACKS; i++)
+		check(callbacks[i].fired_at == -1 ||
+		      callbacks[i].fired_at == callbacks[i].due,
+		      "callback due at %ld called at %ld", callbacks[i].due,
+		      callbacks[i].fired_at);
+}
+
+static void reset(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_CALLBACKS; i++)
+		callbacks[i].fired_at = -1;
+}
+
+/* Expirations on, just before and just after the stretches of each level. */
+static void test_boundaries(void)
+{
+	static const long starts[] = {
+		0, 1, 63, 64, 4095, 4096, 4097, 262143, 262144, 1000003,
+	};
+	static const unsigned long delays[] = {
+		0, 1, 62, 63, 64, 65, 127, 128, 4095, 4096, 4097, 8191,
+		262143, 262144, 262145, 300000,
+	};
+	int s, d;
+
+	for (s = 0; s < ARRAY_SIZE(starts); s++) {
+		if (now < starts[s])
+			now = starts[s];
+		reset();
+		for (d = 0; d < ARRAY_SIZE(delays); d++)
+			schedule(d, delays[d]);
+		run_exact();
+	}
+}
+
+/*
+ * A callback landing in the slot of the current stretch of a level, one
+ * round of 64 stretches out, must wait for that round.
+ */
+static void test_slot_reuse(void)
+{
+	/* Level 1: 64us stretches. */
+	now = (now | 4095) + 1 + 100;
+	reset();
+	schedule(0, (((now >> 6) + 64) << 6) + 10 - now);
+	schedule(1, 64 * 64 - 1);
+	run_exact();
+
+	/* Level 2: 4096us stretches. */
+	now = (now | 262143) + 1 + 100000;
+	reset();
+	schedule(0, (((now >> 12) + 64) << 12) + 1000 - now);
+	schedule(1, 262143);
+	schedule(2, 5);
+	run_exact();
+}
+
+/* Time jumps far past everything, it all goes off at once and in order. */
+static void test_jump(void)
+{
+	int i;
+
+	reset();
+	for (i = 0; i < NUM_CALLBACKS; i++)
+		schedule(i, rand() % 2000000);
+	now += 3000000;
+	drain();
+	check(!any_pending(), "callbacks left after the jump");
+}
+
+/* Random timeouts of all lengths against a clock that runs in steps. */
+static void test_random(void)
+{
+	struct mono_time mt;
+	long earliest;
+	int step, i, ret;
+
+	reset();
+	for (step = 0; step < 2000000; step++) {
+		i = rand() % NUM_CALLBACKS;
+		if (rand() % 100 < 3 && !callbacks[i].pending) {
+			switch (rand() % 4) {
+			case 0: schedule(i, rand() % 70); break;
+			case 1: schedule(i, rand() % 5000); break;
+			case 2: schedule(i, rand() % 300000); break;
+			default: schedule(i, rand() % 2000000); break;
+			}
+		}
+
+		i = rand() % 1000;
+		now += i < 900 ? rand() % 3 : i < 995 ? rand() % 200 :
+		       rand() % 100000;
+		drain();
+
+		if (step % 1000)
+			continue;
+
+		/* The next expiration may be early, never late. */
+		earliest = -1;
+		for (i = 0; i < NUM_CALLBACKS; i++)
+			if (callbacks[i].pending && (earliest < 0 ||
+			    callbacks[i].due < earliest))
+				earliest = callbacks[i].due;
+		ret = timer_next_expiration(&mt);
+		check((ret == 0) == (earliest >= 0), "next expiration %d with "
+		      "%s pending", ret, earliest >= 0 ? "callbacks" : "none");
+		if (ret == 0 && earliest >= 0)
+			check(mt.microseconds <= earliest, "next expiration %ld "
+			      "after %ld", mt.microseconds, earliest);
+	}
+
+	now += 3000000;
+	drain();
+}
+
+int main(void)
+{
+	/* A wheel that never catches up with the clock hangs in timers_run(). */
+	alarm(60);
+	srand(1);
+
+	test_boundaries();
+	test_slot_reuse();
+	test_jump();
+	test_random();
+
+	printf("timer_queue_test: %s\n", errors ? "FAILED" : "passed");
+	return errors != 0;
+}
@@ -72,7 +72,8 @@ static void op_write_cmos_layout_header(void);
 static int list_one_param(const char name[], int show_name);
 static int list_all_params(void);
 static void list_param_enums(const char name[]);
-static void set_one_param(const char name[], const char value[]);
+static void prepare_one_param(const char name[], const char value[],
+			      cmos_write_t * item);
 static void set_params(FILE * f);
 static void parse_assignment(char arg[], const char **name, const char **value);
 static int list_cmos_entry(const cmos_entry_t * e, int show_name);
@@ -306,22 +307,40 @@ static void op_cmos_show_all_params(void)
 /****************************************************************************
  * op_cmos_set_one_param
  *
- * -w NAME=VALUE
+ * -w NAME=VALUE [-w NAME=VALUE ...]
  *
- * Set parameter NAME to VALUE.
+ * Set parameter NAME to VALUE.  If -w is given more than once, all of the
+ * assignments are checked before any of them is performed.
  ****************************************************************************/
 static void op_cmos_set_one_param(void)
 {
 	const char *name, *value;
+	cmos_write_t *list, *item, **p;
+	int i;
 
 	get_cmos_layout();
 
-	/* Separate 'NAME=VALUE' syntax into two strings representing NAME and
-	 * VALUE.
-	 */
-	parse_assignment(nvramtool_op.param, &name, &value);
+	list = NULL;
+	p = &list;
+
+	for (i = 0; i < nvramtool_op.num_params; i++) {
+		/* Separate 'NAME=VALUE' syntax into two strings representing
+		 * NAME and VALUE.
+		 */
+		parse_assignment(nvramtool_op.params[i], &name, &value);
+
+		if ((item = (cmos_write_t *) malloc(sizeof(*item))) == NULL)
+			out_of_memory();
+
+		prepare_one_param(name, value, item);
 
-	set_one_param(name, value);
+		/* Append write operation to pending write list. */
+		item->next = NULL;
+		*p = item;
+		p = &item->next;
+	}
+
+	do_cmos_writes(list);
 }
 
 /****************************************************************************
@@ -600,16 +619,18 @@ static void list_param_enums(const char name[])
 }
 
 /****************************************************************************
- * set_one_param
+ * prepare_one_param
  *
- * Set the CMOS parameter given by 'name' to 'value'.  The 'name' parameter
- * is case-sensitive.  If we are setting an enum parameter, then 'value' is
+ * Check that the CMOS parameter given by 'name' can be set to 'value' and
+ * describe the write in 'item'.  Exit with an error message if it can't be
+ * done.  The 'name' parameter is case-sensitive.  If we are setting an enum parameter, then 'value' is
  * interpreted as a case-sensitive string that must match the option name
  * exactly.  If we are setting a 'hex' parameter, then 'value' is treated as
  * a string representation of an unsigned integer that may be specified in
  * decimal, hex, or octal.
  ****************************************************************************/
-static void set_one_param(const char name[], const char value[])
+static void prepare_one_param(const char name[], const char value[],
+			      cmos_write_t * item)
 {
 	const cmos_entry_t *e;
 	unsigned long long n;
@@ -686,15 +707,14 @@ static void set_one_param(const char name[], const char value[])
 		goto fail;
 	}
 
-	/* write the value to nonvolatile RAM */
-	set_iopl(3);
-	cmos_write(e, n);
-	cmos_checksum_write(cmos_checksum_compute());
-	set_iopl(0);
+	item->bit = e->bit;
+	item->length = e->length;
+	item->config = e->config;
+	item->value = n;
 	return;
 
       fail:
-	fprintf(stderr, "  CMOS write not performed.\n");
+	fprintf(stderr, "  No CMOS writes performed.\n");
 	exit(1);
 }
 
@@ -37,6 +37,7 @@ nvramtool_op_modifier_info_t nvramtool_op_modifiers[NVRAMTOOL_NUM_OP_MODIFIERS];
 
 static char *handle_optional_arg(int argc, char *argv[]);
 static void register_op(int *op_found, nvramtool_op_t op, char op_param[]);
+static void add_op_param(char op_param[]);
 static void register_op_modifier(nvramtool_op_modifier_t mod, char mod_param[]);
 static void resolve_op_modifiers(void);
 static void sanity_check_args(void);
@@ -137,6 +138,7 @@ void parse_nvramtool_args(int argc, char *argv[])
 		case 'w':
 			register_op(&op_found, NVRAMTOOL_OP_CMOS_SET_ONE_PARAM,
 				    optarg);
+			add_op_param(optarg);
 			break;
 		case 'x':
 			register_op(&op_found, NVRAMTOOL_OP_SHOW_CMOS_HEX_DUMP,
@@ -216,6 +218,22 @@ static void register_op(int *op_found, nvramtool_op_t op, char op_param[])
 	nvramtool_op.param = op_param;
 }
 
+/****************************************************************************
+ * add_op_param
+ *
+ * Remember one more argument of an operation that may be given repeatedly.
+ ****************************************************************************/
+static void add_op_param(char op_param[])
+{
+	nvramtool_op.params = realloc(nvramtool_op.params,
+				      (nvramtool_op.num_params + 1) *
+				      sizeof(*nvramtool_op.params));
+	if (nvramtool_op.params == NULL)
+		out_of_memory();
+
+	nvramtool_op.params[nvramtool_op.num_params++] = op_param;
+}
+
 /****************************************************************************
  * register_op_modifier
  *
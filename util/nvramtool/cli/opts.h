@@ -56,6 +56,9 @@ typedef enum { NVRAMTOOL_OP_SHOW_VERSION = 0,
 typedef struct {
 	nvramtool_op_t op;
 	char *param;
+	/* all arguments of an operation that may be given repeatedly (-w) */
+	int num_params;
+	char **params;
 } nvramtool_op_info_t;
 
 typedef enum { NVRAMTOOL_MOD_SHOW_VALUE_ONLY = 0,
@@ -46,6 +46,13 @@ static cmos_access_t *current_access =
 	&memory_hal;
 #endif
 
+/* Snapshot of CMOS memory, see cmos_cache_begin(). */
+static struct {
+	int active;
+	unsigned char data[CMOS_SIZE];
+	unsigned char saved[CMOS_SIZE];
+} cmos_cache;
+
 void select_hal(hal_t hal, void *data)
 {
 	switch(hal) {
@@ -214,6 +221,9 @@ void cmos_write(const cmos_entry_t * e, unsigned long long value)
  ****************************************************************************/
 unsigned char cmos_read_byte(unsigned index)
 {
+	if (cmos_cache.active)
+		return cmos_cache.data[index];
+
 	return current_access->read(index);
 }
 
@@ -229,9 +239,60 @@ unsigned char cmos_read_byte(unsigned index)
  ****************************************************************************/
 void cmos_write_byte(unsigned index, unsigned char value)
 {
+	if (cmos_cache.active) {
+		cmos_cache.data[index] = value;
+		return;
+	}
+
 	current_access->write(index, value);
 }
 
+/****************************************************************************
+ * cmos_cache_begin
+ *
+ * Read all of CMOS memory outside the real time clock area in one pass.
+ * Until cmos_cache_commit() is called, cmos_read_byte() and
+ * cmos_write_byte() only work on this snapshot, so a series of bit-level
+ * writes and a checksum update cost no further I/O.  The I/O privilege
+ * level of the currently executing process must be set appropriately.
+ ****************************************************************************/
+void cmos_cache_begin(void)
+{
+	unsigned i;
+
+	assert(!cmos_cache.active);
+
+	for (i = CMOS_RTC_AREA_SIZE; i < CMOS_SIZE; i++)
+		cmos_cache.data[i] = current_access->read(i);
+
+	memcpy(cmos_cache.saved, cmos_cache.data, CMOS_SIZE);
+	cmos_cache.active = 1;
+}
+
+/****************************************************************************
+ * cmos_cache_commit
+ *
+ * Write the bytes changed since cmos_cache_begin() back to CMOS memory and
+ * go back to accessing it directly.  Return the number of bytes written.
+ ****************************************************************************/
+unsigned cmos_cache_commit(void)
+{
+	unsigned i, n = 0;
+
+	assert(cmos_cache.active);
+	cmos_cache.active = 0;
+
+	for (i = CMOS_RTC_AREA_SIZE; i < CMOS_SIZE; i++) {
+		if (cmos_cache.data[i] == cmos_cache.saved[i])
+			continue;
+
+		current_access->write(i, cmos_cache.data[i]);
+		n++;
+	}
+
+	return n;
+}
+
 /****************************************************************************
  * cmos_read_all
  *
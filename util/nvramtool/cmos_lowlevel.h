@@ -54,6 +54,8 @@ unsigned char cmos_read_byte(unsigned index);
 void cmos_write_byte(unsigned index, unsigned char value);
 void cmos_read_all(unsigned char data[]);
 void cmos_write_all(unsigned char data[]);
+void cmos_cache_begin(void);
+unsigned cmos_cache_commit(void);
 void set_iopl(int level);
 int verify_cmos_op(unsigned bit, unsigned length, cmos_entry_config_t config);
 
@@ -159,6 +159,7 @@ void do_cmos_writes(cmos_write_t * list)
 	cmos_write_t *item;
 
 	set_iopl(3);
+	cmos_cache_begin();
 
 	while (list != NULL) {
 		cmos_entry_t e;
@@ -172,6 +173,7 @@ void do_cmos_writes(cmos_write_t * list)
 	}
 
 	cmos_checksum_write(cmos_checksum_compute());
+	cmos_cache_commit();
 	set_iopl(0);
 }
 
@@ -1406,6 +1406,7 @@ static void print_dominance_frontiers(struct compile_state *state,
 #define COMPILER_SIMPLIFY_LOGICAL          0x00004000
 #define COMPILER_SIMPLIFY_BITFIELD         0x00008000
 
+#define COMPILER_TIME_PASSES               0x20000000
 #define COMPILER_TRIGRAPHS                 0x40000000
 #define COMPILER_PP_ONLY                   0x80000000
 
@@ -1605,6 +1606,7 @@ static const struct compiler_flag romcc_flags[] = {
 	{ "simplify-bitwise",          COMPILER_SIMPLIFY_BITWISE },
 	{ "simplify-logical",          COMPILER_SIMPLIFY_LOGICAL },
 	{ "simplify-bitfield",         COMPILER_SIMPLIFY_BITFIELD },
+	{ "time-passes",               COMPILER_TIME_PASSES },
 	{ 0, 0 },
 };
 static const struct compiler_arg romcc_args[] = {
@@ -1716,6 +1718,7 @@ static void compiler_usage(FILE *fp)
 	flag_usage(fp, romcc_debug_flags, "-fdebug-", "-fno-debug-");
 	fprintf(fp, "-flabel-prefix=<prefix for assembly language labels>\n");
 	fprintf(fp, "--label-prefix=<prefix for assembly language labels>\n");
+	fprintf(fp, "--time-passes         Same as -ftime-passes\n");
 	fprintf(fp, "-I<include path>\n");
 	fprintf(fp, "-D<macro>[=defn]\n");
 	fprintf(fp, "-U<macro>\n");
@@ -17606,25 +17609,60 @@ static struct reg_block *compute_variable_lifetimes(
 	struct compile_state *state, struct basic_blocks *bb)
 {
 	struct reg_block *blocks;
-	int change;
+	unsigned *grown, *seen, now;
+	int change, first;
 	blocks = xcmalloc(
 		sizeof(*blocks)*(bb->last_vertex + 1), "reg_block");
 	initialize_regblock(blocks, bb->last_block, 0);
+	/* Time stamps of when each block's input set last grew and
+	 * when each block last read its successors' input sets.
+	 */
+	grown = xcmalloc(sizeof(*grown)*(bb->last_vertex + 1), "grown");
+	seen  = xcmalloc(sizeof(*seen)*(bb->last_vertex + 1), "seen");
+	now = 0;
+	first = 1;
 	do {
 		int i;
 		change = 0;
 		for(i = 1; i <= bb->last_vertex; i++) {
 			struct block_set *edge;
 			struct reg_block *rb;
+			int block_change;
 			rb = &blocks[i];
+			/* Nothing can be added unless a successor's input set
+			 * grew since this block last looked.  Skipping such blocks
+			 * leaves the sets, and their order, exactly as a full
+			 * sweep would.
+			 */
+			if (!first) {
+				for(edge = rb->block->edges; edge; edge = edge->next) {
+					if (grown[edge->member->vertex] > seen[i]) {
+						break;
+					}
+				}
+				if (!edge) {
+					continue;
+				}
+			}
+			seen[i] = ++now;
+			block_change = 0;
 			/* Add the all successor's input set to in */
 			for(edge = rb->block->edges; edge; edge = edge->next) {
-				change |= reg_in(state, blocks, rb, edge->member);
+				block_change |= reg_in(state, blocks, rb, edge->member);
+			}
+			/* Add use to in, it only depends on the block itself */
+			if (first) {
+				block_change |= use_in(state, rb);
 			}
-			/* Add use to in... */
-			change |= use_in(state, rb);
+			if (block_change) {
+				grown[i] = ++now;
+			}
+			change |= block_change;
 		}
+		first = 0;
 	} while(change);
+	xfree(grown);
+	xfree(seen);
 	return blocks;
 }
 
@@ -18195,6 +18233,7 @@ struct live_range_def {
 	unsigned orig_id;
 };
 
+/* Initial size of the interference edge hash, it grows with the graph. */
 #define LRE_HASH_SIZE 2048
 struct lre_hash {
 	struct lre_hash *next;
@@ -18204,7 +18243,8 @@ struct lre_hash {
 
 
 struct reg_state {
-	struct lre_hash *hash[LRE_HASH_SIZE];
+	struct lre_hash **hash;
+	unsigned hash_size, hash_count;
 	struct reg_block *blocks;
 	struct live_range_def *lrd;
 	struct live_range *lr;
@@ -18413,25 +18453,16 @@ static void reg_inc_used(struct compile_state *state, char *used, int reg)
 	return;
 }
 
-static unsigned int hash_live_edge(
+static unsigned int hash_live_edge(struct reg_state *rstate,
 	struct live_range *left, struct live_range *right)
 {
-	unsigned int hash, val;
-	unsigned long lval, rval;
-	lval = ((unsigned long)left)/sizeof(struct live_range);
-	rval = ((unsigned long)right)/sizeof(struct live_range);
-	hash = 0;
-	while(lval) {
-		val = lval & 0xff;
-		lval >>= 8;
-		hash = (hash *263) + val;
-	}
-	while(rval) {
-		val = rval & 0xff;
-		rval >>= 8;
-		hash = (hash *263) + val;
-	}
-	hash = hash & (LRE_HASH_SIZE - 1);
+	unsigned int hash;
+	/* Live ranges all live in rstate->lr so their indices are dense. */
+	hash = (left - rstate->lr) * 0x9e3779b1;
+	hash ^= (right - rstate->lr);
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 16;
+	hash = hash & (rstate->hash_size - 1);
 	return hash;
 }
 
@@ -18440,6 +18471,9 @@ static struct lre_hash **lre_probe(struct reg_state *rstate,
 {
 	struct lre_hash **ptr;
 	unsigned int index;
+	if (!rstate->hash) {
+		return 0;
+	}
 	/* Ensure left <= right */
 	if (left > right) {
 		struct live_range *tmp;
@@ -18447,7 +18481,7 @@ static struct lre_hash **lre_probe(struct reg_state *rstate,
 		left = right;
 		right = tmp;
 	}
-	index = hash_live_edge(left, right);
+	index = hash_live_edge(rstate, left, right);
 
 	ptr = &rstate->hash[index];
 	while(*ptr) {
@@ -18459,6 +18493,30 @@ static struct lre_hash **lre_probe(struct reg_state *rstate,
 	return ptr;
 }
 
+/* Keep the hash chains short as the interference graph grows. */
+static void grow_live_edge_hash(struct reg_state *rstate)
+{
+	struct lre_hash **old_hash, *entry, *next;
+	unsigned old_size, i;
+	old_hash = rstate->hash;
+	old_size = rstate->hash_size;
+	rstate->hash_size = old_size ? old_size * 2 : LRE_HASH_SIZE;
+	rstate->hash = xcmalloc(sizeof(rstate->hash[0]) * rstate->hash_size,
+		"lre_hash table");
+	for(i = 0; i < old_size; i++) {
+		for(entry = old_hash[i]; entry; entry = next) {
+			unsigned int index;
+			next = entry->next;
+			index = hash_live_edge(rstate, entry->left, entry->right);
+			entry->next = rstate->hash[index];
+			rstate->hash[index] = entry;
+		}
+	}
+	if (old_hash) {
+		xfree(old_hash);
+	}
+}
+
 static int interfere(struct reg_state *rstate,
 	struct live_range *left, struct live_range *right)
 {
@@ -18487,6 +18545,9 @@ static void add_live_edge(struct reg_state *rstate,
 		left = right;
 		right = tmp;
 	}
+	if (rstate->hash_count >= rstate->hash_size) {
+		grow_live_edge_hash(rstate);
+	}
 	ptr = lre_probe(rstate, left, right);
 	if (*ptr) {
 		return;
@@ -18500,6 +18561,7 @@ static void add_live_edge(struct reg_state *rstate,
 	new_hash->left  = left;
 	new_hash->right = right;
 	*ptr = new_hash;
+	rstate->hash_count++;
 
 	edge = xmalloc(sizeof(*edge), "live_range_edge");
 	edge->next   = left->edges;
@@ -18526,6 +18588,7 @@ static void remove_live_edge(struct reg_state *rstate,
 	entry = *hptr;
 	*hptr = entry->next;
 	xfree(entry);
+	rstate->hash_count--;
 
 	for(ptr = &left->edges; *ptr; ptr = &(*ptr)->next) {
 		edge = *ptr;
@@ -20045,6 +20108,12 @@ static void cleanup_live_edges(struct reg_state *rstate)
 static void cleanup_rstate(struct compile_state *state, struct reg_state *rstate)
 {
 	cleanup_live_edges(rstate);
+	if (rstate->hash) {
+		xfree(rstate->hash);
+	}
+	rstate->hash = 0;
+	rstate->hash_size = 0;
+	rstate->hash_count = 0;
 	xfree(rstate->lrd);
 	xfree(rstate->lr);
 
@@ -21570,10 +21639,70 @@ static void verify_consistency(struct compile_state *state)
 static void verify_consistency(struct compile_state *state) {}
 #endif /* DEBUG_CONSISTENCY */
 
+/* Time spent in each compiler pass, for -ftime-passes. */
+#define MAX_PASS_TIMES 32
+static struct pass_time {
+	const char *name;
+	clock_t ticks;
+	unsigned calls;
+} pass_times[MAX_PASS_TIMES];
+static clock_t pass_start;
+
+static void start_pass_timer(void)
+{
+	pass_start = clock();
+}
+
+/* Charge the time since the last call to the pass name. */
+static void time_pass(struct compile_state *state, const char *name)
+{
+	clock_t now;
+	int i;
+	if (!(state->compiler->flags & COMPILER_TIME_PASSES)) {
+		return;
+	}
+	now = clock();
+	for(i = 0; i < MAX_PASS_TIMES; i++) {
+		if (!pass_times[i].name || (strcmp(pass_times[i].name, name) == 0)) {
+			break;
+		}
+	}
+	if (i < MAX_PASS_TIMES) {
+		pass_times[i].name = name;
+		pass_times[i].ticks += now - pass_start;
+		pass_times[i].calls += 1;
+	}
+	pass_start = clock();
+}
+
+static void print_pass_times(struct compile_state *state)
+{
+	clock_t total;
+	int i;
+	if (!(state->compiler->flags & COMPILER_TIME_PASSES)) {
+		return;
+	}
+	total = 0;
+	for(i = 0; (i < MAX_PASS_TIMES) && pass_times[i].name; i++) {
+		total += pass_times[i].ticks;
+	}
+	fprintf(state->errout, "%-32s %5s %10s %6s\n",
+		"pass", "calls", "seconds", "%");
+	for(i = 0; (i < MAX_PASS_TIMES) && pass_times[i].name; i++) {
+		fprintf(state->errout, "%-32s %5u %10.3f %6.1f\n",
+			pass_times[i].name, pass_times[i].calls,
+			(double)pass_times[i].ticks / CLOCKS_PER_SEC,
+			total ? (100.0 * pass_times[i].ticks) / total : 0.0);
+	}
+	fprintf(state->errout, "%-32s %5s %10.3f\n", "total", "",
+		(double)total / CLOCKS_PER_SEC);
+}
+
 static void optimize(struct compile_state *state)
 {
 	/* Join all of the functions into one giant function */
 	join_functions(state);
+	time_pass(state, "join functions");
 
 	/* Dump what the instruction graph intially looks like */
 	print_triples(state);
@@ -21581,11 +21710,14 @@ static void optimize(struct compile_state *state)
 	/* Replace structures with simpler data types */
 	decompose_compound_types(state);
 	print_triples(state);
+	time_pass(state, "decompose compound types");
 
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 	/* Analyze the intermediate code */
 	state->bb.first = state->first;
 	analyze_basic_blocks(state, &state->bb);
+	time_pass(state, "analyze basic blocks");
 
 	/* Transform the code to ssa form. */
 	/*
@@ -21597,18 +21729,26 @@ static void optimize(struct compile_state *state)
 	 * phi functions early and I kill them often.
 	 */
 	transform_to_ssa_form(state);
+	time_pass(state, "transform to ssa form");
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 
 	/* Remove dead code */
 	eliminate_inefectual_code(state);
+	time_pass(state, "eliminate dead code");
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 
 	/* Do strength reduction and simple constant optimizations */
 	simplify_all(state);
+	time_pass(state, "simplify");
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 	/* Propogate constants throughout the code */
 	scc_transform(state);
+	time_pass(state, "scc transform");
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 #if DEBUG_ROMCC_WARNINGS
 #warning "WISHLIST implement single use constants (least possible register pressure)"
 #warning "WISHLIST implement induction variable elimination"
@@ -21617,26 +21757,37 @@ static void optimize(struct compile_state *state)
 	 * coloring based on architecture constraints.
 	 */
 	transform_to_arch_instructions(state);
+	time_pass(state, "select instructions");
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 
 	/* Remove dead code */
 	eliminate_inefectual_code(state);
+	time_pass(state, "eliminate dead code");
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 
 	/* Color all of the variables to see if they will fit in registers */
 	insert_copies_to_phi(state);
+	time_pass(state, "insert copies to phi");
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 
 	insert_mandatory_copies(state);
+	time_pass(state, "insert mandatory copies");
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 
 	allocate_registers(state);
+	time_pass(state, "allocate registers");
 	verify_consistency(state);
+	time_pass(state, "verify consistency");
 
 	/* Remove the optimization information.
 	 * This is more to check for memory consistency than to free memory.
 	 */
 	free_basic_blocks(state, &state->bb);
+	time_pass(state, "free basic blocks");
 }
 
 static void print_op_asm(struct compile_state *state,
@@ -25010,6 +25161,8 @@ static void compile(const char *filename,
 	state.global_pool->id |= TRIPLE_FLAG_VOLATILE;
 	flatten(&state, state.first, state.global_pool);
 
+	start_pass_timer();
+
 	/* Enter the globl definition scope */
 	start_scope(&state);
 	register_builtins(&state);
@@ -25031,6 +25184,7 @@ static void compile(const char *filename,
 
 	/* Exit the global definition scope */
 	end_scope(&state);
+	time_pass(&state, "parse");
 
 	/* Now that basic compilation has happened
 	 * optimize the intermediate code
@@ -25038,6 +25192,8 @@ static void compile(const char *filename,
 	optimize(&state);
 
 	generate_code(&state);
+	time_pass(&state, "generate code");
+	print_pass_times(&state);
 	if (state.compiler->debug) {
 		fprintf(state.errout, "done\n");
 	}
@@ -25129,6 +25285,9 @@ int main(int argc, char **argv)
 			else if (strncmp(argv[1], "--label-prefix=", 15) == 0) {
 				result = compiler_encode_flag(&compiler, argv[1]+2);
 			}
+			else if (strcmp(argv[1], "--time-passes") == 0) {
+				result = compiler_encode_flag(&compiler, argv[1]+2);
+			}
 			else if (strncmp(argv[1], "-f", 2) == 0) {
 				result = compiler_encode_flag(&compiler, argv[1]+2);
 			}
@@ -388,6 +388,71 @@ void add_ioapic_info(struct device *dev, int apicid, const char *_srcpin, int ir
 	dev->pci_irq_info[srcpin].ioapic_dst_id = apicid;
 }
 
+/*
+ * The DEV_INDEX_PATH chains of the static devices, in all_devices order.
+ * The keys and the hash have to match dev_path_key() and dev_index_hash()
+ * in coreboot.
+ */
+#define DEV_INDEX_BITS	6
+#define DEV_INDEX_SIZE	(1 << DEV_INDEX_BITS)
+
+static struct device *path_index[DEV_INDEX_SIZE];
+
+static int path_key(struct device *d, unsigned int *key)
+{
+	switch (d->bustype) {
+	case PCI:
+		*key = (((d->path_a & 0x1f) << 3) | (d->path_b & 7)) << 16;
+		return 1;
+	case PNP:
+		*key = d->path_a << 16 ^ d->path_b;
+		return 1;
+	case I2C:
+	case APIC:
+		*key = d->path_a << 16;
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static void index_devices(void)
+{
+	struct device *tail[DEV_INDEX_SIZE] = { 0 };
+	struct device *d;
+	unsigned int key, bucket;
+	int seq = 0;
+
+	for (d = &root; d; d = d->nextdev) {
+		d->seq = seq++;
+		if (!path_key(d, &key))
+			continue;
+
+		bucket = (key * 0x9e3779b1u) >> (32 - DEV_INDEX_BITS);
+		d->index_slot = bucket + 1;
+		if (tail[bucket])
+			tail[bucket]->index_next = d;
+		else
+			path_index[bucket] = d;
+		tail[bucket] = d;
+	}
+}
+
+static void write_path_index(FILE *fil)
+{
+	int i;
+
+	fprintf(fil, "\n#ifndef __PRE_RAM__\n");
+	fprintf(fil, "struct device *dev_index[DEV_INDEX_COUNT][DEV_INDEX_SIZE] = {\n");
+	fprintf(fil, "\t[DEV_INDEX_PATH] = {\n");
+	for (i = 0; i < DEV_INDEX_SIZE; i++)
+		if (path_index[i])
+			fprintf(fil, "\t\t[%d] = &%s,\n", i, path_index[i]->name);
+	fprintf(fil, "\t},\n");
+	fprintf(fil, "};\n");
+	fprintf(fil, "#endif\n");
+}
+
 static void pass0(FILE *fil, struct device *ptr) {
 	if (ptr->type == device && ptr->id == 0)
 		fprintf(fil, "ROMSTAGE_CONST struct bus %s_links[];\n", ptr->name);
@@ -445,6 +510,11 @@ static void pass1(FILE *fil, struct device *ptr)
 		fprintf(fil, "\t.chip_ops = &%s_ops,\n", ptr->chip->name_underscore);
 		if (ptr->chip->chip == &mainboard)
 			fprintf(fil, "\t.name = mainboard_name,\n");
+		fprintf(fil, "\t.seq = %d,\n", ptr->seq);
+		if (ptr->index_slot)
+			fprintf(fil, "\t.index_slot[DEV_INDEX_PATH] = %d,\n", ptr->index_slot);
+		if (ptr->index_next)
+			fprintf(fil, "\t.index_next[DEV_INDEX_PATH] = &%s,\n", ptr->index_next->name);
 		fprintf(fil, "#endif\n");
 		if (ptr->chip->chiph_exists)
 			fprintf(fil, "\t.chip_info = &%s_info_%d,\n", ptr->chip->name_underscore, ptr->chip->id);
@@ -660,6 +730,7 @@ int main(int argc, char** argv) {
 		fprintf(autogen, "#endif\n");
 
 		walk_device_tree(autogen, &root, inherit_subsystem_ids, NULL);
+		index_devices();
 		fprintf(autogen, "\n/* pass 0 */\n");
 		walk_device_tree(autogen, &root, pass0, NULL);
 		fprintf(autogen, "\n/* pass 1 */\n"
@@ -668,6 +739,7 @@ int main(int argc, char** argv) {
 		fprintf(autogen, "static ROMSTAGE_CONST struct mainboard_config ROMSTAGE_CONST mainboard_info_0;\n");
 #endif
 		walk_device_tree(autogen, &root, pass1, NULL);
+		write_path_index(autogen);
 
 	} else if (scan_mode == BOOTBLOCK_MODE) {
 		h = &headers;
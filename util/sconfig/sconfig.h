@@ -66,6 +66,9 @@ struct device {
 	int path_a;
 	int path_b;
 	int bustype;
+	int seq;
+	int index_slot;
+	struct device *index_next;
 	struct pci_irq_info pci_irq_info[4];
 	enum devtype type;
 	struct device *parent;